@@ -18,12 +18,60 @@ __OppServe = false
 
 __OPPSIDE = opponent(__SIDE)
 
+-- the game copies the state of the match into the array __MATCH before every step. The
+-- functions below replace the ones of the game with the same name, so reading the state
+-- needs no calls into the game. The slots are defined in ScriptedInputSource.h:
+--   1-4 ball x, y, vx, vy   5 ball valid   6 game running   7 serving player
+--   8-9 score by side   10-11 touches by side   12 + 4*player blob x, y, vx, vy
+local match = __MATCH
+
+function get_ball_pos()
+	return match[1], match[2]
+end
+
+function get_ball_vel()
+	return match[3], match[4]
+end
+
+function get_blob_pos( player )
+	local slot = 12 + 4 * player
+	return match[slot], match[slot + 1]
+end
+
+function get_blob_vel( player )
+	local slot = 14 + 4 * player
+	return match[slot], match[slot + 1]
+end
+
+function get_score( player )
+	return match[8 + player % 2]
+end
+
+function get_touches( player )
+	return match[10 + player % 2]
+end
+
+function is_ball_valid()
+	return match[5]
+end
+
+function is_game_running()
+	return match[6]
+end
+
+function get_serving_player()
+	return match[7]
+end
+
+local __SIDE_SLOT = 12 + 4 * __SIDE
+local __OPPSIDE_SLOT = 12 + 4 * __OPPSIDE
+
 -- legacy functions
 -- these function definitions make lua functions for the old api functions, which are sometimes more conveniente to use 
 -- than their c api equivalent.
 
 function posx()
-	local x, y = get_blob_pos( __SIDE )
+	local x = match[__SIDE_SLOT]
 	if __SIDE == RIGHT_PLAYER then
 		return CONST_FIELD_WIDTH - x
 	else
@@ -32,12 +80,11 @@ function posx()
 end
 
 function posy()
-	local x, y = get_blob_pos( __SIDE )
-	return y
+	return match[__SIDE_SLOT + 1]
 end
 
 function touches()
-	return get_touches( __SIDE )
+	return match[10 + __SIDE % 2]
 end
 
 -- redefine the ball coordinate functions to use the cached values
@@ -57,11 +104,9 @@ function bspeedy()
 	return __bvy
 end
 
--- we need to save balldata somewhere to use it in here
-__balldata__ = balldata
 -- this is the internal function that does the side correction
 function __balldata()
-	local x, y, vx, vy = __balldata__()
+	local x, y, vx, vy = match[1], match[2], match[3], match[4]
 	if __SIDE == RIGHT_PLAYER then
 		x = CONST_FIELD_WIDTH - x
 		vx = -vx
@@ -113,7 +158,7 @@ function moveto(target)
 end
 
 function oppx()
-	local x, y = get_blob_pos( __OPPSIDE )
+	local x = match[__OPPSIDE_SLOT]
 	if __SIDE == RIGHT_PLAYER then
 		return CONST_FIELD_WIDTH - x
 	else
@@ -122,8 +167,7 @@ function oppx()
 end
 
 function oppy()
-	local x, y = get_blob_pos( __OPPSIDE )
-	return y
+	return match[__OPPSIDE_SLOT + 1]
 end
 
 function getScore()
@@ -199,7 +243,6 @@ function estimate(time, posx, posy, velx, vely)
 	posy = posy or bally()
 	vely = vely or bspeedy()
 
-	__PERF_ESTIMATE_COUNTER = __PERF_ESTIMATE_COUNTER + 1
 	return simulate( time, posx, posy, velx, vely )
 end
 
@@ -246,12 +289,15 @@ end
 
 ---------------------------------------------------------------------------------------------
 
--- this function is called every game step from the C++ api
+-- this function is called every game step from the C++ api.
+-- it returns the wanted input (left, right, jump) that the action functions set.
 __lastBallSpeed = nil
 function __OnStep()
 	ActiveMode = "game"
+	__WANT_LEFT = false
+	__WANT_RIGHT = false
+	__WANT_JUMP = false
 
-	__PERF_ESTIMATE_COUNTER = 0 -- count the calls to estimate!
 	__bx, __by, __bvx, __bvy = __balldata()
 	local original_bvx = __bvx
 	-- add some random noise to the ball info, if we have difficulty enabled
@@ -330,7 +376,7 @@ function __OnStep()
 		OnGame()
 	end
 	
-	--print(__PERF_ESTIMATE_COUNTER)
+	return __WANT_LEFT, __WANT_RIGHT, __WANT_JUMP
 end
 
 -----------------------------------------------------------------------------------------------
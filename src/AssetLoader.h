@@ -0,0 +1,215 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+/*! \class AssetLoader
+	\brief decodes assets on worker threads
+	\details preload() queues files which a few worker threads then read and decode in
+			the background. take() hands out a decoded asset, waiting for it if a worker is
+			still busy with it. Files which were never queued, or which no worker has started
+			yet, are decoded by the calling thread, so take() never waits for other files.
+			Only the decoding runs on the workers. Textures and audio buffers are created by
+			the thread which takes the asset.
+			Each asset is handed out once, and afterwards preload() skips that file. Assets
+			which were decoded but never taken are freed by the destructor.
+*/
+template<class Asset>
+class AssetLoader : private boost::noncopyable
+{
+	public:
+		/// reads and decodes a file, throws if that fails
+		typedef std::function<Asset(const std::string& filename)> Decoder;
+		/// frees an asset which was not taken
+		typedef std::function<void(Asset asset)> Deleter;
+
+		AssetLoader(Decoder decoder, Deleter deleter) : mDecoder(decoder), mDeleter(deleter), mWorkerCount(0)
+		{
+		}
+
+		~AssetLoader()
+		{
+			std::vector<std::future<void>> workers;
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				for (const std::string& filename : mQueue)
+					mAssets.erase(filename);
+				mQueue.clear();
+				workers.swap(mWorkers);
+			}
+			for (auto& worker : workers)
+				worker.wait();
+
+			for (auto& asset : mAssets)
+			{
+				try
+				{
+					mDeleter(asset.second.result.get());
+				}
+				catch (const std::exception&)
+				{
+				}
+			}
+		}
+
+		/// queues files for decoding. Files which are queued already, or were taken, are skipped
+		void preload(const std::vector<std::string>& filenames)
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			for (const std::string& filename : filenames)
+			{
+				if (mAssets.count(filename) || mTaken.count(filename))
+					continue;
+
+				PendingAsset& asset = mAssets[filename];
+				asset.promise = std::make_shared<std::promise<Asset>>();
+				asset.result = asset.promise->get_future().share();
+				asset.started = false;
+				mQueue.push_back(filename);
+			}
+
+			// forget the workers which are done, start new ones for the queued files
+			mWorkers.erase(std::remove_if(mWorkers.begin(), mWorkers.end(), [](const std::future<void>& worker)
+			{
+				return worker.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+			}), mWorkers.end());
+
+			// a few threads are enough to keep the disk busy
+			const unsigned int MAX_WORKERS = 4;
+			unsigned int maxWorkers = std::max(1u, std::min(MAX_WORKERS, std::thread::hardware_concurrency()));
+			while (mWorkerCount < maxWorkers && mWorkerCount < mQueue.size())
+			{
+				++mWorkerCount;
+				// we need the explicit async launch policy here, see NetworkSearchState::searchServers
+				mWorkers.push_back(std::async(std::launch::async, [this](){ work(); }));
+			}
+		}
+
+		/// true if the file was queued and not taken yet
+		bool isPending(const std::string& filename)
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			return mAssets.count(filename) != 0;
+		}
+
+		/// true if the file was queued and is decoded, so take() will not block
+		bool isReady(const std::string& filename)
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			auto asset = mAssets.find(filename);
+			return asset != mAssets.end() && asset->second.started &&
+				asset->second.result.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+		}
+
+		/// \brief gets a decoded asset
+		/// \details the caller becomes the owner of the asset. Errors of the decoder are
+		///		rethrown here.
+		Asset take(const std::string& filename)
+		{
+			std::shared_future<Asset> result;
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mTaken.insert(filename);
+				auto asset = mAssets.find(filename);
+				if (asset != mAssets.end())
+				{
+					if (asset->second.started)
+						result = asset->second.result;
+					else
+						mQueue.erase(std::find(mQueue.begin(), mQueue.end(), filename));
+					mAssets.erase(asset);
+				}
+			}
+
+			if (result.valid())
+				return result.get();
+
+			return mDecoder(filename);
+		}
+
+	private:
+		struct PendingAsset
+		{
+			// shared with the worker, which may still hold it after the asset was taken
+			std::shared_ptr<std::promise<Asset>> promise;
+			std::shared_future<Asset> result;
+			bool started;
+		};
+
+		void work()
+		{
+			while (true)
+			{
+				std::string filename;
+				std::shared_ptr<std::promise<Asset>> promise;
+				{
+					std::lock_guard<std::mutex> lock(mMutex);
+					if (mQueue.empty())
+					{
+						--mWorkerCount;
+						return;
+					}
+					filename = mQueue.front();
+					mQueue.pop_front();
+					PendingAsset& asset = mAssets[filename];
+					asset.started = true;
+					promise = asset.promise;
+				}
+
+				try
+				{
+					promise->set_value(mDecoder(filename));
+				}
+				catch (...)
+				{
+					promise->set_exception(std::current_exception());
+				}
+			}
+		}
+
+		Decoder mDecoder;
+		Deleter mDeleter;
+
+		std::mutex mMutex;
+		/// files which no worker has started yet
+		std::deque<std::string> mQueue;
+		/// files which are queued, being decoded or decoded
+		std::map<std::string, PendingAsset> mAssets;
+		/// files which were handed out
+		std::set<std::string> mTaken;
+		std::vector<std::future<void>> mWorkers;
+		unsigned int mWorkerCount;
+};
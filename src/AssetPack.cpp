@@ -0,0 +1,203 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+/* header include */
+#include "AssetPack.h"
+
+/* includes */
+#include <cstring>
+#include <iostream>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "FileSystem.h"
+
+/* implementation */
+const char AssetPack::MAGIC[8] = {'B', 'V', 'P', 'A', 'C', 'K', '\r', '\n'};
+
+AssetPack::AssetPack(const std::string& filename)
+{
+	if (filename.empty())
+		return;
+
+	try
+	{
+		boost::interprocess::file_mapping file(filename.c_str(), boost::interprocess::read_only);
+		mRegion.reset(new boost::interprocess::mapped_region(file, boost::interprocess::read_only));
+	}
+	catch (const boost::interprocess::interprocess_exception&)
+	{
+		// e.g. the pack is inside an archive
+		return;
+	}
+
+	const char* data = (const char*)mRegion->get_address();
+	std::size_t size = mRegion->get_size();
+	const Header* header = (const Header*)data;
+	if (size < sizeof(Header) || memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION
+			|| header->entryCount > (size - sizeof(Header)) / sizeof(Entry))
+	{
+		std::cerr << "Warning: ignoring outdated asset pack " << filename << std::endl;
+		mRegion.reset();
+		return;
+	}
+
+	const Entry* entries = (const Entry*)(data + sizeof(Header));
+	for (unsigned int i = 0; i < header->entryCount; ++i)
+	{
+		const Entry& entry = entries[i];
+		if (entry.offset > size || entry.size > size - entry.offset || entry.name[sizeof(entry.name) - 1] != 0)
+			continue;
+		if ((entry.type == IMAGE || entry.type == SPECULAR) && entry.size != std::uint64_t(entry.width) * entry.height * 4)
+			continue;
+		mEntries[std::make_pair(std::string(entry.name), entry.type)] = &entry;
+	}
+
+	std::string::size_type separator = filename.find_last_of("/\\");
+	mDirectory = filename.substr(0, separator == std::string::npos ? 0 : separator + 1);
+}
+
+AssetPack::~AssetPack()
+{
+}
+
+const AssetPack& AssetPack::getSingleton()
+{
+	static AssetPack pack(FileSystem::getSingleton().getRealPath("assets.pack"));
+	return pack;
+}
+
+const AssetPack::Entry* AssetPack::find(const std::string& filename, AssetType type) const
+{
+	auto entry = mEntries.find(std::make_pair(filename, (std::uint32_t)type));
+	if (entry == mEntries.end())
+		return 0;
+
+	// a file with the same name in another directory, e.g. the user directory, replaces the packed one
+	std::string path = FileSystem::getSingleton().getRealPath(filename);
+	if (path.compare(0, mDirectory.size(), mDirectory) != 0)
+		return 0;
+
+	// the pack is not rebuilt when only the data files are replaced
+	if (!isCurrent(filename, *entry->second))
+		return 0;
+
+	return entry->second;
+}
+
+bool AssetPack::isCurrent(const std::string& filename, const Entry& entry) const
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		auto current = mCurrent.find(filename);
+		if (current != mCurrent.end())
+			return current->second;
+	}
+
+	// only the directory entry is read, so this is cheap enough for the main thread
+	bool current = false;
+	try
+	{
+		current = FileSystem::getSingleton().getFileSize(filename) == entry.sourceSize;
+	}
+	catch (const std::exception&)
+	{
+	}
+
+	if (!current)
+		std::cerr << "Warning: " << filename << " has changed, the asset pack is outdated" << std::endl;
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	mCurrent[filename] = current;
+	return current;
+}
+
+bool AssetPack::hasImage(const std::string& filename) const
+{
+	return find(filename, IMAGE) != 0;
+}
+
+SDL_Surface* AssetPack::getImage(const std::string& filename, bool specular) const
+{
+	const Entry* entry = find(filename, specular ? SPECULAR : IMAGE);
+	if (!entry)
+		return 0;
+
+	// SDL does not write to the pixels of a surface unless it is the target of a blit
+	char* pixels = (char*)mRegion->get_address() + entry->offset;
+	return SDL_CreateRGBSurfaceFrom(pixels, entry->width, entry->height, 32, entry->width * 4,
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+			0xff000000, 0x00ff0000, 0x0000ff00, 0x000000ff);
+#else
+			0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000);
+#endif
+}
+
+const Uint8* AssetPack::getSound(const std::string& filename, const SDL_AudioSpec& spec, Uint32& length) const
+{
+	const Entry* entry = find(filename, SOUND);
+	if (!entry || entry->width != (std::uint32_t)spec.freq || entry->height != spec.channels || entry->format != spec.format)
+		return 0;
+
+	length = Uint32(entry->size);
+	return (const Uint8*)mRegion->get_address() + entry->offset;
+}
+
+void AssetPack::copyImage(SDL_Surface* image, SDL_Surface* target, SDL_Rect* rect)
+{
+	if (image->format->Amask)
+		SDL_SetSurfaceBlendMode(image, SDL_BLENDMODE_NONE);
+	else
+		SDL_SetColorKey(image, SDL_TRUE, SDL_MapRGB(image->format, 0, 0, 0));
+	SDL_BlitSurface(image, 0, target, rect);
+}
+
+SDL_Surface* AssetPack::convertImage(SDL_Surface* image)
+{
+	SDL_Surface* converted =
+		SDL_CreateRGBSurface(SDL_SWSURFACE,
+			image->w, image->h, 32,
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+			0xff000000, 0x00ff0000, 0x0000ff00, 0x000000ff);
+#else
+			0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000);
+#endif
+	copyImage(image, converted, 0);
+	return converted;
+}
+
+void AssetPack::makeSpecular(SDL_Surface* surface)
+{
+	for (int y = 0; y < surface->h; ++y)
+	{
+		SDL_Color* row = (SDL_Color*)((Uint8*)surface->pixels + y * surface->pitch);
+		for (int x = 0; x < surface->w; ++x)
+		{
+			SDL_Color* pixel = &row[x];
+			int luminance = int(pixel->r) * 5 - 4 * 256 - 138;
+			luminance = luminance > 0 ? luminance : 0;
+			luminance = luminance < 255 ? luminance : 255;
+			pixel->r = luminance;
+			pixel->g = luminance;
+			pixel->b = luminance;
+		}
+	}
+}
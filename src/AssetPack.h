@@ -0,0 +1,131 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include <boost/noncopyable.hpp>
+#include <SDL2/SDL.h>
+
+namespace boost { namespace interprocess { class mapped_region; } }
+
+/*! \class AssetPack
+	\brief images and sounds which were converted when the game was built
+	\details blobby-asset-pack converts the images of the game to RGBA pixels, in which
+			black is transparent, computes the specular maps of the blobs and converts the
+			sounds to the format of the audio device. The pack is memory mapped, so the
+			render managers upload the pixels directly from the file.
+			A packed asset is only used if its source file is found next to the pack, so images
+			and sounds in the user directory still replace the packed ones. The build creates the
+			pack again whenever a source file changes; at runtime only the file size is compared,
+			which needs no reading, to catch files that were replaced in the installation.
+			If there is no pack, or it is outdated, the assets are converted when they are loaded,
+			with the same functions blobby-asset-pack uses.
+			The pack is written in the byte order of the machine which builds the game.
+*/
+class AssetPack : private boost::noncopyable
+{
+	public:
+		static const char MAGIC[8];
+		static const std::uint32_t VERSION = 3;
+
+		enum AssetType
+		{
+			IMAGE = 1,
+			SPECULAR = 2,
+			SOUND = 3
+		};
+
+		struct Header
+		{
+			char magic[8];
+			std::uint32_t version;
+			std::uint32_t entryCount;
+		};
+
+		/// the entries follow the header, the data of each entry is 16 byte aligned
+		struct Entry
+		{
+			char name[64];
+			std::uint32_t type;
+			/// width and height of images, frequency and channels of sounds
+			std::uint32_t width;
+			std::uint32_t height;
+			/// SDL_AudioFormat of sounds
+			std::uint32_t format;
+			/// size of the file the asset was converted from
+			std::uint32_t sourceSize;
+			std::uint32_t reserved;
+			std::uint64_t offset;
+			std::uint64_t size;
+		};
+
+		/// maps the pack, which stays empty if the file can't be opened or has another version
+		explicit AssetPack(const std::string& filename);
+		~AssetPack();
+
+		/// the pack of the game, assets.pack in the search path, opened on first use
+		static const AssetPack& getSingleton();
+
+		/// true if the pack holds an image which can be used instead of the file
+		bool hasImage(const std::string& filename) const;
+
+		/// \brief gets a packed image
+		/// \details the surface references the mapped pixels, which must not be changed.
+		/// \return the surface, or 0 if the image is not packed
+		SDL_Surface* getImage(const std::string& filename, bool specular) const;
+
+		/// \brief gets a packed sound
+		/// \return the samples, or 0 if the sound is not packed in the given format
+		const Uint8* getSound(const std::string& filename, const SDL_AudioSpec& spec, Uint32& length) const;
+
+		// conversions of the packed assets, also used for assets which are not packed
+
+		/// \brief copies an image into an RGBA surface
+		/// \details images with an alpha channel are copied as they are, in all other
+		///		images black is transparent.
+		static void copyImage(SDL_Surface* image, SDL_Surface* target, SDL_Rect* rect);
+
+		/// creates an RGBA copy of an image, see copyImage()
+		static SDL_Surface* convertImage(SDL_Surface* image);
+
+		/// turns the pixels of an RGBA surface into the specular highlight of a blob
+		static void makeSpecular(SDL_Surface* surface);
+
+	private:
+		const Entry* find(const std::string& filename, AssetType type) const;
+		/// true if the source file still has the size stored in the entry
+		bool isCurrent(const std::string& filename, const Entry& entry) const;
+
+		std::unique_ptr<boost::interprocess::mapped_region> mRegion;
+		/// directory of the pack, with trailing separator
+		std::string mDirectory;
+		std::map<std::pair<std::string, std::uint32_t>, const Entry*> mEntries;
+
+		/// results of isCurrent by file name, the images are loaded by several threads
+		mutable std::mutex mMutex;
+		mutable std::map<std::string, bool> mCurrent;
+};
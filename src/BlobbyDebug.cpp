@@ -22,6 +22,14 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <map>
 #include <iostream>
 #include <fstream>
+#include <mutex>
+
+// objects are counted from the server and replay worker threads, too
+std::mutex& GetCounterMutex()
+{
+	static std::mutex CounterMutex;
+	return CounterMutex;
+}
 
 std::map<std::string, CountingReport>& GetCounterMap()
 {
@@ -43,6 +51,7 @@ std::map<std::string, int>& GetProfMap()
 
 int count(const std::type_info& type)
 {
+	std::lock_guard<std::mutex> lock(GetCounterMutex());
 	std::string test = type.name();
 	if(GetCounterMap().find(type.name()) == GetCounterMap().end() )
 	{
@@ -55,16 +64,19 @@ int count(const std::type_info& type)
 
 int uncount(const std::type_info& type)
 {
+	std::lock_guard<std::mutex> lock(GetCounterMutex());
 	return --GetCounterMap()[type.name()].alive;
 }
 
 int getObjectCount(const std::type_info& type)
 {
+	std::lock_guard<std::mutex> lock(GetCounterMutex());
 	return 	GetCounterMap()[type.name()].alive;
 }
 
 int count(const std::type_info& type, std::string tag, int n)
 {
+	std::lock_guard<std::mutex> lock(GetCounterMutex());
 	std::string name = std::string(type.name()) + " - " + tag;
 	if(GetCounterMap().find(name) == GetCounterMap().end() )
 	{
@@ -76,6 +88,7 @@ int count(const std::type_info& type, std::string tag, int n)
 
 int uncount(const std::type_info& type, std::string tag, int n)
 {
+	std::lock_guard<std::mutex> lock(GetCounterMutex());
 	return GetCounterMap()[std::string(type.name()) + " - " + tag].alive -= n;
 }
 
@@ -109,6 +122,8 @@ std::fstream total_plot("logs/total.txt", std::fstream::out);
 
 void report(std::ostream& stream)
 {
+	std::lock_guard<std::mutex> lock(GetCounterMutex());
+
 	stream << "MEMORY REPORT\n";
 	int sum = 0;
 	for(std::map<std::string, CountingReport>::iterator i = GetCounterMap().begin(); i != GetCounterMap().end(); ++i)
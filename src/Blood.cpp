@@ -22,6 +22,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "Blood.h"
 
 /* includes */
+#include <algorithm>
 #include <cstdlib>
 
 #include "RenderManager.h"
@@ -32,38 +33,15 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 BloodManager* BloodManager::mSingleton = NULL;
 
-// Blood class
-// ------------
-
-Blood::Blood(const Vector2& position, const Vector2& direction, int player):
-	mPos(position),
-	mDir(direction),
-	mPlayer(player),
-	mLastFrame(SDL_GetTicks())
-{
-}
-
-void Blood::step()
-{
-	const float GRAVITY = 3;
-	/// \todo this is the only place where we do step-rate independent calculations.
-	///			is this intended behaviour???
-	int diff = SDL_GetTicks() - mLastFrame;
-	RenderManager::getSingleton().drawParticle(mPos, mPlayer);
-	const int SPEED = 45;
-	
-	//this calculation is NOT based on physical rules
-	mDir.y += GRAVITY / SPEED * diff;
-	mPos.x += mDir.x / SPEED * diff;
-	mPos.y += mDir.y / SPEED * diff;
-	mLastFrame = SDL_GetTicks();
-}
-
-// BloodManager class
-// -------------------
-
-
-BloodManager::BloodManager()
+BloodManager::BloodManager() :
+	mPosX(MAX_PARTICLES),
+	mPosY(MAX_PARTICLES),
+	mDirX(MAX_PARTICLES),
+	mDirY(MAX_PARTICLES),
+	mPlayer(MAX_PARTICLES),
+	mParticleCount(0),
+	mLastTicks(0),
+	mPendingTime(0)
 {
 	mEnabled =  IUserConfigReader::createUserConfigReader("config.xml")->getBool("blood");
 }
@@ -71,33 +49,73 @@ BloodManager::BloodManager()
 void BloodManager::step()
 {
 	// don't do any processing if there are no particles
-	if ( !mEnabled || mParticles.empty() )
+	if ( !mEnabled || mParticleCount == 0 )
 		return;
 	
-	// start drawing
-	RenderManager::getSingleton().startDrawParticles();
+	RenderManager& rmanager = RenderManager::getSingleton();
+	rmanager.startDrawParticles();
+	rmanager.drawParticles(mPosX.data(), mPosY.data(), mPlayer.data(), mParticleCount);
+	rmanager.endDrawParticles();
+	
+	// advance the particles in fixed steps. After a long pause, e.g. while the game was
+	// minimised, the missed time is dropped instead of being caught up.
+	unsigned int ticks = SDL_GetTicks();
+	mPendingTime = std::min(mPendingTime + (ticks - mLastTicks), 10 * STEP_TIME);
+	mLastTicks = ticks;
+	for (; mPendingTime >= STEP_TIME; mPendingTime -= STEP_TIME)
+		integrate();
 	
-	// iterate over all particles
-	std::list<Blood>::iterator it = mParticles.begin();
-	while (it != mParticles.end())
+	// delete particles below lower screen border
+	for (int i = 0; i < mParticleCount; )
 	{
-		std::list<Blood>::iterator it2 = it;
-		++it;	
-		it2->step();
-		// delete particles below lower screen border
-		if (it2->getPosition().y > 600)
-			mParticles.erase(it2);
+		if (mPosY[i] > 600)
+			removeParticle(i);
+		else
+			++i;
 	}
+}
+
+void BloodManager::integrate()
+{
+	const float GRAVITY = 3;
+	const float SPEED = 45;
 	
-	// finish drawing
-	RenderManager::getSingleton().endDrawParticles();
+	// plain loops over separate arrays, so the compiler can vectorise them.
+	// this calculation is NOT based on physical rules
+	float* posX = mPosX.data();
+	float* posY = mPosY.data();
+	float* dirX = mDirX.data();
+	float* dirY = mDirY.data();
+	for (int i = 0; i < mParticleCount; ++i)
+	{
+		dirY[i] += GRAVITY / SPEED * STEP_TIME;
+		posX[i] += dirX[i] / SPEED * STEP_TIME;
+		posY[i] += dirY[i] / SPEED * STEP_TIME;
+	}
+}
+
+void BloodManager::removeParticle(int index)
+{
+	int last = --mParticleCount;
+	mPosX[index] = mPosX[last];
+	mPosY[index] = mPosY[last];
+	mDirX[index] = mDirX[last];
+	mDirY[index] = mDirY[last];
+	mPlayer[index] = mPlayer[last];
 }
 
 void BloodManager::spillBlood(Vector2 pos, float intensity, int player)
 {
+	// the time steps start when the first particle appears
+	if (mParticleCount == 0)
+	{
+		mLastTicks = SDL_GetTicks();
+		mPendingTime = 0;
+	}
+	
 	const double EL_X_AXIS = 30;
 	const double EL_Y_AXIS = 50;
-	for (int c = 0; c <= int(intensity*50); c++)
+	for (int c = 0; c <= int(intensity*50) && mParticleCount < MAX_PARTICLES; c++)
 	{
 		/// \todo maybe we can find a better algorithm, but for now,
 		///		we just discard particles outside the ellipses
@@ -108,7 +126,12 @@ void BloodManager::spillBlood(Vector2 pos, float intensity, int player)
 		if( ( y * y / (EL_Y_AXIS * EL_Y_AXIS) + x * x / (EL_X_AXIS * EL_X_AXIS) ) > intensity * intensity)
 			continue;
 		
-		mParticles.push_front( Blood(pos, Vector2(x, y), player) );
+		int index = mParticleCount++;
+		mPosX[index] = pos.x;
+		mPosY[index] = pos.y;
+		mDirX[index] = x;
+		mDirY[index] = y;
+		mPlayer[index] = player;
 	}
 }
 
@@ -21,41 +21,19 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #pragma once
 
 #include "Vector.h"
-#include <list>
+#include <vector>
 #include <boost/noncopyable.hpp>
 
 //Bleeding blobs can be a lot of fun :)
 
-/*!	\class Blood
-	\brief Container to hold the data of a single drop of blood
-*/
-class Blood
-{
-	public:
-		/// \brief constructor, takes position, direction and player
-		/// \param position Position this drop starts at
-		/// \param direction initial velocity of the drop
-		///	\param player Player this blood drop started from.
-		Blood(const Vector2& position, const Vector2& direction, int player);
-		
-		/// this function has to be called each step
-		/// it updates position and velocity.
-		void step();
-		
-		/// gets the current position of this drop
-		const Vector2& getPosition() const { return mPos; }
-		
-	private:
-		Vector2 mPos;	///< the drops position
-		Vector2 mDir;	///< the drops current velocity
-		int mPlayer;	///< player who spilled this blood drop
-		int mLastFrame;	///< time this drop was updated for the last time
-};
-
 /*!	\class BloodManager
 	\brief Manages blood effects
 	\details this class is responsible for managing blood effects, creating and deleting the particles, 
 			updating their positions etc. It is designed as a singleton, so it is noncopyable.
+			The particles live in a pool of fixed size which stores each attribute in its own array,
+			so they are updated by simple loops over contiguous memory and drawn as one batch.
+			A dead particle is replaced by the last one. The particles move in fixed time steps,
+			so they look the same at every frame rate.
 */
 class BloodManager : private boost::noncopyable
 {
@@ -90,8 +68,33 @@ class BloodManager : private boost::noncopyable
 		/// min and max, boundaries included
 		static int random(int min, int max);
 		
-		/// list which contains all currently existing blood particles
-		std::list<Blood> mParticles;
+		/// moves all particles by one time step
+		void integrate();
+		
+		/// removes the particle at index by moving the last particle into its place
+		void removeParticle(int index);
+		
+		/// maximum number of particles, drops spilled while the pool is full are discarded
+		static const int MAX_PARTICLES = 4096;
+		
+		/// length of a time step in milliseconds
+		static const unsigned int STEP_TIME = 10;
+		
+		/// positions and velocities of the particles
+		std::vector<float> mPosX;
+		std::vector<float> mPosY;
+		std::vector<float> mDirX;
+		std::vector<float> mDirY;
+		
+		/// player who spilled each particle, determines its colour
+		std::vector<int> mPlayer;
+		
+		/// number of currently existing blood particles
+		int mParticleCount;
+		
+		/// time of the last update and time which was not simulated yet
+		unsigned int mLastTicks;
+		unsigned int mPendingTime;
 		
 		/// true, if blood should be handled/drawn
 		bool mEnabled;
@@ -99,6 +99,13 @@ void DuelMatch::setRules(std::string rulesFile, int score_to_win)
 	mLogic = createGameLogic(rulesFile, this, score_to_win);
 }
 
+void DuelMatch::setRulesScript(const std::string& rulesFile, const std::string& script, int score_to_win, std::ostream* output)
+{
+	if( score_to_win == 0)
+		score_to_win = getScoreToWin();
+	mLogic = createGameLogic(rulesFile, script, this, score_to_win, output);
+}
+
 
 void DuelMatch::step()
 {
@@ -235,6 +242,21 @@ int DuelMatch::getScoreToWin() const
 	return mLogic->getScoreToWin();
 }
 
+bool DuelMatch::getRulesScriptStats(ScriptStats& stats) const
+{
+	return mLogic->getScriptStats(stats);
+}
+
+void DuelMatch::enableRulesProfiler()
+{
+	mLogic->enableScriptProfiler();
+}
+
+const LuaProfiler* DuelMatch::getRulesProfiler() const
+{
+	return mLogic->getScriptProfiler();
+}
+
 bool DuelMatch::getBallDown() const
 {
 	return !mLogic->isBallValid();
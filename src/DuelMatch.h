@@ -59,6 +59,9 @@ class DuelMatch : public ObjectCounter<DuelMatch>
 		~DuelMatch();
 
 		void setRules(std::string rulesFile, int score_to_win = 0);
+		/// uses the rules \p script, e.g. from a replay, instead of reading \p rulesFile.
+		/// Messages of the script go to \p output, nothing is printed if it is null.
+		void setRulesScript(const std::string& rulesFile, const std::string& script, int score_to_win, std::ostream* output);
 
 		void reset();
 
@@ -81,6 +84,11 @@ class DuelMatch : public ObjectCounter<DuelMatch>
 
 		int getScore(PlayerSide player) const;
 		int getScoreToWin() const;
+		/// memory and time used by the rules script, false for the builtin rules
+		bool getRulesScriptStats(ScriptStats& stats) const;
+		void enableRulesProfiler();
+		/// nullptr for the builtin rules, or if enableRulesProfiler has not been called
+		const LuaProfiler* getRulesProfiler() const;
 		PlayerSide getServingPlayer() const;
 		int getTouches(PlayerSide player) const;
 
@@ -42,6 +42,29 @@ void DuelMatchState::swapSides()
 	}	
 }
 
+uint32_t DuelMatchState::checksum() const
+{
+	// the blob animation is not part of the simulation, and its speed is not
+	// contained in the state, so it may differ after a state has been restored.
+	DuelMatchState state = *this;
+	for (int i = 0; i < MAX_PLAYERS; ++i)
+		state.worldState.blobState[i] = 0;
+
+	RakNet::BitStream stream;
+	auto out = createGenericWriter(&stream);
+	out->generic<DuelMatchState>(state);
+
+	// FNV-1a
+	uint32_t hash = 2166136261u;
+	const unsigned char* data = stream.GetData();
+	for (int i = 0; i < stream.GetNumberOfBytesUsed(); ++i)
+	{
+		hash ^= data[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
 USER_SERIALIZER_IMPLEMENTATION_HELPER(DuelMatchState)
 {
 	io.template generic<PhysicState> (value.worldState);
@@ -20,6 +20,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #pragma once
 
+#include <stdint.h>
+
 #include "PhysicState.h"
 #include "GameLogicState.h"
 #include "PlayerInput.h"
@@ -46,6 +48,11 @@ struct DuelMatchState
 
 	void swapSides();
 
+	/// calculates a hash of the serialized state. Two peers simulating the same
+	/// match have equal checksums as long as they are synchronised. The purely
+	/// visual blob animation state is ignored.
+	uint32_t checksum() const;
+
 	PhysicState worldState;
 	GameLogicState logicState;
 
@@ -23,6 +23,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 /* includes */
 #include <cassert>
+#include <map>
+#include <mutex>
 
 #include <physfs.h>
 
@@ -32,12 +34,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "tinyxml/tinyxml.h"
 
-extern "C"
-{
-#include "lua/lua.h"
-#include "lua/lauxlib.h"
-#include "lua/lualib.h"
-}
+#include "LuaCompat.h"
 
 #include "Global.h"
 
@@ -199,42 +196,124 @@ uint32_t FileRead::calcChecksum(uint32_t start)
 
 // reading lua script
 
-struct ReaderInfo
+namespace
 {
-	FileRead file;
-	char buffer[2048];
-};
+	/// a lua chunk compiled to bytecode, together with the version of its source
+	struct CompiledScript
+	{
+		std::string version;
+		std::string bytecode;
+	};
 
-static const char* chunkReader(lua_State* state, void* data, size_t *size)
-{
-	ReaderInfo* info = (ReaderInfo*) data;
+	// compiled scripts of all lua states in this process, by file name. Every match
+	// and every bot loads the same api scripts, so they are only parsed once.
+	std::mutex ScriptCacheMutex;
+	std::map<std::string, CompiledScript> ScriptCache;
+
+	int bytecodeWriter(lua_State* state, const void* data, size_t size, void* target)
+	{
+		static_cast<std::string*>(target)->append(static_cast<const char*>(data), size);
+		return 0;
+	}
+
+	const char* stringReader(lua_State* state, void* data, size_t* size)
+	{
+		// hand out the whole string in the first call
+		std::string*& source = *static_cast<std::string**>(data);
+		if (!source)
+			return nullptr;
+
+		*size = source->size();
+		const char* result = source->data();
+		source = nullptr;
+		return result;
+	}
+
+	int loadString(lua_State* state, const std::string& code, const std::string& name)
+	{
+		const std::string* source = &code;
+		return lua_load(state, stringReader, &source, name.c_str(), NULL);
+	}
 
-	int bytesRead = 2048;
-	if(info->file.length() - info->file.tell() < 2048)
+	/// loads the cached bytecode of \p name, if it was compiled from \p version
+	/// \return false if the script has to be compiled
+	bool loadCached(lua_State* state, const std::string& name, const std::string& version, int& error)
 	{
-		bytesRead = info->file.length() - info->file.tell();
+		std::lock_guard<std::mutex> lock(ScriptCacheMutex);
+		auto cached = ScriptCache.find(name);
+		if (cached == ScriptCache.end() || cached->second.version != version)
+			return false;
+
+		error = loadString(state, cached->second.bytecode, name);
+		return true;
 	}
 
-	info->file.readRawBytes(info->buffer, bytesRead);
-	// if this doesn't throw, bytesRead is the actual number of bytes read
-	/// \todo we must do sth about this code, its just plains awful.
-	/// 		File interface has to be improved to support such buffered reading.
-	*size = bytesRead;
-	if (bytesRead == 0)
+	int compile(lua_State* state, const std::string& name, const std::string& version, const std::string& source)
 	{
+		int error = loadString(state, source, name);
+		if (error)
+			return error;
+
+		// the loaded chunk is on top of the stack, keep its debug information for error messages
+		CompiledScript compiled;
+		compiled.version = version;
+		lua_dump(state, bytecodeWriter, &compiled.bytecode, 0);
+
+		std::lock_guard<std::mutex> lock(ScriptCacheMutex);
+		ScriptCache[name] = std::move(compiled);
 		return 0;
 	}
-	 else
+
+	std::string getChecksumVersion(const std::string& source)
 	{
-		return info->buffer;
+		boost::crc_32_type crc;
+		crc.process_bytes(source.data(), source.size());
+		return "crc " + std::to_string(crc());
 	}
 }
 
 int FileRead::readLuaScript(const std::string& filename, lua_State* mState)
 {
-	ReaderInfo info;
-	info.file.open(makeLuaFilename(filename));
-	return lua_load(mState, chunkReader, &info, filename.c_str(), NULL);
+	std::string path = makeLuaFilename(filename);
+
+	// a file is identified by the directory it is found in, its modification time and
+	// its size, so it is only read when it has to be compiled.
+	std::string version;
+	PHYSFS_Stat stat;
+	const char* directory = PHYSFS_getRealDir(path.c_str());
+	if (directory && PHYSFS_stat(path.c_str(), &stat) && stat.modtime >= 0)
+		version = std::string("file ") + directory + " " + std::to_string(stat.modtime) + " " + std::to_string(stat.filesize);
+
+	int error;
+	if (!version.empty() && loadCached(mState, filename, version, error))
+		return error;
+
+	FileRead file(path);
+	std::string source(file.length(), '\0');
+	if (!source.empty())
+		file.readRawBytes(&source[0], source.size());
+
+	// without a modification time, changes are recognized by the content
+	if (version.empty())
+	{
+		version = getChecksumVersion(source);
+		if (loadCached(mState, filename, version, error))
+			return error;
+	}
+
+	return compile(mState, filename, version, source);
+}
+
+int FileRead::readLuaScript(const std::string& name, const std::string& source, lua_State* mState)
+{
+	// e.g. rules sent by a server, which may differ from the local file of the same name
+	std::string version = getChecksumVersion(source);
+
+	int error;
+	if (loadCached(mState, name, version, error))
+		return error;
+
+	return compile(mState, name, version, source);
 }
 
 std::string FileRead::makeLuaFilename(std::string filename)
@@ -113,7 +113,15 @@ class FileRead : public File
 		// 								LUA/XML reading helper function
 		// -----------------------------------------------------------------------------------------
 		static std::string makeLuaFilename(std::string filename);
+		/// loads the lua script \p filename as a function onto the stack of \p mState,
+		/// like lua_load. The compiled bytecode is cached for the whole process. The
+		/// file is only read again when its modification time or size changes.
+		/// \return the lua_load error code
 		static int readLuaScript(const std::string& filename, lua_State* mState);
+		/// loads the lua script \p source like readLuaScript. \p name is used for
+		/// error messages and for the cache, so it should be unique for each script.
+		/// The script is only compiled again when the checksum of \p source changes.
+		static int readLuaScript(const std::string& name, const std::string& source, lua_State* mState);
 		
 		static std::shared_ptr<TiXmlDocument> readXMLDocument(const std::string& filename);
 };
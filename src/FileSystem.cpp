@@ -93,6 +93,40 @@ bool FileSystem::isDirectory(const std::string& dirname) const
 	return stat.filetype == PHYSFS_FILETYPE_DIRECTORY;
 }
 
+int64_t FileSystem::getModificationTime(const std::string& filename) const
+{
+	PHYSFS_Stat stat;
+	if ( !PHYSFS_stat(filename.c_str(), &stat) )
+		BOOST_THROW_EXCEPTION( PhysfsException() );
+
+	return stat.modtime;
+}
+
+int64_t FileSystem::getFileSize(const std::string& filename) const
+{
+	PHYSFS_Stat stat;
+	if ( !PHYSFS_stat(filename.c_str(), &stat) )
+		BOOST_THROW_EXCEPTION( PhysfsException() );
+
+	return stat.filesize;
+}
+
+std::string FileSystem::getRealPath(const std::string& filename) const
+{
+	const char* dir = PHYSFS_getRealDir(filename.c_str());
+	if ( !dir )
+		return "";
+
+	return std::string(dir) + PHYSFS_getDirSeparator() + filename;
+}
+
+bool FileSystem::isInWriteDir(const std::string& filename) const
+{
+	const char* dir = PHYSFS_getRealDir(filename.c_str());
+	const char* writeDir = PHYSFS_getWriteDir();
+	return dir && writeDir && std::string(dir) == writeDir;
+}
+
 bool FileSystem::mkdir(const std::string& dirname)
 {
 	return PHYSFS_mkdir(dirname.c_str());
@@ -22,6 +22,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <string>
 #include <vector>
+#include <cstdint>
 #include <boost/noncopyable.hpp>
 
 #include "FileExceptions.h"
@@ -58,6 +59,25 @@ class FileSystem : public boost::noncopyable, public ObjectCounter<FileSystem>
 		/// \brief tests wether given path is a directory
 		bool isDirectory(const std::string& dirname) const;
 
+		/// \brief gets the last modification time of a file
+		/// \return seconds since the epoch, or -1 if physfs can't determine it.
+		int64_t getModificationTime(const std::string& filename) const;
+
+		/// \brief gets the size of a file, without opening it
+		/// \return size in bytes, or -1 if physfs can't determine it.
+		int64_t getFileSize(const std::string& filename) const;
+
+		/// \brief gets the path of a file in the native file system
+		/// \details needed for files that have to be opened by other libraries.
+		///			Files inside an archive get the path of the archive as prefix,
+		///			so they can not be opened that way.
+		/// \return the path, or an empty string if the file is not found.
+		std::string getRealPath(const std::string& filename) const;
+
+		/// \brief tests whether a file is found in the write directory
+		/// \details i.e. it was not installed with the game, but downloaded or added by the user.
+		bool isInWriteDir(const std::string& filename) const;
+
 		/// \brief creates a directory and reports success/failure
 		/// \return true, if the directory could be created
 		bool mkdir(const std::string& dirname);
@@ -25,19 +25,20 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <cassert>
 #include <cmath>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <vector>
 
-extern "C"
-{
-#include "lua/lua.h"
-#include "lua/lauxlib.h"
-#include "lua/lualib.h"
-}
+#include <boost/crc.hpp>
+
+#include "LuaCompat.h"
 
 #include "FileRead.h"
 #include "GameLogicState.h"
 #include "DuelMatch.h"
 #include "GameConstants.h"
 #include "IScriptableComponent.h"
+#include "LuaArena.h"
 #include "PlayerInput.h"
 
 
@@ -429,7 +430,10 @@ protected:
 class LuaGameLogic : public FallbackGameLogic, public IScriptableComponent
 {
 	public:
-		LuaGameLogic(const std::string& file, DuelMatch* match, int score_to_win);
+		/// \p script is the content of the rules file \p file. Messages of the script
+		/// are written to \p output, see IScriptableComponent::setOutput.
+		LuaGameLogic(const std::string& file, const std::string& script, DuelMatch* match,
+				int score_to_win, std::ostream* output);
 		virtual ~LuaGameLogic();
 
 		virtual std::string getSourceFile() const
@@ -439,7 +443,10 @@ class LuaGameLogic : public FallbackGameLogic, public IScriptableComponent
 
 		virtual GameLogicPtr clone() const
 		{
-			return GameLogicPtr(new LuaGameLogic(mSourceFile, getMatch(), getScoreToWin()));
+			LuaGameLogic* logic = new LuaGameLogic(mSourceFile, mScript, getMatch(), getScoreToWin(), getOutput());
+			if (getProfiler())
+				logic->enableProfiler();
+			return GameLogicPtr(logic);
 		}
 
 		virtual std::string getAuthor() const
@@ -452,6 +459,21 @@ class LuaGameLogic : public FallbackGameLogic, public IScriptableComponent
 			return mTitle;
 		}
 
+		virtual bool getScriptStats(ScriptStats& stats) const
+		{
+			stats = IScriptableComponent::getScriptStats();
+			return true;
+		}
+
+		virtual void enableScriptProfiler()
+		{
+			enableProfiler();
+		}
+
+		virtual const LuaProfiler* getScriptProfiler() const
+		{
+			return getProfiler();
+		}
 
 	protected:
 
@@ -467,6 +489,12 @@ class LuaGameLogic : public FallbackGameLogic, public IScriptableComponent
 
 	private:
 
+		/// gets a lua state that has run \p script from the pool of unused rule states,
+		/// or null if there is none
+		static lua_State* acquireState(const std::string& file, const std::string& script);
+		/// returns the lua state to the pool, so the next match can use it
+		void releaseState();
+
 		// lua functions
 		static int luaMistake(lua_State* state);
 		static int luaScore(lua_State* state);
@@ -476,38 +504,160 @@ class LuaGameLogic : public FallbackGameLogic, public IScriptableComponent
 
 		// lua state
 		std::string mSourceFile;
+		/// the rules script, kept for clone() so the file is not read again
+		std::string mScript;
+
+		/// callbacks a rules script may define
+		enum Callback
+		{
+			IS_WINNING,
+			HANDLE_INPUT,
+			ON_BALL_HITS_PLAYER,
+			ON_BALL_HITS_WALL,
+			ON_BALL_HITS_NET,
+			ON_BALL_HITS_GROUND,
+			ON_GAME,
+			CALLBACK_COUNT
+		};
+
+		/// pushes \p callback onto the lua stack.
+		/// \return false if the script does not define it, so the fallback rules apply.
+		bool pushCallback(Callback callback) const;
+
+		// registry references to the callbacks of the script, see getLuaFunctionRef
+		int mCallbacks[CALLBACK_COUNT];
+		// bit i is set if the script defines callback i. Determined once when the
+		// script is loaded, so missing hooks do not cause any lua calls.
+		unsigned mCapabilities;
 
 		std::string mAuthor;
 		std::string mTitle;
 };
 
 
-LuaGameLogic::LuaGameLogic( const std::string& filename, DuelMatch* match, int score_to_win ) :
-	FallbackGameLogic( score_to_win ), mSourceFile(filename)
+// -------------------------------------------------------------------------------------------------
+//								Lua state pool
+// -------------------------------------------------------------------------------------------------
+
+/// maximum number of unused lua states kept for new matches
+const unsigned RULES_STATE_POOL_SIZE = 16;
+
+namespace
+{
+	/// rules file and checksum of its script
+	typedef std::pair<std::string, std::uint32_t> RulesKey;
+
+	RulesKey getRulesKey(const std::string& file, const std::string& script)
+	{
+		boost::crc_32_type crc;
+		crc.process_bytes(script.data(), script.size());
+		return RulesKey(file, crc());
+	}
+
+	/*! Lua states that have loaded the api scripts, and have been reset after a match.
+		Servers create a match for each game, so these are reused instead of setting up a
+		new state each time. resetGlobals() can't undo everything a script does, e.g.
+		changes of local variables of the api, so a state is only reused for the same rules.
+	*/
+	struct RulesStatePool
+	{
+		~RulesStatePool()
+		{
+			for (const auto& rules : states)
+				for (lua_State* state : rules.second)
+					LuaArena::closeState(state);
+		}
+
+		std::mutex mutex;
+		std::map<RulesKey, std::vector<lua_State*>> states;
+		unsigned count = 0;
+	};
+
+	RulesStatePool& getRulesStatePool()
+	{
+		static RulesStatePool pool;
+		return pool;
+	}
+}
+
+lua_State* LuaGameLogic::acquireState(const std::string& file, const std::string& script)
+{
+	RulesKey key = getRulesKey(file, script);
+	RulesStatePool& pool = getRulesStatePool();
+	std::lock_guard<std::mutex> lock(pool.mutex);
+	auto rules = pool.states.find(key);
+	if (rules == pool.states.end())
+		return nullptr;
+
+	lua_State* state = rules->second.back();
+	rules->second.pop_back();
+	if (rules->second.empty())
+		pool.states.erase(rules);
+	--pool.count;
+	return state;
+}
+
+void LuaGameLogic::releaseState()
+{
+	for (int i = 0; i < CALLBACK_COUNT; ++i)
+		luaL_unref(mState, LUA_REGISTRYINDEX, mCallbacks[i]);
+	resetGlobals();
+
+	RulesKey key = getRulesKey(mSourceFile, mScript);
+	RulesStatePool& pool = getRulesStatePool();
+	std::lock_guard<std::mutex> lock(pool.mutex);
+	if (pool.count < RULES_STATE_POOL_SIZE)
+	{
+		pool.states[key].push_back(mState);
+		++pool.count;
+		// the state is not ours anymore
+		mState = nullptr;
+	}
+}
+
+LuaGameLogic::LuaGameLogic( const std::string& filename, const std::string& script, DuelMatch* match,
+		int score_to_win, std::ostream* output ) :
+	FallbackGameLogic( score_to_win ), IScriptableComponent( acquireState(filename, script) ), mSourceFile(filename), mScript(script)
 {
 	setMatch( match );
-	lua_pushlightuserdata(mState, this);
-	lua_setglobal(mState, "__GAME_LOGIC_POINTER");
+	setOutput( output );
+
+	// a new state has to load the api first. The rules file is loaded for every match,
+	// as scripts may depend on SCORE_TO_WIN.
+	if (!hasSavedGlobals())
+	{
+		setGameConstants();
+		setGameFunctions();
+
+		// add functions
+		registerLuaFunction("score", luaScore);
+		registerLuaFunction("mistake", luaMistake);
+		registerLuaFunction("servingplayer", luaGetServingPlayer);
+		registerLuaFunction("time", luaGetGameTime);
+		registerLuaFunction("isgamerunning", luaIsGameRunning);
+
+		openScript("api");
+		openScript("rules_api");
+		saveGlobals();
+	}
 
 	/// \todo use lua registry instead of globals!
 	lua_pushnumber(mState, getScoreToWin());
 	lua_setglobal(mState, "SCORE_TO_WIN");
 
-	setGameConstants();
-	setGameFunctions();
-
-	// add functions
-	luaL_requiref(mState, "math", luaopen_math, 1);
-	lua_register(mState, "score", luaScore);
-	lua_register(mState, "mistake", luaMistake);
-	lua_register(mState, "servingplayer", luaGetServingPlayer);
-	lua_register(mState, "time", luaGetGameTime);
-	lua_register(mState, "isgamerunning", luaIsGameRunning);
-
 	// now load script file
-	openScript("api");
-	openScript("rules_api");
-	openScript("rules/"+mSourceFile);
+	openScript("rules/"+mSourceFile, mScript);
+
+	// the callbacks are called every step, so look them up only once
+	const char* callbackNames[CALLBACK_COUNT] = {"IsWinning", "HandleInput", "OnBallHitsPlayer",
+			"OnBallHitsWall", "OnBallHitsNet", "OnBallHitsGround", "OnGame"};
+	mCapabilities = 0;
+	for (int i = 0; i < CALLBACK_COUNT; ++i)
+	{
+		mCallbacks[i] = getLuaFunctionRef(callbackNames[i]);
+		if (mCallbacks[i] >= 0)
+			mCapabilities |= 1u << i;
+	}
 
 	lua_getglobal(mState, "SCORE_TO_WIN");
 	mScoreToWin = lua_toint(mState, -1);
@@ -523,31 +673,38 @@ LuaGameLogic::LuaGameLogic( const std::string& filename, DuelMatch* match, int s
 	mTitle = ( title ? title : "untitled script" );
 	lua_pop(mState, 1);
 
-	std::cout << "loaded rules "<< getTitle()<< " by " << getAuthor() << " from " << mSourceFile << std::endl;
+	if (output)
+		*output << "loaded rules "<< getTitle()<< " by " << getAuthor() << " from " << mSourceFile << std::endl;
 }
 
 LuaGameLogic::~LuaGameLogic()
 {
+	releaseState();
+}
+
+bool LuaGameLogic::pushCallback(Callback callback) const
+{
+	if (!(mCapabilities & (1u << callback)))
+		return false;
+
+	return pushLuaFunction(mCallbacks[callback]);
 }
 
 PlayerSide LuaGameLogic::checkWin() const
 {
 	bool won = false;
-	if (!getLuaFunction("IsWinning"))
+	if (!pushCallback(IS_WINNING))
 	{
 		return FallbackGameLogic::checkWin();
 	}
 
 	lua_pushnumber(mState, getScore(LEFT_SIDE) );
 	lua_pushnumber(mState, getScore(RIGHT_SIDE) );
-	if( lua_pcall(mState, 2, 1, 0) )
+	if( callLuaFunction(2, 1) )
 	{
-		std::cerr << "Lua Error: " << lua_tostring(mState, -1);
-		std::cerr << std::endl;
-	};
-
-	won = lua_toboolean(mState, -1);
-	lua_pop(mState, 1);
+		won = lua_toboolean(mState, -1);
+		lua_pop(mState, 1);
+	}
 
 	if(won)
 	{
@@ -563,7 +720,7 @@ PlayerSide LuaGameLogic::checkWin() const
 
 PlayerInput LuaGameLogic::handleInput(PlayerInput ip, PlayerSide player)
 {
-	if (!getLuaFunction( "HandleInput" ))
+	if (!pushCallback(HANDLE_INPUT))
 	{
 		return FallbackGameLogic::handleInput(ip, player);
 	}
@@ -571,11 +728,10 @@ PlayerInput LuaGameLogic::handleInput(PlayerInput ip, PlayerSide player)
 	lua_pushboolean(mState, ip.left);
 	lua_pushboolean(mState, ip.right);
 	lua_pushboolean(mState, ip.up);
-	if(lua_pcall(mState, 4, 3, 0))
+	if( !callLuaFunction(4, 3) )
 	{
-		std::cerr << "Lua Error: " << lua_tostring(mState, -1);
-		std::cerr << std::endl;
-	};
+		return ip;
+	}
 
 	PlayerInput ret;
 	ret.up = lua_toboolean(mState, -1);
@@ -590,89 +746,70 @@ PlayerInput LuaGameLogic::handleInput(PlayerInput ip, PlayerSide player)
 
 void LuaGameLogic::OnBallHitsPlayerHandler(PlayerSide side)
 {
-	if (!getLuaFunction("OnBallHitsPlayer"))
+	if (!pushCallback(ON_BALL_HITS_PLAYER))
 	{
 		FallbackGameLogic::OnBallHitsPlayerHandler(side);
 		return;
 	}
 	lua_pushnumber(mState, side);
-	if( lua_pcall(mState, 1, 0, 0) )
-	{
-		std::cerr << "Lua Error: " << lua_tostring(mState, -1);
-		std::cerr << std::endl;
-	};
+	callLuaFunction(1);
 }
 
 void LuaGameLogic::OnBallHitsWallHandler(PlayerSide side)
 {
-	if (!getLuaFunction("OnBallHitsWall"))
+	if (!pushCallback(ON_BALL_HITS_WALL))
 	{
 		FallbackGameLogic::OnBallHitsWallHandler(side);
 		return;
 	}
 
 	lua_pushnumber(mState, side);
-	if( lua_pcall(mState, 1, 0, 0) )
-	{
-		std::cerr << "Lua Error: " << lua_tostring(mState, -1);
-		std::cerr << std::endl;
-	};
+	callLuaFunction(1);
 }
 
 void LuaGameLogic::OnBallHitsNetHandler(PlayerSide side)
 {
-	if (!getLuaFunction( "OnBallHitsNet" ))
+	if (!pushCallback(ON_BALL_HITS_NET))
 	{
 		FallbackGameLogic::OnBallHitsNetHandler(side);
 		return;
 	}
 
 	lua_pushnumber(mState, side);
-
-	if( lua_pcall(mState, 1, 0, 0) )
-	{
-		std::cerr << "Lua Error: " << lua_tostring(mState, -1);
-		std::cerr << std::endl;
-	};
+	callLuaFunction(1);
 }
 
 void LuaGameLogic::OnBallHitsGroundHandler(PlayerSide side)
 {
-	if (!getLuaFunction( "OnBallHitsGround" ))
+	if (!pushCallback(ON_BALL_HITS_GROUND))
 	{
 		FallbackGameLogic::OnBallHitsGroundHandler(side);
 		return;
 	}
 
 	lua_pushnumber(mState, side);
-
-	if( lua_pcall(mState, 1, 0, 0) )
-	{
-		std::cerr << "Lua Error: " << lua_tostring(mState, -1);
-		std::cerr << std::endl;
-	};
+	callLuaFunction(1);
 }
 
 void LuaGameLogic::OnGameHandler( const DuelMatchState& state )
 {
-	if (!getLuaFunction( "OnGame" ))
+	if (!pushCallback(ON_GAME))
 	{
 		FallbackGameLogic::OnGameHandler( state );
-		return;
 	}
-	if( lua_pcall(mState, 0, 0, 0) )
+	else
 	{
-		std::cerr << "Lua Error: " << lua_tostring(mState, -1);
-		std::cerr << std::endl;
-	};
+		callLuaFunction();
+	}
+
+	// the rules state runs no other code between two frames
+	stepGarbageCollector();
 }
 
 LuaGameLogic* LuaGameLogic::getGameLogic(lua_State* state)
 {
-	lua_getglobal(state, "__GAME_LOGIC_POINTER");
-	LuaGameLogic* gl = (LuaGameLogic*)lua_touserdata(state, -1);
-	lua_pop(state, 1);
-	return gl;
+	// the functions are registered with registerLuaFunction
+	return static_cast<LuaGameLogic*>(getScriptComponent(state));
 }
 
 int LuaGameLogic::luaMistake(lua_State* state)
@@ -730,9 +867,13 @@ GameLogicPtr createGameLogic(const std::string& file, DuelMatch* match, int scor
 		return GameLogicPtr(new FallbackGameLogic( score_to_win ));
 	}
 
+	std::string script;
 	try
 	{
-		return GameLogicPtr( new LuaGameLogic(file, match, score_to_win ) );
+		FileRead rules(FileRead::makeLuaFilename("rules/" + file));
+		script.resize(rules.length());
+		if (!script.empty())
+			rules.readRawBytes(&script[0], script.size());
 	}
 	catch( std::exception& exp)
 	{
@@ -743,4 +884,22 @@ GameLogicPtr createGameLogic(const std::string& file, DuelMatch* match, int scor
 		return GameLogicPtr(new FallbackGameLogic( score_to_win ));
 	}
 
+	return createGameLogic(file, script, match, score_to_win, &std::cout);
+}
+
+GameLogicPtr createGameLogic(const std::string& file, const std::string& script, DuelMatch* match,
+		int score_to_win, std::ostream* output)
+{
+	try
+	{
+		return GameLogicPtr( new LuaGameLogic(file, script, match, score_to_win, output ) );
+	}
+	catch( std::exception& exp)
+	{
+		std::cerr << "Script Error: Could not create LuaGameLogic: \n";
+		std::cerr << exp.what() << std::endl;
+		std::cerr << "              Using fallback ruleset";
+		std::cerr << std::endl;
+		return GameLogicPtr(new FallbackGameLogic( score_to_win ));
+	}
 }
@@ -23,6 +23,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <memory>
 #include <cassert>
+#include <iosfwd>
 #include <string>
 
 #include "Global.h"
@@ -35,6 +36,8 @@ typedef std::unique_ptr<IGameLogic> GameLogicPtr;
 
 struct GameLogicState;
 struct DuelMatchState;
+struct ScriptStats;
+class LuaProfiler;
 class DuelMatch;
 struct PlayerInput;
 
@@ -147,6 +150,14 @@ class IGameLogic: public ObjectCounter<IGameLogic>
 		virtual std::string getAuthor() const = 0;
 		virtual std::string getTitle() const  = 0;
 
+		/// gets memory and time used by the rules script.
+		/// \return false if the rules are not scripted
+		virtual bool getScriptStats(ScriptStats& stats) const { return false; }
+		/// starts profiling the rules script, does nothing if the rules are not scripted
+		virtual void enableScriptProfiler() { }
+		/// \return nullptr if the rules are not scripted or the profiler is not enabled
+		virtual const LuaProfiler* getScriptProfiler() const { return nullptr; }
+
 	protected:
 		/// this method must be called if a team scores
 		/// it increments the points of that team
@@ -232,5 +243,9 @@ extern const std::string TEMP_RULES_NAME;
 
 // functions for creating a game logic object
 GameLogicPtr createGameLogic(const std::string& rulefile, DuelMatch* match, int score_to_win);
+/// creates a game logic from the content \p script of a rules file, e.g. the rules
+/// stored in a replay. Messages of the script go to \p output, which may be null.
+GameLogicPtr createGameLogic(const std::string& rulefile, const std::string& script, DuelMatch* match,
+		int score_to_win, std::ostream* output);
 
 
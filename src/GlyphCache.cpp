@@ -0,0 +1,223 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+
+/* header include */
+#include "GlyphCache.h"
+
+/* includes */
+#include <algorithm>
+#include <cassert>
+
+#include "RenderManager.h"
+#include "UTF8.h"
+
+/* implementation */
+// the constants are passed by reference, e.g. to std::min, so they need a definition
+const int GlyphCache::GLYPH_SIZE;
+const int GlyphCache::PAGE_WIDTH;
+const int GlyphCache::PAGE_HEIGHT;
+const unsigned int GlyphCache::MAX_TEXT_RUNS;
+
+GlyphCache::GlyphCache(Loader loader)
+	: mLoader(loader)
+	, mGeneration(0)
+	, mFrame(0)
+{
+	mPage = SDL_CreateRGBSurface(SDL_SWSURFACE,
+			PAGE_WIDTH, PAGE_HEIGHT, 32,
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+			0xff000000, 0x00ff0000, 0x0000ff00, 0x000000ff);
+#else
+			0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000);
+#endif
+
+	const int cellSize = GLYPH_SIZE + 2;
+	for (int y = 0; y + cellSize <= PAGE_HEIGHT; y += cellSize)
+	{
+		for (int x = 0; x + cellSize <= PAGE_WIDTH; x += cellSize)
+		{
+			Cell cell;
+			SDL_Rect rect = {x + 1, y + 1, GLYPH_SIZE, GLYPH_SIZE};
+			cell.rect = rect;
+			mCells.push_back(cell);
+		}
+	}
+
+	clear();
+}
+
+GlyphCache::~GlyphCache()
+{
+	SDL_FreeSurface(mPage);
+}
+
+void GlyphCache::clear()
+{
+	SDL_FillRect(mPage, 0, SDL_MapRGBA(mPage->format, 0, 0, 0, 0));
+	mChangedTop = 0;
+	mChangedBottom = PAGE_HEIGHT;
+
+	mGlyphs.clear();
+	mTextRuns.clear();
+	mRecentlyUsed.clear();
+	for (unsigned int i = 0; i < mCells.size(); ++i)
+	{
+		mCells[i].key = 0;
+		mCells[i].lastFrame = mFrame - 1;
+		mCells[i].lru = mRecentlyUsed.insert(mRecentlyUsed.end(), i);
+	}
+	// new text runs have generation 0, so it must never be the current one
+	++mGeneration;
+	if (mGeneration == 0)
+		++mGeneration;
+}
+
+unsigned int GlyphCache::makeKey(unsigned int codepoint, bool highlight)
+{
+	// 0 marks an empty cell, unicode ends at 0x10FFFF
+	return (codepoint + 1) << 1 | (highlight ? 1 : 0);
+}
+
+void GlyphCache::touch(int cell)
+{
+	mRecentlyUsed.splice(mRecentlyUsed.begin(), mRecentlyUsed, mCells[cell].lru);
+	mCells[cell].lastFrame = mFrame;
+}
+
+int GlyphCache::getGlyph(unsigned int codepoint, bool highlight)
+{
+	unsigned int key = makeKey(codepoint, highlight);
+	auto found = mGlyphs.find(key);
+	if (found != mGlyphs.end())
+	{
+		touch(found->second);
+		return found->second;
+	}
+
+	int index = mRecentlyUsed.back();
+	Cell& cell = mCells[index];
+	if (cell.lastFrame == mFrame)
+		return -1;
+
+	if (cell.key != 0)
+	{
+		mGlyphs.erase(cell.key);
+		++mGeneration;
+	}
+
+	SDL_Surface* glyph = mLoader(codepoint, highlight);
+	SDL_FillRect(mPage, &cell.rect, SDL_MapRGBA(mPage->format, 0, 0, 0, 0));
+	SDL_SetColorKey(glyph, SDL_TRUE, SDL_MapRGB(glyph->format, 0, 0, 0));
+	SDL_Rect source = {0, 0, std::min(glyph->w, GLYPH_SIZE), std::min(glyph->h, GLYPH_SIZE)};
+	SDL_Rect destination = cell.rect;
+	SDL_BlitSurface(glyph, &source, mPage, &destination);
+	SDL_FreeSurface(glyph);
+
+	mChangedTop = std::min(mChangedTop, cell.rect.y);
+	mChangedBottom = std::max(mChangedBottom, cell.rect.y + cell.rect.h);
+
+	cell.key = key;
+	mGlyphs[key] = index;
+	touch(index);
+	return index;
+}
+
+const std::vector<SDL_Rect>& GlyphCache::getText(const std::string& text, unsigned int flags)
+{
+	flags &= TF_HIGHLIGHT | TF_OBFUSCATE;
+	TextRun& run = mTextRuns[std::make_pair(text, flags)];
+	run.lastFrame = mFrame;
+
+	if (run.generation == mGeneration)
+	{
+		for (int cell : run.cells)
+		{
+			if (cell >= 0)
+				touch(cell);
+		}
+		return run.rects;
+	}
+
+	run.cells.clear();
+	run.rects.clear();
+	for (auto iter = text.cbegin(); iter != text.cend(); )
+	{
+		unsigned int codepoint = nextCodepoint(iter, text.cend());
+		if (flags & TF_OBFUSCATE)
+			codepoint = '*';
+
+		int cell = getGlyph(codepoint, flags & TF_HIGHLIGHT);
+		run.cells.push_back(cell);
+		if (cell >= 0)
+		{
+			run.rects.push_back(mCells[cell].rect);
+		}
+		else
+		{
+			SDL_Rect empty = {0, 0, 0, 0};
+			run.rects.push_back(empty);
+		}
+	}
+	// cells replaced while building the run do not matter, but missing glyphs are tried again
+	bool complete = std::find(run.cells.begin(), run.cells.end(), -1) == run.cells.end();
+	run.generation = complete ? mGeneration : mGeneration - 1;
+
+	return run.rects;
+}
+
+SDL_Surface* GlyphCache::getPage() const
+{
+	return mPage;
+}
+
+bool GlyphCache::takeChangedRows(SDL_Rect& rows)
+{
+	if (mChangedTop >= mChangedBottom)
+		return false;
+
+	rows.x = 0;
+	rows.y = mChangedTop;
+	rows.w = PAGE_WIDTH;
+	rows.h = mChangedBottom - mChangedTop;
+	mChangedTop = PAGE_HEIGHT;
+	mChangedBottom = 0;
+	return true;
+}
+
+void GlyphCache::nextFrame()
+{
+	if (mTextRuns.size() > MAX_TEXT_RUNS)
+	{
+		for (auto iter = mTextRuns.begin(); iter != mTextRuns.end(); )
+		{
+			if (iter->second.lastFrame != mFrame)
+				iter = mTextRuns.erase(iter);
+			else
+				++iter;
+		}
+	}
+
+	++mFrame;
+}
+
+unsigned int GlyphCache::getFrame() const
+{
+	return mFrame;
+}
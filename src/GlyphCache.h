@@ -0,0 +1,122 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+
+#pragma once
+
+#include <functional>
+#include <list>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <SDL2/SDL.h>
+
+/*! \class GlyphCache
+	\brief font glyphs, loaded when they are drawn
+	\details The glyphs are copied into a page surface which the render managers use as
+			texture, or as part of their atlas. A glyph is loaded the first time it is drawn,
+			so any unicode character for which there is an image can be shown. When the page
+			is full, the glyph which was not drawn for the longest time is replaced. Glyphs
+			which were drawn in the current frame are never replaced, as the render managers
+			draw the whole frame at once in refresh().
+			The glyphs of a text are looked up once and then kept in a text run, until one of
+			its glyphs is replaced.
+*/
+class GlyphCache
+{
+	public:
+		/// loads the image of a glyph, highlighted or not
+		typedef std::function<SDL_Surface*(unsigned int codepoint, bool highlight)> Loader;
+
+		// size of a glyph, the cells of the page have one pixel space around it
+		static const int GLYPH_SIZE = 24;
+		static const int PAGE_WIDTH = 512;
+		static const int PAGE_HEIGHT = 256;
+
+		explicit GlyphCache(Loader loader);
+		~GlyphCache();
+
+		/// forgets all glyphs, e.g. when the texture of the page was recreated
+		void clear();
+
+		/// \brief the glyphs of a text
+		/// \details returns one rect on the page for each character, in the order they are drawn.
+		///		The rect of a glyph which did not fit on the page is empty.
+		///		Only TF_HIGHLIGHT and TF_OBFUSCATE of the flags change the glyphs.
+		///		The result is valid until the next call.
+		const std::vector<SDL_Rect>& getText(const std::string& text, unsigned int flags);
+
+		/// the page in the byte order R, G, B, A
+		SDL_Surface* getPage() const;
+
+		/// gets the rows of the page which changed since the last call,
+		/// returns false if nothing changed
+		bool takeChangedRows(SDL_Rect& rows);
+
+		/// called by the render manager when a frame is finished
+		void nextFrame();
+
+		/// the current frame, for caches which build upon this one
+		unsigned int getFrame() const;
+
+	private:
+		struct Cell
+		{
+			// codepoint and highlight, see makeKey
+			unsigned int key;
+			SDL_Rect rect;
+			unsigned int lastFrame;
+			std::list<int>::iterator lru;
+		};
+
+		struct TextRun
+		{
+			std::vector<int> cells;
+			std::vector<SDL_Rect> rects;
+			// the glyphs may only be reused if no cell was replaced since then
+			unsigned int generation;
+			unsigned int lastFrame;
+
+			TextRun() : generation(0), lastFrame(0) {}
+		};
+
+		// text runs that were not used in the last frame are dropped above this number
+		static const unsigned int MAX_TEXT_RUNS = 256;
+
+		static unsigned int makeKey(unsigned int codepoint, bool highlight);
+
+		/// finds or loads the glyph, returns the index of its cell or -1 if the page is full
+		int getGlyph(unsigned int codepoint, bool highlight);
+		void touch(int cell);
+
+		Loader mLoader;
+		SDL_Surface* mPage;
+		std::vector<Cell> mCells;
+		/// the cells in order of use, the most recently used first
+		std::list<int> mRecentlyUsed;
+		std::unordered_map<unsigned int, int> mGlyphs;
+		std::map<std::pair<std::string, unsigned int>, TextRun> mTextRuns;
+		unsigned int mGeneration;
+		unsigned int mFrame;
+		int mChangedTop;
+		int mChangedBottom;
+};
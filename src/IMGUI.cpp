@@ -22,11 +22,13 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "IMGUI.h"
 
 /* includes */
-#include <queue>
+#include <algorithm>
 #include <cassert>
 
 #include <SDL2/SDL.h>
 
+#include "UTF8.h"
+
 /* implementation */
 
 enum ObjectType
@@ -46,28 +48,204 @@ enum ObjectType
 	ACTIVECHAT
 };
 
+/// a single draw call of a widget
+struct DrawCommand
+{
+	ObjectType type = IMAGE;
+	Vector2 pos1;
+	Vector2 pos2;
+	Color col = Color(0, 0, 0);
+	float alpha = 0;
+	std::string text;
+	unsigned int flags = TF_NORMAL;
+};
+
+/// \brief state of a widget
+/// \details The state of every widget id is kept between frames, together with the draw
+///			commands built from it. As long as the state of a widget does not change, these
+///			commands are drawn again without laying out the widget or copying its strings.
+///			For select and chat boxes, entries only contains the visible rows.
 struct QueueObject
 {
-	ObjectType type;
-	int id;
+	ObjectType type = IMAGE;
+	int id = 0;
 	Vector2 pos1;
 	Vector2 pos2;
-	Color col;
-	float alpha;
+	Color col = Color(0, 0, 0);
+	float alpha = 0;
 	std::string text;
 	std::vector<std::string> entries;
-	int selected;
-	int length;
-	unsigned int flags;
+	int selected = 0;
+	int length = 0;
+	unsigned int flags = TF_NORMAL;
+	std::vector<DrawCommand> commands;
 };
 
-typedef std::queue<QueueObject> RenderQueue;
+typedef std::vector<QueueObject> WidgetCache;
+typedef std::vector<int> RenderQueue;
+typedef std::vector<std::string>::const_iterator EntryIterator;
 
 IMGUI* IMGUI::mSingleton = 0;
+WidgetCache *mWidgets;
 RenderQueue *mQueue;
 
+const std::vector<std::string> NO_ENTRIES;
+
+namespace
+{
+	DrawCommand& addCommand(QueueObject& obj, ObjectType type, const Vector2& pos1, const Vector2& pos2 = Vector2(0, 0))
+	{
+		obj.commands.emplace_back();
+		DrawCommand& command = obj.commands.back();
+		command.type = type;
+		command.pos1 = pos1;
+		command.pos2 = pos2;
+		return command;
+	}
+
+	void addOverlay(QueueObject& obj, float alpha, const Vector2& pos1, const Vector2& pos2, const Color& col = Color(0, 0, 0))
+	{
+		DrawCommand& command = addCommand(obj, OVERLAY, pos1, pos2);
+		command.alpha = alpha;
+		command.col = col;
+	}
+
+	void addImage(QueueObject& obj, const std::string& name, const Vector2& position, const Vector2& size = Vector2(0, 0))
+	{
+		addCommand(obj, IMAGE, position, size).text = name;
+	}
+
+	void addText(QueueObject& obj, const std::string& text, const Vector2& position, unsigned int flags)
+	{
+		DrawCommand& command = addCommand(obj, TEXT, position);
+		command.text = text;
+		command.flags = flags;
+	}
+
+	/// lays out a widget, i.e. translates its state into draw commands
+	void buildCommands(QueueObject& obj)
+	{
+		int FontSize;
+		obj.commands.clear();
+		switch (obj.type)
+		{
+			case IMAGE:
+				addImage(obj, obj.text, obj.pos1, obj.pos2);
+				break;
+
+			case OVERLAY:
+				addOverlay(obj, obj.alpha, obj.pos1, obj.pos2, obj.col);
+				break;
+
+			case TEXT:
+				addText(obj, obj.text, obj.pos1, obj.flags);
+				break;
+
+			case SCROLLBAR:
+				addOverlay(obj, 0.5, obj.pos1, obj.pos1 + Vector2(210.0, 26.0));
+				addImage(obj, "gfx/scrollbar.bmp", obj.pos1 + Vector2(obj.pos2.x * 200.0 + 5 , 13));
+				break;
+
+			case ACTIVESCROLLBAR:
+				addOverlay(obj, 0.4, obj.pos1, obj.pos1 + Vector2(210.0, 26.0));
+				addImage(obj, "gfx/scrollbar.bmp", obj.pos1 + Vector2(obj.pos2.x * 200.0 + 5 , 13));
+				break;
+
+			case EDITBOX:
+				FontSize = (obj.flags & TF_SMALL_FONT ? FONT_WIDTH_SMALL : FONT_WIDTH_NORMAL);
+				addOverlay(obj, 0.5, obj.pos1, obj.pos1 + Vector2(10+obj.length*FontSize, 10+FontSize));
+				addText(obj, obj.text, obj.pos1+Vector2(5, 5), obj.flags);
+				break;
+
+			case ACTIVEEDITBOX:
+				FontSize = (obj.flags & TF_SMALL_FONT ? FONT_WIDTH_SMALL : FONT_WIDTH_NORMAL);
+				addOverlay(obj, 0.3, obj.pos1, obj.pos1 + Vector2(10+obj.length*FontSize, 10+FontSize));
+				addText(obj, obj.text, obj.pos1+Vector2(5, 5), obj.flags);
+				if (obj.pos2.x >= 0)
+					addOverlay(obj, 1.0, Vector2((obj.pos2.x)*FontSize+obj.pos1.x+5, obj.pos1.y+5), Vector2((obj.pos2.x)*FontSize+obj.pos1.x+5+3, obj.pos1.y+5+FontSize), Color(255,255,255));
+				break;
+
+			case SELECTBOX:
+			case ACTIVESELECTBOX:
+				FontSize = (obj.flags & TF_SMALL_FONT ? (FONT_WIDTH_SMALL+LINE_SPACER_SMALL) : (FONT_WIDTH_NORMAL+LINE_SPACER_NORMAL));
+				addOverlay(obj, (obj.type == SELECTBOX ? 0.5 : 0.3), obj.pos1, obj.pos2);
+				for (unsigned int c = 0; c < obj.entries.size(); c++)
+				{
+					if( c == static_cast<unsigned int>(obj.selected) )
+						addText(obj, obj.entries[c], Vector2(obj.pos1.x+5, obj.pos1.y+(c*FontSize)+5), obj.flags | TF_HIGHLIGHT);
+					else
+						addText(obj, obj.entries[c], Vector2(obj.pos1.x+5, obj.pos1.y+(c*FontSize)+5), obj.flags);
+				}
+				break;
+
+			case CHAT:
+			case ACTIVECHAT:
+				FontSize = (obj.flags & TF_SMALL_FONT ? (FONT_WIDTH_SMALL+LINE_SPACER_SMALL) : (FONT_WIDTH_NORMAL+LINE_SPACER_NORMAL));
+				addOverlay(obj, (obj.type == CHAT ? 0.5 : 0.3), obj.pos1, obj.pos2);
+				for (unsigned int c = 0; c < obj.entries.size(); c++)
+				{
+					if (obj.text[c] == 'R' )
+						addText(obj, obj.entries[c], Vector2(obj.pos1.x+5, obj.pos1.y+(c*FontSize)+5), obj.flags | TF_HIGHLIGHT);
+					else
+						addText(obj, obj.entries[c], Vector2(obj.pos1.x+5, obj.pos1.y+(c*FontSize)+5), obj.flags);
+				}
+				break;
+
+			case BLOB:
+				addCommand(obj, BLOB, obj.pos1).col = obj.col;
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	/// puts a widget into the render queue of this frame. Its text and the range of entries
+	/// are passed separately, so they are only copied when they differ from the last frame.
+	void queueWidget(const QueueObject& obj, const std::string& text = std::string(),
+			EntryIterator first = NO_ENTRIES.begin(), EntryIterator last = NO_ENTRIES.end())
+	{
+		if (obj.id >= (int)mWidgets->size())
+			mWidgets->resize(obj.id + 1);
+
+		QueueObject& cached = (*mWidgets)[obj.id];
+		// every widget has at least one draw command, so a widget without any has never been built
+		bool changed = cached.commands.empty() ||
+				cached.type != obj.type ||
+				!(cached.pos1 == obj.pos1) ||
+				!(cached.pos2 == obj.pos2) ||
+				cached.col.toInt() != obj.col.toInt() ||
+				cached.alpha != obj.alpha ||
+				cached.selected != obj.selected ||
+				cached.length != obj.length ||
+				cached.flags != obj.flags ||
+				cached.text != text ||
+				cached.entries.size() != std::size_t(last - first) ||
+				!std::equal(first, last, cached.entries.begin());
+
+		if (changed)
+		{
+			cached.type = obj.type;
+			cached.id = obj.id;
+			cached.pos1 = obj.pos1;
+			cached.pos2 = obj.pos2;
+			cached.col = obj.col;
+			cached.alpha = obj.alpha;
+			cached.selected = obj.selected;
+			cached.length = obj.length;
+			cached.flags = obj.flags;
+			cached.text = text;
+			cached.entries.assign(first, last);
+			buildCommands(cached);
+		}
+
+		mQueue->push_back(obj.id);
+	}
+}
+
 IMGUI::IMGUI()
 {
+	mWidgets = new WidgetCache;
 	mQueue = new RenderQueue;
 	mActiveButton = -1;
 	mHeldWidget = 0;
@@ -81,6 +259,7 @@ IMGUI::IMGUI()
 IMGUI::~IMGUI()
 {
 	delete mQueue;
+	delete mWidgets;
 }
 
 IMGUI& IMGUI::getSingleton()
@@ -95,9 +274,7 @@ void IMGUI::begin()
 	mUsingCursor = false;
 	mButtonReset = false;
 
-	while (!mQueue->empty())
-		mQueue->pop();
-
+	mQueue->clear();
 
 	mLastKeyAction = NONE;
 
@@ -124,85 +301,36 @@ void IMGUI::begin()
 
 void IMGUI::end()
 {
-	int FontSize;
 	RenderManager& rmanager = RenderManager::getSingleton();
 
-	while (!mQueue->empty())
+	for (int id : *mQueue)
 	{
-		QueueObject& obj = mQueue->front();
-		switch (obj.type)
+		for (const DrawCommand& command : (*mWidgets)[id].commands)
 		{
-			case IMAGE:
-				rmanager.drawImage(obj.text, obj.pos1, obj.pos2);
-				break;
-
-			case OVERLAY:
-				rmanager.drawOverlay(obj.alpha, obj.pos1, obj.pos2, obj.col);
-				break;
-
-			case TEXT:
-				rmanager.drawText(obj.text, obj.pos1, obj.flags);
-				break;
-
-			case SCROLLBAR:
-				rmanager.drawOverlay(0.5, obj.pos1, obj.pos1 + Vector2(210.0, 26.0));
-				rmanager.drawImage("gfx/scrollbar.bmp",obj.pos1 + Vector2(obj.pos2.x * 200.0 + 5 , 13));
-				break;
-
-			case ACTIVESCROLLBAR:
-				rmanager.drawOverlay(0.4, obj.pos1, obj.pos1 + Vector2(210.0, 26.0));
-				rmanager.drawImage("gfx/scrollbar.bmp",obj.pos1 + Vector2(obj.pos2.x * 200.0 + 5 , 13));
-				break;
-
-			case EDITBOX:
-				FontSize = (obj.flags & TF_SMALL_FONT ? FONT_WIDTH_SMALL : FONT_WIDTH_NORMAL);
-				rmanager.drawOverlay(0.5, obj.pos1, obj.pos1 + Vector2(10+obj.length*FontSize, 10+FontSize));
-				rmanager.drawText(obj.text, obj.pos1+Vector2(5, 5), obj.flags);
-				break;
-
-			case ACTIVEEDITBOX:
-				FontSize = (obj.flags & TF_SMALL_FONT ? FONT_WIDTH_SMALL : FONT_WIDTH_NORMAL);
-				rmanager.drawOverlay(0.3, obj.pos1, obj.pos1 + Vector2(10+obj.length*FontSize, 10+FontSize));
-				rmanager.drawText(obj.text, obj.pos1+Vector2(5, 5), obj.flags);
-				if (obj.pos2.x >= 0)
-					rmanager.drawOverlay(1.0, Vector2((obj.pos2.x)*FontSize+obj.pos1.x+5, obj.pos1.y+5), Vector2((obj.pos2.x)*FontSize+obj.pos1.x+5+3, obj.pos1.y+5+FontSize), Color(255,255,255));
-				break;
+			switch (command.type)
+			{
+				case IMAGE:
+					rmanager.drawImage(command.text, command.pos1, command.pos2);
+					break;
 
-			case SELECTBOX:
-			case ACTIVESELECTBOX:
-				FontSize = (obj.flags & TF_SMALL_FONT ? (FONT_WIDTH_SMALL+LINE_SPACER_SMALL) : (FONT_WIDTH_NORMAL+LINE_SPACER_NORMAL));
-				rmanager.drawOverlay((obj.type == SELECTBOX ? 0.5 : 0.3), obj.pos1, obj.pos2);
-				for (unsigned int c = 0; c < obj.entries.size(); c++)
-				{
-					if( c == static_cast<unsigned int>(obj.selected) )
-						rmanager.drawText(obj.entries[c], Vector2(obj.pos1.x+5, obj.pos1.y+(c*FontSize)+5), obj.flags | TF_HIGHLIGHT);
-					else
-						rmanager.drawText(obj.entries[c], Vector2(obj.pos1.x+5, obj.pos1.y+(c*FontSize)+5), obj.flags);
-				}
-				break;
+				case OVERLAY:
+					rmanager.drawOverlay(command.alpha, command.pos1, command.pos2, command.col);
+					break;
 
-			case CHAT:
-			case ACTIVECHAT:
-				FontSize = (obj.flags & TF_SMALL_FONT ? (FONT_WIDTH_SMALL+LINE_SPACER_SMALL) : (FONT_WIDTH_NORMAL+LINE_SPACER_NORMAL));
-				rmanager.drawOverlay((obj.type == CHAT ? 0.5 : 0.3), obj.pos1, obj.pos2);
-				for (unsigned int c = 0; c < obj.entries.size(); c++)
-				{
-					if (obj.text[c] == 'R' )
-						rmanager.drawText(obj.entries[c], Vector2(obj.pos1.x+5, obj.pos1.y+(c*FontSize)+5), obj.flags | TF_HIGHLIGHT);
-					else
-						rmanager.drawText(obj.entries[c], Vector2(obj.pos1.x+5, obj.pos1.y+(c*FontSize)+5), obj.flags);
-				}
-				break;
+				case TEXT:
+					rmanager.drawText(command.text, command.pos1, command.flags);
+					break;
 
-			case BLOB:
-				rmanager.drawBlob(obj.pos1, obj.col);
-				break;
+				case BLOB:
+					rmanager.drawBlob(command.pos1, command.col);
+					break;
 
-			default:
-				break;
+				default:
+					break;
+			}
 		}
-		mQueue->pop();
 	}
+	mQueue->clear();
 #if __DESKTOP__
 	if (mDrawCursor)
 	{
@@ -226,8 +354,7 @@ void IMGUI::doImage(int id, const Vector2& position, const std::string& name, co
 	obj.id = id;
 	obj.pos1 = position;
 	obj.pos2 = size;
-	obj.text = name;
-	mQueue->push(obj);
+	queueWidget(obj, name);
 }
 
 void IMGUI::doText(int id, const Vector2& position, const std::string& text, unsigned int flags)
@@ -241,18 +368,16 @@ void IMGUI::doText(int id, const Vector2& position, const std::string& text, uns
 	// update position depending on alignment
 	if( flags & TF_ALIGN_CENTER )
 	{
-		obj.pos1.x -= text.size() * fontSize / 2;
+		obj.pos1.x -= characterCount(text) * fontSize / 2;
 	}
 
 	if( flags & TF_ALIGN_RIGHT )
 	{
-		obj.pos1.x -= text.size() * fontSize;
+		obj.pos1.x -= characterCount(text) * fontSize;
 	}
 
-
-	obj.text = text;
 	obj.flags = flags;
-	mQueue->push(obj);
+	queueWidget(obj, text);
 }
 
 void IMGUI::doText(int id, const Vector2& position, TextManager::STRING text, unsigned int flags)
@@ -269,8 +394,7 @@ void IMGUI::doOverlay(int id, const Vector2& pos1, const Vector2& pos2, const Co
 	obj.pos2 = pos2;
 	obj.col = col;
 	obj.alpha = alpha;
-	mQueue->push(obj);
-	RenderManager::getSingleton().redraw();
+	queueWidget(obj);
 }
 
 bool IMGUI::doButton(int id, const Vector2& position, TextManager::STRING text, unsigned int flags)
@@ -284,7 +408,6 @@ bool IMGUI::doButton(int id, const Vector2& position, const std::string& text, u
 	QueueObject obj;
 	obj.id = id;
 	obj.pos1 = position;
-	obj.text = text;
 	obj.type = TEXT;
 	obj.flags = flags;
 
@@ -293,12 +416,12 @@ bool IMGUI::doButton(int id, const Vector2& position, const std::string& text, u
 	// update position depending on alignment
 	if( flags & TF_ALIGN_CENTER )
 	{
-		obj.pos1.x -= text.size() * fontSize / 2;
+		obj.pos1.x -= characterCount(text) * fontSize / 2;
 	}
 
 	if( flags & TF_ALIGN_RIGHT )
 	{
-		obj.pos1.x -= text.size() * fontSize;
+		obj.pos1.x -= characterCount(text) * fontSize;
 	}
 
 	if (!mInactive)
@@ -374,7 +497,7 @@ bool IMGUI::doButton(int id, const Vector2& position, const std::string& text, u
 		Vector2 mousepos = InputManager::getSingleton()->position();
 		if (mousepos.x + tolerance >= obj.pos1.x &&
 			mousepos.y + tolerance * 2 >= obj.pos1.y &&
-			mousepos.x - tolerance <= obj.pos1.x + text.length() * fontSize &&
+			mousepos.x - tolerance <= obj.pos1.x + characterCount(text) * fontSize &&
 			mousepos.y - tolerance * 2 <= obj.pos1.y + fontSize)
 		{
 			obj.flags = obj.flags
@@ -391,7 +514,7 @@ bool IMGUI::doButton(int id, const Vector2& position, const std::string& text, u
 	}
 
 	mLastWidget = id;
-	mQueue->push(obj);
+	queueWidget(obj, text);
 	return clicked;
 }
 
@@ -526,7 +649,7 @@ bool IMGUI::doScrollbar(int id, const Vector2& position, float& value)
 	obj.pos2.x = value;
 
 	mLastWidget = id;
-	mQueue->push(obj);
+	queueWidget(obj);
 
 	return deselected;
 }
@@ -743,10 +866,9 @@ bool IMGUI::doEditbox(int id, const Vector2& position, unsigned int length, std:
 	}
 
 	obj.pos2.x = SDL_GetTicks() % 1000 >= 500 ? cpos : -1.0;
-	obj.text = text;
 
 	mLastWidget = id;
-	mQueue->push(obj);
+	queueWidget(obj, text);
 
 	// when content changed, it is active
 	// part of chat window hack
@@ -893,21 +1015,15 @@ SelectBoxAction IMGUI::doSelectbox(int id, const Vector2& pos1, const Vector2& p
 	doImage(GEN_ID, Vector2(pos2.x-15, pos2.y-15), "gfx/pfeil_unten.bmp");
 
 	first = (selected / itemsPerPage)*itemsPerPage; //recalc first
-	if ( !entries.empty() )
-	{
-		unsigned int last = first + itemsPerPage;
-		if (last > entries.size())
-			last = entries.size();
-
-		obj.entries = std::vector<std::string>(entries.begin()+first, entries.begin()+last);
-	}
-	else
-		obj.entries = std::vector<std::string>();
+	// only the visible page is handed on, so long lists cost no more than short ones
+	int last = std::min<int>(first + itemsPerPage, entries.size());
+	if (first > last)
+		first = last;
 
 	obj.selected = selected-first;
 
 	mLastWidget = id;
-	mQueue->push(obj);
+	queueWidget(obj, "", entries.begin()+first, entries.begin()+last);
 
 	return changed;
 }
@@ -1029,9 +1145,13 @@ void IMGUI::doChatbox(int id, const Vector2& pos1, const Vector2& pos2, const st
 	doImage(GEN_ID, Vector2(pos2.x-15, pos2.y-15), "gfx/pfeil_unten.bmp");
 
 	unsigned int first = (selected / itemsPerPage) * itemsPerPage; //recalc first
+	unsigned int last = 0;
+	// HACK: we use text to store information which text is from local player and which from
+	//			remote player.
+	std::string origins;
 	if ( !entries.empty() )
 	{
-		unsigned int last = selected + 1;
+		last = selected + 1;
 		/// \todo maybe we should adapt selected so we even can't scroll up further!
 		// we don't want negative chatlog, so we just scroll upward without coming to negative
 		// elements.
@@ -1046,22 +1166,18 @@ void IMGUI::doChatbox(int id, const Vector2& pos1, const Vector2& pos2, const st
 			last = entries.size();
 		}
 
-		obj.entries = std::vector<std::string>(entries.begin()+first, entries.begin()+last);
-		// HACK: we use text to store information which text is from local player and which from
-		//			remote player.
-		obj.text = "";
 		for(unsigned int i = first; i < last; ++i)
 		{
-			obj.text += local[i] ? 'L' : 'R';
+			origins += local[i] ? 'L' : 'R';
 		}
 	}
 	else
-		obj.entries = std::vector<std::string>();
+		first = 0;
 
 	obj.selected = selected-first;
 
 	mLastWidget = id;
-	mQueue->push(obj);
+	queueWidget(obj, origins, entries.begin()+first, entries.begin()+last);
 }
 
 
@@ -1072,7 +1188,7 @@ bool IMGUI::doBlob(int id, const Vector2& position, const Color& col)
 	obj.pos1 = position;
 	obj.type = BLOB;
 	obj.col = col;
-	mQueue->push(obj);
+	queueWidget(obj);
 	return false;
 }
 
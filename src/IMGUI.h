@@ -47,6 +47,9 @@ enum SelectBoxAction
 	\details This class manages drawing and input handling of the blobby GUI.
 			It is poorly designed, does not use OOP and makes extension difficult, so
 			it needs a complete rewrite.
+			The widgets are still declared every frame, but their state is kept by widget id,
+			and the draw commands of a widget are only rebuilt when that state changes.
+			Select boxes only look at the rows on the visible page.
 */
 class IMGUI : public ObjectCounter<IMGUI>
 {
@@ -1,20 +1,102 @@
 #include "IScriptableComponent.h"
 
-#include "lua/lua.hpp"
+#include "LuaCompat.h"
 
 #include "Global.h"
 #include "GameConstants.h"
 #include "DuelMatch.h"
 #include "DuelMatchState.h"
 #include "FileRead.h"
+#include "LuaArena.h"
+#include "LuaProfiler.h"
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <stdexcept>
 
 // fwd decl
 int lua_print(lua_State* state);
 
-IScriptableComponent::IScriptableComponent() :
-	mState(luaL_newstate())	
+// a script may use at most this many bytes of memory
+static const std::size_t LUA_MEMORY_LIMIT = 32 * 1024 * 1024;
+// a single call into a script may execute at most this many lua instructions. The most
+// expensive shipped bot needs about 600000 in its worst frames.
+static const long LUA_INSTRUCTION_LIMIT = 10000000;
+// the instruction budget is checked after this many instructions
+static const int LUA_HOOK_INTERVAL = 1000;
+
+namespace
+{
+	double millisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	int collectGarbage(lua_State* state)
+	{
+		lua_gc(state, LUA_GCSTEP, (int)lua_tointeger(state, 1));
+		return 0;
+	}
+}
+
+// registry keys, only their addresses are used
+static const char OWNER_KEY = 0;
+static const char GLOBALS_KEY = 0;
+static const char METATABLES_KEY = 0;
+
+namespace
+{
+	/// copies the fields of the table on top of the stack into \p snapshot, indexed by the
+	/// table, and its metatable into \p metatables. Continues with the tables it references.
+	void snapshotTable(lua_State* state, int snapshot, int metatables)
+	{
+		lua_checkstack(state, 8);
+		int table = lua_gettop(state);
+		lua_pushvalue(state, table);
+		lua_rawget(state, snapshot);
+		bool visited = !lua_isnil(state, -1);
+		lua_pop(state, 1);
+		if (visited)
+			return;
+
+		lua_newtable(state);
+		int copy = lua_gettop(state);
+		lua_pushvalue(state, table);
+		lua_pushvalue(state, copy);
+		lua_rawset(state, snapshot);
+
+		if (lua_getmetatable(state, table))
+		{
+			lua_pushvalue(state, table);
+			lua_pushvalue(state, -2);
+			lua_rawset(state, metatables);
+			snapshotTable(state, snapshot, metatables);
+			lua_pop(state, 1);
+		}
+
+		lua_pushnil(state);
+		while (lua_next(state, table))
+		{
+			lua_pushvalue(state, -2);
+			lua_pushvalue(state, -2);
+			lua_rawset(state, copy);
+			if (lua_type(state, -1) == LUA_TTABLE)
+				snapshotTable(state, snapshot, metatables);
+			lua_pop(state, 1);
+		}
+		lua_pop(state, 1);
+	}
+}
+
+IScriptableComponent::IScriptableComponent() : IScriptableComponent(nullptr)
+{
+}
+
+IScriptableComponent::IScriptableComponent(lua_State* state) :
+	mState(state),
+	mInstructionBudget(-1),
+	mOutput(&std::cout)
 {
 	bool playerEnabled[MAX_PLAYERS];
 	for (int i = 0; i < MAX_PLAYERS; ++i)
@@ -24,28 +106,61 @@ IScriptableComponent::IScriptableComponent() :
 
 	mDummyWorld = PhysicWorld(playerEnabled);
 
-	// register this in the lua registry
-	lua_pushliteral(mState, "__C++_ScriptComponent__");
-	lua_pushlightuserdata(mState, (void*)this);
-	lua_settable(mState, LUA_REGISTRYINDEX);
+	if (!mState)
+	{
+		mState = LuaArena::newState();
+		// fails with LuaJIT builds that do not support custom allocators
+		if (!mState)
+			BOOST_THROW_EXCEPTION(std::runtime_error("Could not create a lua state"));
+
+		lua_register(mState, "print", lua_print);
+
+		// open math lib
+		luaL_requiref(mState, "math", luaopen_math, 1);
+		luaL_requiref(mState, "base", luaopen_base, 1);
+		lua_pop(mState, 2);
 
-	lua_register(mState, "print", lua_print);
+		// the owner reference passed to all registered functions
+		lua_newuserdata(mState, sizeof(IScriptableComponent*));
+		lua_rawsetp(mState, LUA_REGISTRYINDEX, &OWNER_KEY);
 
-	// open math lib
-	luaL_requiref(mState, "math", luaopen_math, 1);
-	luaL_requiref(mState, "base", luaopen_base, 1);
+		// garbage is collected in steps driven by the frame loop, see stepGarbageCollector
+		lua_gc(mState, LUA_GCSTOP, 0);
+	}
+
+	// set for reused states too, the previous owner may have enabled the profiler
+	lua_sethook(mState, scriptHook, LUA_MASKCOUNT, LUA_HOOK_INTERVAL);
+
+	lua_rawgetp(mState, LUA_REGISTRYINDEX, &OWNER_KEY);
+	mOwner = (IScriptableComponent**)lua_touserdata(mState, -1);
+	*mOwner = this;
+	lua_pop(mState, 1);
+
+	LuaArena* arena = LuaArena::fromState(mState);
+	arena->resetPeakMemory();
+	mCollectedAllocations = arena->getAllocatedMemory();
 }
 
 IScriptableComponent::~IScriptableComponent()
 {
-	lua_close(mState);
+	if (mState)
+		LuaArena::closeState(mState);
 }
 
 void IScriptableComponent::openScript(std::string file)
 {
-	int error = FileRead::readLuaScript(file, mState);
+	runScript(FileRead::readLuaScript(file, mState));
+}
+
+void IScriptableComponent::openScript(const std::string& name, const std::string& source)
+{
+	runScript(FileRead::readLuaScript(name, source, mState));
+}
+
+void IScriptableComponent::runScript(int error)
+{
 	if (error == 0)
-		error = lua_pcall(mState, 0, 0, 0);
+		error = protectedCall(0, 0);
 
 	if (error)
 	{
@@ -75,14 +190,216 @@ bool IScriptableComponent::getLuaFunction(const char* fname) const
 	return true;
 }
 
-void IScriptableComponent::callLuaFunction(int arg_count)
+int IScriptableComponent::getLuaFunctionRef(const char* fname)
+{
+	if (!getLuaFunction(fname))
+		return LUA_NOREF;
+
+	return luaL_ref(mState, LUA_REGISTRYINDEX);
+}
+
+bool IScriptableComponent::pushLuaFunction(int ref) const
+{
+	if (ref < 0)
+		return false;
+
+	lua_rawgeti(mState, LUA_REGISTRYINDEX, ref);
+	return true;
+}
+
+void IScriptableComponent::registerLuaFunction(const char* name, int (*function)(lua_State*))
+{
+	lua_rawgetp(mState, LUA_REGISTRYINDEX, &OWNER_KEY);
+	lua_pushcclosure(mState, function, 1);
+	lua_setglobal(mState, name);
+}
+
+void IScriptableComponent::saveGlobals()
+{
+	// a script can change the libraries too, e.g. math.floor, or set a metatable for _G
+	lua_settop(mState, 0);
+	lua_newtable(mState);
+	lua_newtable(mState);
+	lua_pushglobaltable(mState);
+	snapshotTable(mState, 1, 2);
+	lua_pop(mState, 1);
+	lua_rawsetp(mState, LUA_REGISTRYINDEX, &METATABLES_KEY);
+	lua_rawsetp(mState, LUA_REGISTRYINDEX, &GLOBALS_KEY);
+}
+
+bool IScriptableComponent::hasSavedGlobals() const
+{
+	bool saved = lua_rawgetp(mState, LUA_REGISTRYINDEX, &GLOBALS_KEY) == LUA_TTABLE;
+	lua_pop(mState, 1);
+	return saved;
+}
+
+void IScriptableComponent::resetGlobals()
 {
-	if (lua_pcall(mState, arg_count, 0, 0))
+	lua_settop(mState, 0);
+	lua_rawgetp(mState, LUA_REGISTRYINDEX, &GLOBALS_KEY);
+	lua_rawgetp(mState, LUA_REGISTRYINDEX, &METATABLES_KEY);
+
+	// the snapshot maps each table to a copy of its fields
+	lua_pushnil(mState);
+	while (lua_next(mState, 1))
+	{
+		const int table = 3;
+		const int copy = 4;
+
+		// remove new fields. Clearing fields is allowed while traversing a table.
+		lua_pushnil(mState);
+		while (lua_next(mState, table))
+		{
+			lua_pop(mState, 1);
+			lua_pushvalue(mState, -1);
+			lua_rawget(mState, copy);
+			if (lua_isnil(mState, -1))
+			{
+				lua_pushvalue(mState, -2);
+				lua_pushnil(mState);
+				lua_rawset(mState, table);
+			}
+			lua_pop(mState, 1);
+		}
+
+		// restore the saved values
+		lua_pushnil(mState);
+		while (lua_next(mState, copy))
+		{
+			lua_pushvalue(mState, -2);
+			lua_insert(mState, -2);
+			lua_rawset(mState, table);
+		}
+
+		// restore the metatable, or remove one the script has set
+		lua_pushvalue(mState, table);
+		lua_rawget(mState, 2);
+		lua_setmetatable(mState, table);
+
+		lua_pop(mState, 1);
+	}
+
+	lua_settop(mState, 0);
+}
+
+bool IScriptableComponent::callLuaFunction(int arg_count, int result_count) const
+{
+	if (protectedCall(arg_count, result_count))
 	{
 		std::cerr << "Lua Error: " << lua_tostring(mState, -1);
 		std::cerr << std::endl;
 		lua_pop(mState, 1);
+		return false;
+	}
+
+	return true;
+}
+
+int IScriptableComponent::protectedCall(int arg_count, int result_count) const
+{
+	// calls made from inside a running call, e.g. rules handlers triggered by
+	// a registered function, share the budget and time of the outer call
+	bool outermost = mInstructionBudget < 0;
+	auto start = std::chrono::steady_clock::now();
+	// the C++ code outside of protected calls would make lua panic if an allocation
+	// failed, so the memory limit only applies while the script runs
+	LuaArena* arena = LuaArena::fromState(mState);
+	if (outermost)
+	{
+		mInstructionBudget = LUA_INSTRUCTION_LIMIT;
+		arena->setLimit(LUA_MEMORY_LIMIT);
+	}
+
+	std::size_t depth = mProfiler ? mProfiler->getDepth() : 0;
+	int error = lua_pcall(mState, arg_count, result_count, 0);
+	if (mProfiler)
+		mProfiler->unwind(depth);
+
+	mStats.calls++;
+	if (error)
+		mStats.errors++;
+
+	if (outermost)
+	{
+		mInstructionBudget = -1;
+		arena->setLimit(0);
+		double time = millisecondsSince(start);
+		mStats.callTime += time;
+		mStats.maxCallTime = std::max(mStats.maxCallTime, time);
 	}
+
+	return error;
+}
+
+void IScriptableComponent::scriptHook(lua_State* state, lua_Debug* ar)
+{
+	lua_rawgetp(state, LUA_REGISTRYINDEX, &OWNER_KEY);
+	IScriptableComponent* owner = *(IScriptableComponent**)lua_touserdata(state, -1);
+	lua_pop(state, 1);
+
+	if (ar->event == LUA_HOOKCALL || ar->event == LUA_HOOKTAILCALL)
+	{
+		owner->mProfiler->onCall(state, ar);
+		return;
+	}
+	if (ar->event == LUA_HOOKRET)
+	{
+		owner->mProfiler->onReturn();
+		return;
+	}
+	if (ar->event != LUA_HOOKCOUNT)
+		return;
+
+	// only calls made through protectedCall are limited
+	if (owner->mInstructionBudget < 0)
+		return;
+
+	owner->mInstructionBudget -= LUA_HOOK_INTERVAL;
+	if (owner->mInstructionBudget <= 0)
+		luaL_error(state, "script exceeded the limit of %d instructions per call", (int)LUA_INSTRUCTION_LIMIT);
+}
+
+void IScriptableComponent::stepGarbageCollector()
+{
+	auto start = std::chrono::steady_clock::now();
+
+	// pay the collector for everything allocated since the last step. This paces the
+	// collection like lua would, but the work happens here instead of inside a script.
+	LuaArena* arena = LuaArena::fromState(mState);
+	std::size_t allocated = arena->getAllocatedMemory() - mCollectedAllocations;
+	mCollectedAllocations = arena->getAllocatedMemory();
+	// finalizers of the script may fail, which must not reach the game unprotected
+	lua_pushcfunction(mState, collectGarbage);
+	lua_pushinteger(mState, int(allocated / 1024) + 1);
+	if (lua_pcall(mState, 1, 0, 0))
+	{
+		std::cerr << "Lua Error: " << lua_tostring(mState, -1) << std::endl;
+		lua_pop(mState, 1);
+	}
+
+	mStats.gcTime += millisecondsSince(start);
+
+	if (mProfiler)
+		mProfiler->endFrame();
+}
+
+void IScriptableComponent::enableProfiler()
+{
+	if (mProfiler)
+		return;
+
+	mProfiler.reset(new LuaProfiler());
+	lua_sethook(mState, scriptHook, LUA_MASKCOUNT | LUA_MASKCALL | LUA_MASKRET, LUA_HOOK_INTERVAL);
+}
+
+ScriptStats IScriptableComponent::getScriptStats() const
+{
+	ScriptStats stats = mStats;
+	LuaArena* arena = LuaArena::fromState(mState);
+	stats.memory = arena->getUsedMemory();
+	stats.peakMemory = arena->getPeakMemory();
+	return stats;
 }
 
 void IScriptableComponent::setGameConstants()
@@ -108,16 +425,13 @@ void IScriptableComponent::setGameConstants()
 	setLuaGlobal("RIGHT_PLAYER", RIGHT_PLAYER);
 }
 
-// helpers
-inline IScriptableComponent* getScriptComponent(lua_State* state)
+IScriptableComponent* IScriptableComponent::getScriptComponent(lua_State* state)
 {
-	lua_pushliteral(state, "__C++_ScriptComponent__");
-	lua_gettable(state, LUA_REGISTRYINDEX);
-	void* result = lua_touserdata(state, -1);
-	lua_pop(state, 1);
-	return (IScriptableComponent*)result;
+	return *(IScriptableComponent**)lua_touserdata(state, lua_upvalueindex(1));
 }
 
+// helpers
+
 enum class VectorType
 {
 	POSITION,
@@ -159,6 +473,15 @@ struct IScriptableComponent::Access
 		auto sc = getScriptComponent( state );
 		return &sc->mDummyWorld;
 	}
+
+	static std::ostream* getOutput( lua_State* state )
+	{
+		// print is registered before the owner reference exists, so it has no upvalue
+		lua_rawgetp(state, LUA_REGISTRYINDEX, &OWNER_KEY);
+		auto sc = *(IScriptableComponent**)lua_touserdata(state, -1);
+		lua_pop(state, 1);
+		return sc->mOutput;
+	}
 };
 
 inline DuelMatch* getMatch( lua_State* s )  { return IScriptableComponent::Access::getMatch(s); };
@@ -365,40 +688,47 @@ int simulate_until(lua_State* state)
 
 int lua_print(lua_State* state)
 {
+	std::ostream* output = IScriptableComponent::Access::getOutput(state);
+	if (!output)
+	{
+		lua_pop(state, lua_gettop(state));
+		return 0;
+	}
+
 	int count = lua_gettop(state);
 	for( int i = 1; i <= count; ++i)
 	{
 		lua_pushvalue(state, i);
 		const char* str = lua_tostring(state, -1);
-		std::cout << (i != 1 ? ", " : "");
+		*output << (i != 1 ? ", " : "");
 		if(str)
-		 std::cout << str;
+		 *output << str;
 		else
-		std::cout << "[" << lua_typename(state, lua_type(state, -1)) << "]";
+		*output << "[" << lua_typename(state, lua_type(state, -1)) << "]";
 	}
-	std::cout << "\n";
+	*output << "\n";
 	lua_pop(state, lua_gettop(state));
 	return 0;
 }
 
 void IScriptableComponent::setGameFunctions()
 {
-	lua_register(mState, "get_ball_pos", get_ball_pos);
-	lua_register(mState, "get_ball_vel", get_ball_vel);
-	lua_register(mState, "get_blob_pos", get_blob_pos);
-	lua_register(mState, "get_blob_vel", get_blob_vel);
-	lua_register(mState, "get_score", get_score);
-	lua_register(mState, "get_touches", get_touches);
-	lua_register(mState, "get_players_count_in_team", get_players_count_in_team);
-	lua_register(mState, "is_ball_valid", get_ball_valid);
-	lua_register(mState, "is_game_running", get_game_running);
-	lua_register(mState, "get_serving_player", get_serving_player);
-	lua_register(mState, "simulate", simulate_steps);
-	lua_register(mState, "simulate_until", simulate_until);
+	registerLuaFunction("get_ball_pos", get_ball_pos);
+	registerLuaFunction("get_ball_vel", get_ball_vel);
+	registerLuaFunction("get_blob_pos", get_blob_pos);
+	registerLuaFunction("get_blob_vel", get_blob_vel);
+	registerLuaFunction("get_score", get_score);
+	registerLuaFunction("get_touches", get_touches);
+	registerLuaFunction("get_players_count_in_team", get_players_count_in_team);
+	registerLuaFunction("is_ball_valid", get_ball_valid);
+	registerLuaFunction("is_game_running", get_game_running);
+	registerLuaFunction("get_serving_player", get_serving_player);
+	registerLuaFunction("simulate", simulate_steps);
+	registerLuaFunction("simulate_until", simulate_until);
 
 	#ifndef NDEBUG
 	// only enable this function in debug builds.
-	lua_register(mState, "set_ball_data", set_ball_data);
-	lua_register(mState, "set_blob_data", set_blob_data);
+	registerLuaFunction("set_ball_data", set_ball_data);
+	registerLuaFunction("set_blob_data", set_blob_data);
 	#endif
 }
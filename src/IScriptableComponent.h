@@ -20,31 +20,105 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #pragma once
 
+#include <iosfwd>
+#include <memory>
 #include <string>
 #include "PhysicWorld.h"
 
 struct lua_State;
+struct lua_Debug;
 class DuelMatch;
+class LuaProfiler;
+
+/// memory and time used by a lua state, see IScriptableComponent::getScriptStats
+struct ScriptStats
+{
+	/// bytes currently used by the lua state
+	std::size_t memory = 0;
+	/// maximum bytes used since the component has been created
+	std::size_t peakMemory = 0;
+	/// number of lua functions called by the component
+	unsigned calls = 0;
+	/// number of these calls that failed
+	unsigned errors = 0;
+	/// time spent in lua calls, in milliseconds
+	double callTime = 0;
+	/// longest single call, in milliseconds
+	double maxCallTime = 0;
+	/// time spent in garbage collection steps, in milliseconds
+	double gcTime = 0;
+};
 
 /*! \class IScriptableComponent
 	\brief Base class for lua scripted objects.
 	\details Use this class as base class for objects that support lua scripting. It defines some commonly used functions to make
-			coding easier. Does not define any public methods.
+			coding easier.
+			Each state gets a memory limit and an instruction budget per call, so runaway scripts
+			fail with a lua error instead of blocking the game. The memory limit only applies
+			while a script runs, so the game itself can always use the state. The garbage collector does not run
+			on its own; derived classes call stepGarbageCollector() once per frame instead.
 */
 class IScriptableComponent
 {
 public:
 	struct Access;
+
+	ScriptStats getScriptStats() const;
+
+	/// starts measuring the time of all functions called by the script
+	void enableProfiler();
+	/// \return nullptr if the profiler has not been enabled
+	const LuaProfiler* getProfiler() const { return mProfiler.get(); }
 protected:
 	IScriptableComponent();
+	/// uses \p state, which has been prepared by an earlier component of the same type
+	/// and reset with resetGlobals(). Creates a new state if \p state is null.
+	explicit IScriptableComponent(lua_State* state);
 	virtual ~IScriptableComponent();
 
 	void openScript(std::string file);
+	/// runs the script \p source, e.g. rules stored in a replay. \p name is used for
+	/// error messages and the script cache, see FileRead::readLuaScript.
+	void openScript(const std::string& name, const std::string& source);
+	/// sets where print() of the script writes to, std::cout by default.
+	/// Nothing is printed if \p output is null.
+	void setOutput(std::ostream* output) { mOutput = output; }
+	std::ostream* getOutput() const { return mOutput; }
 	void setLuaGlobal(const char* name, double value);
 	bool getLuaFunction(const char* name) const;
 
-	// calls a lua function that is on the stack and performs error handling
-	void callLuaFunction(int arg_count = 0);
+	/// looks up the global lua function \p name once and keeps a reference to it
+	/// in the registry, so per frame callbacks do not need a lookup by name.
+	/// \return the reference for pushLuaFunction, or a negative value if \p name
+	///			is not a function.
+	int getLuaFunctionRef(const char* name);
+	/// pushes a function referenced by getLuaFunctionRef onto the stack.
+	/// \return false, without pushing anything, if \p ref is invalid.
+	bool pushLuaFunction(int ref) const;
+	/// registers \p function as global \p name. The function gets a reference to
+	/// the component that currently uses the state as first upvalue, see getScriptComponent.
+	void registerLuaFunction(const char* name, int (*function)(lua_State*));
+
+	/// gets the component that uses \p state. Only valid inside of functions
+	/// registered with registerLuaFunction.
+	static IScriptableComponent* getScriptComponent(lua_State* state);
+
+	/// remembers the current global variables, so the state can be reset and reused.
+	/// The fields and metatables of all tables reachable from the globals, like math,
+	/// are remembered too.
+	void saveGlobals();
+	/// whether saveGlobals() has been called for this state
+	bool hasSavedGlobals() const;
+	/// restores the tables remembered by saveGlobals(). Tables created later are dropped
+	/// with the fields that reference them. Upvalues of the functions are not restored.
+	void resetGlobals();
+
+	/// calls a lua function that is on the stack and performs error handling.
+	/// \return false if the call failed. In that case, no results are left on the stack.
+	bool callLuaFunction(int arg_count = 0, int result_count = 0) const;
+	/// collects the garbage produced since the last call. Meant to be called once
+	/// per frame, after the scripts have run, it also counts the frames for the profiler.
+	void stepGarbageCollector();
 
 	// load lua functions
 	void setGameConstants();
@@ -55,6 +129,24 @@ protected:
 	lua_State* mState;
 
 private:
+	/// runs the chunk loaded by FileRead::readLuaScript, or throws if \p error is set
+	void runScript(int error);
+	/// lua_pcall with instruction budget and time measurement
+	int protectedCall(int arg_count, int result_count) const;
+	/// instruction budget and profiler
+	static void scriptHook(lua_State* state, lua_Debug* ar);
+
+	// points to the component using the state, shared by all registered functions
+	IScriptableComponent** mOwner;
+
+	// instructions the current call may still execute, negative when no call is running
+	mutable long mInstructionBudget;
+	// memory allocated by the state up to the last garbage collection step
+	std::size_t mCollectedAllocations;
+	mutable ScriptStats mStats;
+	std::unique_ptr<LuaProfiler> mProfiler;
+	std::ostream* mOutput;
+
 	DuelMatch* mGame;
 	// we save a dummy physic world here to do simulations
 	PhysicWorld mDummyWorld;
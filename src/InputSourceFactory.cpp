@@ -26,6 +26,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "IUserConfigReader.h"
 #include "LocalInputSource.h"
+#include "NativeInputSource.h"
 #include "ScriptedInputSource.h"
 #include "UserConfig.h"
 
@@ -45,7 +46,13 @@ std::shared_ptr<InputSource> InputSourceFactory::createInputSource( std::shared_
 			return std::make_shared<LocalInputSource>(side, side);
 		}
 
-		return std::make_shared<ScriptedInputSource>("scripts/" + config->getString(prefix + "_script_name"),
+		std::string script = config->getString(prefix + "_script_name");
+		if (NativeInputSource::isNativeBot(script))
+		{
+			return std::make_shared<NativeInputSource>(script, side, config->getInteger(prefix + "_script_strength"));
+		}
+
+		return std::make_shared<ScriptedInputSource>("scripts/" + script,
 		                                             side, config->getInteger(prefix + "_script_strength"));
 	} catch (std::exception& e)
 	{
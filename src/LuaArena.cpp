@@ -0,0 +1,191 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+/* header include */
+#include "LuaArena.h"
+
+/* includes */
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "LuaCompat.h"
+
+/* implementation */
+
+lua_State* LuaArena::newState()
+{
+	LuaArena* arena = new LuaArena();
+	lua_State* state = lua_newstate(luaAllocate, arena);
+	if (!state)
+		delete arena;
+
+	return state;
+}
+
+void LuaArena::closeState(lua_State* state)
+{
+	LuaArena* arena = fromState(state);
+	lua_close(state);
+	delete arena;
+}
+
+LuaArena* LuaArena::fromState(lua_State* state)
+{
+	void* arena;
+	lua_getallocf(state, &arena);
+	return static_cast<LuaArena*>(arena);
+}
+
+LuaArena::LuaArena() :
+	mChunkPosition(nullptr),
+	mChunkEnd(nullptr),
+	mLimit(0),
+	mUsed(0),
+	mPeak(0),
+	mAllocated(0)
+{
+	std::fill(mFreeBlocks, mFreeBlocks + SIZE_CLASSES, nullptr);
+}
+
+LuaArena::~LuaArena()
+{
+	for (char* chunk : mChunks)
+		std::free(chunk);
+}
+
+void* LuaArena::allocate(std::size_t size)
+{
+	if (size > MAX_SMALL_SIZE)
+		return std::malloc(size);
+
+	std::size_t index = sizeClass(size);
+	if (void* block = mFreeBlocks[index])
+	{
+		mFreeBlocks[index] = *static_cast<void**>(block);
+		return block;
+	}
+
+	std::size_t blockSize = (index + 1) * GRANULARITY;
+	if (mChunkPosition + blockSize > mChunkEnd)
+	{
+		// the rest of the old chunk is lost, but that is less than MAX_SMALL_SIZE
+		char* chunk = static_cast<char*>(std::malloc(CHUNK_SIZE));
+		if (!chunk)
+			return nullptr;
+
+		mChunks.push_back(chunk);
+		mChunkPosition = chunk;
+		mChunkEnd = chunk + CHUNK_SIZE;
+	}
+
+	void* block = mChunkPosition;
+	mChunkPosition += blockSize;
+	return block;
+}
+
+void LuaArena::deallocate(void* block, std::size_t size)
+{
+	if (size > MAX_SMALL_SIZE)
+	{
+		std::free(block);
+		return;
+	}
+
+	std::size_t index = sizeClass(size);
+	*static_cast<void**>(block) = mFreeBlocks[index];
+	mFreeBlocks[index] = block;
+}
+
+void* LuaArena::reallocate(void* block, std::size_t oldSize, std::size_t newSize)
+{
+	if (oldSize > MAX_SMALL_SIZE && newSize > MAX_SMALL_SIZE)
+		return std::realloc(block, newSize);
+
+	// the block is big enough already
+	if (oldSize <= MAX_SMALL_SIZE && newSize <= MAX_SMALL_SIZE && sizeClass(oldSize) == sizeClass(newSize))
+		return block;
+
+	void* result = allocate(newSize);
+	if (!result)
+	{
+		// lua expects shrinking to succeed
+		if (newSize > oldSize)
+			return nullptr;
+
+		// the old block is big enough, it is just put into the free list of the smaller
+		// size class later. A block from malloc is kept as a chunk of its own then, so
+		// it is released with the arena instead of being lost in the free list.
+		if (oldSize > MAX_SMALL_SIZE)
+		{
+			try
+			{
+				mChunks.push_back(static_cast<char*>(block));
+			}
+			catch (const std::bad_alloc&)
+			{
+				// this only leaks the block, the state stays usable
+			}
+		}
+		return block;
+	}
+
+	std::memcpy(result, block, std::min(oldSize, newSize));
+	deallocate(block, oldSize);
+	return result;
+}
+
+void* LuaArena::luaAllocate(void* ud, void* block, std::size_t oldSize, std::size_t newSize)
+{
+	LuaArena* arena = static_cast<LuaArena*>(ud);
+	if (newSize == 0)
+	{
+		if (block)
+		{
+			arena->deallocate(block, oldSize);
+			arena->mUsed -= oldSize;
+		}
+		return nullptr;
+	}
+
+	// for new blocks, oldSize encodes the type of the object
+	if (!block)
+		oldSize = 0;
+
+	if (newSize > oldSize)
+	{
+		std::size_t growth = newSize - oldSize;
+		if (arena->mLimit != 0 && arena->mUsed + growth > arena->mLimit)
+			return nullptr;
+
+		void* result = block ? arena->reallocate(block, oldSize, newSize) : arena->allocate(newSize);
+		if (result)
+		{
+			arena->mUsed += growth;
+			arena->mAllocated += growth;
+			arena->mPeak = std::max(arena->mPeak, arena->mUsed);
+		}
+		return result;
+	}
+
+	arena->mUsed -= oldSize - newSize;
+	return arena->reallocate(block, oldSize, newSize);
+}
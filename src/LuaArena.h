@@ -0,0 +1,92 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include "BlobbyDebug.h"
+
+struct lua_State;
+
+/*! \class LuaArena
+	\brief memory arena for the allocations of a single lua state
+	\details Lua allocates lots of small objects (strings, tables, closures). LuaArena
+			serves these from large chunks, using one free list per size class. Lua
+			passes the size of a block when it frees it, so no block headers are needed.
+			Bigger blocks are forwarded to malloc. All memory is released when the
+			arena, i.e. the lua state, is destroyed.
+			The arena counts the memory used by the state, and refuses allocations above
+			its limit. Lua then runs a full garbage collection, and raises a memory error
+			if that does not help.
+			An arena is not thread safe, just like the lua state it belongs to.
+*/
+class LuaArena : public ObjectCounter<LuaArena>, public boost::noncopyable
+{
+	public:
+		/// creates a lua state that uses a new arena for all its allocations
+		static lua_State* newState();
+		/// closes a state created by newState() and releases its arena
+		static void closeState(lua_State* state);
+		/// gets the arena of a state created by newState()
+		static LuaArena* fromState(lua_State* state);
+
+		LuaArena();
+		~LuaArena();
+
+		void* allocate(std::size_t size);
+		void deallocate(void* block, std::size_t size);
+		void* reallocate(void* block, std::size_t oldSize, std::size_t newSize);
+
+		/// sets the maximum number of bytes the state may use, 0 means no limit
+		void setLimit(std::size_t limit) { mLimit = limit; }
+		/// bytes currently used by the state
+		std::size_t getUsedMemory() const { return mUsed; }
+		/// maximum of getUsedMemory() since the last resetPeakMemory()
+		std::size_t getPeakMemory() const { return mPeak; }
+		void resetPeakMemory() { mPeak = mUsed; }
+		/// sum of all growing allocations, i.e. how much garbage may have been produced
+		std::size_t getAllocatedMemory() const { return mAllocated; }
+
+	private:
+		/// lua_Alloc compatible allocation function, \p ud is the arena
+		static void* luaAllocate(void* ud, void* block, std::size_t oldSize, std::size_t newSize);
+
+		static const std::size_t GRANULARITY = 16;
+		static const std::size_t MAX_SMALL_SIZE = 256;
+		static const std::size_t SIZE_CLASSES = MAX_SMALL_SIZE / GRANULARITY;
+		static const std::size_t CHUNK_SIZE = 64 * 1024;
+
+		static std::size_t sizeClass(std::size_t size) { return (size - 1) / GRANULARITY; }
+
+		std::vector<char*> mChunks;
+		char* mChunkPosition;
+		char* mChunkEnd;
+		/// singly linked lists of free blocks, the link is stored in the block itself
+		void* mFreeBlocks[SIZE_CLASSES];
+
+		std::size_t mLimit;
+		std::size_t mUsed;
+		std::size_t mPeak;
+		std::size_t mAllocated;
+};
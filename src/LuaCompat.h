@@ -0,0 +1,105 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+/**
+ * @file LuaCompat.h
+ * @brief Includes the headers of the lua implementation the game is built with
+ *
+ * By default, the bundled lua 5.3 is used. With the CMake option USE_LUAJIT, the game
+ * is built against LuaJIT instead, which implements the lua 5.1 api. The functions of
+ * newer lua versions the game needs are provided here for it.
+ *
+ * Differences scripts can observe with LuaJIT:
+ *  - there is no integer subtype, lua_tointeger truncates numbers and 3/1 prints as "3".
+ *  - math.random does not use the C rand(), so bots get other random numbers.
+ *  - compiled code does not run hooks: the instruction budget of a script
+ *    (LUA_INSTRUCTION_LIMIT) is only checked while the interpreter runs, and the
+ *    profiler sees tail calls as normal calls.
+ */
+
+#pragma once
+
+#ifdef BLOBBY_USE_LUAJIT
+extern "C"
+{
+#include <lua.h>
+#include <lauxlib.h>
+#include <lualib.h>
+#include <luajit.h>
+}
+#else
+extern "C"
+{
+#include "lua/lua.h"
+#include "lua/lauxlib.h"
+#include "lua/lualib.h"
+}
+#endif
+
+#if LUA_VERSION_NUM < 502
+
+// LuaJIT does not report tail calls, they are normal calls for its hooks. The 5.1
+// LUA_HOOKTAILRET is a return event, so the tail call event gets a value no hook sees.
+#define LUA_HOOKTAILCALL -1
+
+// LuaJIT has the mode parameter in lua_loadx, and never strips debug information
+#define lua_load(state, reader, data, chunkname, mode) lua_loadx(state, reader, data, chunkname, mode)
+#define lua_dump(state, writer, data, strip) (lua_dump)(state, writer, data)
+
+inline int lua_absindex(lua_State* state, int index)
+{
+	return index > 0 || index <= LUA_REGISTRYINDEX ? index : lua_gettop(state) + index + 1;
+}
+
+inline void lua_pushglobaltable(lua_State* state)
+{
+	lua_pushvalue(state, LUA_GLOBALSINDEX);
+}
+
+inline int lua_rawgetp(lua_State* state, int index, const void* key)
+{
+	index = lua_absindex(state, index);
+	lua_pushlightuserdata(state, const_cast<void*>(key));
+	lua_rawget(state, index);
+	return lua_type(state, -1);
+}
+
+inline void lua_rawsetp(lua_State* state, int index, const void* key)
+{
+	index = lua_absindex(state, index);
+	lua_pushlightuserdata(state, const_cast<void*>(key));
+	lua_insert(state, -2);
+	lua_rawset(state, index);
+}
+
+inline void luaL_requiref(lua_State* state, const char* name, lua_CFunction open, int global)
+{
+	// the 5.1 libraries register their globals themselves
+	lua_pushcfunction(state, open);
+	lua_pushstring(state, name);
+	lua_call(state, 1, 1);
+	if (global)
+	{
+		lua_pushvalue(state, -1);
+		lua_setglobal(state, name);
+	}
+}
+
+#endif
@@ -0,0 +1,126 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+/* header include */
+#include "LuaProfiler.h"
+
+/* includes */
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+
+#include "LuaCompat.h"
+
+/* implementation */
+
+void LuaProfiler::onCall(lua_State* state, lua_Debug* ar)
+{
+	clock::time_point now = clock::now();
+
+	// a tail call replaces the running function, which gets no return event
+	if (ar->event == LUA_HOOKTAILCALL && !mStack.empty())
+		finish(now);
+
+	lua_getinfo(state, "S", ar);
+	Entry* entry;
+	if (*ar->what == 'C')
+	{
+		lua_getinfo(state, "f", ar);
+		entry = &mFunctions[lua_tocfunction(state, -1)];
+		lua_pop(state, 1);
+	}
+	else
+	{
+		// closures are created all the time, and a new one may get the address of a
+		// collected one, so they are told apart by their definition
+		mKey.assign(ar->source);
+		mKey += ':';
+		mKey += std::to_string(ar->linedefined);
+		entry = &mEntries[mKey];
+	}
+
+	if (entry->calls == 0)
+	{
+		lua_getinfo(state, "n", ar);
+		entry->name = ar->name ? ar->name : "?";
+		if (*ar->what != 'C')
+			entry->name += std::string(" (") + ar->short_src + ":" + std::to_string(ar->linedefined) + ")";
+	}
+	++entry->calls;
+
+	mStack.push_back(Frame{entry, now, 0});
+}
+
+void LuaProfiler::onReturn()
+{
+	if (!mStack.empty())
+		finish(clock::now());
+}
+
+void LuaProfiler::unwind(std::size_t depth)
+{
+	clock::time_point now = clock::now();
+	while (mStack.size() > depth)
+		finish(now);
+}
+
+void LuaProfiler::finish(clock::time_point now)
+{
+	Frame frame = mStack.back();
+	mStack.pop_back();
+
+	double time = std::chrono::duration<double, std::milli>(now - frame.start).count();
+	frame.entry->totalTime += time;
+	frame.entry->selfTime += time - frame.childTime;
+	if (!mStack.empty())
+		mStack.back().childTime += time;
+}
+
+std::vector<LuaProfiler::Entry> LuaProfiler::getEntries() const
+{
+	std::vector<Entry> entries;
+	entries.reserve(mEntries.size() + mFunctions.size());
+	for (const auto& entry : mEntries)
+		entries.push_back(entry.second);
+	for (const auto& entry : mFunctions)
+		entries.push_back(entry.second);
+
+	std::sort(entries.begin(), entries.end(),
+		[](const Entry& a, const Entry& b) { return a.selfTime > b.selfTime; });
+	return entries;
+}
+
+void LuaProfiler::writeReport(std::ostream& stream) const
+{
+	stream << mFrames << " frames\n";
+	stream << std::setw(10) << "calls" << std::setw(12) << "total ms" << std::setw(12) << "self ms"
+			<< std::setw(12) << "us/frame" << "  function\n";
+
+	std::ios::fmtflags flags = stream.flags();
+	std::streamsize precision = stream.precision();
+	stream << std::fixed << std::setprecision(3);
+	for (const auto& entry : getEntries())
+	{
+		stream << std::setw(10) << entry.calls << std::setw(12) << entry.totalTime << std::setw(12) << entry.selfTime
+				<< std::setw(12) << entry.selfTime * 1000 / std::max(mFrames, 1u) << "  " << entry.name << "\n";
+	}
+	stream.flags(flags);
+	stream.precision(precision);
+}
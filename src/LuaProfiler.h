@@ -0,0 +1,101 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#pragma once
+
+#include <chrono>
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include "BlobbyDebug.h"
+
+struct lua_State;
+struct lua_Debug;
+typedef int (*lua_CFunction) (lua_State* L);
+
+/*! \class LuaProfiler
+	\brief measures the time spent in the functions of a lua state
+	\details The profiler is driven by the call and return hooks of the state, see
+			IScriptableComponent::enableProfiler. It counts calls and time for every
+			function, lua functions as well as C functions like simulate.
+			Total time includes the called functions, self time does not. The time of
+			recursive calls is counted once per level in the total time.
+			All closures of a lua function share one entry, as they are told apart by
+			where they are defined.
+*/
+class LuaProfiler : public ObjectCounter<LuaProfiler>, public boost::noncopyable
+{
+	public:
+		struct Entry
+		{
+			std::string name;
+			unsigned calls = 0;
+			/// in milliseconds
+			double totalTime = 0;
+			/// in milliseconds
+			double selfTime = 0;
+		};
+
+		/// handles a call or tail call hook event
+		void onCall(lua_State* state, lua_Debug* ar);
+		/// handles a return hook event
+		void onReturn();
+
+		/// number of functions that are currently running
+		std::size_t getDepth() const { return mStack.size(); }
+		/// finishes all functions above \p depth. Functions left by an error do
+		/// not get a return event, so this has to be called after each protected call.
+		void unwind(std::size_t depth);
+
+		void endFrame() { ++mFrames; }
+		unsigned getFrames() const { return mFrames; }
+
+		/// all functions that have been called, the most expensive (by self time) first
+		std::vector<Entry> getEntries() const;
+		/// writes a table of all functions to \p stream
+		void writeReport(std::ostream& stream) const;
+
+	private:
+		typedef std::chrono::steady_clock clock;
+
+		struct Frame
+		{
+			Entry* entry;
+			clock::time_point start;
+			/// time spent in called functions, in milliseconds
+			double childTime;
+		};
+
+		void finish(clock::time_point now);
+
+		/// entries of lua functions by source and line of the definition
+		std::unordered_map<std::string, Entry> mEntries;
+		/// entries of C functions
+		std::map<lua_CFunction, Entry> mFunctions;
+		/// the key of the last lua function that has been called, kept to reuse its memory
+		std::string mKey;
+		std::vector<Frame> mStack;
+		unsigned mFrames = 0;
+};
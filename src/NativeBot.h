@@ -0,0 +1,63 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#pragma once
+
+#include "Global.h"
+#include "DuelMatchState.h"
+#include "PlayerInput.h"
+
+/*! \class NativeBot
+	\brief interface for bots written in C++
+	\details A native bot gets the complete state of the match every step and returns
+			the input it wants, without any conversion of the coordinates: the bot
+			has to mirror them itself if it plays on the right side. The physics
+			constants can be found in GameConstants.h.
+
+			Bots are either compiled into the game (see NativeInputSource), or loaded
+			from shared objects in the scripts directory the game is installed with. The
+			scripts directory in the write directory is ignored. A shared object has to export
+			two functions with C linkage:
+			\code
+			extern "C" int blobby_native_bot_version() { return NATIVE_BOT_API_VERSION; }
+			extern "C" NativeBot* blobby_create_native_bot(PlayerSide side, unsigned difficulty);
+			\endcode
+			Shared objects only get the declarations of the game, they cannot call
+			functions that are not defined in the headers.
+*/
+class NativeBot
+{
+	public:
+		virtual ~NativeBot() = default;
+
+		/// called once per step, \p state is the state before the step
+		virtual PlayerInput step(const DuelMatchState& state) = 0;
+};
+
+/// has to be increased whenever NativeBot, DuelMatchState or PlayerInput change
+const int NATIVE_BOT_API_VERSION = 1;
+
+/// creates a bot for \p side. \p difficulty is the configured script strength,
+/// 0 means no artificial errors.
+typedef NativeBot* (*NativeBotCreateFunction)(PlayerSide side, unsigned difficulty);
+typedef int (*NativeBotVersionFunction)();
+
+const char NATIVE_BOT_VERSION_SYMBOL[] = "blobby_native_bot_version";
+const char NATIVE_BOT_CREATE_SYMBOL[] = "blobby_create_native_bot";
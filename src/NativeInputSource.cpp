@@ -0,0 +1,167 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+/* header include */
+#include "NativeInputSource.h"
+
+/* includes */
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+
+#include <boost/throw_exception.hpp>
+
+#include <SDL2/SDL.h>
+
+#include "DuelMatch.h"
+#include "DuelMatchState.h"
+#include "FileSystem.h"
+#include "ReducedBot.h"
+#include "ScriptedInputSource.h"
+
+/* implementation */
+
+namespace
+{
+	#if defined(WIN32)
+	const std::string LIBRARY_EXTENSION = ".dll";
+	#elif defined(__APPLE__)
+	const std::string LIBRARY_EXTENSION = ".dylib";
+	#else
+	const std::string LIBRARY_EXTENSION = ".so";
+	#endif
+
+	/// bots that are compiled into the game
+	const std::map<std::string, NativeBotCreateFunction>& getBuiltinBots()
+	{
+		static const std::map<std::string, NativeBotCreateFunction> bots = {
+			{"reduced", &ReducedBot::create}
+		};
+		return bots;
+	}
+}
+
+NativeInputSource::NativeInputSource(const std::string& name, PlayerSide side, unsigned int difficulty)
+: mDifficulty(difficulty)
+, mSide(side)
+, mDelayDistribution( difficulty/3, difficulty/2 )
+{
+	mStartTime = SDL_GetTicks();
+
+	std::string botname = isNativeBot(name) ? name.substr(NATIVE_BOT_PREFIX.size()) : name;
+
+	auto builtin = getBuiltinBots().find(botname);
+	if (builtin != getBuiltinBots().end())
+	{
+		mBot.reset(builtin->second(side, difficulty));
+		return;
+	}
+
+	std::string filename = "scripts/" + botname + LIBRARY_EXTENSION;
+	std::string path = FileSystem::getSingleton().getRealPath(filename);
+	if (path.empty())
+		BOOST_THROW_EXCEPTION(std::runtime_error("Native bot " + botname + " not found"));
+
+	// a library runs with all rights of the game, so only installed ones are loaded
+	if (FileSystem::getSingleton().isInWriteDir(filename))
+		BOOST_THROW_EXCEPTION(std::runtime_error("Native bot " + path + " is not loaded, native bots have to be installed with the game"));
+
+	mLibrary = SDL_LoadObject(path.c_str());
+	if (!mLibrary)
+		BOOST_THROW_EXCEPTION(std::runtime_error("Could not load native bot " + path + ": " + SDL_GetError()));
+
+	auto version = (NativeBotVersionFunction)SDL_LoadFunction(mLibrary, NATIVE_BOT_VERSION_SYMBOL);
+	auto create = (NativeBotCreateFunction)SDL_LoadFunction(mLibrary, NATIVE_BOT_CREATE_SYMBOL);
+	if (!version || !create || version() != NATIVE_BOT_API_VERSION)
+	{
+		SDL_UnloadObject(mLibrary);
+		BOOST_THROW_EXCEPTION(std::runtime_error("Native bot " + path + " has an incompatible interface"));
+	}
+
+	mBot.reset(create(side, difficulty));
+	if (!mBot)
+	{
+		SDL_UnloadObject(mLibrary);
+		BOOST_THROW_EXCEPTION(std::runtime_error("Native bot " + path + " could not be created"));
+	}
+}
+
+NativeInputSource::~NativeInputSource()
+{
+	// the code of the bot lives in the library
+	mBot.reset();
+	if (mLibrary)
+		SDL_UnloadObject(mLibrary);
+}
+
+std::vector<std::string> NativeInputSource::getAvailableBots()
+{
+	std::vector<std::string> names;
+	for (const auto& bot : getBuiltinBots())
+	{
+		names.push_back(NATIVE_BOT_PREFIX + bot.first);
+	}
+
+	FileSystem& fs = FileSystem::getSingleton();
+	for (const auto& library : fs.enumerateFiles("scripts", LIBRARY_EXTENSION))
+	{
+		if (getBuiltinBots().count(library) == 0 && !fs.isInWriteDir("scripts/" + library + LIBRARY_EXTENSION))
+			names.push_back(NATIVE_BOT_PREFIX + library);
+	}
+	return names;
+}
+
+PlayerInputAbs NativeInputSource::getNextInput()
+{
+	if (getMatch() == 0)
+	{
+		return PlayerInputAbs();
+	}
+
+	PlayerInput wanted = mBot->step(getMatch()->getState());
+	bool wantjump = wanted.up;
+
+	bool serving = false;
+	if (!getMatch()->getBallActive() && mSide ==
+			// if no player is serving player, assume the left one is
+			(getMatch()->getServingPlayer() == NO_SIDE ? LEFT_SIDE : getMatch()->getServingPlayer() ))
+	{
+		serving = true;
+	}
+
+	if (mStartTime + WAITING_TIME > SDL_GetTicks() && serving)
+		return PlayerInputAbs();
+
+	// random jump delay depending on difficulty
+	if( wantjump && !mLastJump )
+	{
+		mJumpDelay--;
+		if( mJumpDelay > 0 )
+			wantjump = false;
+		else
+		{
+			mJumpDelay = std::max(0.0, std::min( mDelayDistribution(mRandom) , (double)mDifficulty));
+		}
+	}
+
+	mLastJump = wantjump;
+
+	return PlayerInputAbs(wanted.left, wanted.right, wantjump);
+}
@@ -0,0 +1,77 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <random>
+#include <memory>
+
+#include "Global.h"
+#include "InputSource.h"
+#include "NativeBot.h"
+
+/// prefix of the script names that refer to native bots
+const std::string NATIVE_BOT_PREFIX = "native:";
+
+/*! \class NativeInputSource
+	\brief InputSource for bots written in C++
+	\details Works like ScriptedInputSource, including the waiting time before serving
+			and the jump delays depending on the difficulty, but gets its input from a
+			NativeBot. The bot is either one of the bots compiled into the game, or is
+			loaded from a shared object in the scripts directory. Shared objects in the
+			write directory are never loaded, as any file put there would run as native
+			code. On Windows, where the game writes into its data directory, only the
+			bots compiled into the game are available.
+*/
+class NativeInputSource : public InputSource
+{
+	public:
+		/// creates the bot \p name, with or without NATIVE_BOT_PREFIX.
+		/// \throws std::runtime_error if the bot does not exist or can not be loaded.
+		NativeInputSource(const std::string& name, PlayerSide side, unsigned int difficulty);
+		~NativeInputSource();
+
+		virtual PlayerInputAbs getNextInput();
+
+		/// checks whether \p name refers to a native bot
+		static bool isNativeBot(const std::string& name)
+		{
+			return name.compare(0, NATIVE_BOT_PREFIX.size(), NATIVE_BOT_PREFIX) == 0;
+		}
+		/// gets the names of all native bots, including the prefix
+		static std::vector<std::string> getAvailableBots();
+
+	private:
+		/// handle of the shared object, if the bot was loaded from one
+		void* mLibrary = nullptr;
+		std::unique_ptr<NativeBot> mBot;
+
+		unsigned int mStartTime;
+		int mDifficulty;
+		PlayerSide mSide;
+
+		// error data
+		bool mLastJump = false;
+		double mJumpDelay = 0;
+		std::normal_distribution<double> mDelayDistribution;
+		std::default_random_engine mRandom;
+};
@@ -48,7 +48,9 @@ enum MessageType
 	ID_RULES_CHECKSUM,
 	ID_RULES,
 	ID_SERVER_STATUS,
-	ID_LOBBY
+	ID_LOBBY,
+	ID_SPECTATE,
+	ID_SPECTATOR_UPDATE
 };
 
 // General Information:
@@ -183,6 +185,36 @@ enum MessageType
 //		ID_CHALLENGE
 //		(unsigned char) TYPE
 //
+// ID_SPECTATE
+// 	Description:
+//		Sent from client to server to watch a running game, or to request
+//		a new keyframe if the client lost synchronisation.
+//		Sent from server to client as first packet of the spectator stream.
+//		It describes the match, so the client can set up its own DuelMatch.
+// 	Structure (from client to server):
+// 		ID_SPECTATE
+//		game id (uint32)
+// 	Structure (from server to client):
+// 		ID_SPECTATE
+//		game id (uint32)
+//		player enabled bits (uint32)
+//		for each enabled player: name (string), color (Color)
+//		gamespeed (uint32)
+//		score to win (uint32)
+//		rules (string)
+//
+// ID_SPECTATOR_UPDATE
+// 	Description:
+//		Sent from server to spectators. The spectators simulate the match
+//		themselves, so they only receive the player input.
+// 	Structure:
+// 		ID_SPECTATOR_UPDATE
+//		(unsigned char) SpectatorPacketType
+//		KEYFRAME: step (uint32), player enabled bits (uint32), state (DuelMatchState)
+//		FRAMES: first step (uint32), input (vector<unsigned char>, packed like the
+//			replay input), checksum steps (vector<uint32>), checksums (vector<uint32>)
+//		END: no data, the game is over
+//
 
 enum class LobbyPacketType : unsigned char
 {
@@ -196,6 +228,13 @@ enum class LobbyPacketType : unsigned char
 	CHANGE_TEAM
 };
 
+enum class SpectatorPacketType : unsigned char
+{
+	KEYFRAME,
+	FRAMES,
+	END
+};
+
 class IUserConfigReader;
 
 struct ServerInfo : public ObjectCounter<ServerInfo>
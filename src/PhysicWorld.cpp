@@ -371,7 +371,7 @@ void PhysicWorld::step(PlayerInput inputs[MAX_PLAYERS], bool isBallValid, bool i
 		{
 			for (int j = i + 2; j < MAX_PLAYERS; j += 2)
 			{
-				if (mPlayerEnabled[i] && mPlayerEnabled[j] & handleBlobbiesCollision(PlayerSide(i), PlayerSide(j)))
+				if (mPlayerEnabled[i] && mPlayerEnabled[j] && handleBlobbiesCollision(PlayerSide(i), PlayerSide(j)))
 				{
 
 				}
@@ -537,7 +537,8 @@ void PhysicWorld::setBallAngularVelocity( float angvel )
 
 PhysicState PhysicWorld::getState() const
 {
-	PhysicState st;
+	// value initialise, so unused player slots do not contain garbage
+	PhysicState st = PhysicState();
 
 	for (int i = 0; i < MAX_PLAYERS; i++)
 	{
@@ -0,0 +1,367 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+/* header include */
+#include "ReducedBot.h"
+
+/* includes */
+#include <cmath>
+#include <limits>
+
+#include "DuelMatchState.h"
+#include "GameConstants.h"
+
+/* implementation */
+
+namespace
+{
+	// constants of the lua api
+	const float FIELD_MIDDLE = RIGHT_PLANE / 2;
+	const float GROUND_HEIGHT = 600 - GROUND_PLANE_HEIGHT_MAX;
+	const float BLOBBY_GROUND_HEIGHT = GROUND_HEIGHT + BLOBBY_HEIGHT / 2;
+	const float BALL_BLOBBY_HEAD = GROUND_HEIGHT + BLOBBY_HEIGHT + BALL_RADIUS;
+	const float BLOBBY_MAX_JUMP = BLOBBY_GROUND_HEIGHT +
+			std::abs(BLOBBY_JUMP_ACCELERATION * BLOBBY_JUMP_ACCELERATION / GRAVITATION);
+
+	// same limit as simulate_until in the lua api
+	const int MAX_SIMULATION_STEPS = 75 * 5;
+
+	// first positive time t with pos + vel*t + grav/2 * t^2 == destination
+	float parabolaTimeFirst(float pos, float vel, float grav, float destination)
+	{
+		float sq = vel * vel + 2 * grav * (destination - pos);
+		if (sq < 0)
+			return std::numeric_limits<float>::infinity();
+
+		sq = std::sqrt(sq);
+		float tmin = (-vel - sq) / grav;
+		float tmax = (-vel + sq) / grav;
+		if (grav < 0)
+			std::swap(tmin, tmax);
+
+		if (tmin > 0)
+			return tmin;
+		else if (tmax > 0)
+			return tmax;
+		return std::numeric_limits<float>::infinity();
+	}
+}
+
+ReducedBot::ReducedBot(PlayerSide side, unsigned difficulty)
+: mSide(side)
+, mDifficulty(difficulty / 25.f)
+{
+	bool playerEnabled[MAX_PLAYERS];
+	for (int i = 0; i < MAX_PLAYERS; ++i)
+	{
+		playerEnabled[i] = true;
+	}
+	mWorld = PhysicWorld(playerEnabled);
+}
+
+NativeBot* ReducedBot::create(PlayerSide side, unsigned difficulty)
+{
+	return new ReducedBot(side, difficulty);
+}
+
+PlayerInput ReducedBot::step(const DuelMatchState& state)
+{
+	mState = &state;
+	mWantLeft = false;
+	mWantRight = false;
+	mWantJump = false;
+
+	mBall = getBall(state);
+	float originalSpeed = mBall.vx;
+	if (mDifficulty > 0)
+	{
+		mBall.x += mError.x * mDifficulty;
+		mBall.y += mError.y * mDifficulty;
+		mBall.vx += mError.vx * mDifficulty;
+		mBall.vy += mError.vy * mDifficulty;
+	}
+
+	if (!mHasLastBallSpeed)
+	{
+		mHasLastBallSpeed = true;
+		mLastBallSpeed = originalSpeed;
+	}
+
+	// the ball bounced, so we get new errors
+	if (mLastBallSpeed != originalSpeed && !state.getBallDown())
+	{
+		mLastBallSpeed = originalSpeed;
+		randomizeErrors();
+	}
+
+	if (!state.getBallActive())
+	{
+		// if no player is serving player, assume the left one is
+		PlayerSide server = state.getServingPlayer();
+		if (server == NO_PLAYER)
+			server = LEFT_PLAYER;
+
+		if (mSide == server)
+			onServe(!state.getBallDown());
+		else
+			onOpponentServe();
+	}
+	else
+	{
+		onGame();
+	}
+
+	mState = nullptr;
+	return PlayerInput(mWantLeft, mWantRight, mWantJump);
+}
+
+ReducedBot::Ball ReducedBot::getBall(const DuelMatchState& state) const
+{
+	Vector2 pos = state.getBallPosition();
+	Vector2 vel = state.getBallVelocity();
+	Ball ball{pos.x, 600 - pos.y, vel.x, -vel.y};
+	if (mSide % 2 == RIGHT_SIDE)
+	{
+		ball.x = RIGHT_PLANE - ball.x;
+		ball.vx = -ball.vx;
+	}
+	return ball;
+}
+
+float ReducedBot::posx() const
+{
+	float x = mState->getBlobPosition(mSide).x;
+	return mSide % 2 == RIGHT_SIDE ? RIGHT_PLANE - x : x;
+}
+
+void ReducedBot::jump()
+{
+	mWantJump = true;
+}
+
+bool ReducedBot::moveto(float target)
+{
+	bool mirrored = mSide % 2 == RIGHT_SIDE;
+	float x = posx();
+	if (x < target - BLOBBY_SPEED / 2)
+	{
+		mWantLeft = mirrored;
+		mWantRight = !mirrored;
+		return false;
+	}
+	else if (x > target + BLOBBY_SPEED / 2)
+	{
+		mWantLeft = !mirrored;
+		mWantRight = mirrored;
+		return false;
+	}
+
+	mWantLeft = false;
+	mWantRight = false;
+	return true;
+}
+
+void ReducedBot::simulate(Ball& ball, int steps)
+{
+	mWorld.setBallPosition(Vector2{ball.x, 600 - ball.y});
+	mWorld.setBallVelocity(Vector2{ball.vx, -ball.vy});
+	for (int i = 0; i < steps; ++i)
+	{
+		// set ball valid to false to ignore blobby bounces
+		PlayerInput inputs[MAX_PLAYERS];
+		mWorld.step(inputs, false, true);
+	}
+
+	Vector2 pos = mWorld.getBallPosition();
+	Vector2 vel = mWorld.getBallVelocity();
+	ball = Ball{pos.x, 600 - pos.y, vel.x, -vel.y};
+}
+
+int ReducedBot::simulateUntilY(Ball& ball, float height)
+{
+	const bool init = ball.y < height;
+	mWorld.setBallPosition(Vector2{ball.x, 600 - ball.y});
+	mWorld.setBallVelocity(Vector2{ball.vx, -ball.vy});
+
+	int steps = 0;
+	while (height != ball.y && steps < MAX_SIMULATION_STEPS)
+	{
+		steps++;
+		// set ball valid to false to ignore blobby bounces
+		PlayerInput inputs[MAX_PLAYERS];
+		mWorld.step(inputs, false, true);
+		if ((600 - mWorld.getBallPosition().y < height) != init)
+			break;
+	}
+
+	Vector2 pos = mWorld.getBallPosition();
+	Vector2 vel = mWorld.getBallVelocity();
+	ball = Ball{pos.x, 600 - pos.y, vel.x, -vel.y};
+
+	// indicate failure
+	return steps == MAX_SIMULATION_STEPS ? -1 : steps;
+}
+
+bool ReducedBot::estimateXAtY(float height, float& x, float& vx, float& time)
+{
+	// early out, the ball does not reach the height on a parabola
+	if (std::isinf(parabolaTimeFirst(mBall.y, mBall.vy, -BALL_GRAVITATION, height)))
+		return false;
+
+	Ball ball = mBall;
+	time = simulateUntilY(ball, height);
+	// we want to get the ball on its way down
+	if (ball.vy > 0)
+	{
+		float ot = time + 1;
+		simulate(ball, 1);
+		time = simulateUntilY(ball, height) + ot;
+	}
+
+	x = ball.x;
+	vx = ball.vx;
+	return true;
+}
+
+void ReducedBot::randomizeErrors()
+{
+	const float pi = 3.14159265f;
+	float er = (random() + random()) * BALL_RADIUS;
+	float phi = 2 * pi * random();
+	mError.x = std::sin(phi) * er;
+	mError.y = std::cos(phi) * er;
+	er = random() * 1.5f;
+	phi = 2 * pi * random();
+	mError.vx = std::sin(phi) * er;
+	mError.vy = std::cos(phi) * er;
+}
+
+float ReducedBot::random()
+{
+	return std::uniform_real_distribution<float>(0, 1)(mRandom);
+}
+
+void ReducedBot::onServe(bool ballready)
+{
+	if (!mHasServRand)
+	{
+		mHasServRand = true;
+		mServRand = random();
+	}
+
+	if (moveto(mBall.x + mServRand * 5) && ballready)
+	{
+		jump();
+		mHasServRand = false;
+	}
+}
+
+void ReducedBot::onOpponentServe()
+{
+	moveto(100);
+}
+
+void ReducedBot::onGame()
+{
+	// try high play
+	if (estimImpact(BLOBBY_MAX_JUMP - 25))
+	{
+		if (mNaiveTarget < FIELD_MIDDLE && mTarget < FIELD_MIDDLE
+			&& (mModeLock || mTimeTo > std::abs(posx() - highPlayPos()) / 4.5 + 26)
+			&& mState->getHitcount(PlayerSide(mSide % 2)) < 3)
+		{
+			mModeLock = mTimeTo < 30;
+			if (!mModeLock)
+				mHasServRand = false;
+			highPlay();
+			return;
+		}
+	}
+
+	// otherwise, low play
+	mModeLock = false;
+	mHasServRand = false;
+
+	float balldir = mEstimBSpeedX > 0 ? 1 : -1;
+	if (estimImpact(BALL_BLOBBY_HEAD))
+	{
+		if (mTimeTo > (balldir * (mTarget - posx()) - 10) / BLOBBY_SPEED
+			|| mNaiveTarget >= FIELD_MIDDLE)
+		{
+			lowPlay();
+		}
+		else if (mNaiveTarget < FIELD_MIDDLE)
+		{
+			// this often saves the ball if the blob stands in a corner and
+			// the ball bounces from the wall or the net.
+			lowPlay();
+			jump();
+		}
+	}
+}
+
+float ReducedBot::highPlayPos() const
+{
+	// safety against fast balls
+	if (mEstimBSpeedX < 0)
+		return mTarget - 50 - mEstimBSpeedX * 5;
+	return mTarget - 50;
+}
+
+void ReducedBot::highPlay()
+{
+	if (mTarget > FIELD_MIDDLE)
+	{
+		moveto(100);
+		return;
+	}
+
+	moveto(highPlayPos());
+	// 33 time units for jumping to max height. If the ball really bounces
+	// back, it would be a bad idea to jump, so we use the naive target here.
+	if (!mHasServRand)
+	{
+		mHasServRand = true;
+		mServRand = random();
+	}
+	if (mNaiveTarget < FIELD_MIDDLE && mTimeTo < 28 + mServRand)
+		jump();
+}
+
+void ReducedBot::lowPlay()
+{
+	if (mTarget > FIELD_MIDDLE)
+		moveto(100);
+	else
+		moveto(mTarget);
+}
+
+bool ReducedBot::estimImpact(float destY)
+{
+	float x, vx, t;
+	if (!estimateXAtY(destY, x, vx, t))
+		return false;
+
+	mNaiveTarget = mBall.vx * t + mBall.x;
+	mTarget = x;
+	mEstimBSpeedX = vx;
+	mTimeTo = t;
+	return true;
+}
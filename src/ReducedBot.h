@@ -0,0 +1,95 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#pragma once
+
+#include <random>
+
+#include "NativeBot.h"
+#include "PhysicWorld.h"
+
+/*! \class ReducedBot
+	\brief C++ version of the reduced.lua bot
+	\details Mirrors the logic of scripts/reduced.lua and the parts of bot_api.lua
+			it uses, including the difficulty dependent errors in the ball data.
+			All calculations are done in the coordinates of the lua api, i.e.
+			y pointing up and the own side on the left.
+*/
+class ReducedBot : public NativeBot, public ObjectCounter<ReducedBot>
+{
+	public:
+		ReducedBot(PlayerSide side, unsigned difficulty);
+
+		PlayerInput step(const DuelMatchState& state) override;
+
+		static NativeBot* create(PlayerSide side, unsigned difficulty);
+
+	private:
+		struct Ball
+		{
+			float x, y, vx, vy;
+		};
+
+		// bot_api functions
+		Ball getBall(const DuelMatchState& state) const;
+		float posx() const;
+		void jump();
+		bool moveto(float target);
+		void simulate(Ball& ball, int steps);
+		int simulateUntilY(Ball& ball, float height);
+		bool estimateXAtY(float height, float& x, float& vx, float& time);
+		void randomizeErrors();
+
+		// reduced.lua functions
+		void onServe(bool ballready);
+		void onOpponentServe();
+		void onGame();
+		float highPlayPos() const;
+		void highPlay();
+		void lowPlay();
+		bool estimImpact(float destY);
+		float random();
+
+		PlayerSide mSide;
+		float mDifficulty;
+		PhysicWorld mWorld;
+		std::default_random_engine mRandom;
+
+		// state of the current step
+		const DuelMatchState* mState = nullptr;
+		Ball mBall;
+		bool mWantLeft = false;
+		bool mWantRight = false;
+		bool mWantJump = false;
+
+		// artificial errors
+		Ball mError{0, 0, 0, 0};
+		bool mHasLastBallSpeed = false;
+		float mLastBallSpeed = 0;
+
+		// reduced.lua globals
+		bool mModeLock = false;
+		float mTimeTo = 0;
+		float mTarget = 0;
+		float mNaiveTarget = 0;
+		float mEstimBSpeedX = 0;
+		bool mHasServRand = false;
+		float mServRand = 0;
+};
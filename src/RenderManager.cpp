@@ -22,12 +22,21 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "RenderManager.h"
 
 /* includes */
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+
+#include "AssetPack.h"
 #include "FileRead.h"
+#include "FileSystem.h"
 
 /* implementation */
 RenderManager* RenderManager::mSingleton = 0;
 
-RenderManager::RenderManager() : mDrawGame(false)
+RenderManager::RenderManager()
+	: mDrawGame(false)
+	, mGlyphCache([this](unsigned int codepoint, bool highlight) { return loadGlyph(codepoint, highlight); })
+	, mImageLoader(readSurface, SDL_FreeSurface)
 {
 	//assert(!mSingleton);
 	if (mSingleton)
@@ -81,6 +90,11 @@ SDL_Surface* RenderManager::highlightSurface(SDL_Surface* surface, int luminance
 }
 
 SDL_Surface* RenderManager::loadSurface(std::string filename)
+{
+	return mImageLoader.take(filename);
+}
+
+SDL_Surface* RenderManager::readSurface(const std::string& filename)
 {
 	FileRead file(filename);
 	int fileLength = file.length();
@@ -97,6 +111,20 @@ SDL_Surface* RenderManager::loadSurface(std::string filename)
 	return newSurface;
 }
 
+SDL_Surface* RenderManager::loadTextureSurface(const std::string& filename, bool specular)
+{
+	SDL_Surface* surface = AssetPack::getSingleton().getImage(filename, specular);
+	if (surface)
+		return surface;
+
+	SDL_Surface* image = loadSurface(filename);
+	surface = AssetPack::convertImage(image);
+	SDL_FreeSurface(image);
+	if (specular)
+		AssetPack::makeSpecular(surface);
+
+	return surface;
+}
 
 SDL_Surface* RenderManager::createEmptySurface(unsigned int width, unsigned int height)
 {
@@ -105,72 +133,238 @@ SDL_Surface* RenderManager::createEmptySurface(unsigned int width, unsigned int
 	return newSurface;
 }
 
-int RenderManager::getNextFontIndex(std::string::const_iterator& iter)
+SDL_Surface* RenderManager::createAtlas(const std::vector<SDL_Surface*>& images, std::vector<SDL_Rect>& rects)
 {
-	int index = 47;
-	wchar_t testChar = *iter;
-	++iter;
-	if (testChar >= '0' && testChar <= '9')
-		index = testChar - '0';
-	else if (testChar >= 'a' && testChar <= 'z')
-		index = testChar - 'a' + 10;
-	else if (testChar >= 'A' && testChar <= 'Z')
-		index = testChar - 'A' + 10;
-	else if (testChar == '.')
-		index = 36;
-	else if (testChar == '!')
-		index = 37;
-	else if (testChar == '(')
-		index = 38;
-	else if (testChar == ')')
-		index = 39;
-	else if (testChar == '\'')
-		index = 44;
-	else if (testChar == ':')
-		index = 45;
-	else if (testChar == ';')
-		index = 46;
-	else if (testChar == '?')
-		index = 47;
-	else if (testChar == ',')
-		index = 48;
-	else if (testChar == '/')
-		index = 49;
-	else if (testChar == '_')
-		index = 50;
-	else if (testChar == ' ')
-		index = 51;
-	else if (testChar == '-')
-		index = 52;
-	else if (testChar == '%')
-		index = 53;
-	else if (testChar == '+')
-		index = 54;
-	else if (testChar == std::string("ß")[0]) // UTF-8 escape
+	// simple shelf packing, highest images first. The images are one pixel apart,
+	// so scaled quads never pick up pixels of their neighbours.
+	const int width = 1024;
+	std::vector<unsigned int> order(images.size());
+	for (unsigned int i = 0; i < order.size(); ++i)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&images](unsigned int a, unsigned int b)
+	{
+		return images[a]->h > images[b]->h;
+	});
+
+	rects.resize(images.size());
+	int x = 0;
+	int y = 0;
+	int shelfHeight = 0;
+	for (unsigned int i : order)
 	{
-		testChar = *iter;
-		++iter;
-		if (testChar == std::string("ß")[1])
+		assert(images[i]->w < width);
+		if (x + images[i]->w > width)
+		{
+			x = 0;
+			y += shelfHeight + 1;
+			shelfHeight = 0;
+		}
+		SDL_Rect rect = {x, y, images[i]->w, images[i]->h};
+		rects[i] = rect;
+		x += images[i]->w + 1;
+		shelfHeight = std::max(shelfHeight, images[i]->h);
+	}
+
+	int height = 1;
+	while (height < y + shelfHeight)
+		height *= 2;
+
+	SDL_Surface* atlas =
+		SDL_CreateRGBSurface(SDL_SWSURFACE,
+			width, height, 32,
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+			0xff000000, 0x00ff0000, 0x0000ff00, 0x000000ff);
+#else
+			0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000);
+#endif
+
+	for (unsigned int i = 0; i < images.size(); ++i)
+		AssetPack::copyImage(images[i], atlas, &rects[i]);
+
+	return atlas;
+}
+
+int RenderManager::getFontIndex(unsigned int codepoint)
+{
+	if (codepoint >= '0' && codepoint <= '9')
+		return codepoint - '0';
+	if (codepoint >= 'a' && codepoint <= 'z')
+		return codepoint - 'a' + 10;
+	if (codepoint >= 'A' && codepoint <= 'Z')
+		return codepoint - 'A' + 10;
+
+	switch (codepoint)
+	{
+		case '.':
+			return 36;
+		case '*':
+			return FONT_INDEX_ASTERISK;
+		case '!':
+			return 37;
+		case '(':
+			return 38;
+		case ')':
+			return 39;
+		case 0xDF: // ß
 			return 40;
-		else if (testChar == std::string("ä")[1])
+		case 0xE4: // ä
+		case 0xC4: // Ä
 			return 41;
-		else if (testChar == std::string("ö")[1])
+		case 0xF6: // ö
+		case 0xD6: // Ö
 			return 42;
-		else if (testChar == std::string("ü")[1])
+		case 0xFC: // ü
+		case 0xDC: // Ü
 			return 43;
-		else if (testChar == std::string("ì")[1])
-			return 55;
-		else if (testChar == std::string("Ä")[1])
-			return 41;
-		else if (testChar == std::string("Ö")[1])
-			return 42;
-		else if (testChar == std::string("Ü")[1])
-			return 43;
-		else if (testChar == std::string("Ì")[1])
+		case '\'':
+			return 44;
+		case ':':
+			return 45;
+		case ';':
+			return 46;
+		case '?':
+			return 47;
+		case ',':
+			return 48;
+		case '/':
+			return 49;
+		case '_':
+			return 50;
+		case ' ':
+			return 51;
+		case '-':
+			return 52;
+		case '%':
+			return 53;
+		case '+':
+			return 54;
+		case 0xEC: // ì
+		case 0xCC: // Ì
 			return 55;
 	}
 
-	return index;
+	return -1;
+}
+
+unsigned int RenderManager::toUpperCase(unsigned int codepoint)
+{
+	// latin-1, greek and cyrillic, where the cases are in separate blocks
+	if ((codepoint >= 0xE0 && codepoint <= 0xFE && codepoint != 0xF7)
+			|| (codepoint >= 0x3B1 && codepoint <= 0x3CB && codepoint != 0x3C2)
+			|| (codepoint >= 0x430 && codepoint <= 0x44F))
+		return codepoint - 0x20;
+	if (codepoint >= 0x450 && codepoint <= 0x45F)
+		return codepoint - 0x50;
+
+	return codepoint;
+}
+
+SDL_Surface* RenderManager::loadGlyph(unsigned int codepoint, bool highlight)
+{
+	char filename[64];
+	int index = getFontIndex(codepoint);
+	if (index >= 0)
+	{
+		sprintf(filename, "gfx/font%02d.bmp", index);
+	}
+	else
+	{
+		// other characters have their own images, named after their code point.
+		// Like the built in glyphs, one image may be used for both cases.
+		sprintf(filename, "gfx/font_u%04x.bmp", codepoint);
+		if (!FileSystem::getSingleton().exists(filename))
+			sprintf(filename, "gfx/font_u%04x.bmp", toUpperCase(codepoint));
+		if (!FileSystem::getSingleton().exists(filename))
+			sprintf(filename, "gfx/font%02d.bmp", getFontIndex('?'));
+	}
+
+	SDL_Surface* glyph = loadSurface(filename);
+	if (highlight)
+	{
+		SDL_Surface* highlighted = highlightSurface(glyph, 60);
+		SDL_FreeSurface(glyph);
+		return highlighted;
+	}
+
+	return glyph;
+}
+
+void RenderManager::preloadImages(const std::vector<std::string>& filenames)
+{
+	// packed images are not decoded at all
+	std::vector<std::string> images;
+	for (const std::string& filename : filenames)
+	{
+		if (!AssetPack::getSingleton().hasImage(filename))
+			images.push_back(filename);
+	}
+	mImageLoader.preload(images);
+}
+
+void RenderManager::preloadGameImages()
+{
+	std::vector<std::string> images;
+	images.push_back("Icon.bmp");
+	images.push_back("backgrounds/strand2.bmp");
+	images.push_back("gfx/schball.bmp");
+	char filename[64];
+	for (int i = 1; i <= 16; ++i)
+	{
+		sprintf(filename, "gfx/ball%02d.bmp", i);
+		images.push_back(filename);
+	}
+	for (int i = 1; i <= 5; ++i)
+	{
+		sprintf(filename, "gfx/blobbym%d.bmp", i);
+		images.push_back(filename);
+		sprintf(filename, "gfx/sch1%d.bmp", i);
+		images.push_back(filename);
+	}
+	images.push_back("gfx/blood.bmp");
+	preloadImages(images);
+}
+
+void RenderManager::preloadInterfaceImages()
+{
+	std::vector<std::string> images;
+	for (const std::string& name : FileSystem::getSingleton().enumerateFiles("gfx", ".bmp", true))
+	{
+		images.push_back("gfx/" + name);
+		// the glyphs are copied into the glyph cache, all other images get a texture of their own
+		if (name.compare(0, 4, "font") != 0)
+			mPendingUploads.push_back("gfx/" + name);
+	}
+	preloadImages(images);
+}
+
+BufferedImage* RenderManager::uploadImage(SDL_Surface* surface)
+{
+	SDL_FreeSurface(surface);
+	return 0;
+}
+
+void RenderManager::uploadPreloadedImage()
+{
+	// skip the images which were drawn or used otherwise in the meantime
+	while (!mPendingUploads.empty() && (mImageMap.count(mPendingUploads.front()) ||
+			!mImageLoader.isPending(mPendingUploads.front())))
+		mPendingUploads.pop_front();
+
+	if (mPendingUploads.empty() || !mImageLoader.isReady(mPendingUploads.front()))
+		return;
+
+	std::string filename = mPendingUploads.front();
+	mPendingUploads.pop_front();
+	try
+	{
+		BufferedImage* image = uploadImage(loadSurface(filename));
+		if (image)
+			mImageMap[filename] = image;
+	}
+	catch (const FileLoadException&)
+	{
+		// it is reported again when the image is drawn
+	}
 }
 
 void RenderManager::setMouseMarker(float position)
@@ -240,6 +434,12 @@ SDL_Rect RenderManager::blobShadowRect(const Vector2& position)
 	return rect;
 }
 
+void RenderManager::drawParticles(const float* x, const float* y, const int* players, int count)
+{
+	for (int i = 0; i < count; ++i)
+		drawParticle(Vector2(x[i], y[i]), players[i]);
+}
+
 void RenderManager::redraw()
 {
 	mNeedRedraw = true;
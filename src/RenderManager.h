@@ -20,12 +20,17 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #pragma once
 
+#include <deque>
 #include <map>
+#include <string>
+#include <vector>
 #include <SDL2/SDL.h>
 
 #include "Vector.h"
 #include "Global.h"
 #include "BlobbyDebug.h"
+#include "GlyphCache.h"
+#include "AssetLoader.h"
 
 
 // Text definitions
@@ -106,6 +111,7 @@ class RenderManager : public ObjectCounter<RenderManager>
 		static RenderManager* createRenderManagerSDL();
 		//static RenderManager* createRenderManagerGP2X();
         static RenderManager* createRenderManagerGL2D();
+		static RenderManager* createRenderManagerGL3();
 		static RenderManager* createRenderManagerNull();
     
 		static RenderManager& getSingleton()
@@ -168,9 +174,19 @@ class RenderManager : public ObjectCounter<RenderManager>
 		virtual void startDrawParticles() {};
 		//Draw blood particle
 		virtual void drawParticle(const Vector2& pos, int player){};
+		//Draws a batch of blood particles, given as arrays of coordinates and players
+		virtual void drawParticles(const float* x, const float* y, const int* players, int count);
 		// Finishes drawing particles
 		virtual void endDrawParticles() {};
 
+		// Returns the number of draw calls of the last frame, for benchmarking.
+		// Renderers which do not count them return -1
+		virtual int getDrawCallCount() const { return -1; }
+
+		// Returns a copy of the frame which the next refresh() shows, for comparing
+		// renderers. The caller frees the surface. Renderers which can't read back return 0
+		virtual SDL_Surface* takeScreenshot() { return 0; }
+
 		// This forces a redraw of the background, for example
 		// when the windows was minimized
 		void redraw();
@@ -184,14 +200,42 @@ class RenderManager : public ObjectCounter<RenderManager>
 
 		// Returns the window
 		SDL_Window* getWindow();
+
+		// Starts decoding images in the background, e.g. the background
+		// which is set after init(). Images from the asset pack are skipped
+		void preloadImages(const std::vector<std::string>& filenames);
 	protected:
 		RenderManager();
-		// Returns -1 on EOF
-		// Returns index for ? on unknown char
-		int getNextFontIndex(std::string::const_iterator& iter);
+		// Returns the index of the built in glyph of a character, -1 if there is none
+		static int getFontIndex(unsigned int codepoint);
+		// Returns the upper case letter for the lower case letters of some alphabets
+		static unsigned int toUpperCase(unsigned int codepoint);
+		// Loads the image of a character for the glyph cache
+		SDL_Surface* loadGlyph(unsigned int codepoint, bool highlight);
 		SDL_Surface* highlightSurface(SDL_Surface* surface, int luminance);
+		// Returns the decoded image, from the background loader if it was preloaded
 		SDL_Surface* loadSurface(std::string filename);
+		// Reads and decodes an image, this may run on any thread
+		static SDL_Surface* readSurface(const std::string& filename);
+		// Returns the image as RGBA surface in which black is transparent, optionally
+		// as specular map. The pixels come from the asset pack if it holds the image
+		SDL_Surface* loadTextureSurface(const std::string& filename, bool specular = false);
 		SDL_Surface* createEmptySurface(unsigned int width, unsigned int height);
+		// Copies the images into one RGBA surface, with a power of two size, see
+		// AssetPack::copyImage. rects receives the position of each image
+		SDL_Surface* createAtlas(const std::vector<SDL_Surface*>& images, std::vector<SDL_Rect>& rects);
+
+		// Queues the images init() needs, should be called before the window is created
+		// so they are decoded meanwhile
+		void preloadGameImages();
+		// Queues the images of the menus, which are then uploaded one per frame
+		// by uploadPreloadedImage(), so drawing them the first time does not stall
+		void preloadInterfaceImages();
+		// Creates the texture of an image which is drawn by drawImage(), takes ownership
+		// of the surface. Renderers without such textures return 0
+		virtual BufferedImage* uploadImage(SDL_Surface* surface);
+		// Called in refresh(), uploads the next preloaded interface image if it is decoded
+		void uploadPreloadedImage();
 
 		SDL_Window* mWindow;
 
@@ -212,6 +256,12 @@ class RenderManager : public ObjectCounter<RenderManager>
 
 		bool mPlayerEnabled[MAX_PLAYERS];
 
+		GlyphCache mGlyphCache;
+
+		AssetLoader<SDL_Surface*> mImageLoader;
+		// interface images which are preloaded but have no texture yet
+		std::deque<std::string> mPendingUploads;
+
 	private:
 		static RenderManager *mSingleton;
 
@@ -24,11 +24,15 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #if HAVE_LIBGL
 
 /* includes */
+#include <cstddef>
+#include <cstdlib>
+
+#include "AssetPack.h"
 #include "FileExceptions.h"
 
 /* implementation */
 RenderManagerGL2D::Texture::Texture( GLuint tex, int x, int y, int width, int height, int tw, int th ) :
-		w(width), h(height), texture(tex)
+		w(width), h(height), ox(-width / 2.f), oy(-height / 2.f), texture(tex)
 {
 	assert(x + w <= tw);
 	assert(y + h <= th);
@@ -41,6 +45,12 @@ RenderManagerGL2D::Texture::Texture( GLuint tex, int x, int y, int width, int he
 	indices[6] = x / (float)tw;
 	indices[7] = (y + h) / (float)th;
 }
+
+RenderManagerGL2D::AtlasImage::AtlasImage(SDL_Surface* surface, bool padded) :
+		surface(surface), padded(padded)
+{
+}
+
 int debugStateChanges = 0;
 int debugBindTextureCount = 0;
 
@@ -86,7 +96,7 @@ int RenderManagerGL2D::getNextPOT(int npot)
 	return pot;
 }
 
-GLuint RenderManagerGL2D::loadTexture(SDL_Surface *surface, bool specular)
+GLuint RenderManagerGL2D::loadTexture(SDL_Surface *surface)
 {
 	SDL_Surface* textureSurface;
 	SDL_Surface* convertedTexture;
@@ -105,8 +115,6 @@ GLuint RenderManagerGL2D::loadTexture(SDL_Surface *surface, bool specular)
 	targetRect.x = (paddedX - oldX) / 2;
 	targetRect.y = (paddedY - oldY) / 2;
 
-	SDL_SetColorKey(textureSurface, SDL_TRUE,
-			SDL_MapRGB(textureSurface->format, 0, 0, 0));
 	convertedTexture =
 		SDL_CreateRGBSurface(SDL_SWSURFACE,
 			paddedX, paddedY, 32,
@@ -115,26 +123,7 @@ GLuint RenderManagerGL2D::loadTexture(SDL_Surface *surface, bool specular)
 #else
 			0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000);
 #endif
-	SDL_BlitSurface(textureSurface, 0, convertedTexture, &targetRect);
-
-	if (specular)
-	{
-		for (int y = 0; y < convertedTexture->h; ++y)
-		{
-			for (int x = 0; x < convertedTexture->w; ++x)
-			{
-				SDL_Color* pixel =
-					&(((SDL_Color*)convertedTexture->pixels)
-					[y * convertedTexture->w +x]);
-				int luminance = int(pixel->r) * 5 - 4 * 256 - 138;
-				luminance = luminance > 0 ? luminance : 0;
-				luminance = luminance < 255 ? luminance : 255;
-				pixel->r = luminance;
-				pixel->g = luminance;
-				pixel->b = luminance;
-			}
-		}
-	}
+	AssetPack::copyImage(textureSurface, convertedTexture, &targetRect);
 
 	GLuint texture;
 	glGenTextures(1, &texture);
@@ -150,53 +139,161 @@ GLuint RenderManagerGL2D::loadTexture(SDL_Surface *surface, bool specular)
 	return texture;
 }
 
-void RenderManagerGL2D::drawQuad(float x, float y, float w, float h)
+GLuint RenderManagerGL2D::buildAtlas(std::vector<AtlasImage>& images)
 {
-	glEnableClientState(GL_VERTEX_ARRAY);
-	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	std::vector<SDL_Surface*> surfaces;
+	for (const AtlasImage& image : images)
+		surfaces.push_back(image.surface);
+	std::vector<SDL_Rect> rects;
+	SDL_Surface* atlas = createAtlas(surfaces, rects);
+	mAtlasWidth = atlas->w;
+	mAtlasHeight = atlas->h;
 
-	GLfloat vertices[] = {x - w / 2.f, y - h / 2.f,
-	                      x + w / 2.f, y - h / 2.f,
-	                      x + w / 2.f, y + h / 2.f,
-	                      x - w / 2.f, y + h / 2.f};
+	GLuint texture;
+	glGenTextures(1, &texture);
 
-	GLfloat texCoords[] = {0.f, 0.f,
-	                       1.f, 0.f,
-	                       1.f, 1.f,
-	                       0.f, 1.f};
+	for (unsigned int i = 0; i < images.size(); ++i)
+	{
+		AtlasImage& image = images[i];
+		image.texture = Texture(texture, rects[i].x, rects[i].y, rects[i].w, rects[i].h, atlas->w, atlas->h);
+		if (image.padded)
+		{
+			// the image used to be centered in a power of two texture, which was drawn centered
+			int paddedX = getNextPOT(rects[i].w);
+			int paddedY = getNextPOT(rects[i].h);
+			image.texture.ox = (paddedX - rects[i].w) / 2 - paddedX / 2.f;
+			image.texture.oy = (paddedY - rects[i].h) / 2 - paddedY / 2.f;
+		}
+		SDL_FreeSurface(image.surface);
+		image.surface = 0;
+	}
 
-	glVertexPointer(2, GL_FLOAT, 0, vertices);
-	glTexCoordPointer(2, GL_FLOAT, 0, texCoords);
-	glDrawArrays(GL_QUADS, 0, 4);
+	glBindTexture(texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8,
+			atlas->w, atlas->h, 0, GL_RGBA,
+			GL_UNSIGNED_BYTE, atlas->pixels);
+	SDL_FreeSurface(atlas);
 
-	glDisableClientState(GL_VERTEX_ARRAY);
-	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	return texture;
 }
 
-void RenderManagerGL2D::drawQuad(float x, float y, const Texture& tex) {
-	glBindTexture(tex.texture);
+void RenderManagerGL2D::drawQuad(float x, float y, float w, float h, const float* indices,
+		GLuint texture, DrawMode mode, const Color& color, GLubyte alpha)
+{
+	if (mBatches.empty() || mBatches.back().texture != texture || mBatches.back().mode != mode)
+	{
+		Batch batch = {texture, mode, (GLint)mVertices.size(), 0};
+		mBatches.push_back(batch);
+	}
+	mBatches.back().count += 4;
 
-	glEnableClientState(GL_VERTEX_ARRAY);
-	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	GLfloat vertices[] = {x, y,
+	                      x + w, y,
+	                      x + w, y + h,
+	                      x, y + h};
 
-	float w = tex.w;
-	float h = tex.h;
+	for (int i = 0; i < 4; ++i)
+	{
+		Vertex vertex = {vertices[2 * i], vertices[2 * i + 1], indices[2 * i], indices[2 * i + 1],
+				{color.r, color.g, color.b, alpha}};
+		mVertices.push_back(vertex);
+	}
+}
 
-	GLfloat vertices[] = {x - w / 2.f, y - h / 2.f,
-	                      x + w / 2.f, y - h / 2.f,
-	                      x + w / 2.f, y + h / 2.f,
-	                      x - w / 2.f, y + h / 2.f};
+void RenderManagerGL2D::drawQuad(float x, float y, float w, float h, GLuint texture, DrawMode mode)
+{
+	static const GLfloat texCoords[] = {0.f, 0.f,
+	                                    1.f, 0.f,
+	                                    1.f, 1.f,
+	                                    0.f, 1.f};
 
-	glVertexPointer(2, GL_FLOAT, 0, vertices);
-	glTexCoordPointer(2, GL_FLOAT, 0, tex.indices);
-	glDrawArrays(GL_QUADS, 0, 4);
+	drawQuad(x - w / 2.f, y - h / 2.f, w, h, texCoords, texture, mode, Color(255, 255, 255));
+}
 
-	glDisableClientState(GL_VERTEX_ARRAY);
-	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+void RenderManagerGL2D::drawQuad(float x, float y, const Texture& tex, DrawMode mode,
+		const Color& color, GLubyte alpha)
+{
+	drawQuad(x + tex.ox, y + tex.oy, tex.w, tex.h, tex.indices, tex.texture, mode, color, alpha);
+}
+
+void RenderManagerGL2D::drawRect(Vector2 pos1, Vector2 pos2, DrawMode mode, const Color& color, GLubyte alpha)
+{
+	drawQuad(pos1.x, pos1.y, pos2.x - pos1.x, pos2.y - pos1.y,
+			mSolid.indices, mSolid.texture, mode, color, alpha);
+}
+
+void RenderManagerGL2D::setDrawMode(DrawMode mode)
+{
+	switch (mode)
+	{
+		case DRAW_OPAQUE:
+			glDisable(GL_ALPHA_TEST);
+			glDisable(GL_BLEND);
+			break;
+		case DRAW_ALPHA_TEST:
+			glEnable(GL_ALPHA_TEST);
+			glDisable(GL_BLEND);
+			break;
+		case DRAW_BLEND:
+			glDisable(GL_ALPHA_TEST);
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			glEnable(GL_BLEND);
+			break;
+		case DRAW_ADDITIVE:
+			glEnable(GL_ALPHA_TEST);
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+			glEnable(GL_BLEND);
+			break;
+	}
+}
+
+void RenderManagerGL2D::flush()
+{
+	if (mVertices.empty())
+		return;
+
+	// glyphs which were loaded since the last flush
+	SDL_Rect rows;
+	if (mGlyphCache.takeChangedRows(rows))
+	{
+		SDL_Surface* page = mGlyphCache.getPage();
+		glBindTexture(mAtlas);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, mGlyphPage.x, mGlyphPage.y + rows.y, rows.w, rows.h,
+				GL_RGBA, GL_UNSIGNED_BYTE, (const Uint8*)page->pixels + rows.y * page->pitch);
+	}
+
+	const GLvoid* base = &mVertices[0];
+	if (mVertexBuffer)
+	{
+		// a new data store each time, so we never wait for the previous frame
+		mBufferData(GL_ARRAY_BUFFER, mVertices.size() * sizeof(Vertex), &mVertices[0], GL_STREAM_DRAW);
+		base = 0;
+	}
+
+	glVertexPointer(2, GL_FLOAT, sizeof(Vertex), (const GLubyte*)base + offsetof(Vertex, x));
+	glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), (const GLubyte*)base + offsetof(Vertex, u));
+	glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), (const GLubyte*)base + offsetof(Vertex, color));
+
+	for (const Batch& batch : mBatches)
+	{
+		setDrawMode(batch.mode);
+		glBindTexture(batch.texture);
+		glDrawArrays(GL_QUADS, batch.first, batch.count);
+	}
+
+	mDrawCalls += mBatches.size();
+	mVertices.clear();
+	mBatches.clear();
 }
 
 RenderManagerGL2D::RenderManagerGL2D()
 	: RenderManager()
+	, mDrawCalls(0)
+	, mDrawCallCount(0)
+	, mVertexBuffer(0)
+	, mCurrentTexture(0)
 {
 	for (int i = 0; i < MAX_PLAYERS; ++i)
 	{
@@ -211,6 +308,9 @@ RenderManager* RenderManager::createRenderManagerGL2D()
 
 void RenderManagerGL2D::init(int xResolution, int yResolution, bool fullscreen)
 {
+	// the images are decoded while the window and the context are created
+	preloadGameImages();
+
 	glDisable(GL_DEPTH_TEST);
 	mCurrentFlags.insert(GL_MULTISAMPLE);
 	SDL_GL_SetAttribute(SDL_GL_RED_SIZE, 8);
@@ -252,76 +352,77 @@ void RenderManagerGL2D::init(int xResolution, int yResolution, bool fullscreen)
 	glEnable(GL_TEXTURE_2D);
 
 	// Load background
-	SDL_Surface* bgSurface = loadSurface("backgrounds/strand2.bmp");
+	SDL_Surface* bgSurface = loadTextureSurface("backgrounds/strand2.bmp");
 	BufferedImage* bgBufImage = new BufferedImage;
 	bgBufImage->w = getNextPOT(bgSurface->w);
 	bgBufImage->h = getNextPOT(bgSurface->h);
-	bgBufImage->glHandle = loadTexture(bgSurface, false);
+	bgBufImage->glHandle = loadTexture(bgSurface);
 	mBackground = bgBufImage->glHandle;
 	mImageMap["background"] = bgBufImage;
 
-	mBallShadow = loadTexture(loadSurface("gfx/schball.bmp"), false);
+	// all other images share one texture
+	std::vector<AtlasImage> images;
+	images.push_back(AtlasImage(loadTextureSurface("gfx/schball.bmp"), true));
 
 	for (int i = 1; i <= 16; ++i)
 	{
 		char filename[64];
 		sprintf(filename, "gfx/ball%02d.bmp", i);
-		GLuint ballImage = loadTexture(loadSurface(filename), false);
-		mBall.push_back(ballImage);
+		images.push_back(AtlasImage(loadTextureSurface(filename), true));
 	}
 
 	for (int i = 1; i <= 5; ++i)
 	{
 		char filename[64];
 		sprintf(filename, "gfx/blobbym%d.bmp", i);
-		GLuint blobImage = loadTexture(loadSurface(filename), false);
-		mBlob.push_back(blobImage);
-		sprintf(filename, "gfx/blobbym%d.bmp", i);
-		GLuint blobSpecular = loadTexture(loadSurface(filename), true);
-		mBlobSpecular.push_back(blobSpecular);
+		images.push_back(AtlasImage(loadTextureSurface(filename), true));
+		images.push_back(AtlasImage(loadTextureSurface(filename, true), true));
 		sprintf(filename, "gfx/sch1%d.bmp", i);
-		GLuint blobShadow = loadTexture(loadSurface(filename), false);
-		mBlobShadow.push_back(blobShadow);
+		images.push_back(AtlasImage(loadTextureSurface(filename), true));
 	}
 
-	// create text base textures
-	SDL_Surface* textbase = createEmptySurface(2048, 32);
-	SDL_Surface* hltextbase = createEmptySurface(2048, 32);
+	images.push_back(AtlasImage(loadTextureSurface("gfx/blood.bmp"), true));
 
-	int x = 0;
-	int sx = 0;
+	// space for the glyph cache, the glyphs are copied there when they are drawn
+	images.push_back(AtlasImage(createEmptySurface(GlyphCache::PAGE_WIDTH, GlyphCache::PAGE_HEIGHT), false));
 
-	for (int i = 0; i <= 55; ++i)
-	{
-		char filename[64];
-		sprintf(filename, "gfx/font%02d.bmp", i);
-		SDL_Surface* fontSurface = loadSurface(filename);
+	SDL_Surface* solid = createEmptySurface(1, 1);
+	SDL_FillRect(solid, 0, SDL_MapRGB(solid->format, 255, 255, 255));
+	images.push_back(AtlasImage(solid, false));
 
-		SDL_Surface* highlight = highlightSurface(fontSurface, 60);
+	mAtlas = buildAtlas(images);
 
-		SDL_Rect r = {(Uint16)x, 0, (Uint16)fontSurface->w, (Uint16)fontSurface->h};
-		SDL_BlitSurface(fontSurface, 0, textbase, &r);
-		SDL_BlitSurface(highlight, 0, hltextbase, &r);
-		r.x = sx;
-		r.y = 0;
-		Texture s = Texture(0, x, 0, fontSurface->w, fontSurface->h, 2048, 32);
-		mFont.push_back(s);
-		mHighlightFont.push_back(s);
-
-		x += fontSurface->w;
+	std::vector<AtlasImage>::const_iterator image = images.begin();
+	mBallShadow = (image++)->texture;
+	for (int i = 1; i <= 16; ++i)
+		mBall.push_back((image++)->texture);
 
-		SDL_FreeSurface(fontSurface);
+	for (int i = 1; i <= 5; ++i)
+	{
+		mBlob.push_back((image++)->texture);
+		mBlobSpecular.push_back((image++)->texture);
+		mBlobShadow.push_back((image++)->texture);
 	}
 
-	GLuint texture =  loadTexture(textbase, false);
-	GLuint hltexture =  loadTexture(hltextbase, false);
-	for (unsigned int i = 0; i < mFont.size(); ++i)
+	mParticle = (image++)->texture;
+
+	const Texture& glyphPage = (image++)->texture;
+	mGlyphPage.x = lround(glyphPage.indices[0] * mAtlasWidth);
+	mGlyphPage.y = lround(glyphPage.indices[1] * mAtlasHeight);
+	mGlyphPage.w = glyphPage.w;
+	mGlyphPage.h = glyphPage.h;
+	mGlyphCache.clear();
+
+	// always sample the center of the white pixel
+	mSolid = (image++)->texture;
+	float u = (mSolid.indices[0] + mSolid.indices[2]) / 2;
+	float v = (mSolid.indices[1] + mSolid.indices[5]) / 2;
+	for (int i = 0; i < 8; i += 2)
 	{
-		mFont[i].texture = texture;
-		mHighlightFont[i].texture = hltexture;
+		mSolid.indices[i] = u;
+		mSolid.indices[i + 1] = v;
 	}
-
-	mParticle = loadTexture(loadSurface("gfx/blood.bmp"), false);
+	assert(image == images.end());
 
 	glViewport(0, 0, xResolution, yResolution);
 	glMatrixMode(GL_PROJECTION);
@@ -334,18 +435,41 @@ void RenderManagerGL2D::init(int xResolution, int yResolution, bool fullscreen)
 
 	glAlphaFunc(GL_GREATER, 0.5);
 	glEnable(GL_ALPHA_TEST);
+
+	// vertex buffer for the quads of a frame, plain vertex arrays if
+	// buffer objects are not available
+	mVertexBuffer = 0;
+	const char* version = (const char*)glGetString(GL_VERSION);
+	if (version && std::atof(version) >= 1.5)
+	{
+		mGenBuffers = (GenBuffersFunc)SDL_GL_GetProcAddress("glGenBuffers");
+		mDeleteBuffers = (DeleteBuffersFunc)SDL_GL_GetProcAddress("glDeleteBuffers");
+		mBindBuffer = (BindBufferFunc)SDL_GL_GetProcAddress("glBindBuffer");
+		mBufferData = (BufferDataFunc)SDL_GL_GetProcAddress("glBufferData");
+		if (mGenBuffers && mDeleteBuffers && mBindBuffer && mBufferData)
+		{
+			mGenBuffers(1, &mVertexBuffer);
+			mBindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
+		}
+	}
+	mVertices.reserve(4 * 512);
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+
+	preloadInterfaceImages();
 }
 
 void RenderManagerGL2D::deinit()
 {
+	mVertices.clear();
+	mBatches.clear();
+	if (mVertexBuffer)
+		mDeleteBuffers(1, &mVertexBuffer);
+
 	glDeleteTextures(1, &mBackground);
-	glDeleteTextures(mBall.size(), &mBall[0]);
-	glDeleteTextures(1, &mBallShadow);
-	glDeleteTextures(mBlob.size(), &mBlob[0]);
-	glDeleteTextures(mBlobSpecular.size(), &mBlobSpecular[0]);
-	glDeleteTextures(mBlobShadow.size(), &mBlobShadow[0]);
-	glDeleteTextures(1/*mFont.size()*/, &mFont[0].texture);
-	glDeleteTextures(/*mHighlightFont.size()*/1, &mHighlightFont[0].texture);
+	glDeleteTextures(1, &mAtlas);
 
 	for (std::map<std::string, BufferedImage*>::iterator iter = mImageMap.begin();
 		iter != mImageMap.end(); ++iter)
@@ -354,8 +478,6 @@ void RenderManagerGL2D::deinit()
 		delete iter->second;
 	}
 
-	glDeleteTextures(1, &mParticle);
-
 	SDL_GL_DeleteContext(mGlContext);
 	SDL_DestroyWindow(mWindow);
 }
@@ -366,20 +488,10 @@ void RenderManagerGL2D::draw()
 		return;
 
 	// Background
-	glDisable(GL_ALPHA_TEST);
-	glColor4f(1.0, 1.0, 1.0, 1.0);
-	glBindTexture(mBackground);
-	glLoadIdentity();
-	drawQuad(400.0, 300.0, 1024.0, 1024.0);
-
+	drawQuad(400.0, 300.0, 1024.0, 1024.0, mBackground, DRAW_OPAQUE);
 
 	if(mShowShadow)
 	{
-		// Generic shadow settings
-
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-		glEnable(GL_BLEND);
-
 		// Blob shadows
 		Vector2 pos;
 
@@ -388,106 +500,63 @@ void RenderManagerGL2D::draw()
 			if(mPlayerEnabled[i])
 			{
 				pos = blobShadowPosition(mBlobPosition[i]);
-				glColor4ub(mBlobColor[i].r, mBlobColor[i].g, mBlobColor[i].b, 128);
-				glBindTexture(mBlobShadow[int(mBlobAnimationState[i]) % 5]);
-				drawQuad(pos.x, pos.y, 128.0, 32.0);
+				drawQuad(pos.x, pos.y, mBlobShadow[int(mBlobAnimationState[i]) % 5],
+						DRAW_BLEND, mBlobColor[i], 128);
 			}
 		}		
 
 		// Ball shadow
 		pos = ballShadowPosition(mBallPosition);
-		glColor4f(1.0, 1.0, 1.0, 0.5);
-		glBindTexture(mBallShadow);
-		drawQuad(pos.x, pos.y, 128.0, 32.0);
-
-		glDisable(GL_BLEND);
+		drawQuad(pos.x, pos.y, mBallShadow, DRAW_BLEND, Color(255, 255, 255), 128);
 	}
 
-	glEnable(GL_ALPHA_TEST);
-
-	// General object settings
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE);
 	// The Ball
-
-	glColor4f(1.0, 1.0, 1.0, 1.0);
-	glBindTexture(mBall[int(mBallRotation / M_PI / 2 * 16) % 16]);
-/*
-	float opacity = 0.0;
-	for (std::list<Vector2>::iterator iter = mLastBallStates.begin();
-		iter != mLastBallStates.end(); ++iter)
-	{
-//		glColor4f(1.0 / MotionBlurIterations,
-//			1.0 / MotionBlurIterations, 1.0 / MotionBlurIterations, 1.0 - opacity);
-		glColor4f(1.0, 1.0, 1.0, opacity);
-
-
-		Vector2& ballPosition = *iter;
-*/
-		drawQuad(mBallPosition.x, mBallPosition.y, 64.0, 64.0);
-
-/*
-		opacity += 0.1;
-	}
-	if (mLastBallStates.size() > MotionBlurIterations)
-			mLastBallStates.pop_back();
-	glDisable(GL_BLEND);
-*/
+	drawQuad(mBallPosition.x, mBallPosition.y, mBall[int(mBallRotation / M_PI / 2 * 16) % 16], DRAW_ALPHA_TEST);
 
 	// blob normal
-
 	for (int i = 0; i < MAX_PLAYERS; ++i)
 	{
 		if (mPlayerEnabled[i])
 		{
-			glBindTexture(mBlob[int(mBlobAnimationState[i]) % 5]);
-			glColor3ubv(mBlobColor[i].val);
-			drawQuad(mBlobPosition[i].x, mBlobPosition[i].y, 128.0, 128.0);
+			drawQuad(mBlobPosition[i].x, mBlobPosition[i].y, mBlob[int(mBlobAnimationState[i]) % 5],
+					DRAW_ALPHA_TEST, mBlobColor[i]);
 		}
 	}	
 
 	// blob specular
-	glEnable(GL_BLEND);
-	glColor4f(1.0, 1.0, 1.0, 1.0);
-
 	for (int i = 0; i < MAX_PLAYERS; ++i)
 	{
 		if(mPlayerEnabled[i])
 		{
-			glBindTexture(mBlobSpecular[int(mBlobAnimationState[i]) % 5]);
-			drawQuad(mBlobPosition[i].x, mBlobPosition[i].y, 128.0, 128.0);
+			drawQuad(mBlobPosition[i].x, mBlobPosition[i].y, mBlobSpecular[int(mBlobAnimationState[i]) % 5],
+					DRAW_ADDITIVE);
 		}
 	}
-	
-	glDisable(GL_BLEND);
-
 
 	// Ball marker
-	glDisable(GL_ALPHA_TEST);
-	glDisable(GL_TEXTURE_2D);
 	GLubyte markerColor = SDL_GetTicks() % 1000 >= 500 ? 255 : 0;
-	glColor3ub(markerColor, markerColor, markerColor);
-	drawQuad(mBallPosition.x, 7.5, 5.0, 5.0);
+	Color marker(markerColor, markerColor, markerColor);
+	drawRect(Vector2(mBallPosition.x - 2.5, 5.0), Vector2(mBallPosition.x + 2.5, 10.0), DRAW_ALPHA_TEST, marker);
 
 	// Mouse marker
 
 	// Position relativ zu BallMarker
-	drawQuad(mMouseMarkerPosition, 592.5, 5.0, 5.0);
-
-	glEnable(GL_TEXTURE_2D);
-	glEnable(GL_ALPHA_TEST);
+	drawRect(Vector2(mMouseMarkerPosition - 2.5, 590.0), Vector2(mMouseMarkerPosition + 2.5, 595.0), DRAW_ALPHA_TEST, marker);
 }
 
 bool RenderManagerGL2D::setBackground(const std::string& filename)
 {
 	try
 	{
-		SDL_Surface* newSurface = loadSurface(filename);
+		SDL_Surface* newSurface = loadTextureSurface(filename);
+		// the old background might still be used by the current frame
+		flush();
 		glDeleteTextures(1, &mBackground);
 		delete mImageMap["background"];
 		BufferedImage *imgBuffer = new BufferedImage;
 		imgBuffer->w = getNextPOT(newSurface->w);
 		imgBuffer->h = getNextPOT(newSurface->h);
-		imgBuffer->glHandle = loadTexture(newSurface, false);
+		imgBuffer->glHandle = loadTexture(newSurface);
 		mBackground = imgBuffer->glHandle;
 		mImageMap["background"] = imgBuffer;
 	}
@@ -531,169 +600,98 @@ void RenderManagerGL2D::setBlob(int player, const Vector2& position, float anima
 
 void RenderManagerGL2D::drawText(const std::string& text, Vector2 position, unsigned int flags)
 {
-	glEnable(GL_TEXTURE_2D);
-	glEnable(GL_ALPHA_TEST);
-	glDisable(GL_BLEND);
-
-	glColor4f(1.0, 1.0, 1.0, 1.0);
 	int FontSize = (flags & TF_SMALL_FONT ? FONT_WIDTH_SMALL : FONT_WIDTH_NORMAL);
+	const std::vector<SDL_Rect>& glyphs = mGlyphCache.getText(text, flags);
 
-	float x = position.x - (FontSize / 2);
-	float y = position.y + (FontSize / 2);
-
-	for (auto iter = text.cbegin(); iter != text.cend(); )
-
+	float x = position.x;
+	for (const SDL_Rect& glyph : glyphs)
 	{
-		int index = getNextFontIndex(iter);
-
-		if (flags & TF_OBFUSCATE)
-			index = FONT_INDEX_ASTERISK;
-
-		x += FontSize;
-		if (flags & TF_SMALL_FONT)
+		if (glyph.w > 0)
 		{
-			if (flags & TF_HIGHLIGHT)
-			{
-				int charWidth = mHighlightFont[index].w;
-				int charHeight = mHighlightFont[index].h;
-				mHighlightFont[index].w = FONT_WIDTH_SMALL;
-				mHighlightFont[index].h = FONT_WIDTH_SMALL;
-				drawQuad(x, y, mHighlightFont[index]);
-				mHighlightFont[index].w = charWidth;
-				mHighlightFont[index].h = charHeight;
-			}
-			else
-			{
-				int charWidth = mFont[index].w;
-				int charHeight = mFont[index].h;
-				mFont[index].w = FONT_WIDTH_SMALL;
-				mFont[index].h = FONT_WIDTH_SMALL;
-				drawQuad(x, y, mFont[index]);
-				mFont[index].w = charWidth;
-				mFont[index].h = charHeight;
-			}
-		}
-		else
-		{
-			if (flags & TF_HIGHLIGHT)
-				drawQuad(x, y, mHighlightFont[index]);
-			else
-				drawQuad(x, y, mFont[index]);
+			Texture texture(mAtlas, mGlyphPage.x + glyph.x, mGlyphPage.y + glyph.y, glyph.w, glyph.h,
+					mAtlasWidth, mAtlasHeight);
+			drawQuad(x, position.y, FontSize, FontSize, texture.indices, mAtlas, DRAW_ALPHA_TEST, Color(255, 255, 255));
 		}
+		x += FontSize;
 	}
 }
 
 void RenderManagerGL2D::drawImage(const std::string& filename, Vector2 position, Vector2 size)
 {
-	glEnable(GL_TEXTURE_2D);
-	glEnable(GL_ALPHA_TEST);
-	glDisable(GL_BLEND);
-
 	BufferedImage* imageBuffer = mImageMap[filename];
 	if (!imageBuffer)
 	{
-		imageBuffer = new BufferedImage;
-		SDL_Surface* newSurface = loadSurface(filename);
-		imageBuffer->w = getNextPOT(newSurface->w);
-		imageBuffer->h = getNextPOT(newSurface->h);
-		imageBuffer->glHandle = loadTexture(newSurface, false);
+		imageBuffer = uploadImage(loadSurface(filename));
 		mImageMap[filename] = imageBuffer;
 	}
 
-	glColor4f(1.0, 1.0, 1.0, 1.0);
-	glDisable(GL_BLEND);
-	//glLoadIdentity();
-	//glTranslatef(position.x , position.y, 0.0);
-	glBindTexture(imageBuffer->glHandle);
-	drawQuad(position.x, position.y, imageBuffer->w, imageBuffer->h);
+	drawQuad(position.x, position.y, imageBuffer->w, imageBuffer->h, imageBuffer->glHandle, DRAW_ALPHA_TEST);
 }
 
-void RenderManagerGL2D::drawOverlay(float opacity, Vector2 pos1, Vector2 pos2, Color col)
+BufferedImage* RenderManagerGL2D::uploadImage(SDL_Surface* surface)
 {
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glDisable(GL_TEXTURE_2D);
-	glDisable(GL_ALPHA_TEST);
-	glEnable(GL_BLEND);
+	BufferedImage* imageBuffer = new BufferedImage;
+	imageBuffer->w = getNextPOT(surface->w);
+	imageBuffer->h = getNextPOT(surface->h);
+	imageBuffer->glHandle = loadTexture(surface);
+	return imageBuffer;
+}
 
-	glColor4f(col.r, col.g, col.b, opacity);
-	//glLoadIdentity();
-	glBegin(GL_QUADS);
-		glVertex2f(pos1.x, pos1.y);
-		glVertex2f(pos1.x, pos2.y);
-		glVertex2f(pos2.x, pos2.y);
-		glVertex2f(pos2.x, pos1.y);
-	glEnd();
+void RenderManagerGL2D::drawOverlay(float opacity, Vector2 pos1, Vector2 pos2, Color col)
+{
+	drawRect(pos1, pos2, DRAW_BLEND, col, GLubyte(opacity * 255 + 0.5f));
 }
 
 void RenderManagerGL2D::drawBlob(const Vector2& pos, const Color& col)
 {
-	glEnable(GL_TEXTURE_2D);
-	glEnable(GL_ALPHA_TEST);
-	glDisable(GL_BLEND);
-
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-
-	//glLoadIdentity();
-	//glTranslatef(pos.x, pos.y, 0.6);
-	glBindTexture(mBlob[0]);
-	glColor3ubv(col.val);
-	drawQuad(pos.x, pos.y, 128.0, 128.0);
-
-	glEnable(GL_BLEND);
-	glColor4f(1.0, 1.0, 1.0, 1.0);
-	glBindTexture(mBlobSpecular[0]);
-	drawQuad(pos.x, pos.y, 128.0, 128.0);
-	glDisable(GL_BLEND);
+	drawQuad(pos.x, pos.y, mBlob[0], DRAW_ALPHA_TEST, col);
+	drawQuad(pos.x, pos.y, mBlobSpecular[0], DRAW_ADDITIVE);
 }
 
-void RenderManagerGL2D::startDrawParticles()
+void RenderManagerGL2D::drawParticle(const Vector2& pos, int player)
 {
-	glEnable(GL_TEXTURE_2D);
-	glEnable(GL_ALPHA_TEST);
-	glDisable(GL_BLEND);
-
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-	glBindTexture(mParticle);
-	glBegin(GL_QUADS);
+	drawQuad(pos.x, pos.y, mParticle, DRAW_ALPHA_TEST, mBlobColor[player]);
 }
 
-void RenderManagerGL2D::drawParticle(const Vector2& pos, int player)
+void RenderManagerGL2D::drawParticles(const float* x, const float* y, const int* players, int count)
 {
-	//glLoadIdentity();
-	//glTranslatef(pos.x, pos.y, 0.6);
-	
-	glColor3ubv(mBlobColor[player].val);
-
-	/*
-	if (player > 1)
-		glColor3ubv(Color(255, 0, 0).val);
-	*/
+	for (int i = 0; i < count; ++i)
+		drawQuad(x[i], y[i], mParticle, DRAW_ALPHA_TEST, mBlobColor[players[i]]);
+}
 
-	float w = 16.0;
-	float h = 16.0;
-	glTexCoord2f(0.0, 0.0);
-	glVertex2f(pos.x - w / 2.0, pos.y - h / 2.0);
-	glTexCoord2f(1.0, 0.0);
-	glVertex2f(pos.x + w / 2.0, pos.y - h / 2.0);
-	glTexCoord2f(1.0, 1.0);
-	glVertex2f(pos.x + w / 2.0, pos.y + h / 2.0);
-	glTexCoord2f(0.0, 1.0);
-	glVertex2f(pos.x - w / 2.0, pos.y + h / 2.0);
+int RenderManagerGL2D::getDrawCallCount() const
+{
+	return mDrawCallCount;
 }
 
-void RenderManagerGL2D::endDrawParticles()
+SDL_Surface* RenderManagerGL2D::takeScreenshot()
 {
-	glEnd();
+	flush();
+
+	int width, height;
+	SDL_GL_GetDrawableSize(mWindow, &width, &height);
+	SDL_Surface* screenshot = createEmptySurface(width, height);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	// the rows of OpenGL start at the bottom
+	SDL_LockSurface(screenshot);
+	for (int y = 0; y < height; ++y)
+		glReadPixels(0, height - 1 - y, width, 1, GL_RGBA, GL_UNSIGNED_BYTE, (Uint8*)screenshot->pixels + y * screenshot->pitch);
+	SDL_UnlockSurface(screenshot);
+	return screenshot;
 }
 
 void RenderManagerGL2D::refresh()
 {
+	flush();
+	mGlyphCache.nextFrame();
+	uploadPreloadedImage();
+	mDrawCallCount = mDrawCalls;
+	mDrawCalls = 0;
 	//std::cout << debugStateChanges << "\n";
 	SDL_GL_SwapWindow(mWindow);
 	debugStateChanges = 0;
 	//std::cerr << debugBindTextureCount << "\n";
 	debugBindTextureCount = 0;
-
 }
 
 #else
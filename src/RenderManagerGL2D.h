@@ -32,6 +32,10 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <GL/glext.h>
 #endif
 
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
 #include <vector>
 #include <list>
 #include <set>
@@ -42,6 +46,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 	\brief RenderManager on top of OpenGL
 	\details This render manager uses OpenGL for drawing, SDL is only used for loading
 			the images.
+			All sprites and the page of the glyph cache are packed into one atlas texture.
+			The quads of a frame are collected in one vertex buffer and drawn in refresh(),
+			with one draw call for each run of quads that share texture and blend mode.
 */
 class RenderManagerGL2D : public RenderManager
 {
@@ -65,9 +72,11 @@ class RenderManagerGL2D : public RenderManager
 		virtual void drawImage(const std::string& filename, Vector2 position, Vector2 size);
 		virtual void drawOverlay(float opacity, Vector2 pos1, Vector2 pos2, Color col);
 		virtual void drawBlob(const Vector2& pos, const Color& col);
-		virtual void startDrawParticles();
 		virtual void drawParticle(const Vector2& pos, int player);
-		virtual void endDrawParticles();
+		virtual void drawParticles(const float* x, const float* y, const int* players, int count);
+
+		virtual int getDrawCallCount() const;
+		virtual SDL_Surface* takeScreenshot();
 
 	private:
 		// Make sure this object is created before any opengl call
@@ -76,22 +85,72 @@ class RenderManagerGL2D : public RenderManager
 		struct Texture
 		{
 			float indices[8];
-			float w, h ;
+			float w, h;
+			/// position of the top left corner relative to the point the texture is drawn at
+			float ox, oy;
 			GLuint texture;
 
+			Texture() {}
 			Texture( GLuint tex, int x, int y, int w, int h, int tw, int th );
 		};
 
-		GLuint mBackground;
-		GLuint mBallShadow;
+		/// an image which is copied into the atlas in init()
+		struct AtlasImage
+		{
+			SDL_Surface* surface;
+			/// keep the image where it was in its own padded texture, see loadTexture()
+			bool padded;
+			Texture texture;
+
+			AtlasImage(SDL_Surface* surface, bool padded);
+		};
+
+		/// the GL state a quad is drawn with
+		enum DrawMode
+		{
+			DRAW_OPAQUE,		// no blending, no alpha test
+			DRAW_ALPHA_TEST,	// transparent pixels are skipped
+			DRAW_BLEND,			// alpha blending
+			DRAW_ADDITIVE		// additive blending of the non transparent pixels
+		};
 
-		std::vector<GLuint> mBall;
-		std::vector<GLuint> mBlob;
-		std::vector<GLuint> mBlobSpecular;
-		std::vector<GLuint> mBlobShadow;
-		std::vector<Texture> mFont;
-		std::vector<Texture> mHighlightFont;
-		GLuint mParticle;
+		struct Vertex
+		{
+			GLfloat x, y;
+			GLfloat u, v;
+			GLubyte color[4];
+		};
+
+		/// consecutive quads which are drawn with one call
+		struct Batch
+		{
+			GLuint texture;
+			DrawMode mode;
+			GLint first;
+			GLsizei count;
+		};
+
+		// buffer objects are OpenGL 1.5, which is more than some libraries export
+		typedef void (APIENTRY *GenBuffersFunc)(GLsizei, GLuint*);
+		typedef void (APIENTRY *DeleteBuffersFunc)(GLsizei, const GLuint*);
+		typedef void (APIENTRY *BindBufferFunc)(GLenum, GLuint);
+		typedef void (APIENTRY *BufferDataFunc)(GLenum, GLsizeiptr, const GLvoid*, GLenum);
+
+		GLuint mBackground;
+		GLuint mAtlas;
+		int mAtlasWidth;
+		int mAtlasHeight;
+		/// where the page of the glyph cache is in the atlas
+		SDL_Rect mGlyphPage;
+
+		Texture mBallShadow;
+		std::vector<Texture> mBall;
+		std::vector<Texture> mBlob;
+		std::vector<Texture> mBlobSpecular;
+		std::vector<Texture> mBlobShadow;
+		Texture mParticle;
+		/// a single white pixel, for untextured quads
+		Texture mSolid;
 
 		std::list<Vector2> mLastBallStates;
 
@@ -105,9 +164,30 @@ class RenderManagerGL2D : public RenderManager
 
 		Color mBlobColor[MAX_PLAYERS];		
 
-		void drawQuad(float x, float y, float width, float height);
-		void drawQuad(float x, float y, const Texture& tex);
-		GLuint loadTexture(SDL_Surface* surface, bool specular);
+		std::vector<Vertex> mVertices;
+		std::vector<Batch> mBatches;
+		int mDrawCalls;
+		/// draw calls of the last frame
+		int mDrawCallCount;
+
+		GLuint mVertexBuffer;
+		GenBuffersFunc mGenBuffers;
+		DeleteBuffersFunc mDeleteBuffers;
+		BindBufferFunc mBindBuffer;
+		BufferDataFunc mBufferData;
+
+		void drawQuad(float x, float y, float width, float height, const float* indices,
+				GLuint texture, DrawMode mode, const Color& color, GLubyte alpha = 255);
+		void drawQuad(float x, float y, float width, float height, GLuint texture, DrawMode mode);
+		void drawQuad(float x, float y, const Texture& tex, DrawMode mode,
+				const Color& color = Color(255, 255, 255), GLubyte alpha = 255);
+		void drawRect(Vector2 pos1, Vector2 pos2, DrawMode mode, const Color& color, GLubyte alpha = 255);
+		void flush();
+		void setDrawMode(DrawMode mode);
+
+		GLuint loadTexture(SDL_Surface* surface);
+		virtual BufferedImage* uploadImage(SDL_Surface* surface);
+		GLuint buildAtlas(std::vector<AtlasImage>& images);
 		int getNextPOT(int npot);
 
 		void glEnable(unsigned int flag);
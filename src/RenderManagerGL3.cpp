@@ -0,0 +1,877 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+/* header include */
+#include "RenderManagerGL3.h"
+
+#if HAVE_LIBGL
+
+/* includes */
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+#include "AssetPack.h"
+#include "FileExceptions.h"
+
+/* implementation */
+namespace
+{
+	/// everything after OpenGL 1.1 is loaded when the context exists
+	struct GLFunctions
+	{
+		GLuint (APIENTRY *CreateShader)(GLenum);
+		void (APIENTRY *ShaderSource)(GLuint, GLsizei, const GLchar* const*, const GLint*);
+		void (APIENTRY *CompileShader)(GLuint);
+		void (APIENTRY *GetShaderiv)(GLuint, GLenum, GLint*);
+		void (APIENTRY *GetShaderInfoLog)(GLuint, GLsizei, GLsizei*, GLchar*);
+		void (APIENTRY *DeleteShader)(GLuint);
+		GLuint (APIENTRY *CreateProgram)();
+		void (APIENTRY *AttachShader)(GLuint, GLuint);
+		void (APIENTRY *BindAttribLocation)(GLuint, GLuint, const GLchar*);
+		void (APIENTRY *LinkProgram)(GLuint);
+		void (APIENTRY *GetProgramiv)(GLuint, GLenum, GLint*);
+		void (APIENTRY *GetProgramInfoLog)(GLuint, GLsizei, GLsizei*, GLchar*);
+		void (APIENTRY *UseProgram)(GLuint);
+		void (APIENTRY *DeleteProgram)(GLuint);
+		GLint (APIENTRY *GetUniformLocation)(GLuint, const GLchar*);
+		void (APIENTRY *Uniform1i)(GLint, GLint);
+		void (APIENTRY *GenBuffers)(GLsizei, GLuint*);
+		void (APIENTRY *DeleteBuffers)(GLsizei, const GLuint*);
+		void (APIENTRY *BindBuffer)(GLenum, GLuint);
+		void (APIENTRY *BufferData)(GLenum, GLsizeiptr, const void*, GLenum);
+		void (APIENTRY *EnableVertexAttribArray)(GLuint);
+		void (APIENTRY *VertexAttribPointer)(GLuint, GLint, GLenum, GLboolean, GLsizei, const void*);
+		// OpenGL 3.3 and OpenGL ES 3 only
+		void (APIENTRY *VertexAttribDivisor)(GLuint, GLuint);
+		void (APIENTRY *DrawArraysInstanced)(GLenum, GLint, GLsizei, GLsizei);
+		void (APIENTRY *GenVertexArrays)(GLsizei, GLuint*);
+		void (APIENTRY *BindVertexArray)(GLuint);
+		void (APIENTRY *DeleteVertexArrays)(GLsizei, const GLuint*);
+	} gl;
+
+	template<class T>
+	bool loadFunction(T& function, const char* name)
+	{
+		function = (T)SDL_GL_GetProcAddress(name);
+		return function != 0;
+	}
+
+	bool loadFunctions(bool instancing)
+	{
+		bool ok = loadFunction(gl.CreateShader, "glCreateShader")
+			&& loadFunction(gl.ShaderSource, "glShaderSource")
+			&& loadFunction(gl.CompileShader, "glCompileShader")
+			&& loadFunction(gl.GetShaderiv, "glGetShaderiv")
+			&& loadFunction(gl.GetShaderInfoLog, "glGetShaderInfoLog")
+			&& loadFunction(gl.DeleteShader, "glDeleteShader")
+			&& loadFunction(gl.CreateProgram, "glCreateProgram")
+			&& loadFunction(gl.AttachShader, "glAttachShader")
+			&& loadFunction(gl.BindAttribLocation, "glBindAttribLocation")
+			&& loadFunction(gl.LinkProgram, "glLinkProgram")
+			&& loadFunction(gl.GetProgramiv, "glGetProgramiv")
+			&& loadFunction(gl.GetProgramInfoLog, "glGetProgramInfoLog")
+			&& loadFunction(gl.UseProgram, "glUseProgram")
+			&& loadFunction(gl.DeleteProgram, "glDeleteProgram")
+			&& loadFunction(gl.GetUniformLocation, "glGetUniformLocation")
+			&& loadFunction(gl.Uniform1i, "glUniform1i")
+			&& loadFunction(gl.GenBuffers, "glGenBuffers")
+			&& loadFunction(gl.DeleteBuffers, "glDeleteBuffers")
+			&& loadFunction(gl.BindBuffer, "glBindBuffer")
+			&& loadFunction(gl.BufferData, "glBufferData")
+			&& loadFunction(gl.EnableVertexAttribArray, "glEnableVertexAttribArray")
+			&& loadFunction(gl.VertexAttribPointer, "glVertexAttribPointer");
+
+		if (ok && instancing)
+		{
+			ok = loadFunction(gl.VertexAttribDivisor, "glVertexAttribDivisor")
+				&& loadFunction(gl.DrawArraysInstanced, "glDrawArraysInstanced")
+				&& loadFunction(gl.GenVertexArrays, "glGenVertexArrays")
+				&& loadFunction(gl.BindVertexArray, "glBindVertexArray")
+				&& loadFunction(gl.DeleteVertexArrays, "glDeleteVertexArrays");
+		}
+		return ok;
+	}
+
+	enum Attribute
+	{
+		ATTRIBUTE_CORNER,
+		ATTRIBUTE_POSITION,
+		ATTRIBUTE_TEXTURE,
+		ATTRIBUTE_SPECULAR,
+		ATTRIBUTE_COLOR
+	};
+
+	// the sources are written for GLSL ES 1.00, the version header adapts them
+	const char VERTEX_SHADER[] =
+		"VERTEX_IN vec2 corner;\n"
+		"VERTEX_IN vec4 position;\n"
+		"VERTEX_IN vec4 texRect;\n"
+		"VERTEX_IN float specular;\n"
+		"VERTEX_IN vec4 color;\n"
+		"VERTEX_OUT vec2 vTexCoord;\n"
+		"VERTEX_OUT float vSpecular;\n"
+		"VERTEX_OUT vec4 vColor;\n"
+		"void main()\n"
+		"{\n"
+		"	vec2 pos = position.xy + corner * position.zw;\n"
+		"	gl_Position = vec4(pos.x / 400.0 - 1.0, 1.0 - pos.y / 300.0, 0.0, 1.0);\n"
+		"	vTexCoord = texRect.xy + corner * texRect.zw;\n"
+		"	vSpecular = specular;\n"
+		"	vColor = color;\n"
+		"}\n";
+
+	const char FRAGMENT_SHADER[] =
+		"#ifdef GL_ES\n"
+		"#ifdef GL_FRAGMENT_PRECISION_HIGH\n"
+		"precision highp float;\n"
+		"#else\n"
+		"precision mediump float;\n"
+		"#endif\n"
+		"#endif\n"
+		"uniform sampler2D atlas;\n"
+		"FRAGMENT_IN vec2 vTexCoord;\n"
+		"FRAGMENT_IN float vSpecular;\n"
+		"FRAGMENT_IN vec4 vColor;\n"
+		"FRAGMENT_OUT\n"
+		"void main()\n"
+		"{\n"
+		"	vec4 texel = texture2D(atlas, vTexCoord);\n"
+		"	vec4 color = texel * vColor;\n"
+		"#ifdef ALPHA_TEST\n"
+		"	if (color.a <= 0.5)\n"
+		"		discard;\n"
+		"#endif\n"
+		// same highlight as the specular textures of RenderManagerGL2D
+		"	float highlight = clamp((texel.r * 255.0 * 5.0 - 4.0 * 256.0 - 138.0) / 255.0, 0.0, 1.0);\n"
+		"	color.rgb += vSpecular * highlight;\n"
+		"	fragColor = color;\n"
+		"}\n";
+
+	const char VERSION_330[] =
+		"#version 330 core\n"
+		"#define VERTEX_IN in\n"
+		"#define VERTEX_OUT out\n"
+		"#define FRAGMENT_IN in\n"
+		"#define texture2D texture\n"
+		"#define FRAGMENT_OUT out vec4 fragColor;\n";
+
+	const char VERSION_300_ES[] =
+		"#version 300 es\n"
+		"#define VERTEX_IN in\n"
+		"#define VERTEX_OUT out\n"
+		"#define FRAGMENT_IN in\n"
+		"#define texture2D texture\n"
+		"#define FRAGMENT_OUT out vec4 fragColor;\n";
+
+	const char VERSION_100[] =
+		"#version 100\n"
+		"#define VERTEX_IN attribute\n"
+		"#define VERTEX_OUT varying\n"
+		"#define FRAGMENT_IN varying\n"
+		"#define FRAGMENT_OUT\n"
+		"#define fragColor gl_FragColor\n";
+
+	GLuint compileShader(GLenum type, const char* version, const char* defines, const char* source)
+	{
+		const char* sources[] = {version, defines, source};
+		GLuint shader = gl.CreateShader(type);
+		gl.ShaderSource(shader, 3, sources, 0);
+		gl.CompileShader(shader);
+
+		GLint compiled;
+		gl.GetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+		if (!compiled)
+		{
+			char log[1024];
+			gl.GetShaderInfoLog(shader, sizeof(log), 0, log);
+			gl.DeleteShader(shader);
+			BOOST_THROW_EXCEPTION(std::runtime_error(std::string("Could not compile shader: ") + log));
+		}
+		return shader;
+	}
+}
+
+RenderManagerGL3::RenderManagerGL3()
+	: RenderManager()
+	, mGlContext(0)
+	, mDrawCalls(0)
+	, mDrawCallCount(0)
+	, mVertexArray(0)
+{
+	for (int i = 0; i < MAX_PLAYERS; ++i)
+	{
+		mPlayerEnabled[i] = true;
+	}
+}
+
+RenderManager* RenderManager::createRenderManagerGL3()
+{
+	return new RenderManagerGL3();
+}
+
+int RenderManagerGL3::getNextPOT(int npot)
+{
+	int pot = 1;
+	while (pot < npot)
+		pot *= 2;
+
+	return pot;
+}
+
+const char* RenderManagerGL3::createContext()
+{
+	// the first context the driver can create wins
+	struct ContextVersion
+	{
+		int profile;
+		int major;
+		int minor;
+		const char* glsl;
+	};
+	const ContextVersion versions[] = {
+		{SDL_GL_CONTEXT_PROFILE_CORE, 3, 3, VERSION_330},
+		{SDL_GL_CONTEXT_PROFILE_ES, 3, 0, VERSION_300_ES},
+		{SDL_GL_CONTEXT_PROFILE_ES, 2, 0, VERSION_100}
+	};
+
+	for (const ContextVersion& version : versions)
+	{
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, version.profile);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, version.major);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, version.minor);
+		mGlContext = SDL_GL_CreateContext(mWindow);
+		if (mGlContext)
+		{
+			mInstancing = version.major >= 3;
+			return version.glsl;
+		}
+	}
+
+	BOOST_THROW_EXCEPTION(std::runtime_error(std::string("Could not create an OpenGL 3.3 or OpenGL ES 2 context: ") + SDL_GetError()));
+}
+
+GLuint RenderManagerGL3::createProgram(const char* version, const char* defines)
+{
+	GLuint vertexShader = compileShader(GL_VERTEX_SHADER, version, defines, VERTEX_SHADER);
+	GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, version, defines, FRAGMENT_SHADER);
+
+	GLuint program = gl.CreateProgram();
+	gl.AttachShader(program, vertexShader);
+	gl.AttachShader(program, fragmentShader);
+	gl.BindAttribLocation(program, ATTRIBUTE_CORNER, "corner");
+	gl.BindAttribLocation(program, ATTRIBUTE_POSITION, "position");
+	gl.BindAttribLocation(program, ATTRIBUTE_TEXTURE, "texRect");
+	gl.BindAttribLocation(program, ATTRIBUTE_SPECULAR, "specular");
+	gl.BindAttribLocation(program, ATTRIBUTE_COLOR, "color");
+	gl.LinkProgram(program);
+	gl.DeleteShader(vertexShader);
+	gl.DeleteShader(fragmentShader);
+
+	GLint linked;
+	gl.GetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (!linked)
+	{
+		char log[1024];
+		gl.GetProgramInfoLog(program, sizeof(log), 0, log);
+		BOOST_THROW_EXCEPTION(std::runtime_error(std::string("Could not link shader program: ") + log));
+	}
+
+	gl.UseProgram(program);
+	gl.Uniform1i(gl.GetUniformLocation(program, "atlas"), 0);
+	return program;
+}
+
+void RenderManagerGL3::createBuffers()
+{
+	if (mInstancing)
+	{
+		// vertex arrays are mandatory in the core profile
+		gl.GenVertexArrays(1, &mVertexArray);
+		gl.BindVertexArray(mVertexArray);
+
+		// two triangles, shared by all instances
+		const GLfloat corners[] = {0.f, 0.f, 1.f, 0.f, 1.f, 1.f,
+		                           0.f, 0.f, 1.f, 1.f, 0.f, 1.f};
+		gl.GenBuffers(1, &mCornerBuffer);
+		gl.BindBuffer(GL_ARRAY_BUFFER, mCornerBuffer);
+		gl.BufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+		gl.VertexAttribPointer(ATTRIBUTE_CORNER, 2, GL_FLOAT, GL_FALSE, 0, 0);
+
+		for (GLuint attribute = ATTRIBUTE_POSITION; attribute <= ATTRIBUTE_COLOR; ++attribute)
+			gl.VertexAttribDivisor(attribute, 1);
+	}
+	else
+	{
+		mCornerBuffer = 0;
+	}
+
+	for (GLuint attribute = ATTRIBUTE_CORNER; attribute <= ATTRIBUTE_COLOR; ++attribute)
+		gl.EnableVertexAttribArray(attribute);
+
+	gl.GenBuffers(1, &mInstanceBuffer);
+	gl.BindBuffer(GL_ARRAY_BUFFER, mInstanceBuffer);
+	mInstances.reserve(512);
+}
+
+void RenderManagerGL3::setInstanceAttributes(const GLubyte* offset, GLsizei stride)
+{
+	gl.VertexAttribPointer(ATTRIBUTE_POSITION, 4, GL_FLOAT, GL_FALSE, stride, offset + offsetof(Instance, position));
+	gl.VertexAttribPointer(ATTRIBUTE_TEXTURE, 4, GL_FLOAT, GL_FALSE, stride, offset + offsetof(Instance, texture));
+	gl.VertexAttribPointer(ATTRIBUTE_SPECULAR, 1, GL_FLOAT, GL_FALSE, stride, offset + offsetof(Instance, specular));
+	gl.VertexAttribPointer(ATTRIBUTE_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, offset + offsetof(Instance, color));
+}
+
+GLuint RenderManagerGL3::loadTexture(SDL_Surface* surface)
+{
+	// Determine size of padding for 2^n format
+	SDL_Surface* convertedTexture =
+		SDL_CreateRGBSurface(SDL_SWSURFACE,
+			getNextPOT(surface->w), getNextPOT(surface->h), 32,
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+			0xff000000, 0x00ff0000, 0x0000ff00, 0x000000ff);
+#else
+			0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000);
+#endif
+	SDL_Rect targetRect = {(convertedTexture->w - surface->w) / 2, (convertedTexture->h - surface->h) / 2,
+			surface->w, surface->h};
+	AssetPack::copyImage(surface, convertedTexture, &targetRect);
+
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
+			convertedTexture->w, convertedTexture->h, 0, GL_RGBA,
+			GL_UNSIGNED_BYTE, convertedTexture->pixels);
+	SDL_FreeSurface(surface);
+	SDL_FreeSurface(convertedTexture);
+
+	return texture;
+}
+
+void RenderManagerGL3::init(int xResolution, int yResolution, bool fullscreen)
+{
+	// the images are decoded while the window and the context are created
+	preloadGameImages();
+
+	SDL_GL_SetAttribute(SDL_GL_RED_SIZE, 8);
+	SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE, 8);
+	SDL_GL_SetAttribute(SDL_GL_BLUE_SIZE, 8);
+	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+
+	// Set modesetting
+	Uint32 screenFlags = SDL_WINDOW_OPENGL;
+	if (fullscreen)
+		screenFlags |= SDL_WINDOW_FULLSCREEN;
+
+	// Create window
+	mWindow = SDL_CreateWindow(AppTitle,
+		SDL_WINDOWPOS_UNDEFINED,
+		SDL_WINDOWPOS_UNDEFINED,
+		xResolution, yResolution,
+		screenFlags);
+
+	// Set icon
+	SDL_Surface* icon = loadSurface("Icon.bmp");
+	SDL_SetColorKey(icon, SDL_TRUE,
+			SDL_MapRGB(icon->format, 0, 0, 0));
+	SDL_SetWindowIcon(mWindow, icon);
+	SDL_FreeSurface(icon);
+
+	// the shaders are compiled before anything else is set up, so a driver that can't
+	// run them leaves nothing behind and the caller can fall back to another renderer
+	try
+	{
+		const char* glslVersion = createContext();
+		if (!loadFunctions(mInstancing))
+			BOOST_THROW_EXCEPTION(std::runtime_error("OpenGL driver lacks shader or buffer functions"));
+
+		mProgram = createProgram(glslVersion, "");
+		mAlphaTestProgram = createProgram(glslVersion, "#define ALPHA_TEST\n");
+	}
+	catch (...)
+	{
+		if (mGlContext)
+			SDL_GL_DeleteContext(mGlContext);
+		mGlContext = 0;
+		SDL_DestroyWindow(mWindow);
+		mWindow = 0;
+		throw;
+	}
+
+	SDL_ShowCursor(0);
+
+	for (int i = 0; i < MAX_PLAYERS; ++i)
+	{
+		mBlobColor[i] = Color(255, 0, 0);
+	}
+
+	// Load background
+	SDL_Surface* bgSurface = loadTextureSurface("backgrounds/strand2.bmp");
+	BufferedImage* bgBufImage = new BufferedImage;
+	bgBufImage->w = getNextPOT(bgSurface->w);
+	bgBufImage->h = getNextPOT(bgSurface->h);
+	bgBufImage->glHandle = loadTexture(bgSurface);
+	mBackground = bgBufImage->glHandle;
+	mImageMap["background"] = bgBufImage;
+
+	// all other images share one texture. The padded ones are positioned as if they
+	// were centered in a power of two texture, like RenderManagerGL2D draws them
+	std::vector<SDL_Surface*> images;
+	std::vector<bool> padded;
+	images.push_back(loadTextureSurface("gfx/schball.bmp"));
+	padded.push_back(true);
+
+	for (int i = 1; i <= 16; ++i)
+	{
+		char filename[64];
+		sprintf(filename, "gfx/ball%02d.bmp", i);
+		images.push_back(loadTextureSurface(filename));
+		padded.push_back(true);
+	}
+
+	for (int i = 1; i <= 5; ++i)
+	{
+		char filename[64];
+		sprintf(filename, "gfx/blobbym%d.bmp", i);
+		images.push_back(loadTextureSurface(filename));
+		padded.push_back(true);
+		sprintf(filename, "gfx/sch1%d.bmp", i);
+		images.push_back(loadTextureSurface(filename));
+		padded.push_back(true);
+	}
+
+	images.push_back(loadTextureSurface("gfx/blood.bmp"));
+	padded.push_back(true);
+
+	// space for the glyph cache, the glyphs are copied there when they are drawn
+	const unsigned int glyphPage = images.size();
+	images.push_back(createEmptySurface(GlyphCache::PAGE_WIDTH, GlyphCache::PAGE_HEIGHT));
+	padded.push_back(false);
+
+	SDL_Surface* solid = createEmptySurface(1, 1);
+	SDL_FillRect(solid, 0, SDL_MapRGB(solid->format, 255, 255, 255));
+	images.push_back(solid);
+	padded.push_back(false);
+
+	std::vector<SDL_Rect> rects;
+	SDL_Surface* atlas = createAtlas(images, rects);
+
+	glGenTextures(1, &mAtlas);
+	glBindTexture(GL_TEXTURE_2D, mAtlas);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, atlas->w, atlas->h, 0, GL_RGBA,
+			GL_UNSIGNED_BYTE, atlas->pixels);
+	mAtlasWidth = atlas->w;
+	mAtlasHeight = atlas->h;
+
+	std::vector<Sprite> sprites(images.size());
+	for (unsigned int i = 0; i < images.size(); ++i)
+	{
+		Sprite& sprite = sprites[i];
+		sprite.rect[0] = rects[i].x / float(atlas->w);
+		sprite.rect[1] = rects[i].y / float(atlas->h);
+		sprite.rect[2] = rects[i].w / float(atlas->w);
+		sprite.rect[3] = rects[i].h / float(atlas->h);
+		sprite.w = rects[i].w;
+		sprite.h = rects[i].h;
+		sprite.ox = -rects[i].w / 2.f;
+		sprite.oy = -rects[i].h / 2.f;
+		if (padded[i])
+		{
+			int paddedX = getNextPOT(rects[i].w);
+			int paddedY = getNextPOT(rects[i].h);
+			sprite.ox = (paddedX - rects[i].w) / 2 - paddedX / 2.f;
+			sprite.oy = (paddedY - rects[i].h) / 2 - paddedY / 2.f;
+		}
+		sprite.texture = mAtlas;
+		SDL_FreeSurface(images[i]);
+	}
+	SDL_FreeSurface(atlas);
+
+	std::vector<Sprite>::const_iterator sprite = sprites.begin();
+	mBallShadow = *sprite++;
+	mBall.assign(sprite, sprite + 16);
+	sprite += 16;
+
+	for (int i = 1; i <= 5; ++i)
+	{
+		mBlob.push_back(*sprite++);
+		mBlobShadow.push_back(*sprite++);
+	}
+
+	mParticle = *sprite++;
+
+	mGlyphPage = rects[glyphPage];
+	++sprite;
+	mGlyphCache.clear();
+
+	// always sample the center of the white pixel
+	mSolid = *sprite++;
+	mSolid.rect[0] += mSolid.rect[2] / 2;
+	mSolid.rect[1] += mSolid.rect[3] / 2;
+	mSolid.rect[2] = 0;
+	mSolid.rect[3] = 0;
+
+	createBuffers();
+
+	glViewport(0, 0, xResolution, yResolution);
+
+	preloadInterfaceImages();
+}
+
+void RenderManagerGL3::deinit()
+{
+	// init failed, there is nothing to release
+	if (!mGlContext)
+		return;
+
+	mInstances.clear();
+	mBatches.clear();
+
+	gl.DeleteBuffers(1, &mInstanceBuffer);
+	if (mCornerBuffer)
+		gl.DeleteBuffers(1, &mCornerBuffer);
+	if (mVertexArray)
+		gl.DeleteVertexArrays(1, &mVertexArray);
+	gl.DeleteProgram(mProgram);
+	gl.DeleteProgram(mAlphaTestProgram);
+
+	glDeleteTextures(1, &mBackground);
+	glDeleteTextures(1, &mAtlas);
+
+	for (std::map<std::string, BufferedImage*>::iterator iter = mImageMap.begin();
+		iter != mImageMap.end(); ++iter)
+	{
+		glDeleteTextures(1, &(*iter).second->glHandle);
+		delete iter->second;
+	}
+
+	SDL_GL_DeleteContext(mGlContext);
+	SDL_DestroyWindow(mWindow);
+}
+
+void RenderManagerGL3::drawSprite(float x, float y, float w, float h, const GLfloat* rect,
+		GLuint texture, DrawMode mode, const Color& color, GLubyte alpha, bool specular)
+{
+	if (mBatches.empty() || mBatches.back().texture != texture || mBatches.back().mode != mode)
+	{
+		Batch batch = {texture, mode, (GLint)mInstances.size(), 0};
+		mBatches.push_back(batch);
+	}
+	mBatches.back().count++;
+
+	Instance instance = {{x, y, w, h}, {rect[0], rect[1], rect[2], rect[3]},
+			specular ? 1.f : 0.f, {color.r, color.g, color.b, alpha}};
+	mInstances.push_back(instance);
+}
+
+void RenderManagerGL3::drawSprite(float x, float y, const Sprite& sprite, DrawMode mode,
+		const Color& color, GLubyte alpha, bool specular)
+{
+	drawSprite(x + sprite.ox, y + sprite.oy, sprite.w, sprite.h, sprite.rect, sprite.texture,
+			mode, color, alpha, specular);
+}
+
+void RenderManagerGL3::drawTexture(float x, float y, float w, float h, GLuint texture)
+{
+	static const GLfloat rect[] = {0.f, 0.f, 1.f, 1.f};
+	drawSprite(x - w / 2.f, y - h / 2.f, w, h, rect, texture, DRAW_ALPHA_TEST, Color(255, 255, 255));
+}
+
+void RenderManagerGL3::drawRect(Vector2 pos1, Vector2 pos2, DrawMode mode, const Color& color, GLubyte alpha)
+{
+	drawSprite(pos1.x, pos1.y, pos2.x - pos1.x, pos2.y - pos1.y, mSolid.rect, mSolid.texture,
+			mode, color, alpha);
+}
+
+void RenderManagerGL3::setDrawMode(DrawMode mode)
+{
+	if (mode == DRAW_BLEND)
+	{
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glEnable(GL_BLEND);
+	}
+	else
+	{
+		glDisable(GL_BLEND);
+	}
+	gl.UseProgram(mode == DRAW_ALPHA_TEST ? mAlphaTestProgram : mProgram);
+}
+
+void RenderManagerGL3::flush()
+{
+	if (mInstances.empty())
+		return;
+
+	// glyphs which were loaded since the last flush
+	SDL_Rect rows;
+	if (mGlyphCache.takeChangedRows(rows))
+	{
+		SDL_Surface* page = mGlyphCache.getPage();
+		glBindTexture(GL_TEXTURE_2D, mAtlas);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, mGlyphPage.x, mGlyphPage.y + rows.y, rows.w, rows.h,
+				GL_RGBA, GL_UNSIGNED_BYTE, (const Uint8*)page->pixels + rows.y * page->pitch);
+	}
+
+	if (mInstancing)
+	{
+		gl.BufferData(GL_ARRAY_BUFFER, mInstances.size() * sizeof(Instance), &mInstances[0], GL_STREAM_DRAW);
+		for (const Batch& batch : mBatches)
+		{
+			setDrawMode(batch.mode);
+			glBindTexture(GL_TEXTURE_2D, batch.texture);
+			setInstanceAttributes((const GLubyte*)0 + batch.first * sizeof(Instance), sizeof(Instance));
+			gl.DrawArraysInstanced(GL_TRIANGLES, 0, 6, batch.count);
+		}
+	}
+	else
+	{
+		// every instance becomes two triangles
+		static const GLfloat corners[] = {0.f, 0.f, 1.f, 0.f, 1.f, 1.f,
+		                                  0.f, 0.f, 1.f, 1.f, 0.f, 1.f};
+		mVertices.resize(mInstances.size() * 6);
+		for (unsigned int i = 0; i < mVertices.size(); ++i)
+		{
+			mVertices[i].corner[0] = corners[2 * (i % 6)];
+			mVertices[i].corner[1] = corners[2 * (i % 6) + 1];
+			mVertices[i].instance = mInstances[i / 6];
+		}
+
+		gl.BufferData(GL_ARRAY_BUFFER, mVertices.size() * sizeof(Vertex), &mVertices[0], GL_STREAM_DRAW);
+		gl.VertexAttribPointer(ATTRIBUTE_CORNER, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), 0);
+		setInstanceAttributes((const GLubyte*)0 + offsetof(Vertex, instance), sizeof(Vertex));
+		for (const Batch& batch : mBatches)
+		{
+			setDrawMode(batch.mode);
+			glBindTexture(GL_TEXTURE_2D, batch.texture);
+			glDrawArrays(GL_TRIANGLES, batch.first * 6, batch.count * 6);
+		}
+	}
+
+	mDrawCalls += mBatches.size();
+	mInstances.clear();
+	mBatches.clear();
+}
+
+void RenderManagerGL3::draw()
+{
+	if (!mDrawGame)
+		return;
+
+	// Background
+	static const GLfloat all[] = {0.f, 0.f, 1.f, 1.f};
+	drawSprite(400.0 - 512.0, 300.0 - 512.0, 1024.0, 1024.0, all, mBackground, DRAW_OPAQUE, Color(255, 255, 255));
+
+	if(mShowShadow)
+	{
+		// Blob shadows
+		Vector2 pos;
+
+		for (int i = 0; i < MAX_PLAYERS; ++i)
+		{
+			if(mPlayerEnabled[i])
+			{
+				pos = blobShadowPosition(mBlobPosition[i]);
+				drawSprite(pos.x, pos.y, mBlobShadow[int(mBlobAnimationState[i]) % 5],
+						DRAW_BLEND, mBlobColor[i], 128);
+			}
+		}
+
+		// Ball shadow
+		pos = ballShadowPosition(mBallPosition);
+		drawSprite(pos.x, pos.y, mBallShadow, DRAW_BLEND, Color(255, 255, 255), 128);
+	}
+
+	// The Ball
+	drawSprite(mBallPosition.x, mBallPosition.y, mBall[int(mBallRotation / M_PI / 2 * 16) % 16], DRAW_ALPHA_TEST);
+
+	// blobs, coloured and with specular highlight
+	for (int i = 0; i < MAX_PLAYERS; ++i)
+	{
+		if (mPlayerEnabled[i])
+		{
+			drawSprite(mBlobPosition[i].x, mBlobPosition[i].y, mBlob[int(mBlobAnimationState[i]) % 5],
+					DRAW_ALPHA_TEST, mBlobColor[i], 255, true);
+		}
+	}
+
+	// Ball marker
+	GLubyte markerColor = SDL_GetTicks() % 1000 >= 500 ? 255 : 0;
+	Color marker(markerColor, markerColor, markerColor);
+	drawRect(Vector2(mBallPosition.x - 2.5, 5.0), Vector2(mBallPosition.x + 2.5, 10.0), DRAW_ALPHA_TEST, marker);
+
+	// Mouse marker
+	drawRect(Vector2(mMouseMarkerPosition - 2.5, 590.0), Vector2(mMouseMarkerPosition + 2.5, 595.0), DRAW_ALPHA_TEST, marker);
+}
+
+bool RenderManagerGL3::setBackground(const std::string& filename)
+{
+	try
+	{
+		SDL_Surface* newSurface = loadTextureSurface(filename);
+		// the old background might still be used by the current frame
+		flush();
+		glDeleteTextures(1, &mBackground);
+		delete mImageMap["background"];
+		BufferedImage *imgBuffer = new BufferedImage;
+		imgBuffer->w = getNextPOT(newSurface->w);
+		imgBuffer->h = getNextPOT(newSurface->h);
+		imgBuffer->glHandle = loadTexture(newSurface);
+		mBackground = imgBuffer->glHandle;
+		mImageMap["background"] = imgBuffer;
+	}
+	catch (const FileLoadException&)
+	{
+		return false;
+	}
+	return true;
+}
+
+void RenderManagerGL3::setBlobColor(int player, Color color)
+{
+	mBlobColor[player] = color;
+}
+
+void RenderManagerGL3::showShadow(bool shadow)
+{
+	mShowShadow = shadow;
+}
+
+void RenderManagerGL3::setBall(const Vector2& position, float rotation)
+{
+	mBallPosition = position;
+	mBallRotation = rotation;
+}
+
+void RenderManagerGL3::setBlob(int player, const Vector2& position, float animationState, bool enabled)
+{
+	mPlayerEnabled[player] = enabled;
+	mBlobPosition[player] = position;
+	mBlobAnimationState[player] = animationState;
+}
+
+void RenderManagerGL3::drawText(const std::string& text, Vector2 position, unsigned int flags)
+{
+	int FontSize = (flags & TF_SMALL_FONT ? FONT_WIDTH_SMALL : FONT_WIDTH_NORMAL);
+	const std::vector<SDL_Rect>& glyphs = mGlyphCache.getText(text, flags);
+
+	float x = position.x;
+	for (const SDL_Rect& glyph : glyphs)
+	{
+		if (glyph.w > 0)
+		{
+			GLfloat rect[] = {(mGlyphPage.x + glyph.x) / float(mAtlasWidth), (mGlyphPage.y + glyph.y) / float(mAtlasHeight),
+					glyph.w / float(mAtlasWidth), glyph.h / float(mAtlasHeight)};
+			drawSprite(x, position.y, FontSize, FontSize, rect, mAtlas, DRAW_ALPHA_TEST, Color(255, 255, 255));
+		}
+		x += FontSize;
+	}
+}
+
+void RenderManagerGL3::drawImage(const std::string& filename, Vector2 position, Vector2 size)
+{
+	BufferedImage* imageBuffer = mImageMap[filename];
+	if (!imageBuffer)
+	{
+		imageBuffer = uploadImage(loadSurface(filename));
+		mImageMap[filename] = imageBuffer;
+	}
+
+	drawTexture(position.x, position.y, imageBuffer->w, imageBuffer->h, imageBuffer->glHandle);
+}
+
+BufferedImage* RenderManagerGL3::uploadImage(SDL_Surface* surface)
+{
+	BufferedImage* imageBuffer = new BufferedImage;
+	imageBuffer->w = getNextPOT(surface->w);
+	imageBuffer->h = getNextPOT(surface->h);
+	imageBuffer->glHandle = loadTexture(surface);
+	return imageBuffer;
+}
+
+void RenderManagerGL3::drawOverlay(float opacity, Vector2 pos1, Vector2 pos2, Color col)
+{
+	drawRect(pos1, pos2, DRAW_BLEND, col, GLubyte(opacity * 255 + 0.5f));
+}
+
+void RenderManagerGL3::drawBlob(const Vector2& pos, const Color& col)
+{
+	drawSprite(pos.x, pos.y, mBlob[0], DRAW_ALPHA_TEST, col, 255, true);
+}
+
+void RenderManagerGL3::drawParticle(const Vector2& pos, int player)
+{
+	drawSprite(pos.x, pos.y, mParticle, DRAW_ALPHA_TEST, mBlobColor[player]);
+}
+
+void RenderManagerGL3::drawParticles(const float* x, const float* y, const int* players, int count)
+{
+	for (int i = 0; i < count; ++i)
+		drawSprite(x[i], y[i], mParticle, DRAW_ALPHA_TEST, mBlobColor[players[i]]);
+}
+
+int RenderManagerGL3::getDrawCallCount() const
+{
+	return mDrawCallCount;
+}
+
+SDL_Surface* RenderManagerGL3::takeScreenshot()
+{
+	flush();
+
+	int width, height;
+	SDL_GL_GetDrawableSize(mWindow, &width, &height);
+	SDL_Surface* screenshot = createEmptySurface(width, height);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	// the rows of OpenGL start at the bottom
+	SDL_LockSurface(screenshot);
+	for (int y = 0; y < height; ++y)
+		glReadPixels(0, height - 1 - y, width, 1, GL_RGBA, GL_UNSIGNED_BYTE, (Uint8*)screenshot->pixels + y * screenshot->pitch);
+	SDL_UnlockSurface(screenshot);
+	return screenshot;
+}
+
+void RenderManagerGL3::refresh()
+{
+	flush();
+	mGlyphCache.nextFrame();
+	uploadPreloadedImage();
+	mDrawCallCount = mDrawCalls;
+	mDrawCalls = 0;
+	SDL_GL_SwapWindow(mWindow);
+}
+
+#else
+
+#include "RenderManager.h"
+
+RenderManager* RenderManager::createRenderManagerGL3()
+{
+	std::cerr << "OpenGL not available! Falling back to SDL renderer" <<
+		std::endl;
+	return RenderManager::createRenderManagerSDL();
+}
+
+
+#endif
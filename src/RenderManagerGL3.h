@@ -0,0 +1,185 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#pragma once
+
+#if HAVE_LIBGL
+
+#include <SDL2/SDL.h>
+
+#if __MACOSX__
+#include <OpenGL/gl.h>
+#include <OpenGL/glext.h>
+#else
+#include <GL/gl.h>
+#include <GL/glext.h>
+#endif
+
+#include <vector>
+
+#include "RenderManager.h"
+
+/*! \class RenderManagerGL3
+	\brief RenderManager on top of OpenGL 3.3 core or OpenGL ES 2/3
+	\details This render manager draws everything with one shader, compiled with and
+			without alpha test, and does not need the fixed function pipeline. Each sprite is one instance with its
+			position, texture rectangle, colour and specular flag, so the blobs are
+			coloured and get their specular highlight in a single pass.
+			Like RenderManagerGL2D, all sprites and glyphs share an atlas, and each run of
+			instances with the same texture and blend mode is one instanced draw call.
+			Without instancing (OpenGL ES 2) the instances are expanded to vertices.
+*/
+class RenderManagerGL3 : public RenderManager
+{
+	public:
+		RenderManagerGL3();
+
+		virtual void init(int xResolution, int yResolution, bool fullscreen);
+		virtual void deinit();
+		virtual void draw();
+		virtual void refresh();
+
+		virtual bool setBackground(const std::string& filename);
+		virtual void setBlobColor(int player, Color color);
+		virtual void showShadow(bool shadow);
+
+		virtual void setBall(const Vector2& position, float rotation);
+		virtual void setBlob(int player, const Vector2& position,
+				float animationState, bool enabled);
+
+		virtual void drawText(const std::string& text, Vector2 position, unsigned int flags = TF_NORMAL);
+		virtual void drawImage(const std::string& filename, Vector2 position, Vector2 size);
+		virtual void drawOverlay(float opacity, Vector2 pos1, Vector2 pos2, Color col);
+		virtual void drawBlob(const Vector2& pos, const Color& col);
+		virtual void drawParticle(const Vector2& pos, int player);
+		virtual void drawParticles(const float* x, const float* y, const int* players, int count);
+
+		virtual int getDrawCallCount() const;
+		virtual SDL_Surface* takeScreenshot();
+
+	private:
+		SDL_GLContext mGlContext;
+
+		/// part of a texture, drawn centered around a point
+		struct Sprite
+		{
+			GLfloat rect[4];
+			float w, h;
+			/// position of the top left corner relative to the point the sprite is drawn at
+			float ox, oy;
+			GLuint texture;
+		};
+
+		/// the per instance attributes
+		struct Instance
+		{
+			GLfloat position[4];	// x, y, width, height
+			GLfloat texture[4];		// u, v, width, height
+			GLfloat specular;
+			GLubyte color[4];
+		};
+
+		/// one corner of an instance, for drawing without instancing
+		struct Vertex
+		{
+			GLfloat corner[2];
+			Instance instance;
+		};
+
+		/// the GL state an instance is drawn with
+		enum DrawMode
+		{
+			DRAW_OPAQUE,		// no blending, no alpha test
+			DRAW_ALPHA_TEST,	// transparent pixels are skipped
+			DRAW_BLEND			// alpha blending
+		};
+
+		/// consecutive instances which are drawn with one call
+		struct Batch
+		{
+			GLuint texture;
+			DrawMode mode;
+			GLint first;
+			GLsizei count;
+		};
+
+		GLuint mBackground;
+		GLuint mAtlas;
+		int mAtlasWidth;
+		int mAtlasHeight;
+		/// where the page of the glyph cache is in the atlas
+		SDL_Rect mGlyphPage;
+
+		Sprite mBallShadow;
+		std::vector<Sprite> mBall;
+		std::vector<Sprite> mBlob;
+		std::vector<Sprite> mBlobShadow;
+		Sprite mParticle;
+		/// a single white pixel, for untextured quads
+		Sprite mSolid;
+
+		Vector2 mBallPosition;
+		float mBallRotation;
+
+		Vector2 mBlobPosition[MAX_PLAYERS];
+		float mBlobAnimationState[MAX_PLAYERS];
+
+		bool mShowShadow;
+
+		Color mBlobColor[MAX_PLAYERS];
+
+		std::vector<Instance> mInstances;
+		std::vector<Batch> mBatches;
+		int mDrawCalls;
+		/// draw calls of the last frame
+		int mDrawCallCount;
+
+		bool mInstancing;
+		GLuint mProgram;
+		/// same program, but discards transparent texels. Kept separate because
+		/// a shader that may discard is slower for the big opaque background
+		GLuint mAlphaTestProgram;
+		GLuint mVertexArray;
+		GLuint mCornerBuffer;
+		GLuint mInstanceBuffer;
+		/// the instances expanded to vertices, without instancing
+		std::vector<Vertex> mVertices;
+
+		const char* createContext();
+		GLuint createProgram(const char* version, const char* defines);
+		void createBuffers();
+		void setInstanceAttributes(const GLubyte* offset, GLsizei stride);
+
+		void drawSprite(float x, float y, float width, float height, const GLfloat* rect,
+				GLuint texture, DrawMode mode, const Color& color, GLubyte alpha = 255, bool specular = false);
+		void drawSprite(float x, float y, const Sprite& sprite, DrawMode mode,
+				const Color& color = Color(255, 255, 255), GLubyte alpha = 255, bool specular = false);
+		void drawTexture(float x, float y, float width, float height, GLuint texture);
+		void drawRect(Vector2 pos1, Vector2 pos2, DrawMode mode, const Color& color, GLubyte alpha = 255);
+		void flush();
+		void setDrawMode(DrawMode mode);
+
+		GLuint loadTexture(SDL_Surface* surface);
+		virtual BufferedImage* uploadImage(SDL_Surface* surface);
+		int getNextPOT(int npot);
+};
+
+
+#endif
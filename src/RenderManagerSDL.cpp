@@ -22,83 +22,31 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "RenderManagerSDL.h"
 
 /* includes */
+#include <algorithm>
+
 #include "FileExceptions.h"
+#include "UTF8.h"
 
 /* implementation */
-SDL_Surface* RenderManagerSDL::colorSurface(SDL_Surface *surface, Color color)
+bool RenderManagerSDL::DrawCommand::operator==(const DrawCommand& other) const
 {
-	// Create new surface
-	SDL_Surface *newSurface = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ABGR8888, 0);
-
-	SDL_LockSurface(newSurface);
-
-	SDL_Color pixel;
-
-	for (int p = 0; p < newSurface->w * newSurface->h; ++p)
-	{
-		SDL_GetRGBA(((Uint32*)newSurface->pixels)[p], 
-		              newSurface->format,
-		              &pixel.r,
-		              &pixel.g,
-		              &pixel.b,
-		              &pixel.a);
-
-		const bool colorkey = !(pixel.r | pixel.g | pixel.b);
-
-		if (colorkey)
-		{
-			pixel.r = 0;
-			pixel.g = 0;
-			pixel.b = 0;
-			pixel.a = 0;
-		}
-		else
-		{
-			int rr = (int(pixel.r) * int(color.r)) >> 8;
-			int rg = (int(pixel.g) * int(color.g)) >> 8;
-			int rb = (int(pixel.b) * int(color.b)) >> 8;
-			int fak = int(pixel.r) * 5 - 4 * 256 - 138;
-
-
-			if (fak > 0)
-			{
-				rr += fak;
-				rg += fak;
-				rb += fak;
-			}
-			rr = rr < 255 ? rr : 255;
-			rg = rg < 255 ? rg : 255;
-			rb = rb < 255 ? rb : 255;
-
-			// This is clamped to 1 because dark colors may would be
-			// colorkeyed otherwise
-			pixel.r = rr > 0 ? rr : 1;
-			pixel.g = rg > 0 ? rg : 1;
-			pixel.b = rb > 0 ? rb : 1;
-		}
-
-		((Uint32*)newSurface->pixels)[p] = SDL_MapRGBA(newSurface->format, 
-		                                               pixel.r, 
-		                                               pixel.g, 
-		                                               pixel.b, 
-		                                               pixel.a);
-	}
-	SDL_UnlockSurface(newSurface);
-
-	// Use a black colorkey
-	SDL_SetColorKey(newSurface, SDL_TRUE, SDL_MapRGB(newSurface->format, 0, 0, 0));
-
-	return newSurface;
+	return texture == other.texture && hasSource == other.hasSource
+		&& (!hasSource || SDL_RectEquals(&source, &other.source))
+		&& SDL_RectEquals(&destination, &other.destination)
+		&& color.toInt() == other.color.toInt() && alpha == other.alpha;
 }
 
 RenderManagerSDL::RenderManagerSDL()
 	: RenderManager()
+	, mDrawCallCount(0)
+	, mComposed(false)
 {
 	mBallRotation = 0.0;
 	for (int i = 0; i < MAX_PLAYERS; ++i)
 	{
 		mBlobAnimationState[i] = 0.0;
 		mPlayerEnabled[i] = true;
+		mBlobColor[i] = Color(255, 0, 0);
 	}	
 }
 
@@ -109,6 +57,9 @@ RenderManager* RenderManager::createRenderManagerSDL()
 
 void RenderManagerSDL::init(int xResolution, int yResolution, bool fullscreen)
 {
+	// the images are decoded while the window and the renderer are created
+	preloadGameImages();
+
 	SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "1");
 
 	// Set modesetting
@@ -143,6 +94,14 @@ void RenderManagerSDL::init(int xResolution, int yResolution, bool fullscreen)
 
 	// Create rendertarget to make window resizeable
 	mRenderTarget = SDL_CreateTexture(mRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, xResolution, yResolution);
+	mScreenRect.x = 0;
+	mScreenRect.y = 0;
+	mScreenRect.w = xResolution;
+	mScreenRect.h = yResolution;
+	mTilesX = (xResolution + DIRTY_TILE_SIZE - 1) / DIRTY_TILE_SIZE;
+	mTilesY = (yResolution + DIRTY_TILE_SIZE - 1) / DIRTY_TILE_SIZE;
+	mLastCommands.clear();
+	mNeedRedraw = true;
 
 	// Load all textures and surfaces to render the game
 	SDL_Surface* tmpSurface;
@@ -179,95 +138,39 @@ void RenderManagerSDL::init(int xResolution, int yResolution, bool fullscreen)
 	{
 		char filename[64];
 		sprintf(filename, "gfx/ball%02d.bmp", i);
-		tmpSurface = loadSurface(filename);
-		SDL_SetColorKey(tmpSurface, SDL_TRUE,
-				SDL_MapRGB(tmpSurface->format, 0, 0, 0));
-
+		tmpSurface = loadTextureSurface(filename);
 		SDL_Texture *ballTexture = SDL_CreateTextureFromSurface(mRenderer, tmpSurface);
 		SDL_FreeSurface(tmpSurface);
 		mBall.push_back(ballTexture);
 	}
 
 	// Load ball shadow
-	tmpSurface = loadSurface("gfx/schball.bmp");
-	SDL_SetColorKey(tmpSurface, SDL_TRUE,
-			SDL_MapRGB(tmpSurface->format, 0, 0, 0));
-
-	SDL_SetSurfaceAlphaMod(tmpSurface, 127);
+	tmpSurface = loadTextureSurface("gfx/schball.bmp");
 	mBallShadow = SDL_CreateTextureFromSurface(mRenderer, tmpSurface);
 	SDL_FreeSurface(tmpSurface);
 
 	// Load blobby and shadows surface
-	// Load streamed textures for coloring
 	for (int i = 1; i <= 5; ++i)
 	{
 		// Load blobby surface
 		char filename[64];
 		sprintf(filename, "gfx/blobbym%d.bmp", i);
-		SDL_Surface* blobImage = loadSurface(filename);
-		SDL_Surface* formatedBlobImage = SDL_ConvertSurfaceFormat(blobImage, SDL_PIXELFORMAT_ABGR8888, 0);
+		SDL_Surface* blobImage = loadTextureSurface(filename);
+		mBlob.push_back(SDL_CreateTextureFromSurface(mRenderer, blobImage));
 		SDL_FreeSurface(blobImage);
 
-		SDL_SetColorKey(formatedBlobImage, SDL_TRUE,
-				SDL_MapRGB(formatedBlobImage->format, 0, 0, 0));
-		for(int j = 0; j < formatedBlobImage->w * formatedBlobImage->h; j++)
-		{
-			SDL_Color* pixel = &(((SDL_Color*)formatedBlobImage->pixels)[j]);
-			if (!(pixel->r | pixel->g | pixel->b))
-			{
-				pixel->a = 0;
-			}
-		}
-
-		mStandardBlob.push_back(formatedBlobImage);
+		SDL_Surface* blobSpecular = loadTextureSurface(filename, true);
+		SDL_Texture* blobSpecularTex = SDL_CreateTextureFromSurface(mRenderer, blobSpecular);
+		SDL_SetTextureBlendMode(blobSpecularTex, SDL_BLENDMODE_ADD);
+		mBlobSpecular.push_back(blobSpecularTex);
+		SDL_FreeSurface(blobSpecular);
 
-		// Load blobby shadow surface
+		// Load blobby shadow surface, it is drawn half transparent
 		sprintf(filename, "gfx/sch1%d.bmp", i);
-		SDL_Surface* blobShadow = loadSurface(filename);
-		SDL_Surface* formatedBlobShadowImage = SDL_ConvertSurfaceFormat(blobShadow, SDL_PIXELFORMAT_ABGR8888, 0);
+		SDL_Surface* blobShadow = loadTextureSurface(filename);
+		mBlobShadow.push_back(SDL_CreateTextureFromSurface(mRenderer, blobShadow));
 		SDL_FreeSurface(blobShadow);
 
-		SDL_SetSurfaceAlphaMod(formatedBlobShadowImage, 127);
-		SDL_SetColorKey(formatedBlobShadowImage, SDL_TRUE, SDL_MapRGB(formatedBlobShadowImage->format, 0, 0, 0));
-		for(int j = 0; j < formatedBlobShadowImage->w * formatedBlobShadowImage->h; j++)
-		{
-			SDL_Color* pixel = &(((SDL_Color*)formatedBlobShadowImage->pixels)[j]);
-			if (!(pixel->r | pixel->g | pixel->b))
-			{
-				pixel->a = 0;
-			} else {
-				pixel->a = 127;
-			}
-		}
-
-		mStandardBlobShadow.push_back(formatedBlobShadowImage);
-		
-		for (int j = 0; j < MAX_PLAYERS; ++j)
-		{
-			// Prepare blobby textures
-			SDL_Texture* blobTex = SDL_CreateTexture(mRenderer,
-			                                         SDL_PIXELFORMAT_ABGR8888,
-			                                         SDL_TEXTUREACCESS_STREAMING,
-			                                         formatedBlobImage->w, formatedBlobImage->h);
-			SDL_SetTextureBlendMode(blobTex, SDL_BLENDMODE_BLEND);
-			SDL_UpdateTexture(blobTex, NULL, formatedBlobImage->pixels, formatedBlobImage->pitch);
-
-			mBlob[j].push_back(DynamicColoredTexture(
-				blobTex,
-				Color(255, 255, 255)));
-
-			// Prepare blobby shadow textures
-			SDL_Texture* blobShadowTex = SDL_CreateTexture(mRenderer,
-			                                               SDL_PIXELFORMAT_ABGR8888,
-			                                               SDL_TEXTUREACCESS_STREAMING,
-			                                               formatedBlobShadowImage->w, formatedBlobShadowImage->h);
-			SDL_SetTextureBlendMode(blobShadowTex, SDL_BLENDMODE_BLEND);
-			mBlobShadow[j].push_back(DynamicColoredTexture(
-				blobShadowTex,
-				Color(255, 255, 255)));
-			SDL_UpdateTexture(blobShadowTex, NULL, formatedBlobShadowImage->pixels, formatedBlobShadowImage->pitch);
-		}					
-
 		// Load specific icon to cancel a game
 #if !__FEATURE_HAS_BACKBUTTON__
 		tmpSurface = loadSurface("gfx/flag.bmp");
@@ -277,55 +180,21 @@ void RenderManagerSDL::init(int xResolution, int yResolution, bool fullscreen)
 #endif
 	}
 
-	// Load font
-	for (int i = 0; i <= 55; ++i)
-	{
-		char filename[64];
-		sprintf(filename, "gfx/font%02d.bmp", i);
-		SDL_Surface* tempFont = loadSurface(filename);
-
-		SDL_SetColorKey(tempFont, SDL_TRUE, SDL_MapRGB(tempFont->format, 0, 0, 0));
-		mFont.push_back(SDL_CreateTextureFromSurface(mRenderer, tempFont));
-		SDL_Surface* tempFont2 = highlightSurface(tempFont, 60);
-		mHighlightFont.push_back(SDL_CreateTextureFromSurface(mRenderer, tempFont2));
-		SDL_FreeSurface(tempFont);
-		SDL_FreeSurface(tempFont2);
-	}
+	// Texture for the glyph cache, which is only copied into the text textures
+	SDL_Surface* glyphPage = mGlyphCache.getPage();
+	mGlyphPage = SDL_CreateTexture(mRenderer, glyphPage->format->format, SDL_TEXTUREACCESS_STREAMING,
+			glyphPage->w, glyphPage->h);
+	SDL_SetTextureBlendMode(mGlyphPage, SDL_BLENDMODE_NONE);
+	mGlyphCache.clear();
 
 	// Load blood surface
-	SDL_Surface* blobStandardBlood = loadSurface("gfx/blood.bmp");
-	SDL_Surface* formatedBlobStandardBlood = SDL_ConvertSurfaceFormat(blobStandardBlood, SDL_PIXELFORMAT_ABGR8888, 0);
+	SDL_Surface* blobStandardBlood = loadTextureSurface("gfx/blood.bmp");
+	mBlobBlood = SDL_CreateTextureFromSurface(mRenderer, blobStandardBlood);
 	SDL_FreeSurface(blobStandardBlood);
 
-	SDL_SetColorKey(formatedBlobStandardBlood, SDL_TRUE, SDL_MapRGB(formatedBlobStandardBlood->format, 0, 0, 0));
-	for(int j = 0; j < formatedBlobStandardBlood->w * formatedBlobStandardBlood->h; j++)
-	{
-		SDL_Color* pixel = &(((SDL_Color*)formatedBlobStandardBlood->pixels)[j]);
-		if (!(pixel->r | pixel->g | pixel->b))
-		{
-			pixel->a = 0;
-		} else {
-			pixel->a = 255;
-		}
-	}
-
-	mStandardBlobBlood = formatedBlobStandardBlood;
-
-	for (int i = 0; i < MAX_PLAYERS; ++i)
-	{
-		// Create streamed textures for blood
-		SDL_Texture* blobBlood = SDL_CreateTexture(mRenderer,
-		                                           SDL_PIXELFORMAT_ABGR8888,
-		                                           SDL_TEXTUREACCESS_STREAMING,
-		                                           formatedBlobStandardBlood->w, formatedBlobStandardBlood->h);
-		SDL_SetTextureBlendMode(blobBlood, SDL_BLENDMODE_BLEND);
-		mBlobBlood[i] = DynamicColoredTexture(
-			blobBlood,
-			Color(255, 0, 0));
-		SDL_UpdateTexture(blobBlood, NULL, formatedBlobStandardBlood->pixels, formatedBlobStandardBlood->pitch);
-	}	
-	
 	SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "1");
+
+	preloadInterfaceImages();
 }
 
 void RenderManagerSDL::deinit()
@@ -343,30 +212,19 @@ void RenderManagerSDL::deinit()
 
 	SDL_DestroyTexture(mBallShadow);
 
-	for (unsigned int i = 0; i < mStandardBlob.size(); ++i)
+	for (unsigned int i = 0; i < mBlob.size(); ++i)
 	{
-		SDL_FreeSurface(mStandardBlob[i]);
-		SDL_FreeSurface(mStandardBlobShadow[i]);
-
-		for (int j = 0; j < MAX_PLAYERS; ++j)
-		{
-			SDL_DestroyTexture(mBlob[j][i].mSDLsf);
-			SDL_DestroyTexture(mBlobShadow[j][i].mSDLsf);
-		}		
+		SDL_DestroyTexture(mBlob[i]);
+		SDL_DestroyTexture(mBlobSpecular[i]);
+		SDL_DestroyTexture(mBlobShadow[i]);
 	}
 
-	SDL_FreeSurface(mStandardBlobBlood);
+	SDL_DestroyTexture(mBlobBlood);
 
-	for (int j = 0; j < MAX_PLAYERS; ++j)
-	{
-		SDL_DestroyTexture(mBlobBlood[j].mSDLsf);
-	}	
-
-	for (unsigned int i = 0; i < mFont.size(); ++i)
-	{
-		SDL_DestroyTexture(mFont[i]);
-		SDL_DestroyTexture(mHighlightFont[i]);
-	}
+	SDL_DestroyTexture(mGlyphPage);
+	for (const auto& text : mTextTextures)
+		SDL_DestroyTexture(text.second.texture);
+	mTextTextures.clear();
 
 #if !__FEATURE_HAS_BACKBUTTON__
     SDL_DestroyTexture(mBackFlag);
@@ -381,10 +239,7 @@ void RenderManagerSDL::draw()
 	if (!mDrawGame)
 		return;
 
-	SDL_RenderCopy(mRenderer,
-			mBackground,
-			NULL,
-			NULL);
+	renderCopy(mBackground, NULL, NULL);
 
 	int animationState;
 	SDL_Rect position;
@@ -394,20 +249,20 @@ void RenderManagerSDL::draw()
 	position.x = (int)lround(mBallPosition.x - 2.5);
 	position.w = 5;
 	position.h = 5;
-	SDL_RenderCopy(mRenderer, mMarker[(int)SDL_GetTicks() % 1000 >= 500], 0, &position);
+	renderCopy(mMarker[(int)SDL_GetTicks() % 1000 >= 500], 0, &position);
 
 	// Mouse marker
 	position.y = 590;
 	position.x = (int)lround(mMouseMarkerPosition - 2.5);
 	position.w = 5;
 	position.h = 5;
-	SDL_RenderCopy(mRenderer, mMarker[(int)SDL_GetTicks() % 1000 >= 500], 0, &position);
+	renderCopy(mMarker[(int)SDL_GetTicks() % 1000 >= 500], 0, &position);
 
 	if(mShowShadow)
 	{
 		// Ball Shadow
 		position = ballShadowRect(ballShadowPosition(mBallPosition));
-		SDL_RenderCopy(mRenderer, mBallShadow, 0, &position);
+		renderCopy(mBallShadow, 0, &position, Color(255, 255, 255), 127);
 
 		// Blobs shadows
 		for (int i = 0; i < MAX_PLAYERS; ++i)
@@ -416,7 +271,7 @@ void RenderManagerSDL::draw()
 			{
 				position = blobShadowRect(blobShadowPosition(mBlobPosition[i]));
 				animationState = int(mBlobAnimationState[i]) % 5;
-				SDL_RenderCopy(mRenderer, mBlobShadow[i][animationState].mSDLsf, 0, &position);
+				renderCopy(mBlobShadow[animationState], 0, &position, mBlobColor[i], 127);
 			}
 		}		
 	}
@@ -429,32 +284,29 @@ void RenderManagerSDL::draw()
 	rodPosition.y = 300;
 	rodPosition.w = 14;
 	rodPosition.h = 300;
-	SDL_RenderCopy(mRenderer, mBackground, &rodPosition, &rodPosition);
+	renderCopy(mBackground, &rodPosition, &rodPosition);
 
 #if !__FEATURE_HAS_BACKBUTTON__
 	position.x = 400 - 35;
 	position.y = 70;
 	position.w = 70;
 	position.h = 82;
-    SDL_RenderCopy(mRenderer, mBackFlag, 0, &position);
+    renderCopy(mBackFlag, 0, &position);
 #endif
 
 	// Drawing the Ball
 	position = ballRect(mBallPosition);
 	animationState = int(mBallRotation / M_PI / 2 * 16) % 16;
-	SDL_RenderCopy(mRenderer, mBall[animationState], 0, &position);
+	renderCopy(mBall[animationState], 0, &position);
 	
 	// Drawing blobs
 	for (int i = 0; i < MAX_PLAYERS; ++i)
 	{
 		if(mPlayerEnabled[i])
 		{
-			// update blob colors
-			colorizeBlobs(i);
-
 			position = blobRect(mBlobPosition[i]);
 			animationState = int(mBlobAnimationState[i]) % 5;
-			SDL_RenderCopy(mRenderer, mBlob[i][animationState].mSDLsf, 0, &position);
+			drawColoredBlob(position, animationState, mBlobColor[i]);
 		}
 	}	
 }
@@ -476,6 +328,7 @@ bool RenderManagerSDL::setBackground(const std::string& filename)
 		SDL_FreeSurface(tempBackgroundSurface);
 		mBackground = newImage->sdlImage;
 		mImageMap["background"] = newImage;
+		mNeedRedraw = true;
 	}
 	catch (const FileLoadException&)
 	{
@@ -486,41 +339,16 @@ bool RenderManagerSDL::setBackground(const std::string& filename)
 
 void RenderManagerSDL::setBlobColor(int player, Color color)
 {
-	if (color != mBlobColor[player]) {
-		mBlobColor[player] = color;
-	} else {
-		return;
-	}
-
-	DynamicColoredTexture* handledBlobBlood = &mBlobBlood[player];
-	
-	SDL_Surface* tempSurface = colorSurface(mStandardBlobBlood, mBlobColor[player]);
-	SDL_UpdateTexture(handledBlobBlood->mSDLsf, NULL, tempSurface->pixels, tempSurface->pitch);
-	SDL_FreeSurface(tempSurface);
+	// the color is applied when drawing, nothing has to be uploaded
+	mBlobColor[player] = color;
 }
 
-
-void RenderManagerSDL::colorizeBlobs(int player)
+void RenderManagerSDL::drawColoredBlob(const SDL_Rect& position, int frame, const Color& color)
 {
-	std::vector<DynamicColoredTexture>* handledBlob = &mBlob[player];
-	std::vector<DynamicColoredTexture>* handledBlobShadow = &mBlobShadow[player];
-	const int frame = mBlobAnimationState[player];
-	
-	if( (*handledBlob)[frame].mColor != mBlobColor[player])
-	{
-		SDL_Surface* tempSurface = colorSurface(mStandardBlob[frame], mBlobColor[player]);
-		SDL_UpdateTexture((*handledBlob)[frame].mSDLsf, NULL, tempSurface->pixels, tempSurface->pitch);
-		SDL_FreeSurface(tempSurface);
-
-		SDL_Surface* tempSurface2 = colorSurface(mStandardBlobShadow[frame], mBlobColor[player]);
-		SDL_UpdateTexture((*handledBlobShadow)[frame].mSDLsf, NULL, tempSurface2->pixels, tempSurface2->pitch);
-		SDL_FreeSurface(tempSurface2);
-
-		(*handledBlob)[frame].mColor = mBlobColor[player];
-	}
+	renderCopy(mBlob[frame], 0, &position, color);
+	renderCopy(mBlobSpecular[frame], 0, &position);
 }
 
-
 void RenderManagerSDL::showShadow(bool shadow)
 {
 	mShowShadow = shadow;
@@ -552,66 +380,63 @@ void RenderManagerSDL::drawText(const std::string& text, Vector2 position, unsig
 
 void RenderManagerSDL::drawTextImpl(const std::string& text, Vector2 position, unsigned int flags)
 {
-	int FontSize = (flags & TF_SMALL_FONT ? FONT_WIDTH_SMALL : FONT_WIDTH_NORMAL);
-	int length = 0;
+	if (text.empty())
+		return;
 
-	for (auto iter = text.cbegin(); iter != text.cend(); )
+	// only these flags change how the text looks
+	flags &= TF_HIGHLIGHT | TF_SMALL_FONT | TF_OBFUSCATE;
+	TextTexture& textTexture = mTextTextures[std::make_pair(text, flags)];
+	if (!textTexture.texture)
 	{
-		int index = getNextFontIndex(iter);
+		int FontSize = (flags & TF_SMALL_FONT ? FONT_WIDTH_SMALL : FONT_WIDTH_NORMAL);
+		textTexture.texture = SDL_CreateTexture(mRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET,
+				characterCount(text) * FontSize, FontSize);
+		SDL_SetTextureBlendMode(textTexture.texture, SDL_BLENDMODE_BLEND);
+		renderText(textTexture.texture, text, flags);
+	}
+	textTexture.lastFrame = mGlyphCache.getFrame();
 
-		if (flags & TF_OBFUSCATE)
-			index = FONT_INDEX_ASTERISK;
+	SDL_Rect textRect;
+	textRect.x = lround(position.x);
+	textRect.y = lround(position.y);
+	SDL_QueryTexture(textTexture.texture, NULL, NULL, &textRect.w, &textRect.h);
+	renderCopy(textTexture.texture, NULL, &textRect);
+}
+
+void RenderManagerSDL::renderText(SDL_Texture* texture, const std::string& text, unsigned int flags)
+{
+	int FontSize = (flags & TF_SMALL_FONT ? FONT_WIDTH_SMALL : FONT_WIDTH_NORMAL);
+	const std::vector<SDL_Rect>& glyphs = mGlyphCache.getText(text, flags);
 
-		SDL_Rect charRect;
-		charRect.x = lround(position.x) + length;
-		charRect.y = lround(position.y);
+	SDL_Rect rows;
+	if (mGlyphCache.takeChangedRows(rows))
+	{
+		SDL_Surface* page = mGlyphCache.getPage();
+		SDL_UpdateTexture(mGlyphPage, &rows, (const Uint8*)page->pixels + rows.y * page->pitch, page->pitch);
+	}
 
-		if (flags & TF_SMALL_FONT)
-		{
-			charRect.w = FONT_WIDTH_SMALL;
-			charRect.h = FONT_WIDTH_SMALL;
-			if (flags & TF_HIGHLIGHT)
-			{
-				SDL_RenderCopy(mRenderer, mHighlightFont[index], NULL, &charRect);
-			}
-			else
-			{
-				SDL_RenderCopy(mRenderer,mFont[index], NULL, &charRect);
-			}
-		}
-		else
-		{
-			if (flags & TF_HIGHLIGHT)
-			{
-				SDL_QueryTexture(mHighlightFont[index], NULL, NULL, &charRect.w, &charRect.h);
-				SDL_RenderCopy(mRenderer, mHighlightFont[index], NULL, &charRect);
-			}
-			else
-			{
-				SDL_QueryTexture(mHighlightFont[index], NULL, NULL, &charRect.w, &charRect.h);
-				SDL_RenderCopy(mRenderer,mFont[index], NULL, &charRect);
-			}
-		}
+	SDL_SetRenderTarget(mRenderer, texture);
+	SDL_SetRenderDrawColor(mRenderer, 0, 0, 0, 0);
+	SDL_RenderClear(mRenderer);
 
-		length += FontSize;
+	SDL_Rect charRect = {0, 0, FontSize, FontSize};
+	for (const SDL_Rect& glyph : glyphs)
+	{
+		if (glyph.w > 0)
+			SDL_RenderCopy(mRenderer, mGlyphPage, &glyph, &charRect);
+		charRect.x += FontSize;
 	}
+
+	SDL_SetRenderTarget(mRenderer, mRenderTarget);
 }
 
 void RenderManagerSDL::drawImage(const std::string& filename, Vector2 position, Vector2 size)
 {
-	mNeedRedraw = true;
 	BufferedImage* imageBuffer = mImageMap[filename];
 
 	if (!imageBuffer)
 	{
-		imageBuffer = new BufferedImage;
-		SDL_Surface* tmpSurface = loadSurface(filename);
-		SDL_SetColorKey(tmpSurface, SDL_TRUE,
-				SDL_MapRGB(tmpSurface->format, 0, 0, 0));
-		imageBuffer->sdlImage = SDL_CreateTextureFromSurface(mRenderer, tmpSurface);
-		imageBuffer->w = tmpSurface->w;
-		imageBuffer->h = tmpSurface->h;
-		SDL_FreeSurface(tmpSurface);
+		imageBuffer = uploadImage(loadSurface(filename));
 		mImageMap[filename] = imageBuffer;
 	}
 
@@ -624,7 +449,7 @@ void RenderManagerSDL::drawImage(const std::string& filename, Vector2 position,
 			(short)imageBuffer->w,
 			(short)imageBuffer->h
 		};
-		SDL_RenderCopy(mRenderer, imageBuffer->sdlImage, NULL, &blitRect);
+		renderCopy(imageBuffer->sdlImage, NULL, &blitRect);
 	}
 	else
 	{
@@ -635,11 +460,23 @@ void RenderManagerSDL::drawImage(const std::string& filename, Vector2 position,
 			(short)size.x,
 			(short)size.y
 		};
-		SDL_RenderCopy(mRenderer, imageBuffer->sdlImage, NULL, &blitRect);
+		renderCopy(imageBuffer->sdlImage, NULL, &blitRect);
 	}
 
 }
 
+BufferedImage* RenderManagerSDL::uploadImage(SDL_Surface* surface)
+{
+	BufferedImage* imageBuffer = new BufferedImage;
+	SDL_SetColorKey(surface, SDL_TRUE,
+			SDL_MapRGB(surface->format, 0, 0, 0));
+	imageBuffer->sdlImage = SDL_CreateTextureFromSurface(mRenderer, surface);
+	imageBuffer->w = surface->w;
+	imageBuffer->h = surface->h;
+	SDL_FreeSurface(surface);
+	return imageBuffer;
+}
+
 void RenderManagerSDL::drawOverlay(float opacity, Vector2 pos1, Vector2 pos2, Color col)
 {
 	SDL_Rect ovRect;
@@ -647,9 +484,7 @@ void RenderManagerSDL::drawOverlay(float opacity, Vector2 pos1, Vector2 pos2, Co
 	ovRect.y = (int)lround(pos1.y);
 	ovRect.w = (int)lround(pos2.x - pos1.x);
 	ovRect.h = (int)lround(pos2.y - pos1.y);
-	SDL_SetTextureAlphaMod(mOverlayTexture, lround(opacity * 255));
-	SDL_SetTextureColorMod(mOverlayTexture, col.r, col.g, col.b);
-	SDL_RenderCopy(mRenderer, mOverlayTexture, NULL, &ovRect);
+	renderCopy(mOverlayTexture, NULL, &ovRect, col, lround(opacity * 255));
 }
 
 void RenderManagerSDL::drawBlob(const Vector2& pos, const Color& col)
@@ -659,41 +494,16 @@ void RenderManagerSDL::drawBlob(const Vector2& pos, const Color& col)
 	position.x = (int)lround(pos.x);
 	position.y = (int)lround(pos.y);
 
-	static int toDraw = 0;
-
-	for (int i = 0; i < MAX_PLAYERS; ++i)
-	{
-		mBlobAnimationState[i] = 0;
-	}	
-
-	setBlobColor(toDraw, col);
-	/// \todo this recolores the current frame (0)
-	/// + shadows; thats not exactly what we want
-	colorizeBlobs(toDraw);
-
-
 	//  Second dirty workaround in the function to have the right position of blobs in the GUI
 	position.x = position.x - (int)(75/2);
 	position.y = position.y - (int)(89/2);
 
-	if(toDraw == 1)
-	{
-		SDL_QueryTexture(mBlob[toDraw][mBlobAnimationState[toDraw]].mSDLsf, NULL, NULL, &position.w, &position.h);
-		SDL_RenderCopy(mRenderer, mBlob[toDraw][mBlobAnimationState[toDraw]].mSDLsf, 0, &position);
-		toDraw = 0;
-	}
-	else
-	{
-		SDL_QueryTexture(mBlob[toDraw][mBlobAnimationState[toDraw]].mSDLsf, NULL, NULL, &position.w, &position.h);
-		SDL_RenderCopy(mRenderer, mBlob[toDraw][mBlobAnimationState[toDraw]].mSDLsf, 0, &position);
-		toDraw = 1;
-	}
+	SDL_QueryTexture(mBlob[0], NULL, NULL, &position.w, &position.h);
+	drawColoredBlob(position, 0, col);
 }
 
 void RenderManagerSDL::drawParticle(const Vector2& pos, int player)
 {
-	mNeedRedraw = true;
-
 	SDL_Rect blitRect = {
 		(short)lround(pos.x - float(9) / 2.0),
 		(short)lround(pos.y - float(9) / 2.0),
@@ -701,11 +511,230 @@ void RenderManagerSDL::drawParticle(const Vector2& pos, int player)
 		(short)9,
 	};
 	
-	SDL_RenderCopy(mRenderer, mBlobBlood[player].mSDLsf, 0, &blitRect);
+	renderCopy(mBlobBlood, 0, &blitRect, mBlobColor[player]);
+}
+
+void RenderManagerSDL::drawParticles(const float* x, const float* y, const int* players, int count)
+{
+	mCommands.reserve(mCommands.size() + count);
+	for (int i = 0; i < count; ++i)
+		RenderManagerSDL::drawParticle(Vector2(x[i], y[i]), players[i]);
+}
+
+void RenderManagerSDL::renderCopy(SDL_Texture* texture, const SDL_Rect* source, const SDL_Rect* destination,
+		const Color& color, Uint8 alpha)
+{
+	DrawCommand command;
+	command.texture = texture;
+	command.hasSource = source != 0;
+	if (source)
+		command.source = *source;
+	command.destination = destination ? *destination : mScreenRect;
+	command.color = color;
+	command.alpha = alpha;
+	SDL_BlendMode blendMode;
+	command.opaque = SDL_GetTextureBlendMode(texture, &blendMode) == 0 && blendMode == SDL_BLENDMODE_NONE;
+	mCommands.push_back(command);
+}
+
+void RenderManagerSDL::addDirtyRect(const SDL_Rect& rect)
+{
+	SDL_Rect clipped;
+	if (!SDL_IntersectRect(&rect, &mScreenRect, &clipped))
+		return;
+
+	for (int y = clipped.y / DIRTY_TILE_SIZE; y <= (clipped.y + clipped.h - 1) / DIRTY_TILE_SIZE; ++y)
+	{
+		for (int x = clipped.x / DIRTY_TILE_SIZE; x <= (clipped.x + clipped.w - 1) / DIRTY_TILE_SIZE; ++x)
+		{
+			mDirtyTiles[y * mTilesX + x] = true;
+		}
+	}
+}
+
+void RenderManagerSDL::collectDirtyRects()
+{
+	mDirtyRects.clear();
+
+	if (mNeedRedraw)
+	{
+		mDirtyRects.push_back(mScreenRect);
+		return;
+	}
+
+	mDirtyTiles.assign(mTilesX * mTilesY, false);
+
+	// A command that is the same as at this position in the last frame does not need to
+	// be drawn again: if a pixel is only covered by such commands, everything drawn
+	// there is the same as in the last frame.
+	std::size_t count = std::max(mCommands.size(), mLastCommands.size());
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		if (i < mCommands.size() && i < mLastCommands.size() && mCommands[i] == mLastCommands[i])
+			continue;
+
+		if (i < mLastCommands.size())
+			addDirtyRect(mLastCommands[i].destination);
+		if (i < mCommands.size())
+			addDirtyRect(mCommands[i].destination);
+	}
+
+	// each run of dirty tiles in a row becomes a rect, which is extended
+	// downwards while the rows below have a run with the same extent
+	std::vector<std::size_t> previousRow;
+	for (int y = 0; y < mTilesY; ++y)
+	{
+		std::vector<std::size_t> currentRow;
+		for (int x = 0; x < mTilesX; ++x)
+		{
+			if (!mDirtyTiles[y * mTilesX + x])
+				continue;
+
+			int end = x;
+			while (end < mTilesX && mDirtyTiles[y * mTilesX + end])
+				++end;
+
+			SDL_Rect run = {x * DIRTY_TILE_SIZE, y * DIRTY_TILE_SIZE, (end - x) * DIRTY_TILE_SIZE, DIRTY_TILE_SIZE};
+			bool extended = false;
+			for (std::size_t index : previousRow)
+			{
+				SDL_Rect& above = mDirtyRects[index];
+				if (above.x == run.x && above.w == run.w)
+				{
+					above.h += DIRTY_TILE_SIZE;
+					currentRow.push_back(index);
+					extended = true;
+					break;
+				}
+			}
+			if (!extended)
+			{
+				currentRow.push_back(mDirtyRects.size());
+				mDirtyRects.push_back(run);
+			}
+			x = end;
+		}
+		previousRow.swap(currentRow);
+	}
+
+	if (mDirtyRects.size() > MAX_DIRTY_RECTS)
+	{
+		mDirtyRects.assign(1, mScreenRect);
+		return;
+	}
+
+	for (SDL_Rect& rect : mDirtyRects)
+		SDL_IntersectRect(&rect, &mScreenRect, &rect);
+}
+
+void RenderManagerSDL::drawDirtyRect(const SDL_Rect& rect)
+{
+	SDL_RenderSetClipRect(mRenderer, &rect);
+
+	// nothing below the last opaque command which covers the whole region is visible
+	std::size_t first = mCommands.size();
+	while (first > 0)
+	{
+		const DrawCommand& command = mCommands[first - 1];
+		SDL_Rect covered;
+		if (command.opaque && SDL_IntersectRect(&command.destination, &rect, &covered)
+				&& SDL_RectEquals(&covered, &rect))
+			break;
+		--first;
+	}
+
+	if (first == 0)
+	{
+		// not every screen has a background that covers everything
+		SDL_SetRenderDrawColor(mRenderer, 0, 0, 0, 255);
+		SDL_RenderFillRect(mRenderer, &rect);
+	}
+	else
+	{
+		--first;
+	}
+
+	for (std::size_t i = first; i < mCommands.size(); ++i)
+	{
+		const DrawCommand& command = mCommands[i];
+		if (!SDL_HasIntersection(&command.destination, &rect))
+			continue;
+
+		SDL_SetTextureColorMod(command.texture, command.color.r, command.color.g, command.color.b);
+		SDL_SetTextureAlphaMod(command.texture, command.alpha);
+		SDL_RenderCopy(mRenderer, command.texture, command.hasSource ? &command.source : 0, &command.destination);
+		++mDrawCallCount;
+	}
+}
+
+int RenderManagerSDL::getDrawCallCount() const
+{
+	return mDrawCallCount;
+}
+
+SDL_Surface* RenderManagerSDL::takeScreenshot()
+{
+	compose();
+
+	int width, height;
+	SDL_QueryTexture(mRenderTarget, 0, 0, &width, &height);
+	SDL_Surface* screenshot = createEmptySurface(width, height);
+	SDL_RenderReadPixels(mRenderer, 0, SDL_PIXELFORMAT_ABGR8888, screenshot->pixels, screenshot->pitch);
+	return screenshot;
+}
+
+void RenderManagerSDL::compose()
+{
+	if (mComposed)
+		return;
+
+	SDL_SetRenderTarget(mRenderer, mRenderTarget);
+	// some drivers lose the content of render targets, e.g. when the window is resized
+	if (SDL_HasEvent(SDL_RENDER_TARGETS_RESET))
+	{
+		mNeedRedraw = true;
+		for (const auto& text : mTextTextures)
+			renderText(text.second.texture, text.first.first, text.first.second);
+	}
+
+	collectDirtyRects();
+	mDrawCallCount = 0;
+	for (const SDL_Rect& rect : mDirtyRects)
+		drawDirtyRect(rect);
+	SDL_RenderSetClipRect(mRenderer, 0);
+	mComposed = true;
 }
 
 void RenderManagerSDL::refresh()
 {
+	// compose the frame from the recorded commands
+	compose();
+	mComposed = false;
+
+	mLastCommands.swap(mCommands);
+	mCommands.clear();
+	mNeedRedraw = false;
+
+	// Only textures which were not drawn in this frame are destroyed, so no texture
+	// of mLastCommands is destroyed and no new one can have the same address.
+	if (mTextTextures.size() > MAX_TEXT_TEXTURES)
+	{
+		for (auto iter = mTextTextures.begin(); iter != mTextTextures.end(); )
+		{
+			if (iter->second.lastFrame != mGlyphCache.getFrame())
+			{
+				SDL_DestroyTexture(iter->second.texture);
+				iter = mTextTextures.erase(iter);
+			}
+			else
+			{
+				++iter;
+			}
+		}
+	}
+	mGlyphCache.nextFrame();
+	uploadPreloadedImage();
+
 	SDL_SetRenderTarget(mRenderer, NULL);
 
 	// We have a resizeable window
@@ -21,6 +21,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #pragma once
 
 #include <SDL2/SDL.h>
+#include <map>
 #include <vector>
 
 #include "RenderManager.h"
@@ -28,7 +29,12 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 /*! \class RenderManagerSDL
 	\brief Render Manager on top of SDL
 	\details This render manager uses SDL for all drawing operations. This means it is
-			highly portable, but somewhat slow (e.g. when doing morphing blobs).
+			highly portable, but somewhat slow.
+			To make up for this, the drawing operations of a frame are only recorded and
+			compared to the last frame in refresh(). The render target keeps the last frame,
+			so only the regions where something changed are drawn again.
+			Each text is drawn into its own texture once, from the glyph cache, and then
+			copied as a whole.
 */
 class RenderManagerSDL : public RenderManager
 {
@@ -55,37 +61,59 @@ class RenderManagerSDL : public RenderManager
 		virtual void drawOverlay(float opacity, Vector2 pos1, Vector2 pos2, Color col);
 		virtual void drawBlob(const Vector2& pos, const Color& col);
 		virtual void drawParticle(const Vector2& pos, int player);
+		virtual void drawParticles(const float* x, const float* y, const int* players, int count);
+
+		virtual int getDrawCallCount() const;
+		virtual SDL_Surface* takeScreenshot();
 
 	private:
-		struct DynamicColoredTexture
+		struct DrawCommand
 		{
-			// constructors
-			// start surface is expected to have color 0xffffff
-			DynamicColoredTexture() : mSDLsf(0), mColor(255, 255, 255) {};
-			explicit DynamicColoredTexture(SDL_Texture* sf) : mSDLsf(sf), mColor(255, 255, 255) {};
-
-			DynamicColoredTexture(SDL_Texture* sf, Color c) : mSDLsf(sf), mColor(c) {};
+			SDL_Texture* texture;
+			SDL_Rect source;
+			bool hasSource;
+			SDL_Rect destination;
+			Color color;
+			Uint8 alpha;
+			// hides everything below it
+			bool opaque;
+
+			bool operator==(const DrawCommand& other) const;
+		};
 
-			SDL_Texture* mSDLsf;
-			Color mColor;
+		/// a text which is drawn with one copy
+		struct TextTexture
+		{
+			SDL_Texture* texture;
+			/// frame of the glyph cache it was last drawn in
+			unsigned int lastFrame;
 		};
 
+		// text textures which were not drawn in the current frame are destroyed above this number
+		static const unsigned int MAX_TEXT_TEXTURES = 128;
+
+		// changes are tracked in tiles of this size, so many small changes end up in
+		// a few regions. With more than MAX_DIRTY_RECTS regions the whole screen is drawn
+		static const int DIRTY_TILE_SIZE = 32;
+		static const unsigned int MAX_DIRTY_RECTS = 32;
 
 		SDL_Texture* mBackground;
 		SDL_Texture* mBallShadow;
 		SDL_Texture* mMarker[2];
 
 		std::vector<SDL_Texture*> mBall;
-		std::vector<SDL_Surface*> mStandardBlob;
-		std::vector<SDL_Surface*> mStandardBlobShadow;
-		SDL_Surface* mStandardBlobBlood;
 
-		std::vector<DynamicColoredTexture> mBlob[MAX_PLAYERS];
-		std::vector<DynamicColoredTexture> mBlobShadow[MAX_PLAYERS];
-		DynamicColoredTexture mBlobBlood[MAX_PLAYERS];
+		// the blob textures are white and shared by all players,
+		// they are coloured with SDL_SetTextureColorMod when drawn
+		std::vector<SDL_Texture*> mBlob;
+		// specular highlight of each blob frame, added on top of the coloured blob
+		std::vector<SDL_Texture*> mBlobSpecular;
+		std::vector<SDL_Texture*> mBlobShadow;
+		SDL_Texture* mBlobBlood;
 		
-		std::vector<SDL_Texture*> mFont;
-		std::vector<SDL_Texture*> mHighlightFont;
+		SDL_Texture* mGlyphPage;
+		/// texts drawn into their own textures, keyed by text and flags
+		std::map<std::pair<std::string, unsigned int>, TextTexture> mTextTextures;
 
 		SDL_Texture *mOverlayTexture;
 
@@ -99,18 +127,39 @@ class RenderManagerSDL : public RenderManager
 		
 		bool mShowShadow;
 
-		// Store color for caching
 		Color mBlobColor[MAX_PLAYERS];
 
 		// Rendertarget to make windowmode resizeable
 		SDL_Texture* mRenderTarget;
+		SDL_Rect mScreenRect;
+
+		std::vector<DrawCommand> mCommands;
+		std::vector<DrawCommand> mLastCommands;
+		std::vector<bool> mDirtyTiles;
+		int mTilesX;
+		int mTilesY;
+		std::vector<SDL_Rect> mDirtyRects;
+		int mDrawCallCount;
+		// the render target already holds the next frame
+		bool mComposed;
 
-		// colors a surface
-		// the returned SDL_Surface* is already converted into DisplayFormat
-		SDL_Surface* colorSurface(SDL_Surface *surface, Color color);
+		// extracts the specular highlight of a blob surface
+		// the returned SDL_Surface* has the format SDL_PIXELFORMAT_ABGR8888
 
 		void drawTextImpl(const std::string& text, Vector2 position, unsigned int flags);
-		void colorizeBlobs(int player);
+		// draws the glyphs of the text into the texture
+		void renderText(SDL_Texture* texture, const std::string& text, unsigned int flags);
+		void drawColoredBlob(const SDL_Rect& position, int frame, const Color& color);
+		virtual BufferedImage* uploadImage(SDL_Surface* surface);
+
+		// records a texture copy, destination 0 is the whole screen
+		void renderCopy(SDL_Texture* texture, const SDL_Rect* source, const SDL_Rect* destination,
+				const Color& color = Color(255, 255, 255), Uint8 alpha = 255);
+		void addDirtyRect(const SDL_Rect& rect);
+		void collectDirtyRects();
+		void drawDirtyRect(const SDL_Rect& rect);
+		// draws the recorded commands into the render target
+		void compose();
 
 #if !__FEATURE_HAS_BACKBUTTON__
         SDL_Texture* mBackFlag;
@@ -0,0 +1,78 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#pragma once
+
+#include <atomic>
+
+#include <boost/noncopyable.hpp>
+
+/*! \class SPSCQueue
+	\brief fixed size queue from one producer thread to one consumer thread
+	\details push() and pop() neither lock nor allocate, so the queue can feed a thread
+			which must not wait, like the audio callback. Each side only writes its own
+			index. The element is written before the index is released, so the other side
+			sees it once it acquires the index.
+*/
+template<class T, unsigned int CAPACITY>
+class SPSCQueue : private boost::noncopyable
+{
+	public:
+		SPSCQueue() : mHead(0), mTail(0)
+		{
+		}
+
+		/// called by the producer, returns false if the queue is full
+		bool push(const T& element)
+		{
+			unsigned int tail = mTail.load(std::memory_order_relaxed);
+			unsigned int next = (tail + 1) % SIZE;
+			if (next == mHead.load(std::memory_order_acquire))
+				return false;
+
+			mElements[tail] = element;
+			mTail.store(next, std::memory_order_release);
+			return true;
+		}
+
+		/// called by the consumer, returns false if the queue is empty
+		bool pop(T& element)
+		{
+			unsigned int head = mHead.load(std::memory_order_relaxed);
+			if (head == mTail.load(std::memory_order_acquire))
+				return false;
+
+			element = mElements[head];
+			mHead.store((head + 1) % SIZE, std::memory_order_release);
+			return true;
+		}
+
+	private:
+		// one slot stays empty, so a full queue can be told apart from an empty one
+		static const unsigned int SIZE = CAPACITY + 1;
+
+		T mElements[SIZE];
+		/// next element to pop, written by the consumer
+		std::atomic<unsigned int> mHead;
+		// the indices are written by different threads, so they should not share a cache line
+		char mPadding[64];
+		/// next free slot, written by the producer
+		std::atomic<unsigned int> mTail;
+};
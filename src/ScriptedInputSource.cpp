@@ -29,14 +29,11 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <SDL2/SDL.h>
 
-extern "C"
-{
-#include "lua/lua.h"
-#include "lua/lauxlib.h"
-#include "lua/lualib.h"
-}
+#include "LuaCompat.h"
 
 #include "DuelMatch.h"
+#include "DuelMatchState.h"
+#include "GameLogic.h"
 #include "IUserConfigReader.h"
 
 /* implementation */
@@ -56,19 +53,22 @@ ScriptedInputSource::ScriptedInputSource(const std::string& filename, PlayerSide
 	lua_pushnumber(mState, mDifficulty / 25.0);
 	lua_setglobal(mState, "__DIFFICULTY");
 	auto config = IUserConfigReader::createUserConfigReader("config.xml");
-	bool debug = config->getBool("bot_debug");
-	lua_pushboolean(mState, debug);
+	mDebug = config->getBool("bot_debug");
+	// the profiler must not be read while the worker thread uses it
+	mAsync = config->getBool("bot_async") && !mDebug;
+	lua_pushboolean(mState, mDebug);
 	lua_setglobal(mState, "__DEBUG");
 	lua_pushinteger(mState, mSide);
 	lua_setglobal(mState, "__SIDE");
+	createStateTable();
 
 	openScript("api");
 	openScript("bot_api");
 	openScript(filename);
 
 	// check whether all required lua functions are available
-	bool step = getLuaFunction("__OnStep");
-	if (!step)
+	mOnStep = getLuaFunctionRef("__OnStep");
+	if (!pushLuaFunction(mOnStep))
 	{
 		std::string error_message = "Missing bot functions, check bot_api.lua! ";
 		std::cerr << "Lua Error: " << error_message << std::endl;
@@ -80,32 +80,80 @@ ScriptedInputSource::ScriptedInputSource(const std::string& filename, PlayerSide
 
 	// clean up stack
 	lua_pop(mState, lua_gettop(mState));
+
+	// profile the game play only, not the loading of the script
+	if (mDebug)
+		enableProfiler();
 }
 
 ScriptedInputSource::~ScriptedInputSource()
 {
+	if (mWorker.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(mWorkerMutex);
+			mWorkerQuit = true;
+		}
+		mWorkerCondition.notify_all();
+		mWorker.join();
+	}
+
+	if (mDebug)
+	{
+		ScriptStats stats = getScriptStats();
+		std::cout << "bot script: " << stats.calls << " calls, " << stats.errors << " errors, "
+				<< stats.callTime << " ms (max " << stats.maxCallTime << " ms), gc "
+				<< stats.gcTime << " ms, memory " << stats.memory / 1024 << " KiB (peak "
+				<< stats.peakMemory / 1024 << " KiB)" << std::endl;
+	}
 }
 
 PlayerInputAbs ScriptedInputSource::getNextInput()
 {
 	bool serving = false;
-	// reset input
-	lua_pushboolean(mState, false);
-	lua_setglobal(mState, "__WANT_LEFT");
-	lua_pushboolean(mState, false);
-	lua_setglobal(mState, "__WANT_RIGHT");
-	lua_pushboolean(mState, false);
-	lua_setglobal(mState, "__WANT_JUMP");
 
 	if (getMatch() == 0)
 	{
 		return PlayerInputAbs();
-	} else
+	}
+
+	PlayerInput wanted;
+	if (!mAsync)
 	{
 		IScriptableComponent::setMatch( const_cast<DuelMatch*>(getMatch()) );
+		wanted = runScript();
 	}
-	lua_getglobal(mState, "__OnStep");
-	callLuaFunction();
+	else
+	{
+		if (!mWorker.joinable())
+		{
+			bool playerEnabled[MAX_PLAYERS];
+			for (int i = 0; i < MAX_PLAYERS; ++i)
+			{
+				playerEnabled[i] = getMatch()->getPlayerEnabled(PlayerSide(i));
+			}
+
+			// the script only reads the state, so the builtin rules are enough
+			mSnapshot.reset(new DuelMatch(true, FALLBACK_RULES_NAME, playerEnabled, getMatch()->getScoreToWin()));
+			IScriptableComponent::setMatch(mSnapshot.get());
+			mWorker = std::thread(&ScriptedInputSource::runWorker, this);
+		}
+
+		{
+			// wait until the decision for the last frame is ready, then let
+			// the worker compute the next one while the game goes on
+			std::unique_lock<std::mutex> lock(mWorkerMutex);
+			mWorkerCondition.wait(lock, [this]() { return !mWorkPending; });
+			wanted = mWorkerInput;
+			mSnapshot->setState(getMatch()->getState());
+			mWorkPending = true;
+		}
+		mWorkerCondition.notify_all();
+	}
+
+	bool wantleft = wanted.left;
+	bool wantright = wanted.right;
+	bool wantjump = wanted.up;
 
 	if (!getMatch()->getBallActive() && mSide ==
 			// if no player is serving player, assume the left one is
@@ -114,24 +162,6 @@ PlayerInputAbs ScriptedInputSource::getNextInput()
 		serving = true;
 	}
 
-	// read input info from lua script
-	lua_getglobal(mState, "__WANT_LEFT");
-	lua_getglobal(mState, "__WANT_RIGHT");
-	lua_getglobal(mState, "__WANT_JUMP");
-	bool wantleft = lua_toboolean(mState, -3);
-	bool wantright = lua_toboolean(mState, -2);
-	bool wantjump = lua_toboolean(mState, -1);
-	lua_pop(mState, 3);
-
-	int stacksize = lua_gettop(mState);
-	if (stacksize > 0)
-	{
-		std::cerr << "Warning: Stack messed up!" << std::endl;
-		std::cerr << "Element on stack is a ";
-		std::cerr << lua_typename(mState, -1) << std::endl;
-		lua_pop(mState, stacksize);
-	}
-
 	if (mStartTime + WAITING_TIME > SDL_GetTicks() && serving)
 		return PlayerInputAbs();
 
@@ -151,3 +181,115 @@ PlayerInputAbs ScriptedInputSource::getNextInput()
 
 	return PlayerInputAbs(wantleft, wantright, wantjump);
 }
+
+PlayerInput ScriptedInputSource::runScript()
+{
+	publishState();
+
+	// __OnStep returns the wanted input
+	PlayerInput wanted;
+	pushLuaFunction(mOnStep);
+	if (callLuaFunction(0, 3))
+	{
+		wanted.left = lua_toboolean(mState, -3);
+		wanted.right = lua_toboolean(mState, -2);
+		wanted.up = lua_toboolean(mState, -1);
+		lua_pop(mState, 3);
+	}
+
+	int stacksize = lua_gettop(mState);
+	if (stacksize > 0)
+	{
+		std::cerr << "Warning: Stack messed up!" << std::endl;
+		std::cerr << "Element on stack is a ";
+		std::cerr << lua_typename(mState, -1) << std::endl;
+		lua_pop(mState, stacksize);
+	}
+
+	// collect the garbage of this step now, instead of whenever lua wants to
+	stepGarbageCollector();
+
+	return wanted;
+}
+
+void ScriptedInputSource::runWorker()
+{
+	std::unique_lock<std::mutex> lock(mWorkerMutex);
+	while (true)
+	{
+		mWorkerCondition.wait(lock, [this]() { return mWorkPending || mWorkerQuit; });
+		if (mWorkerQuit)
+			return;
+
+		// mSnapshot is not changed while mWorkPending is set
+		lock.unlock();
+		PlayerInput wanted = runScript();
+		lock.lock();
+
+		mWorkerInput = wanted;
+		mWorkPending = false;
+		mWorkerCondition.notify_all();
+	}
+}
+
+void ScriptedInputSource::createStateTable()
+{
+	// all slots are created here, so publishState never has to resize the table
+	lua_createtable(mState, MATCH_SLOTS, 0);
+	for (int i = 1; i <= MATCH_SLOTS; ++i)
+	{
+		lua_pushnumber(mState, 0);
+		lua_rawseti(mState, -2, i);
+	}
+
+	lua_pushvalue(mState, -1);
+	lua_setglobal(mState, "__MATCH");
+	mStateTable = luaL_ref(mState, LUA_REGISTRYINDEX);
+}
+
+void ScriptedInputSource::publishState()
+{
+	// the match the script sees, which is the snapshot in asynchronous mode
+	const DuelMatch* match = IScriptableComponent::getMatch();
+	const DuelMatchState state = match->getState();
+	const PhysicState& world = state.worldState;
+	const GameLogicState& logic = state.logicState;
+
+	lua_rawgeti(mState, LUA_REGISTRYINDEX, mStateTable);
+	auto setNumber = [this](int slot, double value)
+	{
+		lua_pushnumber(mState, value);
+		lua_rawseti(mState, -2, slot);
+	};
+
+	// the same coordinates as get_ball_pos and the other functions of the game
+	setNumber(MATCH_BALL, world.ballPosition.x);
+	setNumber(MATCH_BALL + 1, 600 - world.ballPosition.y);
+	setNumber(MATCH_BALL + 2, world.ballVelocity.x);
+	setNumber(MATCH_BALL + 3, -world.ballVelocity.y);
+
+	lua_pushboolean(mState, logic.isBallValid);
+	lua_rawseti(mState, -2, MATCH_BALL_VALID);
+	lua_pushboolean(mState, logic.isGameRunning);
+	lua_rawseti(mState, -2, MATCH_GAME_RUNNING);
+	setNumber(MATCH_SERVING_PLAYER, logic.servingPlayer);
+	setNumber(MATCH_SCORE + LEFT_SIDE, logic.leftScore);
+	setNumber(MATCH_SCORE + RIGHT_SIDE, logic.rightScore);
+	setNumber(MATCH_TOUCHES + LEFT_SIDE, logic.hitCount[LEFT_SIDE]);
+	setNumber(MATCH_TOUCHES + RIGHT_SIDE, logic.hitCount[RIGHT_SIDE]);
+
+	// disabled players keep their old values
+	for (int i = 0; i < MAX_PLAYERS; ++i)
+	{
+		if (!match->getPlayerEnabled(PlayerSide(i)))
+			continue;
+
+		int slot = MATCH_BLOBS + 4 * i;
+		setNumber(slot, world.blobPosition[i].x);
+		setNumber(slot + 1, 600 - world.blobPosition[i].y);
+		setNumber(slot + 2, world.blobVelocity[i].x);
+		setNumber(slot + 3, -world.blobVelocity[i].y);
+	}
+
+	lua_pop(mState, 1);
+}
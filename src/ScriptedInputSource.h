@@ -27,6 +27,10 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <string>
 #include <random>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #include "Global.h"
 #include "InputSource.h"
@@ -40,10 +44,31 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 /// and provided with an interface to the game.
 
 /// The API documentation can now be found in doc/ScriptAPI.txt
+///
+/// The state of the match is copied into the lua array __MATCH before every step,
+/// bot_api.lua reads it from there instead of calling into the game.
+///
+/// With bot_async set in the config, the script runs on its own thread. In each frame,
+/// the bot gets a copy of the match state and returns the decision it has computed
+/// for the previous frame, so the script can run while the game is drawn.
 
 // The time the bot waits after game start
 const int WAITING_TIME = 1500;
 
+/// slots of the lua array __MATCH, have to match the ones in bot_api.lua.
+/// Blob values are stored as x, y, vx, vy for each player.
+enum MatchSlot
+{
+	MATCH_BALL = 1,				// x, y, vx, vy
+	MATCH_BALL_VALID = 5,
+	MATCH_GAME_RUNNING = 6,
+	MATCH_SERVING_PLAYER = 7,
+	MATCH_SCORE = 8,			// by side
+	MATCH_TOUCHES = 10,			// by side
+	MATCH_BLOBS = 12,
+	MATCH_SLOTS = MATCH_BLOBS + 4 * MAX_PLAYERS - 1
+};
+
 struct lua_State;
 class DuelMatch;
 
@@ -59,7 +84,19 @@ class ScriptedInputSource : public InputSource, public IScriptableComponent
 		virtual PlayerInputAbs getNextInput();
 		using InputSource::getMatch;
 
+		/// overrides bot_async. Has to be called before the first getNextInput.
+		void setAsync(bool async) { mAsync = async; }
+
 	private:
+		/// calls the script and returns the input it wants
+		PlayerInput runScript();
+		/// thread function for the asynchronous mode
+		void runWorker();
+		/// creates the array __MATCH, which publishState fills
+		void createStateTable();
+		/// copies the state of the match into __MATCH, so the script
+		/// can read it without calling functions of the game
+		void publishState();
 
 		unsigned int mStartTime;
 
@@ -68,6 +105,26 @@ class ScriptedInputSource : public InputSource, public IScriptableComponent
 
 		PlayerSide mSide;
 
+		// registry reference to __OnStep
+		int mOnStep;
+		// registry reference to __MATCH
+		int mStateTable;
+
+		// print script stats when the bot is destroyed
+		bool mDebug;
+
+		// asynchronous mode: the script reads mSnapshot instead of the real match
+		bool mAsync;
+		std::unique_ptr<DuelMatch> mSnapshot;
+		std::thread mWorker;
+		std::mutex mWorkerMutex;
+		std::condition_variable mWorkerCondition;
+		// set when mSnapshot has been updated, cleared when the worker has finished
+		bool mWorkPending = false;
+		bool mWorkerQuit = false;
+		// input computed by the worker for the last snapshot
+		PlayerInput mWorkerInput;
+
 		// error data
 		bool mLastJump = false;
 		double mJumpDelay = 0;
@@ -22,17 +22,50 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "SoundManager.h"
 
 /* includes */
+#include <algorithm>
 #include <iostream>
 #include <cassert>
 
+#include "AssetPack.h"
 #include "Global.h"
 #include "FileRead.h"
+#include "FileSystem.h"
 
 /* implementation */
 SoundManager* SoundManager::mSingleton;
 
+// the mixing loops are kept simple, so the compiler can vectorise them
+static void mixSamples(Sint32* mixed, const Sint16* samples, int count, int volume)
+{
+	for (int i = 0; i < count; ++i)
+		mixed[i] += Sint32(samples[i]) * volume;
+}
+
+static void saturate(Sint16* stream, const Sint32* mixed, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		Sint32 sample = mixed[i] / SDL_MIX_MAXVOLUME;
+		sample = sample > -32768 ? sample : -32768;
+		sample = sample < 32767 ? sample : 32767;
+		stream[i] = Sint16(sample);
+	}
+}
+
 Sound* SoundManager::loadSound(const std::string& filename)
 {
+	// the packed sounds are converted already
+	Uint32 packedLength;
+	const Uint8* packedSound = AssetPack::getSingleton().getSound(filename, mAudioSpec, packedLength);
+	if (packedSound)
+	{
+		Sound *newSound = new Sound;
+		newSound->data = new Uint8[packedLength];
+		memcpy(newSound->data, packedSound, packedLength);
+		newSound->length = packedLength;
+		return newSound;
+	}
+
 	FileRead file(filename);
 	int fileLength = file.length();
 
@@ -62,7 +95,6 @@ Sound* SoundManager::loadSound(const std::string& filename)
 		newSound->data = new Uint8[newSoundLength];
 		memcpy(newSound->data, newSoundBuffer, newSoundLength);
 		newSound->length = newSoundLength;
-		newSound->position = 0;
 		SDL_FreeWAV(newSoundBuffer);
                 return newSound;
 	}
@@ -85,7 +117,6 @@ Sound* SoundManager::loadSound(const std::string& filename)
 		Sound *newSound = new Sound;
 		newSound->data = conversionStructure.buf;
 		newSound->length = Uint32(conversionStructure.len_cvt);
-		newSound->position = 0;
 		return newSound;
 	}
 }
@@ -104,15 +135,16 @@ bool SoundManager::playSound(const std::string& filename, float volume)
 		Sound* soundBuffer = mSound[filename];
 		if (!soundBuffer)
 		{
-			soundBuffer = loadSound(filename);
+			soundBuffer = mSoundLoader.take(filename);
 			mSound[filename] = soundBuffer;
 		}
-		Sound soundInstance = Sound(*soundBuffer);
-		soundInstance.volume =
+		PlayCommand command;
+		command.sound = soundBuffer;
+		command.volume =
 			volume > 0.0 ? (volume < 1.0 ? volume : 1.0) : 0.0;
-		SDL_LockAudioDevice(mAudioDevice);
-		mPlayingSound.push_back(soundInstance);
-		SDL_UnlockAudioDevice(mAudioDevice);
+		// the audio callback has not caught up with the game, so there are enough sounds playing
+		if (!mCommands.push(command))
+			return false;
 	}
 	catch (const FileLoadException& exception)
 	{
@@ -126,19 +158,14 @@ bool SoundManager::init()
 {
 	SDL_AudioSpec desiredSpec;
 	desiredSpec.freq = 44100;
-	desiredSpec.format = AUDIO_S16LSB;
+	// the mixer only handles 16 bit samples in the byte order of the machine
+	desiredSpec.format = AUDIO_S16SYS;
 	desiredSpec.channels = 2;
 	desiredSpec.samples = 1024;
 	desiredSpec.callback = playCallback;
 	desiredSpec.userdata = mSingleton;
 
-	mAudioDevice = SDL_OpenAudioDevice(NULL, 0, &desiredSpec, &mAudioSpec, SDL_AUDIO_ALLOW_FORMAT_CHANGE);
-
-	if (desiredSpec.format != mAudioSpec.format)
-	{
-		std::cerr << "Warning: Can't create device with desired audio spec!" << std::endl;
-		std::cerr << "Reason: " << SDL_GetError() << std::endl;
-	}
+	mAudioDevice = SDL_OpenAudioDevice(NULL, 0, &desiredSpec, &mAudioSpec, 0);
 
 	if (mAudioDevice == 0)
 	{
@@ -147,42 +174,85 @@ bool SoundManager::init()
 		return false;
 	}
 
+	// the callback must not allocate, so the buffer is sized before it starts
+	mMixBuffer.resize(mAudioSpec.samples * mAudioSpec.channels);
+	mVoiceCount = 0;
+	mVolume = 1.0;
 	SDL_PauseAudioDevice(mAudioDevice, 0);
 	mInitialised = true;
-	mVolume = 1.0;
+
+	// the sounds can only be converted once the format of the device is known
+	std::vector<std::string> sounds;
+	for (const std::string& sound : FileSystem::getSingleton().enumerateFiles("sounds", ".wav", true))
+		sounds.push_back("sounds/" + sound);
+	mSoundLoader.preload(sounds);
+
 	return true;
 }
 
 void SoundManager::playCallback(void* singleton, Uint8* stream, int length)
 {
-	SDL_memset(stream, 0, length);
-	std::list<Sound>& playingSound = ((SoundManager*)singleton)->mPlayingSound;
-	int volume = int(SDL_MIX_MAXVOLUME * ((SoundManager*)singleton)->mVolume);
+	((SoundManager*)singleton)->mix((Sint16*)stream, length / sizeof(Sint16));
+}
 
-	for (auto iter = playingSound.begin(); iter != playingSound.end(); ++iter)
+void SoundManager::mix(Sint16* stream, int count)
+{
+	PlayCommand command;
+	while (mCommands.pop(command))
 	{
-		int bytesLeft = iter->length - iter->position;
-		if (bytesLeft < length)
+		if (!command.sound)
 		{
-			SDL_MixAudio(stream, iter->data + iter->position, bytesLeft, int(volume * iter->volume));
-			auto eraseIter = iter;
-			auto nextIter = ++iter;
-			playingSound.erase(eraseIter);
-			iter = nextIter;
-			// prevents increment of past-end-interator
-			if(iter == playingSound.end())
-				break;
+			mVoiceCount = 0;
 		}
-		else
+		// if all voices are busy, the new sound is dropped
+		else if (mVoiceCount < MAX_VOICES)
+		{
+			Voice& voice = mVoices[mVoiceCount++];
+			voice.sound = command.sound;
+			voice.position = 0;
+			voice.volume = command.volume;
+		}
+	}
+
+	float volume = mVolume.load(std::memory_order_relaxed);
+	// the stream is usually as large as the mix buffer, but SDL does not promise that
+	while (count > 0)
+	{
+		int chunk = std::min(count, (int)mMixBuffer.size());
+		Sint32* mixed = mMixBuffer.data();
+		std::fill(mixed, mixed + chunk, 0);
+
+		for (unsigned int i = 0; i < mVoiceCount; )
 		{
-			SDL_MixAudioFormat(stream, iter->data + iter->position, mSingleton->mAudioSpec.format, length, int(volume * iter->volume));
-			iter->position += length;
+			Voice& voice = mVoices[i];
+			const Sint16* samples = (const Sint16*)voice.sound->data;
+			int samplesLeft = voice.sound->length / sizeof(Sint16) - voice.position;
+			int mixedSamples = std::min(samplesLeft, chunk);
+			mixSamples(mixed, samples + voice.position, mixedSamples, int(SDL_MIX_MAXVOLUME * volume * voice.volume));
+			voice.position += mixedSamples;
+
+			if (mixedSamples == samplesLeft)
+				voice = mVoices[--mVoiceCount];
+			else
+				++i;
 		}
+
+		saturate(stream, mixed, chunk);
+		stream += chunk;
+		count -= chunk;
 	}
 }
 
 void SoundManager::deinit()
 {
+	// the voices reference the sounds, so the callback has to be stopped first
+	SDL_CloseAudioDevice(mAudioDevice);
+	// the callback does not run any more, so this thread may take the place of the consumer.
+	// Commands and voices which are left would use the sounds after they are freed.
+	PlayCommand command;
+	while (mCommands.pop(command))
+		;
+	mVoiceCount = 0;
 	for (std::map<std::string, Sound*>::iterator iter = mSound.begin();
 			iter != mSound.end(); ++iter)
 	{
@@ -195,8 +265,7 @@ void SoundManager::deinit()
 			delete iter->second;
 		}
 	}
-	SDL_UnlockAudioDevice(mAudioDevice);
-	SDL_CloseAudioDevice(mAudioDevice);
+	mSound.clear();
 	mInitialised = false;
 }
 
@@ -206,11 +275,15 @@ SoundManager* SoundManager::createSoundManager()
 }
 
 SoundManager::SoundManager()
+	: mSoundLoader([this](const std::string& filename) { return loadSound(filename); },
+			[](Sound* sound) { delete[] sound->data; delete sound; })
 {
 	mMute = false;
 	mSingleton = this;
 	mInitialised = false;
 	mAudioDevice = 0;
+	mVoiceCount = 0;
+	mVolume = 1.0;
 }
 
 SoundManager::~SoundManager()
@@ -241,20 +314,13 @@ void SoundManager::setMute(bool mute)
 	if( mute == mMute )
 		return;
 
-	static bool locked = false;
-	if (mute)
-	{
-		if (!locked)  //locking audio twice leads to a bug(??)
-		{
-			locked = true;
-			SDL_LockAudioDevice(mAudioDevice);
-		}
-	}
-	else
+	// sounds which were playing when the game was muted are not continued
+	if (!mute)
 	{
-		mPlayingSound.clear();
-		SDL_UnlockAudioDevice(mAudioDevice);
-		locked = false;
+		PlayCommand stop;
+		stop.sound = 0;
+		stop.volume = 0;
+		mCommands.push(stop);
 	}
 	mMute = mute;
 	SDL_PauseAudioDevice(mAudioDevice, (int)mute);
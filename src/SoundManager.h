@@ -26,10 +26,13 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #pragma once
 
 #include <SDL2/SDL.h>
+#include <atomic>
 #include <string>
 #include <map>
-#include <list>
+#include <vector>
 #include "BlobbyDebug.h"
+#include "AssetLoader.h"
+#include "SPSCQueue.h"
 
 /// \brief struct for holding sound data
 struct Sound : public ObjectCounter<Sound>
@@ -41,14 +44,17 @@ struct Sound : public ObjectCounter<Sound>
 
 	Uint8* data;
 	Uint32 length;
-	int position;
-	float volume;
 };
 
 /*! \class SoundManager
 	\brief class managing game sound.
 	\details Managing loading, converting to target format, muting, setting volume
 			and, of couse, playing of sounds.
+			All sounds are loaded and converted in the background when the audio device
+			is opened, so playing a sound for the first time does not stall the game.
+			playSound() passes the sound to the audio callback through a lock free queue.
+			The callback mixes up to MAX_VOICES sounds at once, without locks or allocations
+			on either side.
 */
 class SoundManager : public ObjectCounter<SoundManager>
 {
@@ -67,17 +73,49 @@ class SoundManager : public ObjectCounter<SoundManager>
 
 		static SoundManager* mSingleton;
 
+		/// number of sounds which can play at the same time, further sounds are dropped
+		static const unsigned int MAX_VOICES = 32;
+
+		/// a sound which is playing
+		struct Voice
+		{
+			const Sound* sound;
+			/// position in samples
+			Uint32 position;
+			float volume;
+		};
+
+		/// a sound to start, sound is 0 to stop all sounds
+		struct PlayCommand
+		{
+			const Sound* sound;
+			float volume;
+		};
+
 		SDL_AudioDeviceID mAudioDevice;
 
 		/// This maps filenames to sound buffers, which are always in
-		/// target format
+		/// target format. The buffers are kept until deinit(), as the voices use them
 		std::map<std::string, Sound*> mSound;
-		std::list<Sound> mPlayingSound;
 		SDL_AudioSpec mAudioSpec;
 		bool mInitialised;
-		float mVolume;
+		std::atomic<float> mVolume;
 		bool mMute;
 
+		/// sounds started by playSound(), for the audio callback
+		SPSCQueue<PlayCommand, 64> mCommands;
+
+		// only used by the audio callback
+		Voice mVoices[MAX_VOICES];
+		unsigned int mVoiceCount;
+		/// one sample per channel and frame of the device buffer, sums the voices before they are clamped
+		std::vector<Sint32> mMixBuffer;
+
+		/// decodes the sounds on worker threads, declared last as it uses mAudioSpec
+		AssetLoader<Sound*> mSoundLoader;
+
 		Sound* loadSound(const std::string& filename);
 		static void playCallback(void* singleton, Uint8* stream, int length);
+		/// mixes the voices into the buffer of the audio device
+		void mix(Sint16* stream, int count);
 };
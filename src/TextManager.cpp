@@ -199,6 +199,12 @@ void TextManager::setDefault()
 	mStrings[RP_SAVE_NAME] = "name of the replay:";
 	mStrings[RP_WAIT_REPLAY] = "receiving replay...";
 	mStrings[RP_SAVE] = "save replay";
+	mStrings[RP_SORT_NAME] = "by name";
+	mStrings[RP_SORT_DATE] = "by date";
+	mStrings[RP_SORT_PLAYER] = "by player";
+	mStrings[RP_SORT_SCORE] = "by score";
+	mStrings[RP_SORT_DURATION] = "by duration";
+	mStrings[RP_FILTER_PLAYER] = "player:";
 
 	mStrings[GAME_WIN] = "has won the game!";
 	mStrings[GAME_TRY_AGAIN] = "try again";
@@ -233,6 +239,9 @@ void TextManager::setDefault()
 	mStrings[NET_SECOND_TEAM] = "second team";
 	mStrings[NET_PAUSED_GAME] = "paused the game";
 	mStrings[NET_WAITING_CONTINUE] = "is waiting for continue";
+	mStrings[NET_SPECTATE] = "spectate";
+	mStrings[NET_RUNNING_GAME] = "live: ";
+	mStrings[NET_GAME_ABORTED] = "the game was aborted";
 
 	mStrings[OP_TOUCH_TYPE] = "touch input type:";
 	mStrings[OP_TOUCH_ARROWS] = "arrow keys";
@@ -76,6 +76,12 @@ class TextManager
 			RP_SAVE_NAME,
 			RP_WAIT_REPLAY,
 			RP_SAVE,
+			RP_SORT_NAME,
+			RP_SORT_DATE,
+			RP_SORT_PLAYER,
+			RP_SORT_SCORE,
+			RP_SORT_DURATION,
+			RP_FILTER_PLAYER,
 
 			// game texts
 			GAME_WIN,
@@ -112,6 +118,9 @@ class TextManager
 			NET_SECOND_TEAM,
 			NET_PAUSED_GAME,
 			NET_WAITING_CONTINUE,
+			NET_SPECTATE,
+			NET_RUNNING_GAME,
+			NET_GAME_ABORTED,
 
 			// options
 			OP_TOUCH_TYPE,
@@ -0,0 +1,77 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+
+/* header include */
+#include "UTF8.h"
+
+/* implementation */
+unsigned int nextCodepoint(std::string::const_iterator& iter, std::string::const_iterator end)
+{
+	unsigned char lead = *iter++;
+	if (lead < 0x80)
+		return lead;
+
+	int length;
+	unsigned int codepoint;
+	if ((lead & 0xE0) == 0xC0)
+	{
+		length = 1;
+		codepoint = lead & 0x1F;
+	}
+	else if ((lead & 0xF0) == 0xE0)
+	{
+		length = 2;
+		codepoint = lead & 0x0F;
+	}
+	else if ((lead & 0xF8) == 0xF0)
+	{
+		length = 3;
+		codepoint = lead & 0x07;
+	}
+	else
+	{
+		return UTF8_REPLACEMENT;
+	}
+
+	std::string::const_iterator continuation = iter;
+	for (int i = 0; i < length; ++i, ++continuation)
+	{
+		if (continuation == end || (*continuation & 0xC0) != 0x80)
+			return UTF8_REPLACEMENT;
+		codepoint = (codepoint << 6) | (*continuation & 0x3F);
+	}
+
+	// overlong encodings, surrogates and values beyond unicode
+	static const unsigned int minimum[] = {0, 0x80, 0x800, 0x10000};
+	if (codepoint < minimum[length] || (codepoint >= 0xD800 && codepoint <= 0xDFFF) || codepoint > 0x10FFFF)
+		return UTF8_REPLACEMENT;
+
+	iter = continuation;
+	return codepoint;
+}
+
+std::size_t characterCount(const std::string& text)
+{
+	std::size_t count = 0;
+	for (auto iter = text.cbegin(); iter != text.cend(); ++count)
+		nextCodepoint(iter, text.cend());
+
+	return count;
+}
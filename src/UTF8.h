@@ -0,0 +1,34 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// the code point which is returned for invalid UTF-8 sequences
+const unsigned int UTF8_REPLACEMENT = 0xFFFD;
+
+/// decodes the character at iter and advances iter to the next one.
+/// Invalid bytes become UTF8_REPLACEMENT, one byte at a time.
+unsigned int nextCodepoint(std::string::const_iterator& iter, std::string::const_iterator end);
+
+/// the number of characters of a UTF-8 string, as they are drawn
+std::size_t characterCount(const std::string& text);
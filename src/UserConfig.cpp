@@ -32,6 +32,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "FileWrite.h"
 #include "PlayerIdentity.h"
 #include "LocalInputSource.h"
+#include "NativeInputSource.h"
 #include "ScriptedInputSource.h"
 
 
@@ -67,15 +68,15 @@ PlayerIdentity UserConfig::loadPlayerIdentity(PlayerSide side, bool force_human)
 	std::string prefix = getPlayerPrefix(side);
 	std::string name = "";
 	// init local input
-	if(force_human)
+	if(force_human || getBool(prefix + "_player_human"))
 	{
 		name = getString(prefix + "_player_name");
 	}
 	else
 	{
-		name = getBool(prefix + "_player_human") ?
-					getString(prefix + "_player_name") :
-					getString(prefix + "_script_name") + ".lua";
+		name = getString(prefix + "_script_name");
+		if (!NativeInputSource::isNativeBot(name))
+			name += ".lua";
 	}	   
 
 	PlayerIdentity player = PlayerIdentity(name);
@@ -0,0 +1,414 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+/* includes */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <boost/scoped_ptr.hpp>
+
+#include <SDL2/SDL.h>
+
+#include "DuelMatch.h"
+#include "FileSystem.h"
+#include "FileWrite.h"
+#include "GameLogic.h"
+#include "PhysicWorld.h"
+#include "PlayerIdentity.h"
+#include "RenderManager.h"
+#include "replays/ReplayPlayer.h"
+
+/* implementation */
+
+/*
+	Measures the frame time and the number of draw calls per frame of a renderer.
+	Three scenes are drawn: a running game with score, names and blood particles,
+	a menu with overlays and many lines of text, like the options, and all players
+	with blob colours that change every frame, like the oscillating blobs.
+	If a replay is given, it is played as a fourth scene, one physics step per frame and
+	starting over at its end, which shows the frame times of a real match. Like in the game,
+	the replay file name is relative to the data directory, e.g. replays/last.bvr
+	To compare renderers without a graphics card, run it with a software OpenGL and
+	without a display, e.g. SDL_VIDEODRIVER=offscreen LIBGL_ALWAYS_SOFTWARE=1
+
+	With screenshots, the scenes are drawn once and some frames of each are saved as
+	bitmaps into the directory, which has to exist. compare checks the bitmaps of two such
+	directories pixel by pixel, e.g. OpenGL3 against OpenGL, or the SDL renderer of two
+	builds. A pixel differs if one of its colours differs by more than the tolerance.
+	SDL_RENDER_DRIVER=software runs the SDL renderer without a graphics card. Its dirty
+	rects must not change a single pixel, so compare it with tolerance 0 against a build
+	which redraws the whole screen each frame.
+
+	usage: blobby-render-benchmark <data directory> [frames] [OpenGL|OpenGL3|SDL] [replay]
+	       blobby-render-benchmark <data directory> screenshots <OpenGL|OpenGL3|SDL> <directory> [replay]
+	       blobby-render-benchmark compare <directory> <reference directory> [tolerance]
+*/
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	const int PARTICLES = 64;
+
+	// the frames which are saved as screenshots, the first one loads the images
+	const int SCREENSHOT_FRAMES[] = { 0, 1, 2, 10, 60, 200 };
+	const char* const SCENES[] = { "game", "menu", "colors", "replay" };
+	// images with more differing pixels do not match
+	const double MAX_DIFFERENT_PIXELS = 0.001;
+
+	void drawGame(RenderManager& renderer, int frame)
+	{
+		float t = frame / 60.f;
+		renderer.setBall(Vector2(400 + 300 * std::sin(t), 300 + 200 * std::cos(2.3f * t)), t * 5);
+		for (int i = 0; i < MAX_PLAYERS; ++i)
+		{
+			float x = (i % 2 == 0 ? 200 : 600) + 150 * std::sin(t * (1 + i));
+			renderer.setBlob(i, Vector2(x, 450 - 50 * std::abs(std::sin(t * 2 + i))), (frame / 4 + i) % 5, i < 2);
+		}
+		renderer.draw();
+
+		renderer.drawText("12", Vector2(24, 24), TF_NORMAL);
+		renderer.drawText("7", Vector2(800 - 48, 24), TF_NORMAL);
+		renderer.drawText("Left Player", Vector2(12, 550), TF_SMALL_FONT);
+		renderer.drawText("Right Player", Vector2(800 - 12 - 12 * 12, 550), TF_SMALL_FONT);
+		renderer.drawText("1:23", Vector2(352, 24), TF_NORMAL);
+
+		// particles are submitted as one batch, like the BloodManager does
+		float x[PARTICLES], y[PARTICLES];
+		int players[PARTICLES];
+		for (int i = 0; i < PARTICLES; ++i)
+		{
+			float age = std::fmod(t + i * 0.05f, 1.5f);
+			x[i] = 200 + i * 6 + 40 * age;
+			y[i] = 300 - 150 * age + 200 * age * age;
+			players[i] = i % 2;
+		}
+		renderer.startDrawParticles();
+		renderer.drawParticles(x, y, players, PARTICLES);
+		renderer.endDrawParticles();
+	}
+
+	void drawMenu(RenderManager& renderer, int frame)
+	{
+		renderer.draw();
+		renderer.drawOverlay(0.65, Vector2(0, 0), Vector2(800, 600));
+		renderer.drawImage("gfx/titel.bmp", Vector2(250, 210));
+		renderer.drawOverlay(0.5, Vector2(180, 150), Vector2(620, 490));
+		for (int line = 0; line < 12; ++line)
+		{
+			unsigned int flags = (line == frame / 10 % 12 ? TF_HIGHLIGHT : TF_NORMAL);
+			renderer.drawText("menu entry " + std::to_string(line), Vector2(200, 160 + 26 * line), flags);
+			if (line % 4 == 0)
+				renderer.drawOverlay(0.3, Vector2(190, 158 + 26 * line), Vector2(610, 184 + 26 * line));
+		}
+		renderer.drawBlob(Vector2(700, 500), Color(0, 0, 255));
+		renderer.drawText("ok", Vector2(224, 530), TF_HIGHLIGHT);
+		renderer.drawText("cancel", Vector2(424, 530), TF_NORMAL);
+		renderer.drawImage("gfx/cursor.bmp", Vector2(424 + frame % 200, 300));
+	}
+
+	void drawColors(RenderManager& renderer, int frame)
+	{
+		for (int i = 0; i < MAX_PLAYERS; ++i)
+		{
+			renderer.setBlobColor(i, Color((frame * 7 + i * 32) % 256, (frame * 3 + i * 64) % 256, 255 - frame * 5 % 256));
+			renderer.setBlob(i, Vector2(50 + i * 100, 450), (frame / 4 + i) % 5, true);
+		}
+		renderer.draw();
+
+		renderer.startDrawParticles();
+		for (int i = 0; i < PARTICLES; ++i)
+			renderer.drawParticle(Vector2(50 + i * 11, 300 - 3 * (frame + i) % 200), i % MAX_PLAYERS);
+		renderer.endDrawParticles();
+
+		renderer.drawBlob(Vector2(150, 200), Color(frame % 256, 0, 255 - frame % 256));
+		renderer.drawBlob(Vector2(650, 200), Color(0, frame % 256, 128));
+	}
+
+	/// draws a replay like the GameState does: blobs, ball, score, names and time
+	class ReplayScene
+	{
+		public:
+			explicit ReplayScene(const std::string& file)
+			{
+				mPlayer.load(file);
+
+				// DuelMatch can only load rules from a file, like in the ReplayState
+				FileWrite rulesFile("rules/" + TEMP_RULES_NAME);
+				rulesFile.write(mPlayer.getRules());
+				rulesFile.close();
+
+				bool playerEnabled[MAX_PLAYERS];
+				PlayerIdentity players[MAX_PLAYERS];
+				for (int i = 0; i < MAX_PLAYERS; ++i)
+				{
+					playerEnabled[i] = mPlayer.getPlayerEnabled(PlayerSide(i));
+					if (playerEnabled[i])
+					{
+						players[i] = PlayerIdentity(mPlayer.getPlayerName(PlayerSide(i)));
+						players[i].setStaticColor(mPlayer.getBlobColor(PlayerSide(i)));
+					}
+				}
+
+				mMatch.reset(new DuelMatch(false, TEMP_RULES_NAME, playerEnabled));
+				mMatch->setPlayers(players);
+			}
+
+			void operator()(RenderManager& renderer, int frame)
+			{
+				if (mPlayer.endOfFile() || !mPlayer.play(mMatch.get()))
+				{
+					while (!mPlayer.gotoPlayingPosition(0, mMatch.get()))
+						;
+				}
+				mMatch->getClock().setTime(mPlayer.getReplayPosition() / (mPlayer.getGameSpeed() * mPlayer.getBytesPerStep()));
+
+				for (int i = 0; i < MAX_PLAYERS; ++i)
+				{
+					const PlayerSide player = PlayerSide(i);
+					renderer.setBlob(i, mMatch->getBlobPosition(player), mMatch->getWorld().getBlobState(player), mMatch->getPlayerEnabled(player));
+					if (mMatch->getPlayerEnabled(player))
+						renderer.setBlobColor(i, mMatch->getPlayer(player).getStaticColor());
+				}
+				renderer.setBall(mMatch->getBallPosition(), mMatch->getWorld().getBallRotation());
+				renderer.draw();
+
+				char score[8];
+				std::snprintf(score, sizeof(score), mMatch->getServingPlayer() == LEFT_SIDE ? "%02d!" : "%02d ", mMatch->getScore(LEFT_SIDE));
+				renderer.drawText(score, Vector2(24, 24), TF_NORMAL);
+				std::snprintf(score, sizeof(score), mMatch->getServingPlayer() == RIGHT_SIDE ? "%02d!" : "%02d ", mMatch->getScore(RIGHT_SIDE));
+				renderer.drawText(score, Vector2(800 - 24 - 3 * 24, 24), TF_NORMAL);
+				renderer.drawText(mMatch->getPlayer(LEFT_PLAYER).getName(), Vector2(12, 550), TF_SMALL_FONT);
+				renderer.drawText(mMatch->getPlayer(RIGHT_PLAYER).getName(), Vector2(422, 550), TF_SMALL_FONT);
+				renderer.drawText(mMatch->getClock().getTimeString(), Vector2(352, 24), TF_NORMAL);
+			}
+
+		private:
+			ReplayPlayer mPlayer;
+			boost::scoped_ptr<DuelMatch> mMatch;
+	};
+
+	void run(RenderManager& renderer, const std::string& name, const std::function<void(RenderManager&, int)>& scene, int frames)
+	{
+		// one frame to load all images, it is not measured
+		scene(renderer, 0);
+		renderer.refresh();
+
+		long drawCalls = 0;
+		Clock::time_point start = Clock::now();
+		for (int frame = 1; frame <= frames; ++frame)
+		{
+			scene(renderer, frame);
+			renderer.refresh();
+			drawCalls += renderer.getDrawCallCount();
+		}
+		double milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+		std::cout << name << ": " << milliseconds / frames << " ms per frame";
+		if (renderer.getDrawCallCount() >= 0)
+			std::cout << ", " << double(drawCalls) / frames << " draw calls per frame";
+		std::cout << std::endl;
+	}
+
+	std::string screenshotName(const std::string& directory, const std::string& scene, int frame)
+	{
+		return directory + "/" + scene + "-" + std::to_string(frame) + ".bmp";
+	}
+
+	void saveScreenshots(RenderManager& renderer, const std::string& name, const std::function<void(RenderManager&, int)>& scene, const std::string& directory)
+	{
+		const int* last = std::end(SCREENSHOT_FRAMES) - 1;
+		for (int frame = 0; frame <= *last; ++frame)
+		{
+			scene(renderer, frame);
+			if (std::count(std::begin(SCREENSHOT_FRAMES), std::end(SCREENSHOT_FRAMES), frame))
+			{
+				SDL_Surface* screenshot = renderer.takeScreenshot();
+				if (!screenshot)
+					throw std::runtime_error("this renderer can't take screenshots");
+				std::string filename = screenshotName(directory, name, frame);
+				if (SDL_SaveBMP(screenshot, filename.c_str()) != 0)
+					throw std::runtime_error("could not save " + filename + ": " + SDL_GetError());
+				SDL_FreeSurface(screenshot);
+			}
+			renderer.refresh();
+		}
+	}
+
+	// returns false if the images do not match
+	bool compareScreenshots(const std::string& filename, const std::string& referenceFilename, int tolerance)
+	{
+		SDL_Surface* loaded = SDL_LoadBMP(filename.c_str());
+		SDL_Surface* loadedReference = SDL_LoadBMP(referenceFilename.c_str());
+		if (!loaded || !loadedReference)
+		{
+			if (loaded || loadedReference)
+				std::cout << filename << ": no screenshot to compare with" << std::endl;
+			SDL_FreeSurface(loaded);
+			SDL_FreeSurface(loadedReference);
+			// scenes which are in neither directory, like the replay, are skipped
+			return !loaded && !loadedReference;
+		}
+
+		SDL_Surface* image = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_ABGR8888, 0);
+		SDL_Surface* reference = SDL_ConvertSurfaceFormat(loadedReference, SDL_PIXELFORMAT_ABGR8888, 0);
+		SDL_FreeSurface(loaded);
+		SDL_FreeSurface(loadedReference);
+
+		bool match = false;
+		if (image->w != reference->w || image->h != reference->h)
+		{
+			std::cout << filename << ": " << image->w << "x" << image->h << " instead of "
+					<< reference->w << "x" << reference->h << std::endl;
+		}
+		else
+		{
+			long differentPixels = 0;
+			int maxDifference = 0;
+			for (int y = 0; y < image->h; ++y)
+			{
+				const Uint8* row = (const Uint8*)image->pixels + y * image->pitch;
+				const Uint8* referenceRow = (const Uint8*)reference->pixels + y * reference->pitch;
+				for (int x = 0; x < image->w; ++x)
+				{
+					int difference = 0;
+					// red, green and blue, the alpha is not shown
+					for (int channel = 0; channel < 3; ++channel)
+						difference = std::max(difference, std::abs(row[4 * x + channel] - referenceRow[4 * x + channel]));
+					maxDifference = std::max(maxDifference, difference);
+					if (difference > tolerance)
+						++differentPixels;
+				}
+			}
+
+			double fraction = double(differentPixels) / (image->w * image->h);
+			match = fraction <= MAX_DIFFERENT_PIXELS;
+			std::cout << filename << ": " << (match ? "ok, " : "DIFFERENT, ") << 100 * fraction
+					<< "% of the pixels differ, by at most " << maxDifference << std::endl;
+		}
+
+		SDL_FreeSurface(image);
+		SDL_FreeSurface(reference);
+		return match;
+	}
+
+	int compare(const std::string& directory, const std::string& referenceDirectory, int tolerance)
+	{
+		int mismatches = 0;
+		for (const char* scene : SCENES)
+		{
+			for (int frame : SCREENSHOT_FRAMES)
+			{
+				if (!compareScreenshots(screenshotName(directory, scene, frame), screenshotName(referenceDirectory, scene, frame), tolerance))
+					++mismatches;
+			}
+		}
+
+		std::cout << mismatches << " screenshots do not match" << std::endl;
+		return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	bool screenshots = argc > 2 && std::string(argv[2]) == "screenshots";
+	if (argc < 2 || (screenshots && argc < 5) || (std::string(argv[1]) == "compare" && argc < 4))
+	{
+		std::cerr << "usage: " << argv[0] << " <data directory> [frames] [OpenGL|OpenGL3|SDL] [replay]" << std::endl;
+		std::cerr << "       " << argv[0] << " <data directory> screenshots <OpenGL|OpenGL3|SDL> <directory> [replay]" << std::endl;
+		std::cerr << "       " << argv[0] << " compare <directory> <reference directory> [tolerance]" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	if (std::string(argv[1]) == "compare")
+		return compare(argv[2], argv[3], argc > 4 ? std::atoi(argv[4]) : 16);
+
+	int frames = argc > 2 && !screenshots ? std::max(1, std::atoi(argv[2])) : 1000;
+	std::string device = argc > 3 ? argv[3] : "OpenGL";
+	std::string screenshotDirectory = screenshots ? argv[4] : "";
+	int replayArgument = screenshots ? 5 : 4;
+
+	FileSystem filesys(argv[0]);
+	filesys.addToSearchPath(argv[1]);
+
+	std::unique_ptr<ReplayScene> replay;
+	if (argc > replayArgument)
+	{
+		// the rules of the replay are written to the same place the game uses
+		std::string userdir = filesys.getUserDir();
+		filesys.setWriteDir(userdir);
+		filesys.mkdir(".blobby/rules");
+		filesys.removeFromSearchPath(userdir);
+		filesys.setWriteDir(userdir + ".blobby");
+
+		replay.reset(new ReplayScene(argv[replayArgument]));
+	}
+
+	if (SDL_Init(SDL_INIT_VIDEO) != 0)
+	{
+		std::cerr << "could not initialise SDL: " << SDL_GetError() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	RenderManager* renderer;
+	if (device == "SDL")
+		renderer = RenderManager::createRenderManagerSDL();
+	else if (device == "OpenGL3")
+		renderer = RenderManager::createRenderManagerGL3();
+	else
+		renderer = RenderManager::createRenderManagerGL2D();
+	renderer->init(BASE_RESOLUTION_X, BASE_RESOLUTION_Y, false);
+	renderer->showShadow(true);
+	renderer->drawGame(true);
+	// measure the drawing, not the waiting for the display
+	SDL_GL_SetSwapInterval(0);
+
+	if (screenshots)
+	{
+		saveScreenshots(*renderer, SCENES[0], drawGame, screenshotDirectory);
+		saveScreenshots(*renderer, SCENES[1], drawMenu, screenshotDirectory);
+		saveScreenshots(*renderer, SCENES[2], drawColors, screenshotDirectory);
+		if (replay)
+			saveScreenshots(*renderer, SCENES[3], std::ref(*replay), screenshotDirectory);
+	}
+	else
+	{
+		std::cout << device << ", " << frames << " frames" << std::endl;
+		run(*renderer, "game", drawGame, frames);
+		run(*renderer, "menu", drawMenu, frames);
+		run(*renderer, "colors", drawColors, frames);
+		if (replay)
+			run(*renderer, "replay", std::ref(*replay), frames);
+	}
+
+	renderer->deinit();
+	delete renderer;
+	SDL_Quit();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,147 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+/* includes */
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "FileSystem.h"
+#include "InputSource.h"
+#include "replays/IReplayLoader.h"
+
+/* implementation */
+
+/*
+	Measures how long it takes to get the attributes of every replay in a directory,
+	as the replay browser does, compared to loading each replay completely.
+
+	usage: blobby-replay-benchmark <directory> [repetitions]
+*/
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	double millisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	/// reads the replay attributes, as used by the replay selection
+	void readMetadata(const IReplayLoader& loader, unsigned& checksum)
+	{
+		for (int i = 0; i < MAX_PLAYERS; ++i)
+			checksum += loader.getPlayerName(PlayerSide(i)).size();
+		checksum += loader.getFinalScore(LEFT_SIDE) + loader.getFinalScore(RIGHT_SIDE);
+		checksum += loader.getDuration() + loader.getSpeed() + loader.getDate();
+	}
+
+	/// additionally touches rules, input and savepoints, so everything gets loaded
+	void readData(IReplayLoader& loader, unsigned& checksum)
+	{
+		checksum += loader.getRules().size();
+
+		InputSource input;
+		if (loader.getLength() > 0)
+		{
+			loader.getInputAt(loader.getLength() - 1, &input, true);
+			checksum += input.getInput().getAll();
+		}
+
+		int position;
+		int index = loader.getSavePoint(loader.getLength(), position);
+		if (index >= 0)
+		{
+			ReplaySavePoint savePoint;
+			loader.readSavePoint(index, savePoint);
+			checksum += savePoint.step;
+		}
+	}
+
+	void report(const std::string& name, double milliseconds, std::size_t files)
+	{
+		std::cout << name << ": " << milliseconds << " ms total, "
+				<< milliseconds * 1000 / files << " us per replay" << std::endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cerr << "usage: " << argv[0] << " <directory> [repetitions]" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	int repetitions = argc > 2 ? std::max(1, std::atoi(argv[2])) : 5;
+
+	FileSystem filesys(argv[0]);
+	filesys.addToSearchPath(argv[1]);
+
+	std::vector<std::string> files = filesys.enumerateFiles("", ".bvr", true);
+	if (files.empty())
+	{
+		std::cerr << "no replays found in " << argv[1] << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::cout << "loading " << files.size() << " replays, best of " << repetitions << " runs" << std::endl;
+
+	double bestMetadata = -1;
+	double bestFull = -1;
+	unsigned checksum = 0;
+
+	for (int run = 0; run < repetitions; ++run)
+	{
+		Clock::time_point start = Clock::now();
+		for (const auto& file : files)
+		{
+			std::unique_ptr<IReplayLoader> loader(IReplayLoader::createReplayLoader(file));
+			readMetadata(*loader, checksum);
+		}
+		double metadata = millisecondsSince(start);
+
+		start = Clock::now();
+		for (const auto& file : files)
+		{
+			std::unique_ptr<IReplayLoader> loader(IReplayLoader::createReplayLoader(file));
+			readMetadata(*loader, checksum);
+			readData(*loader, checksum);
+		}
+		double full = millisecondsSince(start);
+
+		if (bestMetadata < 0 || metadata < bestMetadata)
+			bestMetadata = metadata;
+		if (bestFull < 0 || full < bestFull)
+			bestFull = full;
+	}
+
+	report("time to metadata", bestMetadata, files.size());
+	report("full load", bestFull, files.size());
+	// print the checksum so the compiler cannot drop the loading
+	std::cout << "checksum: " << checksum << std::endl;
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,190 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+/* includes */
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "DuelMatch.h"
+#include "FileSystem.h"
+#include "GameLogic.h"
+#include "InputSource.h"
+#include "LuaCompat.h"
+#include "ScriptedInputSource.h"
+
+/* implementation */
+
+/*
+	Measures the per frame overhead of lua rules and lua bots. Every configuration
+	simulates the same number of steps, a match is restarted once it is won.
+	  fallback rules   C++ rules, input changes randomly
+	  lua rules        the given rules, input changes randomly
+	  lua rules + bots the given rules, every player is controlled by the given bot
+	Afterwards, it measures how long it takes to create a match with the given rules,
+	as the server does for every new game, and to create a bot.
+	With "all" as bot, every bot in the scripts directory is measured. Comparing
+	a build with USE_LUAJIT to one without shows the gain of LuaJIT for each bot.
+
+	usage: blobby-scripting-benchmark <data directory> [steps] [players] [rules] [bot|all]
+*/
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	struct Settings
+	{
+		int steps;
+		int players;
+		std::string rules;
+		std::string bot;
+	};
+
+	/// runs \p settings.steps steps and returns the time in milliseconds
+	double run(const Settings& settings, const std::string& rules, bool bots, unsigned& checksum)
+	{
+		bool playerEnabled[MAX_PLAYERS] = {};
+		for (int i = 0; i < settings.players; ++i)
+			playerEnabled[i] = true;
+
+		std::srand(0);
+		std::unique_ptr<DuelMatch> match;
+		std::shared_ptr<InputSource> inputs[MAX_PLAYERS];
+
+		Clock::time_point start = Clock::now();
+		for (int step = 0; step < settings.steps; ++step)
+		{
+			if (!match || match->winningPlayer() != NO_PLAYER)
+			{
+				match.reset(new DuelMatch(false, rules, playerEnabled, 15));
+				for (int i = 0; i < settings.players; ++i)
+				{
+					if (bots)
+					{
+						auto bot = std::make_shared<ScriptedInputSource>("scripts/" + settings.bot, PlayerSide(i), 0);
+						// measure the script itself, not the hand over to a worker thread
+						bot->setAsync(false);
+						inputs[i] = bot;
+					}
+					else
+						inputs[i] = std::make_shared<InputSource>();
+					match->setInputSource(PlayerSide(i), inputs[i]);
+				}
+			}
+
+			if (!bots)
+			{
+				for (int i = 0; i < settings.players; ++i)
+				{
+					if (std::rand() % 8 == 0)
+						inputs[i]->setInput(PlayerInput(std::rand() % 2, std::rand() % 2, std::rand() % 2));
+				}
+			}
+
+			match->step();
+			checksum += match->getScore(LEFT_SIDE) + match->getScore(RIGHT_SIDE);
+		}
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	/// creates \p count matches and bots and reports the time per object
+	void measureCreation(const Settings& settings, int count)
+	{
+		bool playerEnabled[MAX_PLAYERS] = {};
+		for (int i = 0; i < settings.players; ++i)
+			playerEnabled[i] = true;
+
+		Clock::time_point start = Clock::now();
+		for (int i = 0; i < count; ++i)
+			DuelMatch match(false, settings.rules, playerEnabled, 15);
+		double matches = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+		start = Clock::now();
+		for (int i = 0; i < count; ++i)
+			ScriptedInputSource bot("scripts/" + settings.bot, LEFT_PLAYER, 0);
+		double bots = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+		std::cout << "match creation: " << matches * 1000 / count << " us per match" << std::endl;
+		std::cout << "bot creation: " << bots * 1000 / count << " us per bot" << std::endl;
+	}
+
+	void report(const std::string& name, double milliseconds, double baseline, int steps)
+	{
+		std::cout << name << ": " << milliseconds * 1000 / steps << " us per step";
+		if (baseline >= 0)
+			std::cout << ", scripting " << (milliseconds - baseline) * 1000 / steps << " us per step";
+		std::cout << std::endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cerr << "usage: " << argv[0] << " <data directory> [steps] [players] [rules] [bot|all]" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	Settings settings;
+	settings.steps = argc > 2 ? std::max(1, std::atoi(argv[2])) : 20000;
+	settings.players = argc > 3 ? std::min(std::max(2, std::atoi(argv[3])), (int)MAX_PLAYERS) : 2;
+	settings.rules = argc > 4 ? argv[4] : "default.lua";
+	settings.bot = argc > 5 ? argv[5] : "reduced";
+
+	FileSystem filesys(argv[0]);
+	filesys.addToSearchPath(argv[1]);
+
+	std::vector<std::string> bots;
+	if (settings.bot == "all")
+		bots = filesys.enumerateFiles("scripts", ".lua");
+	else
+		bots.push_back(settings.bot);
+
+#ifdef BLOBBY_USE_LUAJIT
+	std::cout << LUAJIT_VERSION << ", ";
+#else
+	std::cout << LUA_RELEASE << ", ";
+#endif
+	std::cout << settings.steps << " steps, " << settings.players << " players, rules "
+			<< settings.rules << ", bot " << settings.bot << std::endl;
+
+	unsigned checksum = 0;
+	double fallback = run(settings, FALLBACK_RULES_NAME, false, checksum);
+	double rules = run(settings, settings.rules, false, checksum);
+	report("fallback rules", fallback, -1, settings.steps);
+	report("lua rules", rules, fallback, settings.steps);
+
+	for (const auto& bot : bots)
+	{
+		settings.bot = bot;
+		double time = run(settings, settings.rules, true, checksum);
+		report("lua rules + " + bot, time, fallback, settings.steps);
+	}
+	measureCreation(settings, 200);
+	// print the checksum so the compiler cannot drop the simulation
+	std::cout << "checksum: " << checksum << std::endl;
+
+	return EXIT_SUCCESS;
+}
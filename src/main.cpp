@@ -187,6 +187,15 @@ void setupPHYSFS()
 {
 	DEBUG_STATUS("started main");
 
+	// --benchmark-startup prints the time until the first frame is shown, and quits
+	Uint64 startTime = SDL_GetPerformanceCounter();
+	bool benchmarkStartup = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--benchmark-startup") == 0)
+			benchmarkStartup = true;
+	}
+
 	FileSystem filesys(argv[0]);
 	setupPHYSFS();
 
@@ -239,6 +248,8 @@ void setupPHYSFS()
 			rmanager = RenderManager::createRenderManagerGP2X();*/
 		else if (gameConfig.getString("device") == "OpenGL")
 			rmanager = RenderManager::createRenderManagerGL2D();
+		else if (gameConfig.getString("device") == "OpenGL3")
+			rmanager = RenderManager::createRenderManagerGL3();
 		else
 		{
 			std::cerr << "Warning: Unknown renderer selected!";
@@ -246,11 +257,32 @@ void setupPHYSFS()
 			rmanager = RenderManager::createRenderManagerSDL();
 		}
 
+		// the background is decoded in the background while the renderer starts
+		std::string bg = std::string("backgrounds/") + gameConfig.getString("background");
+		bool hasBackground = FileSystem::getSingleton().exists(bg);
+		if (hasBackground)
+			rmanager->preloadImages(std::vector<std::string>(1, bg));
+
 		// fullscreen?
-		if(gameConfig.getString("fullscreen") == "true")
-			rmanager->init(BASE_RESOLUTION_X, BASE_RESOLUTION_Y, true);
-		else
-			rmanager->init(BASE_RESOLUTION_X, BASE_RESOLUTION_Y, false);
+		bool fullscreen = gameConfig.getString("fullscreen") == "true";
+		try
+		{
+			rmanager->init(BASE_RESOLUTION_X, BASE_RESOLUTION_Y, fullscreen);
+		}
+		catch (std::exception& e)
+		{
+			std::string device = gameConfig.getString("device");
+			if (device != "OpenGL" && device != "OpenGL3")
+				throw;
+
+			// the driver can't run the OpenGL renderer, the SDL renderer always works
+			std::cerr << "Warning: " << e.what() << std::endl;
+			std::cerr << "Falling back to SDL" << std::endl;
+			rmanager = RenderManager::createRenderManagerSDL();
+			if (hasBackground)
+				rmanager->preloadImages(std::vector<std::string>(1, bg));
+			rmanager->init(BASE_RESOLUTION_X, BASE_RESOLUTION_Y, fullscreen);
+		}
 
 		if(gameConfig.getString("show_shadow") == "true")
 			rmanager->showShadow(true);
@@ -265,12 +297,8 @@ void setupPHYSFS()
 		smanager->init();
 		smanager->setVolume(gameConfig.getFloat("global_volume"));
 		smanager->setMute(gameConfig.getBool("mute"));
-		/// \todo play sound is misleading. what we actually want to do is load the sound
-		smanager->playSound("sounds/bums.wav", 0.0);
-		smanager->playSound("sounds/pfiff.wav", 0.0);
 
-		std::string bg = std::string("backgrounds/") + gameConfig.getString("background");
-		if ( FileSystem::getSingleton().exists(bg) )
+		if (hasBackground)
 			rmanager->setBackground(bg);
 
 		InputManager* inputmgr = InputManager::createInputManager();
@@ -327,6 +355,13 @@ void setupPHYSFS()
 				IMGUI::getSingleton().end();
 				BloodManager::getSingleton().step();
 				rmanager->refresh();
+
+				if (benchmarkStartup)
+				{
+					double milliseconds = double(SDL_GetPerformanceCounter() - startTime) * 1000 / SDL_GetPerformanceFrequency();
+					std::cout << "startup: " << milliseconds << " ms until the first frame" << std::endl;
+					running = 0;
+				}
 			}
 			scontroller.update();
 		}
@@ -48,7 +48,9 @@ class IReplayLoader : public ObjectCounter<IReplayLoader>
 
 		/// \brief Creates an IReplayLoader for a certain file.
 		/// \details Determines the version of the file and creates a
-		///			corresponding IReplayLoader.
+		///			corresponding IReplayLoader. Only the replay attributes
+		///			are read here, the rules, input and savepoints are loaded
+		///			when they are accessed for the first time.
 		///  \exception \todo we have to add and document the exceptions
 		static IReplayLoader* createReplayLoader(const std::string& file);
 
@@ -0,0 +1,457 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+/* header include */
+#include "ReplayIndex.h"
+
+/* includes */
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <unordered_set>
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+
+#include "IReplayLoader.h"
+#include "FileRead.h"
+#include "FileWrite.h"
+#include "FileSystem.h"
+
+/* implementation */
+
+namespace
+{
+	const char INDEX_HEADER[4] = { 'B', 'V', 'R', 'I' };
+	const uint32_t INDEX_VERSION = 1;
+	// written in native byte order, so we notice when an index is copied to a machine with different endianness
+	const uint32_t INDEX_BYTE_ORDER = 0x01020304;
+
+	struct IndexHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t byteOrder;
+		uint32_t recordSize;
+		uint32_t recordCount;
+		uint32_t stringSize;
+	};
+}
+
+ReplayIndex::ReplayIndex(const std::string& directory) :
+	mDirectory(directory),
+	mIndexFile(directory + "/index.bvi"),
+	mRevision(0),
+	mCancelRefresh(false)
+{
+	load();
+}
+
+ReplayIndex::~ReplayIndex()
+{
+	mCancelRefresh = true;
+	if(mRefreshJob.valid())
+		mRefreshJob.wait();
+}
+
+void ReplayIndex::load()
+{
+	mRecords.clear();
+	mStrings.clear();
+	mRecordByFile.clear();
+
+	try
+	{
+		if(!FileSystem::getSingleton().exists(mIndexFile))
+			return;
+
+		FileRead file(mIndexFile);
+		IndexHeader header;
+		if(file.length() < sizeof(header))
+			return;
+		file.readRawBytes(reinterpret_cast<char*>(&header), sizeof(header));
+
+		if(std::memcmp(header.magic, INDEX_HEADER, sizeof(INDEX_HEADER)) != 0 ||
+			header.version != INDEX_VERSION || header.byteOrder != INDEX_BYTE_ORDER ||
+			header.recordSize != sizeof(Record) ||
+			file.length() != sizeof(header) + header.recordCount * sizeof(Record) + header.stringSize)
+		{
+			std::cerr << "Warning: replay index " << mIndexFile << " is outdated, rebuilding it" << std::endl;
+			return;
+		}
+
+		// the records are used exactly as they are stored
+		mRecords.resize(header.recordCount);
+		mStrings.resize(header.stringSize);
+		file.readRawBytes(reinterpret_cast<char*>(mRecords.data()), mRecords.size() * sizeof(Record));
+		file.readRawBytes(mStrings.data(), mStrings.size());
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << "Warning: could not read replay index: " << e.what() << std::endl;
+		mRecords.clear();
+		mStrings.clear();
+	}
+
+	// make sure a damaged file can't make us read outside of the string pool
+	auto valid = [this](uint32_t offset) { return offset < mStrings.size(); };
+	bool corrupt = !mStrings.empty() && mStrings.back() != 0;
+	for(const auto& record : mRecords)
+	{
+		corrupt = corrupt || !valid(record.file) ||
+			std::any_of(std::begin(record.playerNames), std::end(record.playerNames), [&](uint32_t o) { return !valid(o); });
+	}
+	if(corrupt)
+	{
+		std::cerr << "Warning: replay index " << mIndexFile << " is corrupt, rebuilding it" << std::endl;
+		mRecords.clear();
+		mStrings.clear();
+	}
+
+	for(unsigned i = 0; i < mRecords.size(); ++i)
+	{
+		mRecordByFile[getString(mRecords[i].file)] = i;
+	}
+}
+
+void ReplayIndex::save()
+{
+	IndexHeader header;
+	std::vector<Record> records;
+	std::vector<char> strings;
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		// updated entries leave their old strings behind, so compact the pool while copying
+		records = mRecords;
+		strings.push_back(0);
+		auto copyString = [&](uint32_t& offset)
+		{
+			const char* str = getString(offset);
+			if(*str == 0)
+			{
+				offset = 0;
+				return;
+			}
+			offset = strings.size();
+			strings.insert(strings.end(), str, str + std::strlen(str) + 1);
+		};
+
+		for(auto& record : records)
+		{
+			copyString(record.file);
+			for(auto& name : record.playerNames)
+				copyString(name);
+		}
+	}
+
+	std::memcpy(header.magic, INDEX_HEADER, sizeof(INDEX_HEADER));
+	header.version = INDEX_VERSION;
+	header.byteOrder = INDEX_BYTE_ORDER;
+	header.recordSize = sizeof(Record);
+	header.recordCount = records.size();
+	header.stringSize = strings.size();
+
+	try
+	{
+		FileWrite file(mIndexFile);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(Record));
+		file.write(strings.data(), strings.size());
+		file.close();
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << "Warning: could not write replay index: " << e.what() << std::endl;
+	}
+}
+
+void ReplayIndex::refresh(const std::vector<std::string>& files)
+{
+	mCancelRefresh = true;
+	if(mRefreshJob.valid())
+		mRefreshJob.wait();
+	mCancelRefresh = false;
+
+	// drop entries of deleted replays right away, so they never show up in a query
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		std::unordered_set<std::string> existing(files.begin(), files.end());
+		std::vector<bool> keep(mRecords.size());
+		for(unsigned i = 0; i < mRecords.size(); ++i)
+		{
+			keep[i] = existing.count(getString(mRecords[i].file)) != 0;
+		}
+		removeRecords(keep);
+	}
+
+	// we need the explicit async launch policy here, see NetworkSearchState::searchServers
+	mRefreshJob = std::async(std::launch::async, [this, files](){ doRefresh(files); });
+}
+
+bool ReplayIndex::isRefreshing() const
+{
+	return mRefreshJob.valid() &&
+		mRefreshJob.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+}
+
+unsigned ReplayIndex::getRevision() const
+{
+	return mRevision;
+}
+
+void ReplayIndex::doRefresh(std::vector<std::string> files)
+{
+	bool changed = false;
+	for(const auto& file : files)
+	{
+		if(mCancelRefresh)
+			break;
+
+		int64_t modTime;
+		try
+		{
+			modTime = FileSystem::getSingleton().getModificationTime(mDirectory + "/" + file + ".bvr");
+		}
+		catch(std::exception& e)
+		{
+			continue;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			auto found = mRecordByFile.find(file);
+			if(found != mRecordByFile.end() && mRecords[found->second].modTime == modTime)
+				continue;
+		}
+
+		// the expensive part is done without holding the lock
+		Record record;
+		std::string names[MAX_PLAYERS];
+		if(!indexFile(file, modTime, record, names))
+			continue;
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		record.file = addString(file);
+		for(int i = 0; i < MAX_PLAYERS; ++i)
+		{
+			record.playerNames[i] = addString(names[i]);
+		}
+
+		auto found = mRecordByFile.find(file);
+		if(found != mRecordByFile.end())
+		{
+			mRecords[found->second] = record;
+		}
+		else
+		{
+			mRecordByFile[file] = mRecords.size();
+			mRecords.push_back(record);
+		}
+		++mRevision;
+		changed = true;
+	}
+
+	if(changed)
+		save();
+}
+
+bool ReplayIndex::indexFile(const std::string& file, int64_t modTime, Record& record, std::string (&names)[MAX_PLAYERS])
+{
+	try
+	{
+		boost::scoped_ptr<IReplayLoader> loader(IReplayLoader::createReplayLoader(mDirectory + "/" + file + ".bvr"));
+
+		record.modTime = modTime;
+		record.playerEnabled = 0;
+		for(int i = 0; i < MAX_PLAYERS; ++i)
+		{
+			if(loader->getPlayerEnabled(PlayerSide(i)))
+			{
+				record.playerEnabled |= 1 << i;
+				names[i] = loader->getPlayerName(PlayerSide(i));
+			}
+		}
+		record.finalScore[LEFT_SIDE] = loader->getFinalScore(LEFT_SIDE);
+		record.finalScore[RIGHT_SIDE] = loader->getFinalScore(RIGHT_SIDE);
+		record.speed = loader->getSpeed();
+		record.duration = loader->getDuration();
+		record.length = loader->getLength();
+		record.date = loader->getDate();
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << "Warning: could not index replay " << file << ": " << e.what() << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+std::vector<unsigned> ReplayIndex::query(const Filter& filter, SortKey key, bool descending) const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	auto winnerScore = [](const Record& r)
+	{
+		return std::max(r.finalScore[LEFT_SIDE], r.finalScore[RIGHT_SIDE]);
+	};
+
+	std::vector<unsigned> result;
+	for(unsigned i = 0; i < mRecords.size(); ++i)
+	{
+		const Record& record = mRecords[i];
+		if(record.date < filter.minDate || record.date > filter.maxDate)
+			continue;
+
+		int score = winnerScore(record);
+		if(score < filter.minScore || score > filter.maxScore)
+			continue;
+
+		if(!filter.player.empty())
+		{
+			bool found = false;
+			for(int p = 0; p < MAX_PLAYERS && !found; ++p)
+			{
+				found = (record.playerEnabled & (1 << p)) &&
+					boost::algorithm::icontains(getString(record.playerNames[p]), filter.player);
+			}
+			if(!found)
+				continue;
+		}
+
+		result.push_back(i);
+	}
+
+	auto less = [&](unsigned a, unsigned b)
+	{
+		const Record& ra = mRecords[a];
+		const Record& rb = mRecords[b];
+		switch(key)
+		{
+		case SORT_DATE:
+			return ra.date < rb.date;
+		case SORT_PLAYER:
+			return boost::algorithm::ilexicographical_compare(getString(ra.playerNames[LEFT_PLAYER]), getString(rb.playerNames[LEFT_PLAYER]));
+		case SORT_SCORE:
+			return winnerScore(ra) < winnerScore(rb);
+		case SORT_DURATION:
+			return ra.duration < rb.duration;
+		case SORT_FILENAME:
+		default:
+			return std::strcmp(getString(ra.file), getString(rb.file)) < 0;
+		}
+	};
+
+	if(descending)
+		std::stable_sort(result.begin(), result.end(), [&](unsigned a, unsigned b) { return less(b, a); });
+	else
+		std::stable_sort(result.begin(), result.end(), less);
+
+	return result;
+}
+
+ReplayIndex::Entry ReplayIndex::getEntry(unsigned index) const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return makeEntry(mRecords.at(index));
+}
+
+bool ReplayIndex::findEntry(const std::string& file, Entry& entry) const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	auto found = mRecordByFile.find(file);
+	if(found == mRecordByFile.end())
+		return false;
+
+	entry = makeEntry(mRecords[found->second]);
+	return true;
+}
+
+void ReplayIndex::removeEntry(const std::string& file)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	auto found = mRecordByFile.find(file);
+	if(found == mRecordByFile.end())
+		return;
+
+	std::vector<bool> keep(mRecords.size(), true);
+	keep[found->second] = false;
+	removeRecords(keep);
+}
+
+void ReplayIndex::removeRecords(const std::vector<bool>& keep)
+{
+	if(std::all_of(keep.begin(), keep.end(), [](bool k) { return k; }))
+		return;
+
+	std::vector<Record> records;
+	mRecordByFile.clear();
+	for(unsigned i = 0; i < mRecords.size(); ++i)
+	{
+		if(keep[i])
+		{
+			mRecordByFile[getString(mRecords[i].file)] = records.size();
+			records.push_back(mRecords[i]);
+		}
+	}
+	mRecords.swap(records);
+	++mRevision;
+}
+
+uint32_t ReplayIndex::addString(const std::string& str)
+{
+	if(mStrings.empty())
+		mStrings.push_back(0);
+
+	// offset 0 is always the empty string
+	if(str.empty())
+		return 0;
+
+	uint32_t offset = mStrings.size();
+	mStrings.insert(mStrings.end(), str.c_str(), str.c_str() + str.size() + 1);
+	return offset;
+}
+
+const char* ReplayIndex::getString(uint32_t offset) const
+{
+	if(offset >= mStrings.size())
+		return "";
+	return mStrings.data() + offset;
+}
+
+ReplayIndex::Entry ReplayIndex::makeEntry(const Record& record) const
+{
+	Entry entry;
+	entry.file = getString(record.file);
+	for(int i = 0; i < MAX_PLAYERS; ++i)
+	{
+		entry.playerEnabled[i] = record.playerEnabled & (1 << i);
+		entry.playerNames[i] = getString(record.playerNames[i]);
+	}
+	entry.finalScore[LEFT_SIDE] = record.finalScore[LEFT_SIDE];
+	entry.finalScore[RIGHT_SIDE] = record.finalScore[RIGHT_SIDE];
+	entry.speed = record.speed;
+	entry.duration = record.duration;
+	entry.length = record.length;
+	entry.date = record.date;
+	return entry;
+}
@@ -0,0 +1,165 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+/// \file ReplayIndex.h
+/// \brief contains the persistent replay metadata index used by the replay browser
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <ctime>
+#include <cstdint>
+#include <mutex>
+#include <future>
+#include <atomic>
+#include <limits>
+
+#include <boost/noncopyable.hpp>
+
+#include "Global.h"
+#include "BlobbyDebug.h"
+
+/*! \class ReplayIndex
+	\brief Sidecar table of replay header data
+	\details Caches the metadata of every replay in a directory (names, score, duration, date)
+			keyed by filename and modification time, so the replay browser never has to open
+			a replay just to show, sort or filter it. The table is stored as one block of fixed
+			size records followed by a string pool, so loading it is a single read without
+			any parsing.
+			refresh() updates the table incrementally on a background thread: only replays
+			that are new or whose modification time changed are opened. The result is written
+			back to disk when the refresh has finished or is cancelled.
+*/
+class ReplayIndex : public boost::noncopyable, public ObjectCounter<ReplayIndex>
+{
+	public:
+		/// criteria by which query() can order replays
+		enum SortKey
+		{
+			SORT_FILENAME,
+			SORT_DATE,
+			SORT_PLAYER,		///!< name of the first left player
+			SORT_SCORE,			///!< score of the winning side
+			SORT_DURATION
+		};
+
+		/// \brief restricts the results of query()
+		/// \details Default constructed, the filter accepts all replays.
+		struct Filter
+		{
+			/// case insensitive substring which must appear in at least one player name
+			std::string player;
+			std::time_t minDate = 0;
+			std::time_t maxDate = std::numeric_limits<std::time_t>::max();
+			/// range for the score of the winning side
+			int minScore = 0;
+			int maxScore = std::numeric_limits<int>::max();
+		};
+
+		/// metadata of one replay
+		struct Entry
+		{
+			std::string file;		///!< filename without directory and extension
+			bool playerEnabled[MAX_PLAYERS];
+			std::string playerNames[MAX_PLAYERS];
+			int finalScore[NUM_SIDES];
+			int speed;
+			int duration;
+			int length;
+			std::time_t date;
+		};
+
+		/// \brief loads the index of \p directory
+		/// \details If there is no index file yet or it is unreadable, the index starts out empty.
+		/// \param directory directory containing the replays, e.g. "replays"
+		explicit ReplayIndex(const std::string& directory);
+
+		/// cancels a running refresh and saves what has been indexed so far.
+		~ReplayIndex();
+
+		/// \brief brings the index up to date with the replay directory
+		/// \details Entries of files that are no longer in \p files are removed immediately,
+		///			the remaining files are checked on a background thread.
+		/// \param files all replay files in the directory, without extension
+		void refresh(const std::vector<std::string>& files);
+
+		/// returns whether the background refresh is still running
+		bool isRefreshing() const;
+
+		/// \brief counter that changes whenever entries are added, updated or removed
+		/// \details use this to find out whether a cached query() result is stale.
+		unsigned getRevision() const;
+
+		/// \brief gets the indices of all entries matching \p filter, ordered by \p key
+		/// \details The indices remain valid until the next call of refresh().
+		std::vector<unsigned> query(const Filter& filter, SortKey key, bool descending) const;
+
+		/// gets the metadata of the entry at \p index, as returned by query()
+		Entry getEntry(unsigned index) const;
+
+		/// \brief finds the entry of a replay file
+		/// \return false if the file has not been indexed (yet)
+		bool findEntry(const std::string& file, Entry& entry) const;
+
+		/// forgets the entry of \p file, e.g. after it has been deleted
+		void removeEntry(const std::string& file);
+
+	private:
+		/// on-disk layout of one entry. strings are stored as offsets into the string pool.
+		struct Record
+		{
+			int64_t modTime;
+			uint32_t file;
+			uint32_t playerNames[MAX_PLAYERS];
+			uint32_t playerEnabled;		///!< bit i is set if player i is enabled
+			uint32_t finalScore[NUM_SIDES];
+			uint32_t speed;
+			uint32_t duration;
+			uint32_t length;
+			uint32_t date;
+		};
+
+		void load();
+		void save();
+		void doRefresh(std::vector<std::string> files);
+
+		/// reads the header of a replay file into \p record
+		bool indexFile(const std::string& file, int64_t modTime, Record& record, std::string (&names)[MAX_PLAYERS]);
+
+		uint32_t addString(const std::string& str);
+		const char* getString(uint32_t offset) const;
+		Entry makeEntry(const Record& record) const;
+		void removeRecords(const std::vector<bool>& keep);
+
+		std::string mDirectory;
+		std::string mIndexFile;
+
+		// the table itself. mRecords and mStrings are exactly what is stored on disk.
+		std::vector<Record> mRecords;
+		std::vector<char> mStrings;
+		std::unordered_map<std::string, unsigned> mRecordByFile;
+
+		mutable std::mutex mMutex;
+		std::atomic<unsigned> mRevision;
+		std::atomic<bool> mCancelRefresh;
+		std::future<void> mRefreshJob;
+};
@@ -0,0 +1,437 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+/* header include */
+#include "ReplayInputCoder.h"
+
+/* includes */
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+#include "Global.h"
+#include "ReplayDefs.h"
+
+/* implementation */
+
+namespace
+{
+	const uint8_t STREAM_FORMAT = 1;
+	const int MAX_BYTES_PER_STEP = (MAX_PLAYERS + 1) / 2;
+	/// steps between two keyframes, chosen so each savepoint starts a block
+	const int KEYFRAME_PERIOD = REPLAY_SAVEPOINT_PERIOD;
+
+	// binary range coder as used by LZMA, with 11 bit probabilities
+	const int PROBABILITY_BITS = 11;
+	const uint16_t PROBABILITY_ONE = 1 << PROBABILITY_BITS;
+	const int ADAPTION_SHIFT = 5;
+	const uint32_t RANGE_TOP = 1 << 24;
+
+	class RangeEncoder
+	{
+		public:
+			static const bool ENCODER = true;
+
+			explicit RangeEncoder(std::vector<uint8_t>& target) :
+				mTarget(target), mLow(0), mRange(0xFFFFFFFF), mCache(0), mCacheSize(1), mFirstByte(true)
+			{
+			}
+
+			unsigned bit(uint16_t& probability, unsigned value)
+			{
+				uint32_t bound = (mRange >> PROBABILITY_BITS) * probability;
+				if (value == 0)
+				{
+					mRange = bound;
+					probability += (PROBABILITY_ONE - probability) >> ADAPTION_SHIFT;
+				}
+				else
+				{
+					mLow += bound;
+					mRange -= bound;
+					probability -= probability >> ADAPTION_SHIFT;
+				}
+
+				while (mRange < RANGE_TOP)
+				{
+					mRange <<= 8;
+					shiftLow();
+				}
+
+				return value;
+			}
+
+			void flush()
+			{
+				for (int i = 0; i < 5; ++i)
+					shiftLow();
+			}
+
+		private:
+			void shiftLow()
+			{
+				if ((uint32_t)mLow < 0xFF000000u || (mLow >> 32) != 0)
+				{
+					uint8_t carry = mLow >> 32;
+					uint8_t temp = mCache;
+					do
+					{
+						// the first byte is always zero, so we don't store it
+						if (!mFirstByte)
+							mTarget.push_back(temp + carry);
+						mFirstByte = false;
+						temp = 0xFF;
+					} while (--mCacheSize != 0);
+					mCache = (uint8_t)(mLow >> 24);
+				}
+				++mCacheSize;
+				mLow = (mLow & 0x00FFFFFF) << 8;
+			}
+
+			std::vector<uint8_t>& mTarget;
+			uint64_t mLow;
+			uint32_t mRange;
+			uint8_t mCache;
+			uint64_t mCacheSize;
+			bool mFirstByte;
+	};
+
+	class RangeDecoder
+	{
+		public:
+			static const bool ENCODER = false;
+
+			RangeDecoder(const uint8_t* begin, const uint8_t* end) :
+				mPosition(begin), mEnd(end), mRange(0xFFFFFFFF), mCode(0)
+			{
+				for (int i = 0; i < 4; ++i)
+					mCode = (mCode << 8) | next();
+			}
+
+			/// decodes a bit, the value is ignored
+			unsigned bit(uint16_t& probability, unsigned value)
+			{
+				uint32_t bound = (mRange >> PROBABILITY_BITS) * probability;
+				if (mCode < bound)
+				{
+					mRange = bound;
+					probability += (PROBABILITY_ONE - probability) >> ADAPTION_SHIFT;
+					value = 0;
+				}
+				else
+				{
+					mCode -= bound;
+					mRange -= bound;
+					probability -= probability >> ADAPTION_SHIFT;
+					value = 1;
+				}
+
+				while (mRange < RANGE_TOP)
+				{
+					mRange <<= 8;
+					mCode = (mCode << 8) | next();
+				}
+
+				return value;
+			}
+
+		private:
+			uint8_t next()
+			{
+				return mPosition < mEnd ? *mPosition++ : 0;
+			}
+
+			const uint8_t* mPosition;
+			const uint8_t* mEnd;
+			uint32_t mRange;
+			uint32_t mCode;
+	};
+
+	/// adaptive probabilities, reset at every keyframe
+	struct InputModel
+	{
+		InputModel()
+		{
+			std::fill_n(&runLength[0], sizeof(*this) / sizeof(uint16_t), PROBABILITY_ONE / 2);
+		}
+
+		uint16_t runLength[32];							///!< unary coded number of bits of a run
+		uint16_t runBits[32];							///!< bits of a run
+		uint16_t changed[MAX_BYTES_PER_STEP];			///!< whether a byte differs from the previous step
+		uint16_t flags[MAX_BYTES_PER_STEP][2][2];		///!< bits 7 and 6 of a byte, by their previous value
+		uint16_t inputs[MAX_BYTES_PER_STEP][2][8][8];	///!< 3 bit player input, by its previous value
+	};
+
+	// the following functions are used for both encoding and decoding: the encoder codes and returns
+	// the value passed in, the decoder ignores it and returns the decoded value instead.
+
+	/// codes run + 1 as Elias gamma code with adaptive bits
+	template<class Coder>
+	unsigned codeRun(Coder& coder, InputModel& model, unsigned run)
+	{
+		uint32_t value = run + 1;
+		int bits = 0;
+		while ((value >> (bits + 1)) != 0)
+			++bits;
+
+		int length = 0;
+		while (length < 31 && coder.bit(model.runLength[length], length < bits))
+			++length;
+
+		uint32_t result = 1;
+		for (int i = length - 1; i >= 0; --i)
+			result = (result << 1) | coder.bit(model.runBits[i], (value >> i) & 1);
+
+		return result - 1;
+	}
+
+	/// codes a 3 bit player input as binary tree
+	template<class Coder>
+	unsigned codeInput(Coder& coder, uint16_t* probabilities, unsigned value)
+	{
+		unsigned node = 1;
+		for (int i = 2; i >= 0; --i)
+			node = (node << 1) | coder.bit(probabilities[node], (value >> i) & 1);
+		return node - 8;
+	}
+
+	template<class Coder>
+	uint8_t codeByte(Coder& coder, InputModel& model, int slot, uint8_t previous, uint8_t value)
+	{
+		unsigned marker = coder.bit(model.flags[slot][0][previous >> 7], value >> 7);
+		unsigned unused = coder.bit(model.flags[slot][1][(previous >> 6) & 1], (value >> 6) & 1);
+		unsigned first = codeInput(coder, model.inputs[slot][0][(previous >> 3) & 7], (value >> 3) & 7);
+		unsigned second = codeInput(coder, model.inputs[slot][1][previous & 7], value & 7);
+		return marker << 7 | unused << 6 | first << 3 | second;
+	}
+
+	/// codes the steps of one keyframe block
+	template<class Coder>
+	void codeBlock(Coder& coder, uint8_t* data, int steps, int bytesPerStep)
+	{
+		InputModel model;
+
+		// a keyframe starts without any previous input
+		const uint8_t noInput[MAX_BYTES_PER_STEP] = {};
+		const uint8_t* previous = noInput;
+
+		int step = 0;
+		while (step < steps)
+		{
+			// steps repeating the previous one
+			unsigned run = 0;
+			if (Coder::ENCODER)
+			{
+				while (step + (int)run < steps &&
+						std::equal(previous, previous + bytesPerStep, data + (step + run) * bytesPerStep))
+				{
+					++run;
+				}
+			}
+			run = std::min<unsigned>(codeRun(coder, model, run), steps - step);
+
+			for (unsigned i = 0; i < run; ++i, ++step)
+				std::copy(previous, previous + bytesPerStep, data + step * bytesPerStep);
+
+			if (step == steps)
+				break;
+
+			// followed by a changed step
+			uint8_t* current = data + step * bytesPerStep;
+			for (int slot = 0; slot < bytesPerStep; ++slot)
+			{
+				if (coder.bit(model.changed[slot], current[slot] != previous[slot]))
+					current[slot] = codeByte(coder, model, slot, previous[slot], current[slot]);
+				else
+					current[slot] = previous[slot];
+			}
+
+			previous = current;
+			++step;
+		}
+	}
+
+	void writeNumber(std::vector<uint8_t>& target, uint32_t number)
+	{
+		while (number >= 0x80)
+		{
+			target.push_back((number & 0x7F) | 0x80);
+			number >>= 7;
+		}
+		target.push_back(number);
+	}
+
+	uint32_t readNumber(const std::vector<uint8_t>& source, std::size_t& position)
+	{
+		uint32_t number = 0;
+		for (int shift = 0; shift < 32; shift += 7)
+		{
+			if (position >= source.size())
+				throw std::runtime_error("replay input stream is truncated");
+
+			uint8_t byte = source[position++];
+			number |= (uint32_t)(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0)
+				return number;
+		}
+
+		throw std::runtime_error("invalid number in replay input stream");
+	}
+}
+
+/*
+	stream layout:
+		format byte
+		length of the input in bytes
+		bytes per step
+		keyframe period in steps
+		number of blocks, followed by the coded size of each block
+		coded blocks
+	all numbers except the bytes are stored with 7 bits per byte, least significant first.
+*/
+
+std::vector<uint8_t> encodeReplayInput(const std::vector<uint8_t>& input, int bytesPerStep)
+{
+	assert(bytesPerStep > 0 && bytesPerStep <= MAX_BYTES_PER_STEP);
+
+	// we work on a copy padded to full steps
+	int steps = (input.size() + bytesPerStep - 1) / bytesPerStep;
+	std::vector<uint8_t> data(input);
+	data.resize(steps * bytesPerStep, 0);
+
+	std::vector<uint8_t> blocks;
+	std::vector<uint32_t> blockSizes;
+	for (int start = 0; start < steps; start += KEYFRAME_PERIOD)
+	{
+		std::size_t blockStart = blocks.size();
+
+		RangeEncoder encoder(blocks);
+		codeBlock(encoder, &data[start * bytesPerStep], std::min(KEYFRAME_PERIOD, steps - start), bytesPerStep);
+		encoder.flush();
+
+		blockSizes.push_back(blocks.size() - blockStart);
+	}
+
+	std::vector<uint8_t> stream;
+	stream.push_back(STREAM_FORMAT);
+	writeNumber(stream, input.size());
+	stream.push_back(bytesPerStep);
+	writeNumber(stream, KEYFRAME_PERIOD);
+	writeNumber(stream, blockSizes.size());
+	for (auto size : blockSizes)
+		writeNumber(stream, size);
+	stream.insert(stream.end(), blocks.begin(), blocks.end());
+
+	return stream;
+}
+
+ReplayInputDecoder::ReplayInputDecoder() :
+	mLength(0), mBytesPerStep(1), mBlockSize(1), mCurrentBlock(-1)
+{
+}
+
+void ReplayInputDecoder::load(const std::vector<uint8_t>& stream)
+{
+	std::size_t position = 0;
+	if (stream.size() < 3 || stream[position++] != STREAM_FORMAT)
+		throw std::runtime_error("unknown replay input format");
+
+	mLength = readNumber(stream, position);
+
+	if (position >= stream.size())
+		throw std::runtime_error("replay input stream is truncated");
+	mBytesPerStep = stream[position++];
+	if (mBytesPerStep < 1 || mBytesPerStep > MAX_BYTES_PER_STEP)
+		throw std::runtime_error("invalid bytes per step in replay input stream");
+
+	uint32_t period = readNumber(stream, position);
+	if (period == 0 || period > (1u << 20))
+		throw std::runtime_error("invalid keyframe period in replay input stream");
+	mBlockSize = period * mBytesPerStep;
+
+	uint32_t blocks = readNumber(stream, position);
+	uint32_t steps = ((uint32_t)mLength + mBytesPerStep - 1) / mBytesPerStep;
+	if (blocks != (steps + period - 1) / period)
+		throw std::runtime_error("invalid block count in replay input stream");
+
+	std::vector<uint32_t> sizes;
+	for (uint32_t i = 0; i < blocks; ++i)
+		sizes.push_back(readNumber(stream, position));
+
+	mBlockOffsets.clear();
+	uint32_t offset = 0;
+	for (auto size : sizes)
+	{
+		mBlockOffsets.push_back(offset);
+		offset += size;
+		if (offset > stream.size() - position)
+			throw std::runtime_error("replay input stream is truncated");
+	}
+	mBlockOffsets.push_back(offset);
+
+	mStream.assign(stream.begin() + position, stream.begin() + position + offset);
+	mCurrentBlock = -1;
+	mBlock.clear();
+}
+
+void ReplayInputDecoder::loadRaw(std::vector<uint8_t> input)
+{
+	mLength = input.size();
+	mBytesPerStep = 1;
+	mBlockSize = std::max(mLength, 1);
+	mStream.clear();
+	mBlockOffsets.clear();
+
+	// everything is in the first block
+	mBlock.swap(input);
+	mCurrentBlock = 0;
+}
+
+uint8_t ReplayInputDecoder::getByte(int position) const
+{
+	assert(position >= 0 && position < mLength);
+
+	int block = position / mBlockSize;
+	if (block != mCurrentBlock)
+		decodeBlock(block);
+
+	return mBlock[position - block * mBlockSize];
+}
+
+int ReplayInputDecoder::getLength() const
+{
+	return mLength;
+}
+
+void ReplayInputDecoder::decodeBlock(int block) const
+{
+	int blockSteps = mBlockSize / mBytesPerStep;
+	int totalSteps = (mLength + mBytesPerStep - 1) / mBytesPerStep;
+	int steps = std::min(blockSteps, totalSteps - block * blockSteps);
+
+	mBlock.assign(blockSteps * mBytesPerStep, 0);
+
+	const uint8_t* begin = mStream.data() + mBlockOffsets[block];
+	const uint8_t* end = mStream.data() + mBlockOffsets[block + 1];
+	RangeDecoder decoder(begin, end);
+	codeBlock(decoder, mBlock.data(), steps, mBytesPerStep);
+
+	mCurrentBlock = block;
+}
@@ -0,0 +1,73 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "BlobbyDebug.h"
+
+/// \brief compresses the input recorded by ReplayRecorder
+/// \details Steps which repeat the previous step are run length coded, changed steps are
+///			coded with an adaptive binary range coder which models each 3 bit player input
+///			in the context of its previous value. Every REPLAY_SAVEPOINT_PERIOD steps, a keyframe
+///			resets the coder, so decoding can start there.
+/// \param input recorded input, bytesPerStep bytes for each physic step
+/// \param bytesPerStep number of bytes for each step
+std::vector<uint8_t> encodeReplayInput(const std::vector<uint8_t>& input, int bytesPerStep);
+
+/*! \class ReplayInputDecoder
+	\brief gives access to the recorded input of a replay
+	\details Input created by encodeReplayInput is decoded one keyframe block at a time, so
+			reading it sequentially is cheap and seeking only has to decode the target block.
+			Uncoded input of older replays can be used through the same interface.
+*/
+class ReplayInputDecoder : public ObjectCounter<ReplayInputDecoder>
+{
+	public:
+		ReplayInputDecoder();
+
+		/// \brief uses input created by encodeReplayInput
+		/// \exception std::runtime_error if the stream is malformed
+		void load(const std::vector<uint8_t>& stream);
+
+		/// \brief uses input as it was recorded by ReplayRecorder
+		void loadRaw(std::vector<uint8_t> input);
+
+		/// gets the input byte at position, as recorded by ReplayRecorder
+		uint8_t getByte(int position) const;
+
+		/// gets the length of the input in bytes
+		int getLength() const;
+
+	private:
+		void decodeBlock(int block) const;
+
+		std::vector<uint8_t> mStream;
+		std::vector<uint32_t> mBlockOffsets;	///!< start of each keyframe block in mStream
+		int mLength;
+		int mBytesPerStep;
+		int mBlockSize;							///!< length of a keyframe block in bytes
+
+		// currently decoded block
+		mutable int mCurrentBlock;
+		mutable std::vector<uint8_t> mBlock;
+};
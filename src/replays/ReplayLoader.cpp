@@ -39,6 +39,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "GenericIO.h"
 #include "base64.h"
 #include "ReplayDefs.h"
+#include "ReplayInputCoder.h"
 #include "UserConfig.h"
 
 /* implementation */
@@ -61,7 +62,7 @@ IReplayLoader* IReplayLoader::createReplayLoader(const std::string& filename)
 
 /*! \class ReplayLoader_V2X
 	\brief Replay Loader V 2.x
-	\details Replay Loader for 2.0 replays
+	\details Replay Loader for 2.0 and 2.1 replays
 */
 class ReplayLoader_V2X: public IReplayLoader
 {
@@ -71,7 +72,7 @@ class ReplayLoader_V2X: public IReplayLoader
 		virtual ~ReplayLoader_V2X() { };
 
 		virtual int getVersionMajor() const override { return 2; };
-		virtual int getVersionMinor() const override { return 0; };
+		virtual int getVersionMinor() const override { return mReplayFormatVersion; };
 
 		virtual std::string getPlayerName(PlayerSide player) const override
 		{
@@ -134,6 +135,7 @@ class ReplayLoader_V2X: public IReplayLoader
 
 		virtual std::string getRules() const override
 		{
+			loadData();
 			return mRules;
 		}
 
@@ -142,12 +144,11 @@ class ReplayLoader_V2X: public IReplayLoader
 		{
 			assert( step  < mGameLength );
 
-			// for now, we have only a linear sequence of InputPackets, so finding the right one is just
-			// a matter of address arithmetics.
+			loadData();
 
 			// each packet has size 1 byte for now
 			// so we find step at mReplayOffset + step
-			char packet = mBuffer[mReplayOffset + step];
+			char packet = mInput.getByte(mReplayOffset + step);
 
 			// now read the packet data
 			if (first)
@@ -169,6 +170,8 @@ class ReplayLoader_V2X: public IReplayLoader
 		// 		we can save this parameter in ReplayPlayer
 		virtual int getSavePoint(int targetPosition, int& savepoint) const override
 		{
+			loadData();
+
 			// desired index can't be lower that this value,
 			// cause additional savepoints could shift it only right
 			int index = targetPosition / (REPLAY_SAVEPOINT_PERIOD * mBytesPerStep);
@@ -204,25 +207,87 @@ class ReplayLoader_V2X: public IReplayLoader
 
 		virtual void readSavePoint(int index, ReplaySavePoint& state) const override
 		{
+			loadData();
 			state = mSavePoints.at(index);
 		}
 
 	private:
 		void initLoading(std::string filename) override
 		{
-			std::shared_ptr<TiXmlDocument> configDoc = FileRead::readXMLDocument(filename);
+			mFilename = filename;
 
-			if (configDoc->Error())
+			// the header (version and vars) is written in front of the rules, input and
+			// states sections, which make up nearly all of the file. so we only read
+			// up to the <rules> tag and parse that, the rest is loaded in loadData
+			// once someone actually needs it.
+			std::string header = readHeader(filename);
+
+			TiXmlDocument headerDoc;
+			if(!header.empty())
+			{
+				header += "</replay>";
+				headerDoc.Parse(header.c_str());
+			}
+
+			if(header.empty() || headerDoc.Error())
+			{
+				// not the layout ReplayRecorder writes, so we fall back to parsing everything now
+				std::shared_ptr<TiXmlDocument> configDoc = FileRead::readXMLDocument(filename);
+				parseHeader(*configDoc, filename);
+				parseData(*configDoc, filename);
+				return;
+			}
+
+			parseHeader(headerDoc, filename);
+		}
+
+		/// reads the beginning of the replay file up to the <rules> tag.
+		/// \return the header, or an empty string if no <rules> tag has been found
+		static std::string readHeader(const std::string& filename)
+		{
+			const std::size_t CHUNK_SIZE = 1024;
+			const char RULES_TAG[] = "<rules>";
+
+			FileRead file(filename);
+			std::size_t remaining = file.length();
+
+			std::string header;
+			char buffer[CHUNK_SIZE];
+			while( remaining > 0 )
+			{
+				std::size_t count = std::min(remaining, CHUNK_SIZE);
+				file.readRawBytes(buffer, count);
+				remaining -= count;
+
+				// the tag may start in the previous chunk
+				std::size_t searchStart = header.size() < sizeof(RULES_TAG) ? 0 : header.size() - sizeof(RULES_TAG);
+				header.append(buffer, count);
+
+				std::size_t pos = header.find(RULES_TAG, searchStart);
+				if( pos != std::string::npos )
+				{
+					header.resize(pos);
+					return header;
+				}
+			}
+
+			return "";
+		}
+
+		/// reads the version and the game attributes
+		void parseHeader(const TiXmlDocument& doc, const std::string& filename)
+		{
+			if (doc.Error())
 			{
 				std::cerr << "Warning: Parse error in " << filename << "!" << std::endl;
 				throw( std::runtime_error("") );
 			}
 
-			TiXmlElement* userConfigElem = configDoc->FirstChildElement("replay");
+			const TiXmlElement* userConfigElem = doc.FirstChildElement("replay");
 			if (userConfigElem == nullptr)
 				throw(std::runtime_error("No <replay> node found!"));
 
-			TiXmlElement* varElem = userConfigElem->FirstChildElement("version");
+			const TiXmlElement* varElem = userConfigElem->FirstChildElement("version");
 			// the first element we find is expected to be the version
 			if(!varElem)
 			{
@@ -291,9 +356,34 @@ class ReplayLoader_V2X: public IReplayLoader
 					mPlayersCount++;
 			}
 			mBytesPerStep = (mPlayersCount + 1) / 2;
+		}
+
+		/// loads rules, input and savepoints if that has not happened yet.
+		/// \details This is not thread safe, a loader must not be shared between threads.
+		void loadData() const
+		{
+			if(mDataLoaded)
+				return;
+
+			std::shared_ptr<TiXmlDocument> configDoc = FileRead::readXMLDocument(mFilename);
+			if (configDoc->Error())
+			{
+				std::cerr << "Warning: Parse error in " << mFilename << "!" << std::endl;
+				throw( std::runtime_error("") );
+			}
+
+			parseData(*configDoc, mFilename);
+		}
+
+		/// reads rules, input and savepoints
+		void parseData(const TiXmlDocument& doc, const std::string& filename) const
+		{
+			const TiXmlElement* userConfigElem = doc.FirstChildElement("replay");
+			if (userConfigElem == nullptr)
+				throw(std::runtime_error("No <replay> node found!"));
 
 			// load rules
-			varElem = userConfigElem->FirstChildElement("rules");
+			const TiXmlElement* varElem = userConfigElem->FirstChildElement("rules");
 			if(!varElem)
 				throw(std::runtime_error(""));
 			auto content = varElem->FirstChild();
@@ -310,7 +400,11 @@ class ReplayLoader_V2X: public IReplayLoader
 			if(!content)
 				throw(std::runtime_error(""));
 
-			mBuffer = decode(content->Value());
+			// since 2.1, the input is entropy coded
+			if(mReplayFormatVersion >= 1)
+				mInput.load(decode(content->Value()));
+			else
+				mInput.loadRaw(decode(content->Value()));
 
 			varElem = userConfigElem->FirstChildElement("states");
 			if(!varElem)
@@ -324,13 +418,19 @@ class ReplayLoader_V2X: public IReplayLoader
 			RakNet::BitStream temp( sp.data(), sp.size(), false );
 			auto convert = createGenericReader(&temp);
 			convert->generic<std::vector<ReplaySavePoint> > (mSavePoints);
+
+			mDataLoaded = true;
 		}
 
 
-		std::vector<uint8_t> mBuffer;
-		uint32_t mReplayOffset;
+		std::string mFilename;
+
+		// these are loaded on first use by loadData
+		mutable bool mDataLoaded = false;
+		mutable ReplayInputDecoder mInput;
+		uint32_t mReplayOffset = 0;
 
-		std::vector<ReplaySavePoint> mSavePoints;
+		mutable std::vector<ReplaySavePoint> mSavePoints;
 
 		// specific data
 		std::string mPlayerNames[MAX_PLAYERS];		
@@ -346,7 +446,7 @@ class ReplayLoader_V2X: public IReplayLoader
 		unsigned int mPlayersCount;
 		unsigned int mBytesPerStep;		
 
-		std::string mRules;
+		mutable std::string mRules;
 
 		unsigned char mReplayFormatVersion;
 };
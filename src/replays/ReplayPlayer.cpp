@@ -84,6 +84,11 @@ int ReplayPlayer::getBytesPerStep() const
 	return loader->getBytesPerStep();
 }
 
+int ReplayPlayer::getFinalScore(const PlayerSide side) const
+{
+	return loader->getFinalScore(side);
+}
+
 float ReplayPlayer::getPlayProgress() const
 {
 	return (float)mPosition / mLength;
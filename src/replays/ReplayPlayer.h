@@ -56,6 +56,8 @@ class ReplayPlayer : public ObjectCounter<ReplayPlayer>
 		int getGameSpeed() const;
 		int getPlayersCount() const;
 		int getBytesPerStep() const;
+		/// score at the end of the recorded game
+		int getFinalScore(const PlayerSide side) const;
 
 		// -----------------------------------------------------------------------------------------
 		// 							Status information
@@ -37,6 +37,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "Global.h"
 #include "ReplayDefs.h"
+#include "ReplayInputCoder.h"
 #include "IReplayLoader.h"
 #include "PhysicState.h"
 #include "GenericIO.h"
@@ -127,7 +128,7 @@ void ReplayRecorder::save( std::shared_ptr<FileWrite> file) const
 
 	// now comes the actual replay data
 	file->write("\t<input>\n");
-	std::string binary = encode(mSaveData, 80);
+	std::string binary = encode(encodeReplayInput(mSaveData, mBytesPerStep), 80);
 	file->write(binary);
 	file->write("\n\t</input>\n");
 
@@ -181,15 +182,17 @@ void ReplayRecorder::receive(std::shared_ptr<GenericIn> source)
 	unsigned playerEnabledBit = 0;
 	source->uint32(playerEnabledBit);
 
+	bool playerEnabled[MAX_PLAYERS];
 	for (int i = 0; i < MAX_PLAYERS; ++i)
 	{
-		mPlayerEnabled[i] = (bool)(playerEnabledBit & (1 << i));
-		if (mPlayerEnabled[i])
+		playerEnabled[i] = (bool)(playerEnabledBit & (1 << i));
+		if (playerEnabled[i])
 		{
 			source->string(mPlayerNames[i]);
 			source->generic<Color> (mPlayerColors[i]);			
 		}
 	}	
+	setPlayerEnabled(playerEnabled);
 
 	source->uint32( mGameSpeed );
 	source->uint32( mEndScore[LEFT_SIDE] );
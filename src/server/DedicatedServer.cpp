@@ -29,6 +29,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "NetworkMessage.h"
 #include "NetworkGame.h"
+#include "SpectatorFeed.h"
 #include "GenericIO.h"
 
 #ifndef WIN32
@@ -52,6 +53,8 @@ DedicatedServer::DedicatedServer(const ServerInfo& info,
 , mAcceptNewPlayers(true)
 , mPlayerHosted( local_server )
 , mServerInfo(info)
+, mGameIDCounter(0)
+, mSpectators(*mServer)
 {
 	if (!mServer->Start(max_clients, 1, mServerInfo.port))
 	{
@@ -97,6 +100,7 @@ void DedicatedServer::queuePackets()
 			case ID_ENTER_SERVER:
 			case ID_LOBBY:
 			case ID_BLOBBY_SERVER_PRESENT:
+			case ID_SPECTATE:
 			{
 				std::lock_guard<std::mutex> lock( mPacketQueueMutex );
 				mPacketQueue.push_back( packet );
@@ -164,6 +168,7 @@ void DedicatedServer::processPackets()
 			case ID_DISCONNECTION_NOTIFICATION:
 			{
 				mConnectedClients--;
+				mSpectators.removeSpectator(packet->playerId);
 
 				auto player = mPlayerMap.find(packet->playerId);
 				// delete the disconnecting player
@@ -231,6 +236,11 @@ void DedicatedServer::processPackets()
 				processBlobbyServerPresent( packet );
 				break;
 			}
+			case ID_SPECTATE:
+			{
+				processSpectate( packet );
+				break;
+			}
 			default:
 				syslog(LOG_DEBUG, "Unknown packet %d received\n", int(packet->data[0]));
 		}
@@ -259,6 +269,7 @@ void DedicatedServer::updateGames()
 	}
 
 	// remove dead games from gamelist
+	bool removedGames = false;
 	for (auto iter = mGameList.begin(); iter != mGameList.end();  )
 	{
 		if (!(*iter)->isGameValid())
@@ -266,12 +277,19 @@ void DedicatedServer::updateGames()
 			syslog( LOG_DEBUG, "Removed game \"%s\" from gamelist",
 					(*iter)->getGameName().c_str());
 			iter = mGameList.erase(iter);
+			removedGames = true;
 		}
 		 else
 		{
 			++iter;
 		}
 	}
+
+	if( removedGames )
+	{
+		updateRunningGames();
+		mMatchMaker.broadcastOpenGameList();
+	}
 }
 
 bool DedicatedServer::hasActiveGame() const
@@ -399,7 +417,7 @@ void DedicatedServer::createGame(std::shared_ptr<NetworkPlayer> players[MAX_PLAY
 								bool switchSide[MAX_PLAYERS], 
 								std::string rules, int scoreToWin, float gamespeed)
 {
-	auto newgame = std::make_shared<NetworkGame>(*mServer.get(), players, playerEnabled, switchSide, rules, scoreToWin, gamespeed);
+	auto newgame = std::make_shared<NetworkGame>(*mServer.get(), mGameIDCounter++, players, playerEnabled, switchSide, rules, scoreToWin, gamespeed);
 	
 	SWLS_Games++;
 
@@ -414,5 +432,44 @@ void DedicatedServer::createGame(std::shared_ptr<NetworkPlayer> players[MAX_PLAY
 	/// \todo add some logging?
 	syslog(LOG_DEBUG, "Created game \"%s\", rules:%s", newgame->getGameName().c_str(), rules.c_str());
 	mGameList.push_back(newgame);
+	mSpectators.addFeed(newgame->getSpectatorFeed());
+
+	// the match maker broadcasts the new list when it removes the open game
+	updateRunningGames();
+}
+
+void DedicatedServer::updateRunningGames()
+{
+	std::map<unsigned, std::string> games;
+	for (const auto& game : mGameList)
+	{
+		if (game->isGameValid())
+			games[game->getID()] = game->getGameName();
+	}
+	mMatchMaker.setRunningGames(games);
+}
+
+void DedicatedServer::processSpectate( const packet_ptr& packet )
+{
+	RakNet::BitStream stream(packet->data, packet->length, false);
+	stream.IgnoreBytes(1);	// ID_SPECTATE
+
+	unsigned gameID;
+	if( !stream.Read(gameID) )
+		return;
+
+	for (const auto& game : mGameList)
+	{
+		if (game->getID() == gameID && game->isGameValid())
+		{
+			// spectators do not wait for a game anymore
+			mMatchMaker.removePlayer(packet->playerId);
+			game->getSpectatorFeed()->addSpectator(packet->playerId);
+			syslog(LOG_DEBUG, "%s is spectating game \"%s\"", packet->playerId.toString().c_str(), game->getGameName().c_str());
+			return;
+		}
+	}
+
+	syslog(LOG_DEBUG, "%s tried to spectate game %u which does not exist (anymore?)", packet->playerId.toString().c_str(), gameID);
 }
 
@@ -31,6 +31,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "NetworkPlayer.h"
 #include "NetworkMessage.h"
 #include "server/MatchMaker.h"
+#include "server/SpectatorBroadcaster.h"
 
 class RakServer;
 
@@ -80,10 +81,13 @@ class DedicatedServer
 	private:
 		// packet handling functions / utility functions
 		void processBlobbyServerPresent( const packet_ptr& packet );
+		void processSpectate( const packet_ptr& packet );
 		// creates a new game with those players
 		// does not add the game to the active game list
 		void createGame(std::shared_ptr<NetworkPlayer> players[MAX_PLAYERS], bool playerEnabled[MAX_PLAYERS],
 			bool switchSide[MAX_PLAYERS], std::string rules, int scoreToWin, float gamespeed);
+		// tells the match maker which games can be spectated
+		void updateRunningGames();
 		// broadcasts the current server  status to all waiting clients
 
 		// member variables
@@ -102,6 +106,7 @@ class DedicatedServer
 
 		// containers for all games and mapping players to their games
 		std::list< std::shared_ptr<NetworkGame> > mGameList;
+		unsigned mGameIDCounter;
 		std::map< PlayerID, std::shared_ptr<NetworkPlayer>> mPlayerMap;
 		std::mutex mPlayerMapMutex;
 
@@ -110,4 +115,7 @@ class DedicatedServer
 		std::mutex mPacketQueueMutex;
 
 		MatchMaker mMatchMaker;
+
+		// sends the running games to their spectators
+		SpectatorBroadcaster mSpectators;
 };
@@ -389,6 +389,17 @@ void MatchMaker::sendOpenGameList( PlayerID recipient )
 	out->generic<std::vector<unsigned char>>( dGameRules );
 	out->generic<std::vector<unsigned char>>( dGameScores );
 
+	// games that can be spectated
+	std::vector<unsigned int> dRunningIDs;
+	std::vector<std::string> dRunningNames;
+	for( const auto& game : mRunningGames )
+	{
+		dRunningIDs.push_back( game.first );
+		dRunningNames.push_back( game.second );
+	}
+	out->generic<std::vector<unsigned int>>( dRunningIDs );
+	out->generic<std::vector<std::string>>( dRunningNames );
+
 	// send the packet
 	mSendPacket( stream, recipient );
 }
@@ -504,3 +515,8 @@ void MatchMaker::setAllowNewGames( bool allow )
 {
 	mAllowNewGames = allow;
 }
+
+void MatchMaker::setRunningGames( const std::map<unsigned, std::string>& games )
+{
+	mRunningGames = games;
+}
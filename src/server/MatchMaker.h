@@ -64,6 +64,8 @@ public:
 	void addGameSpeedOption( int speed );
 	void addRuleOption( const std::string& file );
 	void setAllowNewGames( bool allow );
+	/// sets the games that are currently played and can be spectated. Does not broadcast the change.
+	void setRunningGames( const std::map<unsigned, std::string>& games );
 
 	// info functions
 	unsigned getOpenGamesCount() const;
@@ -112,6 +114,9 @@ private:
 	std::map<unsigned, OpenGame> mOpenGames;
 	unsigned int mIDCounter = 0;
 
+	// running games (id -> name)
+	std::map<unsigned, std::string> mRunningGames;
+
 	// waiting player map
 	std::map< PlayerID, std::shared_ptr<NetworkPlayer>> mPlayerMap;
 
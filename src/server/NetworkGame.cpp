@@ -41,17 +41,28 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "PhysicWorld.h"
 #include "NetworkPlayer.h"
 #include "InputSource.h"
+#include "SpectatorFeed.h"
+#include "IScriptableComponent.h"
+
+#ifndef WIN32
+#ifndef __ANDROID__
+#include <sys/syslog.h>
+#endif
+#endif
 
 extern int SWLS_GameSteps;
 
+void syslog(int pri, const char* format, ...);
+
 /* implementation */
 
-NetworkGame::NetworkGame(RakServer& server, 
+NetworkGame::NetworkGame(RakServer& server, unsigned id,
 		std::shared_ptr<NetworkPlayer> players[MAX_PLAYERS],
 		bool playerEnabled[MAX_PLAYERS],
 		bool switchedSide[MAX_PLAYERS],
 		std::string rules, int scoreToWin, float speed) :
-	mServer(server),	
+	mServer(server),
+	mID(id),
 	mSpeedController(speed),
 	mMatch(new DuelMatch(false, rules, playerEnabled, scoreToWin)),	
 	mRecorder(new ReplayRecorder()),
@@ -111,6 +122,25 @@ NetworkGame::NetworkGame(RakServer& server,
 	mRulesLength = file.length();
 	mRulesString = file.readRawBytes(mRulesLength);
 
+	// match description for spectators
+	RakNet::BitStream header;
+	header.Write((unsigned char)ID_SPECTATE);
+	auto out = createGenericWriter(&header);
+	out->uint32(mID);
+	out->uint32(playerEnabledBit);
+	for (int i = 0; i < MAX_PLAYERS; ++i)
+	{
+		if (playerEnabled[i])
+		{
+			out->string(playerNames[i]);
+			out->generic<Color>(playerColors[i]);
+		}
+	}
+	out->uint32(mSpeedController.getGameSpeed());
+	out->uint32(mMatch->getScoreToWin());
+	out->string(std::string(mRulesString.get(), mRulesLength));
+	mSpectatorFeed = std::make_shared<SpectatorFeed>(header);
+
 	// writing rules checksum
 	RakNet::BitStream stream;
 		
@@ -148,6 +178,14 @@ NetworkGame::NetworkGame(RakServer& server,
 				SWLS_GameSteps++;
 				mSpeedController.update();
 			}
+			mSpectatorFeed->close();
+
+			ScriptStats stats;
+			if (mMatch->getRulesScriptStats(stats))
+			{
+				syslog(LOG_DEBUG, "Game %u rules script: %u calls, %u errors, %.1f ms (max %.2f ms), gc %.1f ms, peak memory %d KiB",
+						mID, stats.calls, stats.errors, stats.callTime, stats.maxCallTime, stats.gcTime, int(stats.peakMemory / 1024));
+			}
 		});
 }
 
@@ -505,6 +543,7 @@ void NetworkGame::step()
 	if(!mMatch->isPaused())
 	{
 		mRecorder->record(mMatch->getState());
+		mSpectatorFeed->record(*mMatch);
 
 		mMatch->step();
 
@@ -616,6 +655,16 @@ PlayerID NetworkGame::getPlayerID(PlayerSide side) const
 	return mPlayers[side];	
 }
 
+unsigned NetworkGame::getID() const
+{
+	return mID;
+}
+
+const std::shared_ptr<SpectatorFeed>& NetworkGame::getSpectatorFeed() const
+{
+	return mSpectatorFeed;
+}
+
 std::string NetworkGame::getGameName() const
 {
 	std::string left;
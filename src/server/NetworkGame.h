@@ -37,6 +37,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 class RakServer;
 class ReplayRecorder;
 class NetworkPlayer;
+class SpectatorFeed;
 
 typedef std::list<packet_ptr> PacketQueue;
 
@@ -51,7 +52,7 @@ class NetworkGame : public ObjectCounter<NetworkGame>
 		// decides which player is switched.
 		/// \exception Throws FileLoadException, if the desired rules file could not be loaded
 		///	\exception Throws std::runtime_error, if \p leftPlayer or \p rightPlayer are already assigned to a game.
-		NetworkGame(RakServer& server,
+		NetworkGame(RakServer& server, unsigned id,
 			std::shared_ptr<NetworkPlayer> players[MAX_PLAYERS],
 			bool playerEnabled[MAX_PLAYERS],
 			bool switchedSide[MAX_PLAYERS], 
@@ -79,6 +80,10 @@ class NetworkGame : public ObjectCounter<NetworkGame>
 		PlayerSide getPlayerSide(PlayerID playerID) const;
 		/// get game name
 		std::string getGameName() const;
+		/// get the server wide unique id of this game
+		unsigned getID() const;
+		/// gets the feed that has to be sent to the spectators of this game
+		const std::shared_ptr<SpectatorFeed>& getSpectatorFeed() const;
 
 	private:
 		void broadcastBitstream(const RakNet::BitStream& stream, const RakNet::BitStream& switchedstream);
@@ -95,6 +100,7 @@ class NetworkGame : public ObjectCounter<NetworkGame>
 		void processPacket( const packet_ptr& packet );
 
 		RakServer& mServer;
+		unsigned mID;
 				
 		PlayerID mPlayers[MAX_PLAYERS];
 		bool mSwitchedSide[MAX_PLAYERS];
@@ -113,6 +119,7 @@ class NetworkGame : public ObjectCounter<NetworkGame>
 		std::thread mGameThread;
 
 		const std::unique_ptr<ReplayRecorder> mRecorder;
+		std::shared_ptr<SpectatorFeed> mSpectatorFeed;
 
 		bool mGameValid;
 
@@ -0,0 +1,83 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+/* header include */
+#include "SpectatorBroadcaster.h"
+
+/* includes */
+#include <chrono>
+#include <vector>
+
+#include "SpectatorFeed.h"
+
+/* implementation */
+
+/// time in milliseconds between two flushes of the spectator feeds
+const int SPECTATOR_SEND_INTERVAL = 50;
+
+SpectatorBroadcaster::SpectatorBroadcaster(RakServer& server) :
+	mServer(server),
+	mRunning(true)
+{
+	mSenderThread = std::thread([this]() { run(); });
+}
+
+SpectatorBroadcaster::~SpectatorBroadcaster()
+{
+	mRunning = false;
+	mSenderThread.join();
+}
+
+void SpectatorBroadcaster::addFeed(std::shared_ptr<SpectatorFeed> feed)
+{
+	std::lock_guard<std::mutex> lock(mFeedMutex);
+	mFeeds.push_back(feed);
+}
+
+void SpectatorBroadcaster::removeSpectator(PlayerID id)
+{
+	std::lock_guard<std::mutex> lock(mFeedMutex);
+	for (auto& feed : mFeeds)
+		feed->removeSpectator(id);
+}
+
+void SpectatorBroadcaster::run()
+{
+	std::vector<std::shared_ptr<SpectatorFeed>> feeds;
+	while (mRunning)
+	{
+		// the list is copied, so new feeds can be added while we are sending
+		{
+			std::lock_guard<std::mutex> lock(mFeedMutex);
+			feeds.assign(mFeeds.begin(), mFeeds.end());
+		}
+
+		for (auto& feed : feeds)
+		{
+			if (!feed->flush(mServer))
+			{
+				std::lock_guard<std::mutex> lock(mFeedMutex);
+				mFeeds.remove(feed);
+			}
+		}
+		feeds.clear();
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(SPECTATOR_SEND_INTERVAL));
+	}
+}
@@ -0,0 +1,61 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <memory>
+
+#include <boost/noncopyable.hpp>
+
+#include "raknet/NetworkTypes.h"
+
+class RakServer;
+class SpectatorFeed;
+
+/*! \class SpectatorBroadcaster
+	\brief sends the spectator feeds of all games of a server
+	\details Owns a single sender thread which periodically drains all
+			registered SpectatorFeeds. Feeds are dropped automatically once
+			their game has ended and the spectators have been notified.
+*/
+class SpectatorBroadcaster : public boost::noncopyable
+{
+	public:
+		SpectatorBroadcaster(RakServer& server);
+		~SpectatorBroadcaster();
+
+		void addFeed(std::shared_ptr<SpectatorFeed> feed);
+		/// removes a disconnected client from all feeds
+		void removeSpectator(PlayerID id);
+
+	private:
+		void run();
+
+		RakServer& mServer;
+
+		std::list<std::shared_ptr<SpectatorFeed>> mFeeds;
+		std::mutex mFeedMutex;
+
+		std::atomic<bool> mRunning;
+		std::thread mSenderThread;
+};
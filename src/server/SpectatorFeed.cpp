@@ -0,0 +1,295 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+/* header include */
+#include "SpectatorFeed.h"
+
+/* includes */
+#include <map>
+#include <algorithm>
+
+#include "raknet/RakServer.h"
+#include "raknet/BitStream.h"
+
+#include "NetworkMessage.h"
+#include "DuelMatch.h"
+#include "DuelMatchState.h"
+#include "InputSource.h"
+#include "GenericIO.h"
+
+/* implementation */
+
+namespace
+{
+	std::shared_ptr<const std::vector<unsigned char>> toPacket(const RakNet::BitStream& stream)
+	{
+		return std::make_shared<const std::vector<unsigned char>>(stream.GetData(), stream.GetData() + stream.GetNumberOfBytesUsed());
+	}
+
+	void sendPacket(RakServer& server, const std::vector<unsigned char>& packet, PlayerID target)
+	{
+		server.Send((const char*)packet.data(), packet.size(), MEDIUM_PRIORITY, RELIABLE_ORDERED, 0, target, false);
+	}
+}
+
+SpectatorFeed::SpectatorFeed(const RakNet::BitStream& header) :
+	mHeader(toPacket(header)),
+	mKeyframeStep(0),
+	mBytesPerStep(1),
+	mClosed(false),
+	mStep(0),
+	mPlayerEnabledBits(0),
+	mRecording(false),
+	mSerialCounter(0),
+	mSpectatorCount(0)
+{
+}
+
+SpectatorFeed::~SpectatorFeed()
+{
+}
+
+void SpectatorFeed::record(const DuelMatch& match)
+{
+	// nobody to send the data to, the next spectator gets a new keyframe
+	if (mSpectatorCount == 0)
+	{
+		if (mRecording)
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mKeyframe.reset();
+			mFrames.clear();
+			mChecksumSteps.clear();
+			mChecksums.clear();
+			mRecording = false;
+		}
+		++mStep;
+		return;
+	}
+
+	unsigned playerEnabledBits = 0;
+	int playerCount = 0;
+	for (int i = 0; i < MAX_PLAYERS; ++i)
+	{
+		if (match.getPlayerEnabled(PlayerSide(i)))
+		{
+			playerEnabledBits |= 1 << i;
+			++playerCount;
+		}
+	}
+
+	// everything expensive is done before locking, so the sender thread
+	// never has to wait for serialisation and vice versa.
+
+	// when a player leaves, the input packing changes, so we restart with a new keyframe
+	packet_data keyframe;
+	if (mStep % SPECTATOR_KEYFRAME_PERIOD == 0 || playerEnabledBits != mPlayerEnabledBits || !mRecording)
+	{
+		RakNet::BitStream stream;
+		stream.Write((unsigned char)ID_SPECTATOR_UPDATE);
+		stream.Write((unsigned char)SpectatorPacketType::KEYFRAME);
+		auto out = createGenericWriter(&stream);
+		out->uint32(mStep);
+		out->uint32(playerEnabledBits);
+		out->generic<DuelMatchState>(match.getState());
+		keyframe = toPacket(stream);
+		mPlayerEnabledBits = playerEnabledBits;
+		mRecording = true;
+	}
+
+	bool hasChecksum = mStep % SPECTATOR_CHECKSUM_PERIOD == 0;
+	unsigned checksum = hasChecksum ? match.getState().checksum() : 0;
+
+	// pack the input the same way as ReplayRecorder: two players per byte, highest bit set.
+	// we send the raw input, the spectators apply the rules' input transformation themselves.
+	unsigned char input[(MAX_PLAYERS + 1) / 2];
+	int length = 0;
+	bool newPacket = true;
+	for (int i = 0; i < MAX_PLAYERS; ++i)
+	{
+		if (!(playerEnabledBits & (1 << i)))
+			continue;
+
+		unsigned char bits = match.getInputSource(PlayerSide(i))->getInput().getAll() & 7;
+		if (newPacket)
+		{
+			input[length++] = (1 << 7) | (bits << 3);
+		}
+		else
+		{
+			input[length - 1] |= bits;
+		}
+		newPacket = !newPacket;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (keyframe)
+		{
+			mKeyframe = keyframe;
+			mKeyframeStep = mStep;
+			mBytesPerStep = std::max((playerCount + 1) / 2, 1);
+			mFrames.clear();
+			mChecksumSteps.clear();
+			mChecksums.clear();
+		}
+
+		if (hasChecksum)
+		{
+			mChecksumSteps.push_back(mStep);
+			mChecksums.push_back(checksum);
+		}
+
+		mFrames.insert(mFrames.end(), input, input + length);
+	}
+
+	++mStep;
+}
+
+void SpectatorFeed::close()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mClosed = true;
+}
+
+void SpectatorFeed::addSpectator(PlayerID id)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	auto found = std::find_if(mSpectators.begin(), mSpectators.end(), [id](const Spectator& s) { return s.id == id; });
+	if (found != mSpectators.end())
+	{
+		// the spectator lost synchronisation, resend the keyframe
+		found->serial = ++mSerialCounter;
+		found->synchronised = false;
+		return;
+	}
+
+	mSpectators.push_back(Spectator{id, ++mSerialCounter, false, false, false, 0});
+	mSpectatorCount = mSpectators.size();
+}
+
+void SpectatorFeed::removeSpectator(PlayerID id)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mSpectators.erase(std::remove_if(mSpectators.begin(), mSpectators.end(), [id](const Spectator& s) { return s.id == id; }),
+						mSpectators.end());
+	mSpectatorCount = mSpectators.size();
+}
+
+bool SpectatorFeed::flush(RakServer& server)
+{
+	// take a snapshot, so the game thread only waits for copying a few bytes
+	std::vector<Spectator> spectators;
+	packet_data keyframe;
+	unsigned keyframeStep;
+	int bytesPerStep;
+	std::vector<unsigned char> frames;
+	std::vector<unsigned int> checksumSteps;
+	std::vector<unsigned int> checksums;
+	bool closed;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (mSpectators.empty())
+			return !mClosed;
+
+		spectators = mSpectators;
+		keyframe = mKeyframe;
+		keyframeStep = mKeyframeStep;
+		bytesPerStep = mBytesPerStep;
+		frames = mFrames;
+		checksumSteps = mChecksumSteps;
+		checksums = mChecksums;
+		closed = mClosed;
+	}
+
+	unsigned endStep = keyframeStep + frames.size() / bytesPerStep;
+
+	// usually all spectators are at the same position, so each packet is built only once
+	std::map<unsigned, std::vector<unsigned char>> framePackets;
+	static const std::vector<unsigned char> endPacket{ (unsigned char)ID_SPECTATOR_UPDATE, (unsigned char)SpectatorPacketType::END };
+
+	for (auto& spectator : spectators)
+	{
+		if (!spectator.headerSent)
+		{
+			sendPacket(server, *mHeader, spectator.id);
+			spectator.headerSent = true;
+		}
+
+		if (keyframe && (!spectator.synchronised || spectator.nextStep < keyframeStep))
+		{
+			sendPacket(server, *keyframe, spectator.id);
+			spectator.nextStep = keyframeStep;
+			spectator.synchronised = true;
+		}
+
+		if (spectator.synchronised && spectator.nextStep < endStep)
+		{
+			auto& packet = framePackets[spectator.nextStep];
+			if (packet.empty())
+			{
+				unsigned first = spectator.nextStep;
+
+				RakNet::BitStream stream;
+				stream.Write((unsigned char)ID_SPECTATOR_UPDATE);
+				stream.Write((unsigned char)SpectatorPacketType::FRAMES);
+				auto out = createGenericWriter(&stream);
+				out->uint32(first);
+				out->generic<std::vector<unsigned char>>(std::vector<unsigned char>(frames.begin() + (first - keyframeStep) * bytesPerStep, frames.end()));
+
+				std::vector<unsigned int> steps;
+				std::vector<unsigned int> sums;
+				for (unsigned i = 0; i < checksumSteps.size(); ++i)
+				{
+					if (checksumSteps[i] >= first)
+					{
+						steps.push_back(checksumSteps[i]);
+						sums.push_back(checksums[i]);
+					}
+				}
+				out->generic<std::vector<unsigned int>>(steps);
+				out->generic<std::vector<unsigned int>>(sums);
+
+				packet.assign(stream.GetData(), stream.GetData() + stream.GetNumberOfBytesUsed());
+			}
+
+			sendPacket(server, packet, spectator.id);
+			spectator.nextStep = endStep;
+		}
+
+		if (closed && !spectator.endSent)
+		{
+			sendPacket(server, endPacket, spectator.id);
+			spectator.endSent = true;
+		}
+	}
+
+	// write back the progress, unless the spectator left or was re-added in the meantime
+	std::lock_guard<std::mutex> lock(mMutex);
+	for (auto& spectator : mSpectators)
+	{
+		auto sent = std::find_if(spectators.begin(), spectators.end(),
+						[&spectator](const Spectator& s) { return s.id == spectator.id && s.serial == spectator.serial; });
+		if (sent != spectators.end())
+			spectator = *sent;
+	}
+
+	return !closed;
+}
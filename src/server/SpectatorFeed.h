@@ -0,0 +1,119 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+#include <boost/noncopyable.hpp>
+
+#include "Global.h"
+#include "raknet/NetworkTypes.h"
+#include "BlobbyDebug.h"
+
+namespace RakNet
+{
+	class BitStream;
+}
+
+class RakServer;
+class DuelMatch;
+
+/// number of game steps between two keyframes. A new spectator has to wait
+/// for at most this many steps to be sent before it is synchronised.
+const unsigned SPECTATOR_KEYFRAME_PERIOD = 750;
+/// number of game steps between two state checksums
+const unsigned SPECTATOR_CHECKSUM_PERIOD = 75;
+
+/*! \class SpectatorFeed
+	\brief buffers the live input of a network game for its spectators
+	\details The game thread publishes the input of every step with record(),
+			which only appends a few bytes to a buffer. Every SPECTATOR_KEYFRAME_PERIOD
+			steps the complete match state is stored as keyframe and the buffer
+			is restarted, so it never grows larger than one keyframe period.
+			While nobody watches, record() only counts the steps, and the first
+			step after a spectator joined starts with a new keyframe.
+			The actual sending to the spectators happens in flush(), which is
+			called from the SpectatorBroadcaster thread and works on a snapshot
+			of the buffer, so spectators never slow down the game.
+*/
+class SpectatorFeed : public ObjectCounter<SpectatorFeed>, public boost::noncopyable
+{
+	public:
+		/// \param header ID_SPECTATE packet describing the match, sent to each new spectator
+		SpectatorFeed(const RakNet::BitStream& header);
+		~SpectatorFeed();
+
+		// game thread
+		/// publishes the input of the next step of \p match. Has to be called
+		/// right before the step, like ReplayRecorder::record. The input is read
+		/// from the input sources, so these have to be plain InputSources whose
+		/// input is already set, as in NetworkGame.
+		void record(const DuelMatch& match);
+		/// marks the end of the game. The spectators are notified on the next flush.
+		void close();
+
+		// server thread
+		/// adds a spectator, or resends the keyframe if it already watches this game
+		void addSpectator(PlayerID id);
+		void removeSpectator(PlayerID id);
+
+		// sender thread
+		/// sends everything published since the last call to the spectators.
+		/// \return false if the feed is closed and no further data will be sent.
+		bool flush(RakServer& server);
+
+	private:
+		typedef std::shared_ptr<const std::vector<unsigned char>> packet_data;
+
+		struct Spectator
+		{
+			PlayerID id;
+			unsigned serial;	///!< changes whenever the spectator is (re)added
+			bool headerSent;
+			bool endSent;
+			bool synchronised;	///!< keyframe has been sent
+			unsigned nextStep;	///!< first step the spectator has not received yet
+		};
+
+		// data written by the game thread
+		std::mutex mMutex;
+		packet_data mHeader;
+		packet_data mKeyframe;
+		unsigned mKeyframeStep;
+		int mBytesPerStep;
+		std::vector<unsigned char> mFrames;
+		std::vector<unsigned int> mChecksumSteps;
+		std::vector<unsigned int> mChecksums;
+		bool mClosed;
+
+		// only accessed by the game thread
+		unsigned mStep;
+		unsigned mPlayerEnabledBits;
+		bool mRecording;	///!< the buffer holds the steps since the last keyframe
+
+		// spectator list
+		std::vector<Spectator> mSpectators;
+		unsigned mSerialCounter;
+		/// size of mSpectators, read by the game thread without locking
+		std::atomic<unsigned> mSpectatorCount;
+};
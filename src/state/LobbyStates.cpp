@@ -10,6 +10,7 @@
 #include "IMGUI.h"
 #include "NetworkState.h"
 #include "NetworkSearchState.h"
+#include "SpectatorState.h"
 #include "UserConfig.h"
 #include "GenericIO.h"
 #include "GameLogic.h"
@@ -131,6 +132,20 @@ void LobbyState::processPacket()
 					mStatus.mOpenGames.push_back(ServerStatusData::OpenGame{ gameids.at(i), gamenames.at(i), gamerules.at(i), gamespeeds.at(i), gamescores.at(i) });
 				}
 
+				// older servers do not send the running games
+				mStatus.mRunningGames.clear();
+				if (stream.GetNumberOfUnreadBits() > 0)
+				{
+					std::vector<unsigned int> runningids;
+					std::vector<std::string> runningnames;
+					in->generic<std::vector<unsigned int>>(runningids);
+					in->generic<std::vector<std::string>>(runningnames);
+					for (unsigned i = 0; i < runningids.size() && i < runningnames.size(); ++i)
+					{
+						mStatus.mRunningGames.push_back(ServerStatusData::RunningGame{ runningids.at(i), runningnames.at(i) });
+					}
+				}
+
 				// find out which settings most closely resemble the local config
 				bool first_config = (mPreferedSpeed == -1u); // detect whether we set config for the first time
 				std::shared_ptr<IUserConfigReader> config = IUserConfigReader::createUserConfigReader("config.xml");
@@ -201,6 +216,13 @@ void LobbyState::processPacket()
 				switchState(new NetworkGameState(mClient, playerEnabled, PlayerSide(playerIndex), serverChecksum, scoreToWin));
 			}
 			break;
+		case ID_SPECTATE: // the server accepted our spectate request
+			{
+				RakNet::BitStream stream(packet->data, packet->length, false);
+				stream.IgnoreBytes(1);	// ignore ID_SPECTATE
+				switchState(new SpectatorState(mClient, mInfo, mPrevious, stream));
+			}
+			break;
 		default:
 			std::cout << "Unknown packet " << int(packet->data[0]) << " received\n";
 		}
@@ -309,6 +331,11 @@ void LobbyMainSubstate::step(const ServerStatusData& status)
 	{
 		gamelist.push_back( game.name );
 	}
+	// running games follow the open games
+	for ( const auto& game : status.mRunningGames)
+	{
+		gamelist.push_back( TextManager::getSingleton()->getString(TextManager::NET_RUNNING_GAME) + game.name );
+	}
 
 	bool doEnterGame = imgui.doSelectbox(GEN_ID, Vector2(25.0, 90.0), Vector2(375.0, 470.0), gamelist, mSelectedGame) == SBA_DBL_CLICK;
 
@@ -316,7 +343,28 @@ void LobbyMainSubstate::step(const ServerStatusData& status)
 	if(mSelectedGame >= gamelist.size())
 		mSelectedGame = 0;
 
-	if(mSelectedGame != 0)
+	if(mSelectedGame > status.mOpenGames.size())
+	{
+		const auto& game = status.mRunningGames.at(mSelectedGame - 1 - status.mOpenGames.size());
+
+		// info panel
+		imgui.doOverlay(GEN_ID, Vector2(425.0, 90.0), Vector2(775.0, 470.0));
+		for (unsigned int i = 0; i < game.name.length(); i += 25)
+		{
+			imgui.doText(GEN_ID, Vector2(435, 100 + i / 25 * 15), game.name.substr(i, 25), TF_SMALL_FONT);
+		}
+
+		// spectate button
+		if( imgui.doButton(GEN_ID, Vector2(435, 430), TextManager::getSingleton()->getString(TextManager::NET_SPECTATE) ) ||
+			doEnterGame)
+		{
+			RakNet::BitStream stream;
+			stream.Write((unsigned char)ID_SPECTATE);
+			stream.Write( game.id );
+			mClient->Send(&stream, LOW_PRIORITY, RELIABLE_ORDERED, 0);
+		}
+	}
+	else if(mSelectedGame != 0)
 	{
 		unsigned gameIndex = mSelectedGame - 1;
 
@@ -30,12 +30,19 @@ struct ServerStatusData
 		unsigned score;
 	};
 
+	struct RunningGame
+	{
+		unsigned id;
+		std::string name;
+	};
+
 	const OpenGame& getGame( unsigned id ) const
 	{
 		return mOpenGames.at(id);
 	}
 
 	std::vector<OpenGame> mOpenGames;
+	std::vector<RunningGame> mRunningGames;
 	std::vector<unsigned int> mPossibleSpeeds;
 	std::vector<std::string> mPossibleRules;
 	std::vector<std::string> mPossibleRulesAuthor;
@@ -23,6 +23,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 /* includes */
 #include <ctime>
+#include <cstdio>
+#include <iostream>
 
 #include "DuelMatch.h"
 #include "InputManager.h"
@@ -33,6 +35,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "SpeedController.h"
 #include "IUserConfigReader.h"
 #include "InputSourceFactory.h"
+#include "ScriptedInputSource.h"
+#include "LuaProfiler.h"
 
 /* implementation */
 LocalGameState::~LocalGameState()
@@ -40,7 +44,7 @@ LocalGameState::~LocalGameState()
 }
 
 LocalGameState::LocalGameState()
-	: mWinner(false), mRecorder(new ReplayRecorder())
+	: mWinner(false), mScriptDebug(false), mRecorder(new ReplayRecorder())
 {
 	std::shared_ptr<IUserConfigReader> config = IUserConfigReader::createUserConfigReader("config.xml");
 
@@ -84,6 +88,11 @@ LocalGameState::LocalGameState()
 	mRecorder->setPlayerColors(playerColors);
 	mRecorder->setGameSpeed((float)config->getInteger("gamefps"));
 	mRecorder->setGameRules( config->getString("rules") );
+
+	// the bots enable their profilers themselves
+	mScriptDebug = config->getBool("bot_debug");
+	if (mScriptDebug)
+		mMatch->enableRulesProfiler();
 }
 
 void LocalGameState::step_impl()
@@ -154,12 +163,94 @@ void LocalGameState::step_impl()
 			mWinner = true;
 			mRecorder->record(mMatch->getState());
 			mRecorder->finalize( mMatch->getScore(LEFT_SIDE), mMatch->getScore(RIGHT_SIDE) );
+
+			if (mScriptDebug)
+				writeScriptProfiles();
 		}
 
 		presentGame();
 	}
 
 	presentGameUI();
+
+	if (mScriptDebug)
+		presentScriptProfiles();
+}
+
+namespace
+{
+	const LuaProfiler* getBotProfiler(const DuelMatch& match, PlayerSide side)
+	{
+		auto bot = std::dynamic_pointer_cast<ScriptedInputSource>(match.getInputSource(side));
+		return bot ? bot->getProfiler() : nullptr;
+	}
+}
+
+void LocalGameState::presentScriptProfiles()
+{
+	IMGUI& imgui = IMGUI::getSingleton();
+	const int ENTRIES = 4;
+	const int LINE_HEIGHT = 14;
+
+	std::vector<std::pair<std::string, const LuaProfiler*>> profilers;
+	if (mMatch->getRulesProfiler())
+		profilers.emplace_back("rules", mMatch->getRulesProfiler());
+	for (int i = 0; i < MAX_PLAYERS; ++i)
+	{
+		if (const LuaProfiler* profiler = getBotProfiler(*mMatch, PlayerSide(i)))
+			profilers.emplace_back("bot " + std::to_string(i), profiler);
+	}
+
+	if (profilers.empty())
+		return;
+
+	float height = profilers.size() * (ENTRIES + 1) * LINE_HEIGHT + 10;
+	imgui.doOverlay(GEN_ID, Vector2(10, 60), Vector2(790, 60 + height));
+
+	char line[128];
+	float y = 65;
+	for (const auto& profiler : profilers)
+	{
+		std::vector<LuaProfiler::Entry> entries = profiler.second->getEntries();
+		double frames = std::max(profiler.second->getFrames(), 1u);
+
+		double time = 0;
+		for (const auto& entry : entries)
+			time += entry.selfTime;
+
+		snprintf(line, sizeof(line), "%s: %.1f us per frame", profiler.first.c_str(), time * 1000 / frames);
+		imgui.doText(GEN_ID, Vector2(15, y), line, TF_SMALL_FONT);
+		y += LINE_HEIGHT;
+
+		for (int i = 0; i < ENTRIES; ++i, y += LINE_HEIGHT)
+		{
+			if (i >= (int)entries.size())
+				continue;
+
+			snprintf(line, sizeof(line), "%8.1f us %6.1f x %.40s", entries[i].selfTime * 1000 / frames,
+					entries[i].calls / frames, entries[i].name.c_str());
+			imgui.doText(GEN_ID, Vector2(15, y), line, TF_SMALL_FONT);
+		}
+	}
+}
+
+void LocalGameState::writeScriptProfiles() const
+{
+	if (const LuaProfiler* profiler = mMatch->getRulesProfiler())
+	{
+		std::cout << "rules profile:\n";
+		profiler->writeReport(std::cout);
+	}
+
+	for (int i = 0; i < MAX_PLAYERS; ++i)
+	{
+		if (const LuaProfiler* profiler = getBotProfiler(*mMatch, PlayerSide(i)))
+		{
+			std::cout << "bot " << i << " profile:\n";
+			profiler->writeReport(std::cout);
+		}
+	}
+	std::cout << std::flush;
 }
 
 const char* LocalGameState::getStateName() const
@@ -40,7 +40,14 @@ class LocalGameState : public GameState
 		virtual const char* getStateName() const;
 
 	private:
-		bool mWinner;		
+		/// shows the most expensive functions of the bot and rules scripts
+		void presentScriptProfiles();
+		/// prints the profiles of all scripts
+		void writeScriptProfiles() const;
+
+		bool mWinner;
+		/// bot_debug is set, the scripts are profiled
+		bool mScriptDebug;
 		boost::scoped_ptr<ReplayRecorder> mRecorder;
 };
 
@@ -22,6 +22,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "OptionsState.h"
 
 /* includes */
+#include <iostream>
 #include <sstream>
 #include <string>
 
@@ -29,6 +30,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "RenderManager.h"
 #include "InputManager.h"
 #include "LocalInputSource.h"
+#include "NativeInputSource.h"
 #include "SpeedController.h"
 #include "SoundManager.h"
 #include "Blood.h"
@@ -46,6 +48,8 @@ OptionState::OptionState()
 	std::string rightScript = mOptionConfig.getString("right_script_name");
 
 	mScriptNames = FileSystem::getSingleton().enumerateFiles("scripts", ".lua");
+	std::vector<std::string> nativeBots = NativeInputSource::getAvailableBots();
+	mScriptNames.insert(mScriptNames.end(), nativeBots.begin(), nativeBots.end());
 
 	// hack. we cant use something like push_front, though
 	mScriptNames.push_back("Human");
@@ -385,11 +389,31 @@ void GraphicOptionsState::save()
 	if ((mOptionConfig.getBool("fullscreen") != mFullscreen) ||	(mOptionConfig.getString("device") != mRenderer))
 	{
 		mOptionConfig.setBool("fullscreen", mFullscreen);
-		mOptionConfig.setString("device", mRenderer);
+		// the old renderer is gone once the new one is created
+		RenderManager* renderer;
 		if (mRenderer == "OpenGL")
-			RenderManager::createRenderManagerGL2D()->init(800, 600, mFullscreen);
+			renderer = RenderManager::createRenderManagerGL2D();
+		else if (mRenderer == "OpenGL3")
+			renderer = RenderManager::createRenderManagerGL3();
 		else
+			renderer = RenderManager::createRenderManagerSDL();
+
+		try
+		{
+			renderer->init(800, 600, mFullscreen);
+		}
+		catch (std::exception& e)
+		{
+			if (mRenderer == "SDL")
+				throw;
+
+			// same fallback as in main, the SDL renderer always works
+			std::cerr << "Warning: " << e.what() << std::endl;
+			std::cerr << "Falling back to SDL" << std::endl;
+			mRenderer = "SDL";
 			RenderManager::createRenderManagerSDL()->init(800, 600, mFullscreen);
+		}
+		mOptionConfig.setString("device", mRenderer);
 		RenderManager::getSingleton().setBackground(std::string("backgrounds/") + mOptionConfig.getString("background"));
 	}
 #endif
@@ -434,8 +458,12 @@ void GraphicOptionsState::step_impl()
 		mRenderer = "OpenGL";
 	if (imgui.doButton(GEN_ID, Vector2(444.0, 70.0), "SDL"))
 		mRenderer = "SDL";
+	if (imgui.doButton(GEN_ID, Vector2(444.0, 100.0), "OpenGL 3"))
+		mRenderer = "OpenGL3";
 	if (mRenderer == "OpenGL")
 		imgui.doImage(GEN_ID, Vector2(428.0, 52.0), "gfx/pfeil_rechts.bmp");
+	else if (mRenderer == "OpenGL3")
+		imgui.doImage(GEN_ID, Vector2(428.0, 112.0), "gfx/pfeil_rechts.bmp");
 	else
 		imgui.doImage(GEN_ID, Vector2(428.0, 82.0), "gfx/pfeil_rechts.bmp");
 #endif
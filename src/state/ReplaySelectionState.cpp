@@ -23,6 +23,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 /* includes */
 #include <algorithm>
+#include <set>
 #include <ctime>
 #include <iostream> // for cerr
 
@@ -41,19 +42,99 @@ ReplaySelectionState::ReplaySelectionState()
 	mVersionError = false;
 	mShowReplayInfo = false;
 
+	mSortKey = ReplayIndex::SORT_DATE;
+	mFilterCursor = 0;
+	mListUpdateDelay = 0;
+
+	mAllReplayFiles = FileSystem::getSingleton().enumerateFiles("replays", ".bvr");
+	mReplayIndex.reset(new ReplayIndex("replays"));
+	mReplayIndex->refresh(mAllReplayFiles);
+
 	mSelectedReplay = 0;
-	mReplayFiles = FileSystem::getSingleton().enumerateFiles("replays", ".bvr");
-	if (mReplayFiles.size() == 0)
-		mSelectedReplay = -1;
-	std::sort(mReplayFiles.rbegin(), mReplayFiles.rend());
+	updateReplayList();
 
 	SpeedController::getMainInstance()->setGameSpeed(75);
 }
 
+void ReplaySelectionState::updateReplayList()
+{
+	std::string selected;
+	if (mSelectedReplay < mReplayFiles.size())
+		selected = mReplayFiles[mSelectedReplay];
+
+	mListRevision = mReplayIndex->getRevision();
+	mReplayFiles.clear();
+	std::set<std::string> indexed;
+	for (unsigned index : mReplayIndex->query(mFilter, mSortKey, mSortKey != ReplayIndex::SORT_FILENAME && mSortKey != ReplayIndex::SORT_PLAYER))
+	{
+		mReplayFiles.push_back(mReplayIndex->getEntry(index).file);
+		indexed.insert(mReplayFiles.back());
+	}
+
+	// replays that have not been indexed yet can't be filtered, so we only show them when there is no filter
+	if (mFilter.player.empty())
+	{
+		std::vector<std::string> pending;
+		for (const auto& file : mAllReplayFiles)
+		{
+			if (indexed.count(file) == 0)
+				pending.push_back(file);
+		}
+		std::sort(pending.rbegin(), pending.rend());
+		mReplayFiles.insert(mReplayFiles.end(), pending.begin(), pending.end());
+	}
+
+	// keep the selection on the same replay
+	auto found = std::find(mReplayFiles.begin(), mReplayFiles.end(), selected);
+	if (found != mReplayFiles.end())
+		mSelectedReplay = found - mReplayFiles.begin();
+	else if (mReplayFiles.empty())
+		mSelectedReplay = -1;
+	else if (mSelectedReplay >= mReplayFiles.size())
+		mSelectedReplay = 0;
+}
+
+bool ReplaySelectionState::loadReplayInfo(const std::string& file)
+{
+	if (mReplayIndex->findEntry(file, mReplayInfo))
+		return true;
+
+	try
+	{
+		boost::scoped_ptr<IReplayLoader> loader(IReplayLoader::createReplayLoader(std::string("replays/" + file + ".bvr")));
+		mReplayInfo.file = file;
+		for (int i = 0; i < MAX_PLAYERS; ++i)
+		{
+			mReplayInfo.playerEnabled[i] = loader->getPlayerEnabled(PlayerSide(i));
+			mReplayInfo.playerNames[i] = loader->getPlayerName(PlayerSide(i));
+		}
+		mReplayInfo.finalScore[LEFT_SIDE] = loader->getFinalScore(LEFT_SIDE);
+		mReplayInfo.finalScore[RIGHT_SIDE] = loader->getFinalScore(RIGHT_SIDE);
+		mReplayInfo.speed = loader->getSpeed();
+		mReplayInfo.duration = loader->getDuration();
+		mReplayInfo.length = loader->getLength();
+		mReplayInfo.date = loader->getDate();
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return false;
+	}
+	return true;
+}
+
 void ReplaySelectionState::step_impl()
 {
 	IMGUI& imgui = IMGUI::getSingleton();
 
+	// pick up replays indexed in the background, but don't resort a huge list every frame
+	if (mListUpdateDelay > 0)
+		--mListUpdateDelay;
+	if (mReplayIndex->getRevision() != mListRevision && (mListUpdateDelay == 0 || !mReplayIndex->isRefreshing()))
+	{
+		updateReplayList();
+		mListUpdateDelay = 30;
+	}
 
 	imgui.doCursor();
 	imgui.doImage(GEN_ID, Vector2(400.0, 300.0), "background");
@@ -99,15 +180,7 @@ void ReplaySelectionState::step_impl()
 	{
 		if (!mReplayFiles.empty())
 		{
-			try
-			{
-				mReplayLoader.reset(IReplayLoader::createReplayLoader(std::string("replays/" + mReplayFiles[mSelectedReplay] + ".bvr")));
-				mShowReplayInfo = true;
-			}
-			catch (std::exception& e)
-			{
-				std::cerr << e.what() << std::endl;
-			}
+			mShowReplayInfo = loadReplayInfo(mReplayFiles[mSelectedReplay]);
 		}
 	}
 	if (imgui.doButton(GEN_ID, Vector2(644.0, 95.0), TextManager::RP_DELETE))
@@ -115,25 +188,43 @@ void ReplaySelectionState::step_impl()
 		if (!mReplayFiles.empty())
 		if (FileSystem::getSingleton().deleteFile("replays/" + mReplayFiles[mSelectedReplay] + ".bvr"))
 		{
+			mReplayIndex->removeEntry(mReplayFiles[mSelectedReplay]);
+			mAllReplayFiles.erase(std::remove(mAllReplayFiles.begin(), mAllReplayFiles.end(), mReplayFiles[mSelectedReplay]), mAllReplayFiles.end());
 			mReplayFiles.erase(mReplayFiles.begin()+mSelectedReplay);
 			if (mSelectedReplay >= mReplayFiles.size())
 				mSelectedReplay = mReplayFiles.size()-1;
+			mListRevision = mReplayIndex->getRevision();
 		}
 	}
 
+	// sorting and filtering, both are answered by the index alone
+	static const TextManager::STRING SORT_LABELS[] = {
+		TextManager::RP_SORT_NAME, TextManager::RP_SORT_DATE, TextManager::RP_SORT_PLAYER,
+		TextManager::RP_SORT_SCORE, TextManager::RP_SORT_DURATION };
+	if (imgui.doButton(GEN_ID, Vector2(644.0, 135.0), SORT_LABELS[mSortKey], TF_SMALL_FONT))
+	{
+		mSortKey = ReplayIndex::SortKey((mSortKey + 1) % (ReplayIndex::SORT_DURATION + 1));
+		updateReplayList();
+	}
+	imgui.doText(GEN_ID, Vector2(644.0, 160.0), TextManager::RP_FILTER_PLAYER, TF_SMALL_FONT);
+	std::string filter = mFilter.player;
+	imgui.doEditbox(GEN_ID, Vector2(644.0, 175.0), 12, mFilter.player, mFilterCursor, TF_SMALL_FONT);
+	if (filter != mFilter.player)
+		updateReplayList();
+
 	if(mShowReplayInfo)
 	{
 		//todo check player enabled
 		// setup
-		std::string left =  mReplayLoader->getPlayerName(LEFT_PLAYER);
-		std::string right =  mReplayLoader->getPlayerName(RIGHT_PLAYER);
+		std::string left =  mReplayInfo.playerNames[LEFT_PLAYER];
+		std::string right =  mReplayInfo.playerNames[RIGHT_PLAYER];
 
 		const int MARGIN = std::min(std::max(int(300 - 24*(std::max(left.size(),right.size()))), 50), 150);
 
 		const int RIGHT = 800 - MARGIN;
 		imgui.doInactiveMode(false);
 		imgui.doOverlay(GEN_ID, Vector2(MARGIN, 180), Vector2(800-MARGIN, 445));
-		std::string repname = mReplayFiles[mSelectedReplay];
+		std::string repname = mReplayInfo.file;
 		imgui.doText(GEN_ID, Vector2(400-repname.size()*12, 190), repname);
 
 		// calculate text positions
@@ -143,7 +234,7 @@ void ReplaySelectionState::step_impl()
 		imgui.doText(GEN_ID, Vector2(400-24, 225), "vs");
 		imgui.doText(GEN_ID, Vector2(RIGHT - 20 - 24*right.size(), 225), right);
 
-		time_t rd = mReplayLoader->getDate();
+		time_t rd = mReplayInfo.date;
 		struct tm* ptm;
 		ptm = gmtime ( &rd );
 		//std::
@@ -153,23 +244,23 @@ void ReplaySelectionState::step_impl()
 		imgui.doText(GEN_ID, Vector2(400 - 12*date.size(), 255), date);
 
 		imgui.doText(GEN_ID, Vector2(MARGIN+20, 300), TextManager::OP_SPEED);
-		std::string speed = std::to_string(mReplayLoader->getSpeed() *100 / 75) + "%" ;
+		std::string speed = std::to_string(mReplayInfo.speed *100 / 75) + "%" ;
 		imgui.doText(GEN_ID, Vector2(RIGHT - 20 - 24*speed.size(), 300), speed);
 
 		imgui.doText(GEN_ID, Vector2(MARGIN+20, 335), TextManager::RP_DURATION);
 		std::string dur;
-		if(mReplayLoader->getDuration() > 99)
+		if(mReplayInfo.duration > 99)
 		{
 			// +30 because of rounding
-			dur = std::to_string((mReplayLoader->getDuration() + 30) / 60) + "min";
+			dur = std::to_string((mReplayInfo.duration + 30) / 60) + "min";
 		} else
 		{
-			dur = std::to_string(mReplayLoader->getDuration()) + "s";
+			dur = std::to_string(mReplayInfo.duration) + "s";
 		}
 		imgui.doText(GEN_ID, Vector2(RIGHT - 20 - 24*dur.size(), 335), dur);
 
 		std::string res;
-		res = std::to_string(mReplayLoader->getFinalScore(LEFT_SIDE)) + " : " +  std::to_string(mReplayLoader->getFinalScore(RIGHT_SIDE));
+		res = std::to_string(mReplayInfo.finalScore[LEFT_SIDE]) + " : " +  std::to_string(mReplayInfo.finalScore[RIGHT_SIDE]);
 
 		imgui.doText(GEN_ID, Vector2(MARGIN+20, 370), TextManager::RP_RESULT);
 		imgui.doText(GEN_ID, Vector2(RIGHT - 20 - 24*res.size(), 370), res);
@@ -21,6 +21,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #pragma once
 
 #include "State.h"
+#include "replays/ReplayIndex.h"
 
 #include <vector>
 
@@ -41,11 +42,25 @@ public:
 	virtual const char* getStateName() const;
 
 private:
+	/// rebuilds mReplayFiles from the index, using the current sort order and filter
+	void updateReplayList();
+	/// gets the info of a replay from the index, or from the file itself if it is not indexed yet
+	bool loadReplayInfo(const std::string& file);
 
+	// all replay files in the directory
+	std::vector<std::string> mAllReplayFiles;
+	// the replay files that are shown, in display order
 	std::vector<std::string> mReplayFiles;
 	unsigned mSelectedReplay;
 	bool mShowReplayInfo;
-	boost::scoped_ptr<IReplayLoader> mReplayLoader;
+	ReplayIndex::Entry mReplayInfo;
+
+	boost::scoped_ptr<ReplayIndex> mReplayIndex;
+	ReplayIndex::SortKey mSortKey;
+	ReplayIndex::Filter mFilter;
+	unsigned mFilterCursor;
+	unsigned mListRevision;
+	int mListUpdateDelay;
 
 	bool mChecksumError;
 	bool mVersionError;
@@ -0,0 +1,323 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+/* header include */
+#include "SpectatorState.h"
+
+/* includes */
+#include <algorithm>
+#include <iostream>
+
+#include "raknet/RakClient.h"
+#include "raknet/PacketEnumerations.h"
+
+#include "DuelMatch.h"
+#include "DuelMatchState.h"
+#include "IMGUI.h"
+#include "InputManager.h"
+#include "InputSource.h"
+#include "SoundManager.h"
+#include "SpeedController.h"
+#include "GenericIO.h"
+#include "FileWrite.h"
+
+/* implementation */
+
+/// number of buffered steps that is kept to bridge the time between two packets
+const int SPECTATOR_MIN_DELAY = 10;
+/// if more steps are buffered, we fast forward
+const int SPECTATOR_MAX_DELAY = 75;
+
+SpectatorState::SpectatorState(std::shared_ptr<RakClient> client, ServerInfo info, PreviousState previous, RakNet::BitStream& header) :
+	mClient(client),
+	mInfo(info),
+	mPrevious(previous),
+	mSynchronised(false),
+	mGameOver(false),
+	mWinningPlayer(NO_SIDE),
+	mNextStep(0),
+	mBytesPerStep(1),
+	mFramePosition(0)
+{
+	IMGUI::getSingleton().resetSelection();
+
+	auto in = createGenericReader(&header);
+
+	unsigned playerEnabledBit;
+	in->uint32(mGameID);
+	in->uint32(playerEnabledBit);
+
+	bool playerEnabled[MAX_PLAYERS];
+	PlayerIdentity players[MAX_PLAYERS];
+	for (int i = 0; i < MAX_PLAYERS; ++i)
+	{
+		playerEnabled[i] = (bool)(playerEnabledBit & (1 << i));
+		if (playerEnabled[i])
+		{
+			std::string name;
+			Color color;
+			in->string(name);
+			in->generic<Color>(color);
+			players[i] = PlayerIdentity(name);
+			players[i].setStaticColor(color);
+		}
+	}
+
+	unsigned gameSpeed, scoreToWin;
+	std::string rules;
+	in->uint32(gameSpeed);
+	in->uint32(scoreToWin);
+	in->string(rules);
+	mGameSpeed = std::max(gameSpeed, 1u);
+
+	FileWrite rulesFile("rules/" + TEMP_RULES_NAME);
+	rulesFile.write(rules);
+	rulesFile.close();
+
+	mMatch.reset(new DuelMatch(false, TEMP_RULES_NAME, playerEnabled, scoreToWin));
+	mMatch->setPlayers(players);
+
+	SpeedController::getMainInstance()->setGameSpeed(mGameSpeed);
+	SoundManager::getSingleton().playSound("sounds/pfiff.wav", ROUND_START_SOUND_VOLUME);
+}
+
+SpectatorState::~SpectatorState()
+{
+	// disconnect is handled by shared ptr
+}
+
+void SpectatorState::processPacket()
+{
+	packet_ptr packet;
+	while ((packet = mClient->Receive()))
+	{
+		switch (packet->data[0])
+		{
+		case ID_SPECTATOR_UPDATE:
+		{
+			RakNet::BitStream stream(packet->data, packet->length, false);
+			auto in = createGenericReader(&stream);
+			unsigned char type;
+			in->byte(type);	// ID_SPECTATOR_UPDATE
+			in->byte(type);
+
+			if ((SpectatorPacketType)type == SpectatorPacketType::KEYFRAME)
+			{
+				unsigned step, playerEnabledBit;
+				DuelMatchState state;
+				in->uint32(step);
+				in->uint32(playerEnabledBit);
+				in->generic<DuelMatchState>(state);
+
+				int playerCount = 0;
+				for (int i = 0; i < MAX_PLAYERS; ++i)
+				{
+					bool enabled = playerEnabledBit & (1 << i);
+					mMatch->setPlayerEnabled(PlayerSide(i), enabled);
+					if (enabled)
+						++playerCount;
+				}
+				mBytesPerStep = std::max((playerCount + 1) / 2, 1);
+
+				mMatch->setState(state);
+				mNextStep = step;
+				clearFrames();
+				mChecksums.clear();
+				mSynchronised = true;
+			}
+			else if ((SpectatorPacketType)type == SpectatorPacketType::FRAMES)
+			{
+				// frames sent before our keyframe request was processed are useless
+				if (!mSynchronised)
+					break;
+
+				unsigned first;
+				std::vector<unsigned char> input;
+				std::vector<unsigned int> checksumSteps;
+				std::vector<unsigned int> checksums;
+				in->uint32(first);
+				in->generic<std::vector<unsigned char>>(input);
+				in->generic<std::vector<unsigned int>>(checksumSteps);
+				in->generic<std::vector<unsigned int>>(checksums);
+
+				unsigned end = mNextStep + getBufferedSteps();
+				if (first > end)
+				{
+					// we missed some steps
+					requestKeyframe();
+					break;
+				}
+
+				unsigned skip = (end - first) * mBytesPerStep;
+				if (skip < input.size())
+					mFrames.insert(mFrames.end(), input.begin() + skip, input.end());
+
+				for (unsigned i = 0; i < checksumSteps.size() && i < checksums.size(); ++i)
+				{
+					if (checksumSteps[i] >= mNextStep)
+						mChecksums[checksumSteps[i]] = checksums[i];
+				}
+			}
+			else if ((SpectatorPacketType)type == SpectatorPacketType::END)
+			{
+				mGameOver = true;
+			}
+			break;
+		}
+		case ID_CONNECTION_LOST:
+		case ID_DISCONNECTION_NOTIFICATION:
+			mGameOver = true;
+			break;
+		// lobby and status messages we don't care about
+		case ID_LOBBY:
+		case ID_SPECTATE:
+		case ID_REMOTE_DISCONNECTION_NOTIFICATION:
+		case ID_REMOTE_CONNECTION_LOST:
+		case ID_REMOTE_NEW_INCOMING_CONNECTION:
+		case ID_REMOTE_EXISTING_CONNECTION:
+			break;
+		default:
+			std::cout << "Unknown packet " << int(packet->data[0]) << " received\n";
+		}
+	}
+}
+
+void SpectatorState::playStep()
+{
+	// read the input of this step, packed like the replay input
+	int position = 0;
+	bool first = true;
+	for (int i = 0; i < MAX_PLAYERS; ++i)
+	{
+		if (!mMatch->getPlayerEnabled(PlayerSide(i)))
+			continue;
+
+		unsigned char packet = mFrames[mFramePosition + position];
+		if (first)
+		{
+			mMatch->getInputSource(PlayerSide(i))->setInput(PlayerInput((bool)(packet & 32), (bool)(packet & 16), (bool)(packet & 8)));
+		}
+		else
+		{
+			mMatch->getInputSource(PlayerSide(i))->setInput(PlayerInput((bool)(packet & 4), (bool)(packet & 2), (bool)(packet & 1)));
+			++position;
+		}
+		first = !first;
+	}
+	mFramePosition += mBytesPerStep;
+
+	// the played input is removed once it makes up half of the buffer, so each byte is moved at most once
+	if (mFramePosition * 2 >= mFrames.size())
+	{
+		mFrames.erase(mFrames.begin(), mFrames.begin() + mFramePosition);
+		mFramePosition = 0;
+	}
+
+	auto checksum = mChecksums.find(mNextStep);
+	if (checksum != mChecksums.end())
+	{
+		if (mMatch->getState().checksum() != checksum->second)
+		{
+			std::cerr << "Warning: spectator simulation lost synchronisation at step " << mNextStep << "\n";
+			requestKeyframe();
+			return;
+		}
+		mChecksums.erase(mChecksums.begin(), ++checksum);
+	}
+
+	mMatch->step();
+	++mNextStep;
+
+	mWinningPlayer = mMatch->winningPlayer();
+}
+
+void SpectatorState::requestKeyframe()
+{
+	mSynchronised = false;
+	clearFrames();
+	mChecksums.clear();
+
+	RakNet::BitStream stream;
+	stream.Write((unsigned char)ID_SPECTATE);
+	stream.Write(mGameID);
+	mClient->Send(&stream, HIGH_PRIORITY, RELIABLE_ORDERED, 0);
+}
+
+void SpectatorState::clearFrames()
+{
+	mFrames.clear();
+	mFramePosition = 0;
+}
+
+int SpectatorState::getBufferedSteps() const
+{
+	return (mFrames.size() - mFramePosition) / mBytesPerStep;
+}
+
+void SpectatorState::step_impl()
+{
+	IMGUI& imgui = IMGUI::getSingleton();
+
+	processPacket();
+
+	if (mSynchronised && mWinningPlayer == NO_SIDE)
+	{
+		// keep a small reserve to bridge the send interval, but catch up if we fall behind
+		int available = getBufferedSteps();
+		int steps = available > SPECTATOR_MAX_DELAY ? available - SPECTATOR_MIN_DELAY : std::min(available, 1);
+		for (int i = 0; i < steps && mSynchronised && mWinningPlayer == NO_SIDE; ++i)
+		{
+			playStep();
+		}
+	}
+
+	presentGame();
+	mMatch->getClock().setTime(mNextStep / mGameSpeed);
+	presentGameUI();
+
+	bool leave = false;
+	if (mWinningPlayer != NO_SIDE)
+	{
+		displayWinningPlayerScreen(mWinningPlayer);
+		leave = imgui.doButton(GEN_ID, Vector2(290, 350), TextManager::LBL_OK);
+		imgui.doCursor();
+	}
+	else if (mGameOver && getBufferedSteps() == 0)
+	{
+		imgui.doOverlay(GEN_ID, Vector2(100.0, 210.0), Vector2(700.0, 390.0));
+		imgui.doText(GEN_ID, Vector2(140.0, 240.0), TextManager::NET_GAME_ABORTED);
+		leave = imgui.doButton(GEN_ID, Vector2(230.0, 290.0), TextManager::LBL_OK);
+		imgui.doCursor();
+	}
+	else if (!mSynchronised)
+	{
+		imgui.doOverlay(GEN_ID, Vector2(100.0, 210.0), Vector2(700.0, 310.0));
+		imgui.doText(GEN_ID, Vector2(150.0, 250.0), TextManager::NET_CONNECTING);
+	}
+
+	if (leave || InputManager::getSingleton()->exit())
+	{
+		switchState(new LobbyState(mInfo, mPrevious));
+	}
+}
+
+const char* SpectatorState::getStateName() const
+{
+	return "SpectatorState";
+}
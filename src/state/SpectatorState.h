@@ -0,0 +1,75 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+#pragma once
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "GameState.h"
+#include "NetworkMessage.h"
+#include "LobbyStates.h"
+
+class RakClient;
+
+/*! \class SpectatorState
+	\brief State for watching a running network game
+	\details The server only sends the player input and periodic checksums,
+			the match itself is simulated locally. If a checksum does not match,
+			the state requests a new keyframe from the server.
+*/
+class SpectatorState : public GameState
+{
+	public:
+		/// \param header content of the ID_SPECTATE packet the server sent, positioned after the packet id
+		SpectatorState(std::shared_ptr<RakClient> client, ServerInfo info, PreviousState previous, RakNet::BitStream& header);
+		virtual ~SpectatorState();
+
+		virtual void step_impl();
+		virtual const char* getStateName() const;
+
+	private:
+		void processPacket();
+		/// simulates the next buffered step
+		void playStep();
+		/// drops all buffered data and asks the server for a new keyframe
+		void requestKeyframe();
+		/// drops the buffered input
+		void clearFrames();
+		/// number of buffered steps which have not been played yet
+		int getBufferedSteps() const;
+
+		std::shared_ptr<RakClient> mClient;
+		ServerInfo mInfo;
+		PreviousState mPrevious;
+
+		unsigned mGameID;
+		int mGameSpeed;
+
+		bool mSynchronised;			///!< a keyframe has been received and no checksum failed since
+		bool mGameOver;				///!< the server does not send any further data
+		PlayerSide mWinningPlayer;
+
+		unsigned mNextStep;			///!< game step of the first buffered frame
+		int mBytesPerStep;
+		std::vector<unsigned char> mFrames;
+		std::size_t mFramePosition;	///!< input of the next step in mFrames, the bytes before it have been played
+		std::map<unsigned, unsigned> mChecksums;
+};
@@ -0,0 +1,196 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+/* header include */
+#include "ReplayAnalyzer.h"
+
+/* includes */
+#include <algorithm>
+#include <cmath>
+
+#include "DuelMatch.h"
+#include "MatchEvents.h"
+#include "replays/ReplayPlayer.h"
+
+/* implementation */
+
+Histogram::Histogram(float bucketWidth) :
+	mBucketWidth(bucketWidth),
+	mCount(0),
+	mSum(0),
+	mMinimum(0),
+	mMaximum(0)
+{
+}
+
+void Histogram::add(float value)
+{
+	if(mCount == 0)
+	{
+		mMinimum = value;
+		mMaximum = value;
+	}
+	else
+	{
+		mMinimum = std::min(mMinimum, value);
+		mMaximum = std::max(mMaximum, value);
+	}
+
+	++mCount;
+	mSum += value;
+	++mBuckets[(int)std::floor(value / mBucketWidth)];
+}
+
+void Histogram::merge(const Histogram& other)
+{
+	if(other.mCount == 0)
+		return;
+
+	if(mCount == 0)
+	{
+		mMinimum = other.mMinimum;
+		mMaximum = other.mMaximum;
+	}
+	else
+	{
+		mMinimum = std::min(mMinimum, other.mMinimum);
+		mMaximum = std::max(mMaximum, other.mMaximum);
+	}
+
+	mCount += other.mCount;
+	mSum += other.mSum;
+	for(const auto& bucket : other.mBuckets)
+		mBuckets[bucket.first] += bucket.second;
+}
+
+float Histogram::getMean() const
+{
+	return mCount > 0 ? mSum / mCount : 0;
+}
+
+ReplayStatistics::ReplayStatistics() :
+	replays(0), failed(0), scoreMismatches(0), steps(0), rallies(0), servesWon(0),
+	// one second per bucket at normal game speed
+	rallyLength(75),
+	hitsPerRally(1),
+	ballSpeed(1)
+{
+}
+
+void ReplayStatistics::merge(const ReplayStatistics& other)
+{
+	replays += other.replays;
+	failed += other.failed;
+	scoreMismatches += other.scoreMismatches;
+	steps += other.steps;
+	rallies += other.rallies;
+	servesWon += other.servesWon;
+
+	rallyLength.merge(other.rallyLength);
+	hitsPerRally.merge(other.hitsPerRally);
+	ballSpeed.merge(other.ballSpeed);
+}
+
+ReplayAnalysis::ReplayAnalysis()
+{
+	for(int i = 0; i < NUM_SIDES; ++i)
+	{
+		recordedScore[i] = 0;
+		simulatedScore[i] = 0;
+	}
+}
+
+bool ReplayAnalysis::scoreMatches() const
+{
+	return recordedScore[LEFT_SIDE] == simulatedScore[LEFT_SIDE] &&
+			recordedScore[RIGHT_SIDE] == simulatedScore[RIGHT_SIDE];
+}
+
+ReplayAnalyzer::ReplayAnalyzer() :
+	mRallyStart(-1),
+	mRallyHits(0),
+	mServingSide(NO_SIDE)
+{
+}
+
+void ReplayAnalyzer::analyse(ReplayPlayer& player, DuelMatch& match, ReplayAnalysis& result)
+{
+	ReplayStatistics& stats = result.statistics;
+
+	mRallyStart = -1;
+	mRallyHits = 0;
+
+	int step = 0;
+	while(!player.endOfFile() && player.play(&match))
+	{
+		processEvents(match, step, stats);
+		++step;
+	}
+
+	stats.steps = step;
+	stats.replays = 1;
+
+	for(int i = 0; i < NUM_SIDES; ++i)
+	{
+		result.recordedScore[i] = player.getFinalScore(PlayerSide(i));
+		result.simulatedScore[i] = match.getScore(PlayerSide(i));
+	}
+
+	if(!result.scoreMatches())
+		stats.scoreMismatches = 1;
+}
+
+void ReplayAnalyzer::processEvents(const DuelMatch& match, int step, ReplayStatistics& stats)
+{
+	for(const auto& event : match.getEvents())
+	{
+		switch(event.event)
+		{
+		case MatchEvent::BALL_HIT_BLOB:
+			// the first hit after the ball was reset is the serve
+			if(mRallyStart < 0)
+			{
+				mRallyStart = step;
+				mRallyHits = 0;
+				mServingSide = PlayerSide(event.side % NUM_SIDES);
+			}
+			++mRallyHits;
+			stats.ballSpeed.add(match.getBallVelocity().length());
+			break;
+		case MatchEvent::PLAYER_ERROR:
+			if(mRallyStart >= 0)
+			{
+				++stats.rallies;
+				if(event.side != mServingSide)
+					++stats.servesWon;
+				stats.rallyLength.add(step - mRallyStart);
+				stats.hitsPerRally.add(mRallyHits);
+				mRallyStart = -1;
+			}
+			break;
+		case MatchEvent::RESET_BALL:
+			// rallies without an error, e.g. when a savepoint changed the state
+			mRallyStart = -1;
+			break;
+		default:
+			break;
+		}
+	}
+}
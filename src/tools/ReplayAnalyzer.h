@@ -0,0 +1,117 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#pragma once
+
+#include <map>
+#include <string>
+
+#include "Global.h"
+#include "BlobbyDebug.h"
+
+class DuelMatch;
+class ReplayPlayer;
+
+/*! \class Histogram
+	\brief counts values in buckets of fixed width
+	\details Bucket i contains all values in [i * width, (i+1) * width).
+*/
+class Histogram
+{
+	public:
+		explicit Histogram(float bucketWidth);
+
+		void add(float value);
+		/// adds all values counted by other, which has to use the same bucket width
+		void merge(const Histogram& other);
+
+		int getCount() const { return mCount; }
+		float getMean() const;
+		float getMinimum() const { return mMinimum; }
+		float getMaximum() const { return mMaximum; }
+		float getBucketWidth() const { return mBucketWidth; }
+		const std::map<int, int>& getBuckets() const { return mBuckets; }
+
+	private:
+		float mBucketWidth;
+		int mCount;
+		double mSum;
+		float mMinimum;
+		float mMaximum;
+		std::map<int, int> mBuckets;
+};
+
+/*! \struct ReplayStatistics
+	\brief statistics gathered by re-simulating one or more replays
+*/
+struct ReplayStatistics
+{
+	ReplayStatistics();
+
+	void merge(const ReplayStatistics& other);
+
+	int replays;			///!< number of successfully simulated replays
+	int failed;				///!< number of replays that could not be loaded or simulated
+	int scoreMismatches;	///!< replays whose simulated final score differs from the recorded one
+	int steps;				///!< simulated physic steps
+	int rallies;			///!< finished rallies
+	int servesWon;			///!< rallies won by the serving team
+
+	Histogram rallyLength;	///!< rally length in physic steps, from serve to error
+	Histogram hitsPerRally;	///!< blob hits per rally
+	Histogram ballSpeed;	///!< ball speed directly after a blob hit
+};
+
+/*! \struct ReplayAnalysis
+	\brief result of re-simulating a single replay
+*/
+struct ReplayAnalysis
+{
+	std::string file;
+	std::string error;		///!< reason why the replay could not be simulated, empty on success
+	int recordedScore[NUM_SIDES];
+	int simulatedScore[NUM_SIDES];
+	ReplayStatistics statistics;
+
+	ReplayAnalysis();
+	bool scoreMatches() const;
+};
+
+/*! \class ReplayAnalyzer
+	\brief re-simulates a replay and collects statistics about it
+	\details The replay is played into a DuelMatch without any rendering. Rallies are
+			tracked using the MatchEvents of that match: a rally starts with the first
+			blob hit after a serve and ends with the next player error.
+*/
+class ReplayAnalyzer : public ObjectCounter<ReplayAnalyzer>
+{
+	public:
+		ReplayAnalyzer();
+
+		/// plays the loaded replay to the end and collects the statistics into result
+		void analyse(ReplayPlayer& player, DuelMatch& match, ReplayAnalysis& result);
+
+	private:
+		void processEvents(const DuelMatch& match, int step, ReplayStatistics& stats);
+
+		int mRallyStart;		///!< step at which the current rally started, -1 if no rally is running
+		int mRallyHits;
+		PlayerSide mServingSide;
+};
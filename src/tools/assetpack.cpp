@@ -0,0 +1,225 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+/* includes */
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h>
+
+#include "AssetPack.h"
+
+/* implementation */
+
+// the format SoundManager asks the audio device for
+static const int SOUND_FREQUENCY = 44100;
+static const SDL_AudioFormat SOUND_FORMAT = AUDIO_S16SYS;
+static const int SOUND_CHANNELS = 2;
+
+struct PackedAsset
+{
+	AssetPack::Entry entry;
+	std::vector<char> data;
+};
+
+void printHelp()
+{
+	std::cout << "Usage: blobby-asset-pack <output> <file>... [--specular <file>...]" << std::endl;
+	std::cout << "Converts images (.bmp) and sounds (.wav) for the game and writes them into" << std::endl;
+	std::cout << "one pack. The names of the files are stored as given, so they have to be" << std::endl;
+	std::cout << "relative to the data directory, e.g. gfx/ball01.bmp." << std::endl;
+	std::cout << "  --specular   the following images also get a specular map, as used by the blobs" << std::endl;
+	std::cout << "  -h, --help   This message" << std::endl;
+}
+
+bool addImage(std::vector<PackedAsset>& assets, const std::string& filename, bool specular)
+{
+	SDL_Surface* image = SDL_LoadBMP(filename.c_str());
+	if (!image)
+	{
+		std::cerr << "could not load " << filename << ": " << SDL_GetError() << std::endl;
+		return false;
+	}
+
+	SDL_Surface* converted = AssetPack::convertImage(image);
+	SDL_FreeSurface(image);
+
+	for (int pass = 0; pass < (specular ? 2 : 1); ++pass)
+	{
+		if (pass == 1)
+			AssetPack::makeSpecular(converted);
+
+		PackedAsset asset;
+		memset(&asset.entry, 0, sizeof(asset.entry));
+		strncpy(asset.entry.name, filename.c_str(), sizeof(asset.entry.name) - 1);
+		asset.entry.type = pass == 0 ? AssetPack::IMAGE : AssetPack::SPECULAR;
+		asset.entry.width = converted->w;
+		asset.entry.height = converted->h;
+		for (int y = 0; y < converted->h; ++y)
+		{
+			const char* row = (const char*)converted->pixels + y * converted->pitch;
+			asset.data.insert(asset.data.end(), row, row + converted->w * 4);
+		}
+		assets.push_back(asset);
+	}
+
+	SDL_FreeSurface(converted);
+	return true;
+}
+
+bool addSound(std::vector<PackedAsset>& assets, const std::string& filename)
+{
+	SDL_AudioSpec spec;
+	Uint8* buffer;
+	Uint32 length;
+	if (!SDL_LoadWAV(filename.c_str(), &spec, &buffer, &length))
+	{
+		std::cerr << "could not load " << filename << ": " << SDL_GetError() << std::endl;
+		return false;
+	}
+
+	PackedAsset asset;
+	memset(&asset.entry, 0, sizeof(asset.entry));
+	strncpy(asset.entry.name, filename.c_str(), sizeof(asset.entry.name) - 1);
+	asset.entry.type = AssetPack::SOUND;
+	asset.entry.width = SOUND_FREQUENCY;
+	asset.entry.height = SOUND_CHANNELS;
+	asset.entry.format = SOUND_FORMAT;
+
+	// same conversion as SoundManager::loadSound
+	if (spec.freq == SOUND_FREQUENCY && spec.format == SOUND_FORMAT && spec.channels == SOUND_CHANNELS)
+	{
+		asset.data.assign((char*)buffer, (char*)buffer + length);
+	}
+	else
+	{
+		SDL_AudioCVT conversion;
+		if (!SDL_BuildAudioCVT(&conversion, spec.format, spec.channels, spec.freq,
+				SOUND_FORMAT, SOUND_CHANNELS, SOUND_FREQUENCY))
+		{
+			std::cerr << "could not convert " << filename << ": " << SDL_GetError() << std::endl;
+			SDL_FreeWAV(buffer);
+			return false;
+		}
+		std::vector<Uint8> converted(length * conversion.len_mult);
+		memcpy(converted.data(), buffer, length);
+		conversion.buf = converted.data();
+		conversion.len = length;
+		if (SDL_ConvertAudio(&conversion))
+		{
+			std::cerr << "could not convert " << filename << ": " << SDL_GetError() << std::endl;
+			SDL_FreeWAV(buffer);
+			return false;
+		}
+		asset.data.assign(converted.begin(), converted.begin() + conversion.len_cvt);
+	}
+	SDL_FreeWAV(buffer);
+
+	assets.push_back(asset);
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2 || strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-h") == 0)
+	{
+		printHelp();
+		return argc < 2 ? EXIT_FAILURE : EXIT_SUCCESS;
+	}
+
+	std::vector<PackedAsset> assets;
+	bool specular = false;
+	for (int i = 2; i < argc; ++i)
+	{
+		std::string filename = argv[i];
+		if (filename == "--specular")
+		{
+			specular = true;
+			continue;
+		}
+		if (filename.size() >= sizeof(AssetPack::Entry::name))
+		{
+			std::cerr << "file name too long: " << filename << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		std::size_t first = assets.size();
+		std::string extension = filename.substr(filename.find_last_of('.') + 1);
+		bool success;
+		if (extension == "bmp")
+			success = addImage(assets, filename, specular);
+		else if (extension == "wav")
+			success = addSound(assets, filename);
+		else
+		{
+			std::cerr << "unknown file type: " << filename << std::endl;
+			success = false;
+		}
+
+		if (!success)
+			return EXIT_FAILURE;
+
+		// the game only uses the packed assets while the file has the same size
+		std::ifstream source(filename, std::ios::binary | std::ios::ate);
+		for (std::size_t j = first; j < assets.size(); ++j)
+			assets[j].entry.sourceSize = std::uint32_t(source.tellg());
+	}
+
+	AssetPack::Header header;
+	memcpy(header.magic, AssetPack::MAGIC, sizeof(header.magic));
+	header.version = AssetPack::VERSION;
+	header.entryCount = assets.size();
+
+	// the data is 16 byte aligned, so it can be read with SIMD instructions
+	std::uint64_t offset = sizeof(AssetPack::Header) + assets.size() * sizeof(AssetPack::Entry);
+	for (PackedAsset& asset : assets)
+	{
+		offset = (offset + 15) & ~std::uint64_t(15);
+		asset.entry.offset = offset;
+		asset.entry.size = asset.data.size();
+		offset += asset.data.size();
+	}
+
+	std::ofstream file(argv[1], std::ios::binary);
+	file.write((const char*)&header, sizeof(header));
+	for (const PackedAsset& asset : assets)
+		file.write((const char*)&asset.entry, sizeof(asset.entry));
+	std::uint64_t position = sizeof(AssetPack::Header) + assets.size() * sizeof(AssetPack::Entry);
+	for (const PackedAsset& asset : assets)
+	{
+		static const char padding[16] = {0};
+		file.write(padding, asset.entry.offset - position);
+		file.write(asset.data.data(), asset.data.size());
+		position = asset.entry.offset + asset.data.size();
+	}
+
+	if (!file)
+	{
+		std::cerr << "could not write " << argv[1] << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,410 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+/* includes */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include "DuelMatch.h"
+#include "FileSystem.h"
+#include "GameLogic.h"
+#include "IUserConfigReader.h"
+#include "replays/ReplayPlayer.h"
+#include "tools/ReplayAnalyzer.h"
+
+#if __DESKTOP__
+#ifndef WIN32
+#include "config.h"
+#endif
+#endif
+
+/* implementation */
+
+static std::string g_directory;
+static std::string g_output_file;
+static std::string g_format = "json";
+static unsigned g_jobs = 0;
+
+void printHelp();
+void process_arguments(int argc, char** argv);
+void setup_physfs(char* argv0);
+
+/*! \class RulesCache
+	\brief names the rules scripts stored in the replays
+	\details The compiled rules are cached by name, so every distinct script gets its own
+			name, which is shared by all replays using it.
+*/
+class RulesCache : public boost::noncopyable
+{
+	public:
+		/// gets the name of the rules file \p script is loaded as
+		std::string getRulesFile(const std::string& script)
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+
+			auto found = mFiles.find(script);
+			if(found != mFiles.end())
+				return found->second;
+
+			std::string name = "replay_rules_" + std::to_string(mFiles.size()) + ".lua";
+			mFiles[script] = name;
+			return name;
+		}
+
+	private:
+		std::mutex mMutex;
+		std::map<std::string, std::string> mFiles;
+};
+
+ReplayAnalysis analyseReplay(const std::string& file, RulesCache& rules, int scoreToWin)
+{
+	ReplayAnalysis result;
+	result.file = file;
+
+	try
+	{
+		ReplayPlayer player;
+		player.load(file);
+
+		bool playerEnabled[MAX_PLAYERS];
+		for (int i = 0; i < MAX_PLAYERS; ++i)
+			playerEnabled[i] = player.getPlayerEnabled(PlayerSide(i));
+
+		// the rules are loaded from the replay, and print nothing, as that would end up in our output
+		DuelMatch match(false, FALLBACK_RULES_NAME, playerEnabled, scoreToWin);
+		match.setRulesScript(rules.getRulesFile(player.getRules()), player.getRules(), scoreToWin, nullptr);
+
+		ReplayAnalyzer analyzer;
+		analyzer.analyse(player, match, result);
+	}
+	catch (std::exception& e)
+	{
+		result.error = e.what();
+		if (result.error.empty())
+			result.error = "could not load replay";
+		result.statistics = ReplayStatistics();
+		result.statistics.failed = 1;
+	}
+
+	return result;
+}
+
+std::string jsonString(const std::string& text)
+{
+	std::string result = "\"";
+	for (char c : text)
+	{
+		if (c == '"' || c == '\\')
+		{
+			result += '\\';
+			result += c;
+		}
+		else if ((unsigned char)c < 0x20)
+		{
+			char escaped[8];
+			snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+			result += escaped;
+		}
+		else
+		{
+			result += c;
+		}
+	}
+	return result + "\"";
+}
+
+std::string csvString(const std::string& text)
+{
+	if (text.find_first_of(",\"\n") == std::string::npos)
+		return text;
+
+	std::string result = "\"";
+	for (char c : text)
+	{
+		if (c == '"')
+			result += '"';
+		result += c;
+	}
+	return result + "\"";
+}
+
+void writeHistogram(std::ostream& stream, const std::string& name, const Histogram& histogram)
+{
+	stream << "\t" << jsonString(name) << ": {\n";
+	stream << "\t\t\"count\": " << histogram.getCount() << ",\n";
+	stream << "\t\t\"mean\": " << histogram.getMean() << ",\n";
+	stream << "\t\t\"min\": " << histogram.getMinimum() << ",\n";
+	stream << "\t\t\"max\": " << histogram.getMaximum() << ",\n";
+	stream << "\t\t\"bucket_width\": " << histogram.getBucketWidth() << ",\n";
+	stream << "\t\t\"buckets\": {";
+	bool first = true;
+	for (const auto& bucket : histogram.getBuckets())
+	{
+		stream << (first ? "" : ", ") << "\"" << bucket.first * histogram.getBucketWidth() << "\": " << bucket.second;
+		first = false;
+	}
+	stream << "}\n\t}";
+}
+
+/// writes the aggregated statistics, followed by the replays which failed the checks
+void writeJSON(std::ostream& stream, const std::vector<ReplayAnalysis>& results, const ReplayStatistics& total)
+{
+	stream << "{\n";
+	stream << "\t\"replays\": " << total.replays << ",\n";
+	stream << "\t\"failed\": " << total.failed << ",\n";
+	stream << "\t\"score_mismatches\": " << total.scoreMismatches << ",\n";
+	stream << "\t\"steps\": " << total.steps << ",\n";
+	stream << "\t\"rallies\": " << total.rallies << ",\n";
+	stream << "\t\"serve_win_rate\": " << (total.rallies > 0 ? (float)total.servesWon / total.rallies : 0) << ",\n";
+	writeHistogram(stream, "rally_length", total.rallyLength);
+	stream << ",\n";
+	writeHistogram(stream, "hits_per_rally", total.hitsPerRally);
+	stream << ",\n";
+	writeHistogram(stream, "ball_speed", total.ballSpeed);
+	stream << ",\n";
+
+	stream << "\t\"errors\": [";
+	bool first = true;
+	for (const auto& result : results)
+	{
+		if (result.error.empty() && result.scoreMatches())
+			continue;
+
+		stream << (first ? "\n" : ",\n") << "\t\t{\"file\": " << jsonString(result.file) << ", ";
+		if (!result.error.empty())
+		{
+			stream << "\"error\": " << jsonString(result.error) << "}";
+		}
+		else
+		{
+			stream << "\"recorded_score\": [" << result.recordedScore[LEFT_SIDE] << ", " << result.recordedScore[RIGHT_SIDE] << "], ";
+			stream << "\"simulated_score\": [" << result.simulatedScore[LEFT_SIDE] << ", " << result.simulatedScore[RIGHT_SIDE] << "]}";
+		}
+		first = false;
+	}
+	stream << (first ? "]\n" : "\n\t]\n");
+	stream << "}" << std::endl;
+}
+
+/// writes one line per replay
+void writeCSV(std::ostream& stream, const std::vector<ReplayAnalysis>& results)
+{
+	stream << "file,steps,rallies,serves_won,mean_rally_length,mean_hits_per_rally,max_ball_speed,"
+			<< "recorded_left,recorded_right,simulated_left,simulated_right,score_ok,error\n";
+
+	for (const auto& result : results)
+	{
+		const ReplayStatistics& stats = result.statistics;
+		stream << csvString(result.file) << ","
+				<< stats.steps << ","
+				<< stats.rallies << ","
+				<< stats.servesWon << ","
+				<< stats.rallyLength.getMean() << ","
+				<< stats.hitsPerRally.getMean() << ","
+				<< stats.ballSpeed.getMaximum() << ","
+				<< result.recordedScore[LEFT_SIDE] << ","
+				<< result.recordedScore[RIGHT_SIDE] << ","
+				<< result.simulatedScore[LEFT_SIDE] << ","
+				<< result.simulatedScore[RIGHT_SIDE] << ","
+				<< (result.error.empty() && result.scoreMatches() ? 1 : 0) << ","
+				<< csvString(result.error) << "\n";
+	}
+	stream.flush();
+}
+
+int main(int argc, char** argv)
+{
+	process_arguments(argc, argv);
+
+	FileSystem fileSys(argv[0]);
+	setup_physfs(argv[0]);
+	fileSys.addToSearchPath(g_directory);
+
+	std::vector<std::string> files = fileSys.enumerateFiles("", ".bvr", true);
+	std::sort(files.begin(), files.end());
+
+	// the score to win is not part of the replay, so we use the configured one like ReplayState does
+	int scoreToWin = 15;
+	try
+	{
+		scoreToWin = IUserConfigReader::createUserConfigReader("config.xml")->getInteger("scoretowin");
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << "Warning: could not read config.xml, playing to " << scoreToWin << " points" << std::endl;
+	}
+
+	unsigned jobs = g_jobs > 0 ? g_jobs : std::max(1u, std::thread::hardware_concurrency());
+
+	auto start = std::chrono::steady_clock::now();
+
+	std::vector<ReplayAnalysis> results(files.size());
+	std::atomic<std::size_t> next(0);
+	{
+		RulesCache rules;
+		std::vector<std::future<void>> workers;
+		for (unsigned i = 0; i < jobs; ++i)
+		{
+			workers.push_back(std::async(std::launch::async, [&]()
+			{
+				for (std::size_t index = next++; index < files.size(); index = next++)
+					results[index] = analyseReplay(files[index], rules, scoreToWin);
+			}));
+		}
+
+		for (auto& worker : workers)
+			worker.get();
+	}
+
+	ReplayStatistics total;
+	for (const auto& result : results)
+		total.merge(result.statistics);
+
+	std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+	std::cerr << "simulated " << total.replays << " of " << files.size() << " replays using " << jobs
+			<< " threads in " << duration.count() << " s" << std::endl;
+
+	std::ofstream outputFile;
+	if (!g_output_file.empty())
+	{
+		outputFile.open(g_output_file);
+		if (!outputFile)
+		{
+			std::cerr << "could not open " << g_output_file << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	std::ostream& stream = g_output_file.empty() ? std::cout : outputFile;
+
+	if (g_format == "csv")
+		writeCSV(stream, results);
+	else
+		writeJSON(stream, results, total);
+
+	return (total.failed > 0 || total.scoreMismatches > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+void process_arguments(int argc, char** argv)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--format") == 0 || strcmp(argv[i], "-f") == 0)
+		{
+			++i;
+			if (i >= argc || (strcmp(argv[i], "json") != 0 && strcmp(argv[i], "csv") != 0))
+			{
+				std::cout << "\"format\" option needs json or csv as argument" << std::endl;
+				printHelp();
+				exit(1);
+			}
+			g_format = argv[i];
+			continue;
+		}
+		if (strcmp(argv[i], "--output") == 0 || strcmp(argv[i], "-o") == 0)
+		{
+			++i;
+			if (i >= argc)
+			{
+				std::cout << "\"output\" option needs an argument" << std::endl;
+				printHelp();
+				exit(1);
+			}
+			g_output_file = argv[i];
+			continue;
+		}
+		if (strcmp(argv[i], "--jobs") == 0 || strcmp(argv[i], "-j") == 0)
+		{
+			++i;
+			if (i >= argc || std::atoi(argv[i]) <= 0)
+			{
+				std::cout << "\"jobs\" option needs a positive number as argument" << std::endl;
+				printHelp();
+				exit(1);
+			}
+			g_jobs = std::atoi(argv[i]);
+			continue;
+		}
+		if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0)
+		{
+			printHelp();
+			exit(3);
+		}
+		if (argv[i][0] != '-' && g_directory.empty())
+		{
+			g_directory = argv[i];
+			continue;
+		}
+		std::cout << "Unknown option \"" << argv[i] << "\"" << std::endl;
+		printHelp();
+		exit(1);
+	}
+
+	if (g_directory.empty())
+	{
+		printHelp();
+		exit(1);
+	}
+}
+
+void setup_physfs(char* argv0)
+{
+	FileSystem& fs = FileSystem::getSingleton();
+
+	#if __DESKTOP__
+	#ifndef WIN32
+		fs.addToSearchPath(BLOBBY_INSTALL_PREFIX  "/share/blobby");
+		fs.addToSearchPath(BLOBBY_INSTALL_PREFIX  "/share/blobby/rules.zip");
+	#endif
+	#endif
+	fs.addToSearchPath("data");
+	fs.addToSearchPath("data" + fs.getDirSeparator() + "rules.zip");
+
+	// the configuration of the user, for the score to win
+	#if !defined(WIN32)
+		fs.addToSearchPath(fs.getUserDir() + ".blobby", false);
+	#endif
+}
+
+void printHelp()
+{
+	std::cout << "Usage: blobby-replay-tool [OPTION...] <directory>" << std::endl;
+	std::cout << "Re-simulates all replays in <directory> and prints statistics about them." << std::endl;
+	std::cout << "  -f, --format <json|csv>   json: aggregated statistics (default)" << std::endl;
+	std::cout << "                            csv: one line per replay" << std::endl;
+	std::cout << "  -o, --output <file>       Write to file instead of stdout" << std::endl;
+	std::cout << "  -j, --jobs <n>            Number of threads, defaults to the number of cores" << std::endl;
+	std::cout << "  -h, --help                This message\n" << std::endl;
+	std::cout << "The exit code is 1 if a replay could not be simulated or its simulated\n"
+			  << "final score differs from the recorded one." << std::endl;
+}
@@ -0,0 +1,177 @@
+#define BOOST_TEST_MODULE GlyphCache
+#include <boost/test/unit_test.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "GlyphCache.h"
+#include "RenderManager.h"
+
+// helper
+struct GlyphLoader
+{
+	std::map<unsigned int, int> loads;
+
+	SDL_Surface* operator()(unsigned int codepoint, bool highlight)
+	{
+		++loads[codepoint];
+		SDL_Surface* glyph = SDL_CreateRGBSurface(0, GlyphCache::GLYPH_SIZE, GlyphCache::GLYPH_SIZE, 32,
+				0x000000FF, 0x0000FF00, 0x00FF0000, 0);
+		SDL_FillRect(glyph, 0, SDL_MapRGB(glyph->format, 255, highlight ? 255 : 0, codepoint & 0xFF));
+		return glyph;
+	}
+};
+
+// encodes code points below 0x10000
+std::string utf8(unsigned int codepoint)
+{
+	std::string text;
+	if( codepoint < 0x80 )
+	{
+		text += char(codepoint);
+	}
+	else if( codepoint < 0x800 )
+	{
+		text += char(0xC0 | codepoint >> 6);
+		text += char(0x80 | (codepoint & 0x3F));
+	}
+	else
+	{
+		text += char(0xE0 | codepoint >> 12);
+		text += char(0x80 | (codepoint >> 6 & 0x3F));
+		text += char(0x80 | (codepoint & 0x3F));
+	}
+	return text;
+}
+
+bool same_rect(const SDL_Rect& a, const SDL_Rect& b)
+{
+	return a.x == b.x && a.y == b.y && a.w == b.w && a.h == b.h;
+}
+
+// the number of glyphs that fit on the page, see the constructor of GlyphCache
+const int CELLS = (GlyphCache::PAGE_WIDTH / (GlyphCache::GLYPH_SIZE + 2)) * (GlyphCache::PAGE_HEIGHT / (GlyphCache::GLYPH_SIZE + 2));
+// some glyphs which have no image in the game font
+const unsigned int FIRST_GLYPH = 0x4E00;
+
+BOOST_AUTO_TEST_SUITE( glyph_cache )
+
+BOOST_AUTO_TEST_CASE( glyphs_are_loaded_once )
+{
+	GlyphLoader loader;
+	GlyphCache cache(std::ref(loader));
+
+	std::vector<SDL_Rect> rects = cache.getText("abca", TF_NORMAL);
+	BOOST_REQUIRE_EQUAL( rects.size(), 4u );
+	BOOST_CHECK( same_rect(rects[0], rects[3]) );
+	BOOST_CHECK( !same_rect(rects[0], rects[1]) );
+	BOOST_CHECK_EQUAL( rects[0].w, GlyphCache::GLYPH_SIZE );
+
+	cache.nextFrame();
+	cache.getText("cab", TF_NORMAL);
+	cache.getText("b\xC3\xA4", TF_NORMAL);
+	BOOST_CHECK_EQUAL( loader.loads['a'], 1 );
+	BOOST_CHECK_EQUAL( loader.loads['b'], 1 );
+	BOOST_CHECK_EQUAL( loader.loads['c'], 1 );
+	BOOST_CHECK_EQUAL( loader.loads[0xE4], 1 );
+}
+
+BOOST_AUTO_TEST_CASE( highlight_and_obfuscate )
+{
+	GlyphLoader loader;
+	GlyphCache cache(std::ref(loader));
+
+	SDL_Rect normal = cache.getText("a", TF_NORMAL)[0];
+	SDL_Rect highlight = cache.getText("a", TF_HIGHLIGHT)[0];
+	BOOST_CHECK( !same_rect(normal, highlight) );
+	BOOST_CHECK_EQUAL( loader.loads['a'], 2 );
+
+	std::vector<SDL_Rect> hidden = cache.getText("secret", TF_OBFUSCATE);
+	BOOST_REQUIRE_EQUAL( hidden.size(), 6u );
+	BOOST_CHECK( same_rect(hidden[0], hidden[5]) );
+	BOOST_CHECK_EQUAL( loader.loads['*'], 1 );
+	BOOST_CHECK_EQUAL( loader.loads['s'], 0 );
+}
+
+BOOST_AUTO_TEST_CASE( least_recently_used_glyph_is_replaced )
+{
+	GlyphLoader loader;
+	GlyphCache cache(std::ref(loader));
+
+	// a glyph that is drawn every frame and one that is only drawn in the first
+	const std::string kept = "k";
+	const std::string dropped = "d";
+	cache.getText(kept, TF_NORMAL);
+	cache.getText(dropped, TF_NORMAL);
+	cache.nextFrame();
+
+	// one new glyph per frame until the page has been filled once more
+	for(int i = 0; i < CELLS; ++i)
+	{
+		cache.getText(kept, TF_NORMAL);
+		cache.getText(utf8(FIRST_GLYPH + i), TF_NORMAL);
+		cache.nextFrame();
+	}
+
+	BOOST_CHECK_EQUAL( loader.loads['k'], 1 );
+	BOOST_CHECK_EQUAL( loader.loads['d'], 1 );
+	cache.getText(dropped, TF_NORMAL);
+	BOOST_CHECK_EQUAL( loader.loads['d'], 2 );
+	// the oldest of the new glyphs made room for it
+	cache.getText(utf8(FIRST_GLYPH + CELLS - 1), TF_NORMAL);
+	BOOST_CHECK_EQUAL( loader.loads[FIRST_GLYPH + CELLS - 1], 1 );
+	cache.getText(utf8(FIRST_GLYPH), TF_NORMAL);
+	BOOST_CHECK_EQUAL( loader.loads[FIRST_GLYPH], 2 );
+}
+
+BOOST_AUTO_TEST_CASE( glyphs_of_the_current_frame_are_kept )
+{
+	GlyphLoader loader;
+	GlyphCache cache(std::ref(loader));
+
+	// more glyphs in one frame than fit on the page
+	std::string text;
+	for(int i = 0; i < CELLS + 10; ++i)
+		text += utf8(FIRST_GLYPH + i);
+
+	std::vector<SDL_Rect> rects = cache.getText(text, TF_NORMAL);
+	BOOST_REQUIRE_EQUAL( rects.size(), (std::size_t)(CELLS + 10) );
+	for(int i = 0; i < CELLS; ++i)
+	{
+		BOOST_REQUIRE_EQUAL( rects[i].w, GlyphCache::GLYPH_SIZE );
+		for(int j = 0; j < i; ++j)
+			BOOST_REQUIRE( !same_rect(rects[i], rects[j]) );
+	}
+	// the glyphs which did not fit are empty
+	for(int i = CELLS; i < CELLS + 10; ++i)
+		BOOST_CHECK_EQUAL( rects[i].w, 0 );
+
+	// they are tried again in the next frame
+	cache.nextFrame();
+	std::vector<SDL_Rect> later = cache.getText(utf8(FIRST_GLYPH + CELLS), TF_NORMAL);
+	BOOST_CHECK_EQUAL( later[0].w, GlyphCache::GLYPH_SIZE );
+}
+
+BOOST_AUTO_TEST_CASE( changed_rows )
+{
+	GlyphLoader loader;
+	GlyphCache cache(std::ref(loader));
+
+	SDL_Rect rows;
+	// the whole page is new
+	BOOST_REQUIRE( cache.takeChangedRows(rows) );
+	BOOST_CHECK_EQUAL( rows.h, GlyphCache::PAGE_HEIGHT );
+	BOOST_CHECK( !cache.takeChangedRows(rows) );
+
+	SDL_Rect glyph = cache.getText("x", TF_NORMAL)[0];
+	BOOST_REQUIRE( cache.takeChangedRows(rows) );
+	BOOST_CHECK_LE( rows.y, glyph.y );
+	BOOST_CHECK_GE( rows.y + rows.h, glyph.y + glyph.h );
+
+	// glyphs which are already on the page change nothing
+	cache.getText("x", TF_NORMAL);
+	BOOST_CHECK( !cache.takeChangedRows(rows) );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
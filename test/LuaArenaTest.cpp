@@ -0,0 +1,161 @@
+#define BOOST_TEST_MODULE LuaArena
+#include <boost/test/unit_test.hpp>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "LuaArena.h"
+#include "LuaCompat.h"
+
+// helper
+void fill(void* block, std::size_t size, unsigned char seed)
+{
+	unsigned char* bytes = static_cast<unsigned char*>(block);
+	for(std::size_t i = 0; i < size; ++i)
+		bytes[i] = (unsigned char)(seed + i);
+}
+
+bool check(const void* block, std::size_t size, unsigned char seed)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(block);
+	for(std::size_t i = 0; i < size; ++i)
+	{
+		if( bytes[i] != (unsigned char)(seed + i) )
+			return false;
+	}
+	return true;
+}
+
+// sizes below, at and above the largest block served from the chunks
+const std::size_t SIZES[] = { 1, 8, 16, 17, 100, 255, 256, 257, 300, 1000, 100000 };
+
+BOOST_AUTO_TEST_SUITE( lua_arena )
+
+BOOST_AUTO_TEST_CASE( allocate_deallocate )
+{
+	LuaArena arena;
+	for(std::size_t size : SIZES)
+	{
+		void* block = arena.allocate(size);
+		BOOST_REQUIRE( block );
+		fill(block, size, 7);
+		BOOST_CHECK( check(block, size, 7) );
+		arena.deallocate(block, size);
+	}
+}
+
+BOOST_AUTO_TEST_CASE( small_blocks_are_reused )
+{
+	LuaArena arena;
+	void* first = arena.allocate(40);
+	arena.deallocate(first, 40);
+
+	// same size class
+	void* second = arena.allocate(48);
+	BOOST_CHECK_EQUAL( first, second );
+	arena.deallocate(second, 48);
+}
+
+BOOST_AUTO_TEST_CASE( small_blocks_do_not_overlap )
+{
+	LuaArena arena;
+	std::vector<void*> blocks;
+	// more than one chunk
+	for(int i = 0; i < 5000; ++i)
+	{
+		blocks.push_back(arena.allocate(24));
+		fill(blocks.back(), 24, (unsigned char)i);
+	}
+
+	for(int i = 0; i < 5000; ++i)
+	{
+		BOOST_REQUIRE( check(blocks[i], 24, (unsigned char)i) );
+		arena.deallocate(blocks[i], 24);
+	}
+}
+
+BOOST_AUTO_TEST_CASE( reallocate_keeps_content )
+{
+	LuaArena arena;
+	for(std::size_t from : SIZES)
+	{
+		for(std::size_t to : SIZES)
+		{
+			void* block = arena.allocate(from);
+			fill(block, from, 3);
+
+			block = arena.reallocate(block, from, to);
+			BOOST_REQUIRE( block );
+			BOOST_CHECK_MESSAGE( check(block, std::min(from, to), 3), "reallocating " << from << " to " << to );
+
+			// the whole new size has to be usable
+			fill(block, to, 5);
+			arena.deallocate(block, to);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( grow_and_shrink_across_threshold )
+{
+	LuaArena arena;
+	void* block = arena.allocate(200);
+	fill(block, 200, 1);
+
+	// small to large, large to large and back to small
+	block = arena.reallocate(block, 200, 4000);
+	BOOST_REQUIRE( check(block, 200, 1) );
+	fill(block, 4000, 2);
+	block = arena.reallocate(block, 4000, 8000);
+	BOOST_REQUIRE( check(block, 4000, 2) );
+	block = arena.reallocate(block, 8000, 64);
+	BOOST_REQUIRE( check(block, 64, 2) );
+
+	// the shrunk block is a small block now, it is reused for the same size class
+	arena.deallocate(block, 64);
+	void* reused = arena.allocate(64);
+	BOOST_CHECK_EQUAL( block, reused );
+	arena.deallocate(reused, 64);
+}
+
+BOOST_AUTO_TEST_CASE( state_memory_accounting )
+{
+	lua_State* state = LuaArena::newState();
+	BOOST_REQUIRE( state );
+	luaL_openlibs(state);
+	LuaArena* arena = LuaArena::fromState(state);
+	lua_gc(state, LUA_GCCOLLECT, 0);
+	std::size_t initial = arena->getUsedMemory();
+
+	// tables and strings which grow and shrink across the small block size
+	const char* script =
+		"local t = {}\n"
+		"for i = 1, 10000 do t[i] = string.rep('x', i % 600) end\n"
+		"for i = 1, 10000 do t[i] = nil end\n"
+		"t = nil\n";
+	BOOST_REQUIRE_EQUAL( luaL_dostring(state, script), 0 );
+
+	BOOST_CHECK_GT( arena->getPeakMemory(), initial );
+	lua_gc(state, LUA_GCCOLLECT, 0);
+	BOOST_CHECK_LE( arena->getUsedMemory(), initial + 1024 );
+
+	LuaArena::closeState(state);
+}
+
+BOOST_AUTO_TEST_CASE( state_memory_limit )
+{
+	lua_State* state = LuaArena::newState();
+	luaL_openlibs(state);
+	LuaArena* arena = LuaArena::fromState(state);
+	arena->setLimit(arena->getUsedMemory() + 64 * 1024);
+
+	BOOST_CHECK_NE( luaL_dostring(state, "local s = string.rep('x', 1000000)"), 0 );
+	BOOST_CHECK_LE( arena->getUsedMemory(), arena->getPeakMemory() );
+
+	arena->setLimit(0);
+	BOOST_CHECK_EQUAL( luaL_dostring(state, "local s = string.rep('x', 1000000)"), 0 );
+
+	LuaArena::closeState(state);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,131 @@
+#define BOOST_TEST_MODULE ReplayInputCoder
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "replays/ReplayDefs.h"
+#include "replays/ReplayInputCoder.h"
+
+// helper
+void check_round_trip(const std::vector<uint8_t>& input, int bytesPerStep)
+{
+	ReplayInputDecoder decoder;
+	decoder.load(encodeReplayInput(input, bytesPerStep));
+
+	// the input is padded to full steps
+	BOOST_REQUIRE_GE( decoder.getLength(), (int)input.size() );
+	BOOST_REQUIRE_LT( decoder.getLength(), (int)input.size() + bytesPerStep );
+
+	for(unsigned int i = 0; i < input.size(); ++i)
+	{
+		if( decoder.getByte(i) != input[i] )
+		{
+			BOOST_ERROR("byte " << i << " decoded as " << (int)decoder.getByte(i) << " instead of " << (int)input[i]);
+			return;
+		}
+	}
+}
+
+std::vector<uint8_t> random_input(int length)
+{
+	std::vector<uint8_t> input(length);
+	for(uint8_t& byte : input)
+		byte = std::rand() & 0xFF;
+	return input;
+}
+
+BOOST_AUTO_TEST_SUITE( replay_input_coder )
+
+BOOST_AUTO_TEST_CASE( empty_input )
+{
+	check_round_trip(std::vector<uint8_t>(), 1);
+}
+
+BOOST_AUTO_TEST_CASE( random_input_round_trip )
+{
+	std::srand(12345);
+
+	// lengths around the keyframe period, so the last block is short, full or empty
+	const int lengths[] = { 1, 17, REPLAY_SAVEPOINT_PERIOD - 1, REPLAY_SAVEPOINT_PERIOD,
+							REPLAY_SAVEPOINT_PERIOD + 1, 5 * REPLAY_SAVEPOINT_PERIOD + 3 };
+	for(int bytesPerStep = 1; bytesPerStep <= 2; ++bytesPerStep)
+	{
+		for(int length : lengths)
+		{
+			check_round_trip( random_input(length * bytesPerStep), bytesPerStep );
+			// not a multiple of the step size
+			check_round_trip( random_input(length * bytesPerStep + 1), bytesPerStep );
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( constant_input_round_trip )
+{
+	const uint8_t values[] = { 0, 0x3F, 0xFF };
+	for(int bytesPerStep = 1; bytesPerStep <= 2; ++bytesPerStep)
+	{
+		for(uint8_t value : values)
+		{
+			std::vector<uint8_t> input(4 * REPLAY_SAVEPOINT_PERIOD * bytesPerStep, value);
+			check_round_trip(input, bytesPerStep);
+
+			// runs are coded, so this has to be much smaller than the input
+			if( value == 0 )
+				BOOST_CHECK_LT( encodeReplayInput(input, bytesPerStep).size(), input.size() / 50 );
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( runs_with_changes )
+{
+	std::srand(54321);
+
+	// long runs interrupted by single changes, like real games
+	std::vector<uint8_t> input;
+	while(input.size() < 3 * REPLAY_SAVEPOINT_PERIOD)
+		input.insert(input.end(), std::rand() % 200 + 1, std::rand() & 0xFF);
+
+	check_round_trip(input, 1);
+	check_round_trip(input, 2);
+}
+
+BOOST_AUTO_TEST_CASE( random_access )
+{
+	std::srand(999);
+	std::vector<uint8_t> input = random_input(6 * REPLAY_SAVEPOINT_PERIOD);
+
+	ReplayInputDecoder decoder;
+	decoder.load(encodeReplayInput(input, 1));
+
+	// seeking backwards and forwards has to decode the right block
+	for(int i = 0; i < 1000; ++i)
+	{
+		int position = std::rand() % input.size();
+		BOOST_REQUIRE_EQUAL( (int)decoder.getByte(position), (int)input[position] );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( raw_input )
+{
+	std::vector<uint8_t> input = random_input(1000);
+
+	ReplayInputDecoder decoder;
+	decoder.loadRaw(input);
+
+	BOOST_REQUIRE_EQUAL( decoder.getLength(), (int)input.size() );
+	for(unsigned int i = 0; i < input.size(); ++i)
+		BOOST_REQUIRE_EQUAL( (int)decoder.getByte(i), (int)input[i] );
+}
+
+BOOST_AUTO_TEST_CASE( truncated_stream )
+{
+	std::vector<uint8_t> stream = encodeReplayInput(random_input(2 * REPLAY_SAVEPOINT_PERIOD), 1);
+	stream.resize(3);
+
+	ReplayInputDecoder decoder;
+	BOOST_CHECK_THROW( decoder.load(stream), std::runtime_error );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,117 @@
+#define BOOST_TEST_MODULE SPSCQueue
+#include <boost/test/unit_test.hpp>
+
+#include <thread>
+
+#include "SPSCQueue.h"
+
+const unsigned int CAPACITY = 4;
+typedef SPSCQueue<int, CAPACITY> Queue;
+
+// helper
+void fill(Queue& queue, int first, int count)
+{
+	for(int i = 0; i < count; ++i)
+		BOOST_REQUIRE( queue.push(first + i) );
+}
+
+void drain(Queue& queue, int first, int count)
+{
+	for(int i = 0; i < count; ++i)
+	{
+		int element = -1;
+		BOOST_REQUIRE( queue.pop(element) );
+		BOOST_REQUIRE_EQUAL( element, first + i );
+	}
+}
+
+BOOST_AUTO_TEST_SUITE( spsc_queue )
+
+BOOST_AUTO_TEST_CASE( empty_queue )
+{
+	Queue queue;
+	int element = -1;
+	BOOST_CHECK( !queue.pop(element) );
+	BOOST_CHECK_EQUAL( element, -1 );
+}
+
+BOOST_AUTO_TEST_CASE( full_queue )
+{
+	Queue queue;
+	fill(queue, 0, CAPACITY);
+	BOOST_CHECK( !queue.push(100) );
+
+	// one free slot after a pop
+	drain(queue, 0, 1);
+	BOOST_CHECK( queue.push(100) );
+	BOOST_CHECK( !queue.push(101) );
+
+	drain(queue, 1, CAPACITY - 1);
+	drain(queue, 100, 1);
+	int element;
+	BOOST_CHECK( !queue.pop(element) );
+}
+
+BOOST_AUTO_TEST_CASE( wrap_around )
+{
+	Queue queue;
+	// the indices wrap around many times, with every fill level
+	int next = 0;
+	for(int round = 0; round < 100; ++round)
+	{
+		int count = round % CAPACITY + 1;
+		fill(queue, next, count);
+		drain(queue, next, count);
+		next += count;
+	}
+
+	// full and empty are still told apart at every position of the indices
+	for(unsigned int offset = 0; offset <= CAPACITY; ++offset)
+	{
+		fill(queue, 0, 1);
+		drain(queue, 0, 1);
+
+		fill(queue, 0, CAPACITY);
+		BOOST_CHECK( !queue.push(-1) );
+		drain(queue, 0, CAPACITY);
+		int element;
+		BOOST_CHECK( !queue.pop(element) );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( producer_and_consumer_thread )
+{
+	Queue queue;
+	const int COUNT = 100000;
+
+	std::thread producer([&queue]()
+	{
+		for(int i = 0; i < COUNT; ++i)
+		{
+			while( !queue.push(i) )
+				std::this_thread::yield();
+		}
+	});
+
+	// every element arrives once and in order
+	int expected = 0;
+	bool ordered = true;
+	while(expected < COUNT)
+	{
+		int element;
+		if( !queue.pop(element) )
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		ordered = ordered && element == expected;
+		++expected;
+	}
+	producer.join();
+
+	BOOST_CHECK( ordered );
+	int element;
+	BOOST_CHECK( !queue.pop(element) );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,106 @@
+#define BOOST_TEST_MODULE UTF8
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+
+#include "UTF8.h"
+
+// helper
+std::vector<unsigned int> decode(const std::string& text)
+{
+	std::vector<unsigned int> codepoints;
+	for(auto iter = text.cbegin(); iter != text.cend(); )
+		codepoints.push_back( nextCodepoint(iter, text.cend()) );
+	return codepoints;
+}
+
+void check_decode(const std::string& text, const std::vector<unsigned int>& expected)
+{
+	std::vector<unsigned int> codepoints = decode(text);
+	BOOST_CHECK_EQUAL_COLLECTIONS( codepoints.begin(), codepoints.end(), expected.begin(), expected.end() );
+	BOOST_CHECK_EQUAL( characterCount(text), expected.size() );
+}
+
+const unsigned int R = UTF8_REPLACEMENT;
+
+BOOST_AUTO_TEST_SUITE( utf8 )
+
+BOOST_AUTO_TEST_CASE( ascii )
+{
+	check_decode("", {});
+	check_decode("Blobby 2", {'B', 'l', 'o', 'b', 'b', 'y', ' ', '2'});
+}
+
+BOOST_AUTO_TEST_CASE( multi_byte )
+{
+	check_decode("\xC3\xA4", {0xE4});
+	check_decode("\xE2\x82\xAC", {0x20AC});
+	check_decode("\xF0\x9F\x98\x80", {0x1F600});
+	check_decode("a\xC3\xA4\xE2\x82\xAC" "b", {'a', 0xE4, 0x20AC, 'b'});
+}
+
+BOOST_AUTO_TEST_CASE( boundaries )
+{
+	// smallest and largest code point of each length
+	check_decode("\x7F", {0x7F});
+	check_decode("\xC2\x80", {0x80});
+	check_decode("\xDF\xBF", {0x7FF});
+	check_decode("\xE0\xA0\x80", {0x800});
+	check_decode("\xEF\xBF\xBF", {0xFFFF});
+	check_decode("\xF0\x90\x80\x80", {0x10000});
+	check_decode("\xF4\x8F\xBF\xBF", {0x10FFFF});
+}
+
+BOOST_AUTO_TEST_CASE( truncated_sequences )
+{
+	// the lead byte is replaced, the continuation bytes which are there follow one by one
+	check_decode("\xC3", {R});
+	check_decode("\xE2\x82", {R, R});
+	check_decode("\xF0\x9F\x98", {R, R, R});
+
+	// the next character is not swallowed
+	check_decode("\xE2\x82" "a", {R, R, 'a'});
+	check_decode("\xF0\x9F\xC3\xA4", {R, R, 0xE4});
+}
+
+BOOST_AUTO_TEST_CASE( overlong_sequences )
+{
+	check_decode("\xC0\xAF", {R, R});
+	check_decode("\xC1\xBF", {R, R});
+	check_decode("\xE0\x80\xAF", {R, R, R});
+	check_decode("\xE0\x9F\xBF", {R, R, R});
+	check_decode("\xF0\x80\x80\xAF", {R, R, R, R});
+	check_decode("\xF0\x8F\xBF\xBF", {R, R, R, R});
+}
+
+BOOST_AUTO_TEST_CASE( invalid_sequences )
+{
+	// surrogates
+	check_decode("\xED\xA0\x80", {R, R, R});
+	check_decode("\xED\xBF\xBF", {R, R, R});
+	// beyond unicode
+	check_decode("\xF4\x90\x80\x80", {R, R, R, R});
+	// bytes which can't start a character
+	check_decode("\x80", {R});
+	check_decode("\xBF" "a", {R, 'a'});
+	check_decode("\xF8\x88\x80\x80\x80", {R, R, R, R, R});
+	check_decode("\xFE\xFF", {R, R});
+}
+
+BOOST_AUTO_TEST_CASE( iterator_advance )
+{
+	std::string text = "\xE2\x82\xAC\xE2\x82" "a";
+	auto iter = text.cbegin();
+
+	BOOST_CHECK_EQUAL( nextCodepoint(iter, text.cend()), 0x20AC );
+	BOOST_CHECK( iter == text.cbegin() + 3 );
+	// an invalid sequence is skipped one byte at a time
+	BOOST_CHECK_EQUAL( nextCodepoint(iter, text.cend()), R );
+	BOOST_CHECK( iter == text.cbegin() + 4 );
+	BOOST_CHECK_EQUAL( nextCodepoint(iter, text.cend()), R );
+	BOOST_CHECK_EQUAL( nextCodepoint(iter, text.cend()), 'a' );
+	BOOST_CHECK( iter == text.cend() );
+}
+
+BOOST_AUTO_TEST_SUITE_END()